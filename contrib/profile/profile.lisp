@@ -10,7 +10,9 @@
 (eval-when (:compile-toplevel :load-toplevel)
   (defpackage "PROFILE"
     (:nicknames "PROF")
-    (:export "PROFILE" "REPORT" "RESET" "UNPROFILE" "UNPROFILE-ALL"))
+    (:export "PROFILE" "REPORT" "RESET" "UNPROFILE" "UNPROFILE-ALL"
+	     "START-SAMPLING" "STOP-SAMPLING" "WITH-SAMPLING" "SAMPLING-REPORT"
+	     "WRITE-FOLDED-STACKS"))
 )
 
 (in-package "PROFILE")
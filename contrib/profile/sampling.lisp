@@ -0,0 +1,176 @@
+;;;;  -*- Mode: Lisp; Syntax: Common-Lisp; Package: PROFILE -*-
+;;;;
+;;;;  This program is free software; you can redistribute it and/or
+;;;;  modify it under the terms of the GNU Lesser General Public
+;;;;  License as published by the Free Software Foundation; either
+;;;;  version 3 of the License, or (at your option) any later version.
+;;;;
+;;;;  See file '../../Copyright' for full details.
+
+;;;; Statistical CPU profiler.
+;;;;
+;;;; Unlike PROFILE, nothing gets wrapped: SIGPROF interrupts whichever
+;;;; thread is running at regular intervals of CPU time and the runtime
+;;;; records its invocation history along with the C function it was in
+;;;; (see mk_si_start_cpu_profiling() in unixint.c).  Interpreted
+;;;; functions always appear in the history, compiled ones when compiled
+;;;; with (DEBUG 2) or more.
+;;;;
+;;;;   (with-sampling (:interval 5 :report :graph) (do-the-work))
+;;;;   (write-folded-stacks "work.folded")  ; for flamegraph.pl
+;;;;
+
+(in-package "PROFILE")
+
+(defvar *samples* nil
+  "Samples of the last sampling run, each one a list
+(thread c-function-name . function-names), innermost function first.")
+
+(defvar *dropped-samples* 0
+  "Number of samples of the last run that did not fit in the buffer.")
+
+(defvar *sampling-interval* 10
+  "Sampling interval of the last run, in milliseconds of CPU time.")
+
+(defun start-sampling (&key (interval 10) (max-samples 100000))
+  "Starts sampling the running threads every INTERVAL milliseconds of CPU
+time, keeping at most about MAX-SAMPLES samples."
+  (setq *sampling-interval* interval)
+  (si::start-cpu-profiling (max 1 (round (* interval 1000))) max-samples))
+
+(defun stop-sampling ()
+  "Stops sampling and keeps the samples for the reports.  Returns the number
+of samples taken."
+  (multiple-value-bind (samples dropped)
+      (si::stop-cpu-profiling)
+    (setq *samples* samples
+	  *dropped-samples* dropped)
+    (length samples)))
+
+(defmacro with-sampling ((&key (interval 10) (max-samples 100000) (report :flat))
+			 &body body)
+  "Runs BODY while sampling, then reports as SAMPLING-REPORT does for type
+REPORT, unless REPORT is NIL."
+  `(progn
+     (start-sampling :interval ,interval :max-samples ,max-samples)
+     (unwind-protect
+	  (progn ,@body)
+       (stop-sampling)
+       ,@(when report `((sampling-report :type ,report))))))
+
+(defun sample-frames (sample)
+  ;; The stack of SAMPLE, innermost first, topped by its C function if known.
+  (destructuring-bind (thread c-name &rest names) sample
+    (declare (ignore thread))
+    (if c-name (cons c-name names) names)))
+
+(defun frame-label (frame)
+  (if (stringp frame)
+      frame
+      (let ((*package* (find-package "KEYWORD")))
+	(prin1-to-string frame))))
+
+(defun percent (count total)
+  (if (zerop total) 0.0 (/ (* 100.0 count) total)))
+
+(defun count-frames (samples)
+  ;; Returns two EQUAL hash tables from frame to number of samples, where it
+  ;; is innermost (self) and where it is anywhere (cumulative).
+  (let ((self (make-hash-table :test #'equal))
+	(cumulative (make-hash-table :test #'equal)))
+    (dolist (sample samples)
+      (let ((frames (sample-frames sample)))
+	(when frames
+	  (incf (gethash (first frames) self 0)))
+	(loop for (frame . outer) on frames
+	      unless (member frame outer :test #'equal) ; once for recursive calls.
+		do (incf (gethash frame cumulative 0)))))
+    (values self cumulative)))
+
+(defun print-flat-profile (samples stream max)
+  (multiple-value-bind (self cumulative)
+      (count-frames samples)
+    (let ((total (length samples))
+	  (rows ()))
+      (maphash #'(lambda (frame count)
+		   (push (list frame (gethash frame self 0) count) rows))
+	       cumulative)
+      (setq rows (sort rows #'> :key #'second))
+      (format stream "~&~7@A ~7@A ~8@A ~8@A  ~A~%" "self%" "cumul%" "self" "cumul" "name")
+      (loop for (frame self-count cumulative-count) in rows
+	    repeat max
+	    do (format stream "~7,2F ~7,2F ~8D ~8D  ~A~%"
+		       (percent self-count total) (percent cumulative-count total)
+		       self-count cumulative-count (frame-label frame))))))
+
+(defun print-graph-profile (samples stream max)
+  ;; One entry per function, by decreasing cumulative count, between its
+  ;; callers above and its callees below, as gprof does.
+  (multiple-value-bind (self cumulative)
+      (count-frames samples)
+    (let ((callers (make-hash-table :test #'equal))
+	  (callees (make-hash-table :test #'equal))
+	  (total (length samples))
+	  (entries ()))
+      (flet ((note-arc (table from to)
+	       (let ((arcs (or (gethash from table)
+			       (setf (gethash from table) (make-hash-table :test #'equal)))))
+		 (incf (gethash to arcs 0))))
+	     (sorted-arcs (table frame)
+	       (let ((arcs ()))
+		 (when (gethash frame table)
+		   (maphash #'(lambda (other count) (push (cons other count) arcs))
+			    (gethash frame table)))
+		 (sort arcs #'> :key #'cdr))))
+	(dolist (sample samples)
+	  (loop for (callee caller) on (sample-frames sample)
+		while caller
+		do (note-arc callers callee caller)
+		   (note-arc callees caller callee)))
+	(maphash #'(lambda (frame count) (push (cons frame count) entries)) cumulative)
+	(setq entries (sort entries #'> :key #'cdr))
+	(loop for (frame . count) in entries
+	      for index from 1 to max
+	      do (loop for (caller . n) in (sorted-arcs callers frame)
+		       do (format stream "~24@T~8D  ~A~%" n (frame-label caller)))
+		 (format stream "[~D]~8T~7,2F% ~7D ~7D  ~A~%"
+			 index (percent count total) (gethash frame self 0) count
+			 (frame-label frame))
+		 (loop for (callee . n) in (sorted-arcs callees frame)
+		       do (format stream "~24@T~8D  ~A~%" n (frame-label callee)))
+		 (format stream "~&~60,,,'-A~%" ""))))))
+
+(defun sampling-report (&key (type :flat) (stream *trace-output*) (max 40))
+  "Reports on the samples of the last run.  TYPE :FLAT lists the MAX
+functions found the most often innermost, with the share of samples where
+they are innermost (self) and where they are anywhere (cumul).  TYPE :GRAPH
+also shows, for each of them, which functions called it and which ones it
+called, with the number of samples of each arc."
+  (format stream "~&~D samples at ~A ms~[~:;, ~:*~D dropped~].~%"
+	  (length *samples*) *sampling-interval* *dropped-samples*)
+  (ecase type
+    (:flat (print-flat-profile *samples* stream max))
+    (:graph (print-graph-profile *samples* stream max)))
+  (values))
+
+(defun folded-label (frame)
+  ;; Frames are separated by semicolons and counts by a space.
+  (substitute-if #\_ #'(lambda (c) (member c '(#\; #\Space #\Tab #\Newline)))
+		 (frame-label frame)))
+
+(defun write-folded-stacks (pathname &key (threads t))
+  "Writes the samples of the last run to PATHNAME as folded stacks, one line
+per distinct stack, outermost first, followed by its number of samples.
+This is the input format of flamegraph.pl.  When THREADS is true, the name
+of the thread comes first on each stack."
+  (let ((stacks (make-hash-table :test #'equal)))
+    (dolist (sample *samples*)
+      (let ((stack (mapcar #'folded-label (reverse (sample-frames sample)))))
+	(when threads
+	  (push (folded-label (or (mt:thread-name (first sample)) "thread")) stack))
+	(incf (gethash stack stacks 0))))
+    (with-open-file (out pathname :direction :output :if-exists :supersede)
+      (maphash #'(lambda (stack count)
+		   (format out "~{~A~^;~} ~D~%" stack count))
+	       stacks))
+    pathname))
@@ -7,6 +7,11 @@
 ;; retrieved from the sockets module using the socket-file-descriptor
 ;; slot.
 ;;
+;; On Linux the event loop is built on epoll(7) instead: the interest
+;; set lives in the kernel and is updated as handlers come and go, so a
+;; pass costs time in the number of ready descriptors only and there is
+;; no FD_SETSIZE limit.  Timers are then available through timerfd.
+;;
 ;; As this file is based on SBCL's serve-event module it is being
 ;; released under the same (non) license as SBCL (i.e. public-domain).
 ;;
@@ -37,10 +42,19 @@
 (defpackage "SERVE-EVENT"
   (:use "CL" "FFI" "UFFI")
   (:export "WITH-FD-HANDLER" "ADD-FD-HANDLER" "REMOVE-FD-HANDLER"
+           "ADD-TIMER-HANDLER" "REMOVE-TIMER-HANDLER"
            "SERVE-EVENT" "SERVE-ALL-EVENTS"))
 (in-package "SERVE-EVENT")
 
-#+unix
+#+linux
+(clines
+ "#include <errno.h>"
+ "#include <time.h>"
+ "#include <unistd.h>"
+ "#include <sys/epoll.h>"
+ "#include <sys/timerfd.h>"
+ )
+#+(and unix (not linux))
 (clines
  "#include <errno.h>"
  "#include <sys/select.h>"
@@ -63,6 +77,19 @@
 (define-c-constants
     +eintr+ "EINTR")
 
+#+linux
+(define-c-constants
+    +eperm+ "EPERM"
+    +enoent+ "ENOENT"
+    +epollin+ "EPOLLIN"
+    +epollout+ "EPOLLOUT"
+    +epollerr+ "EPOLLERR"
+    +epollhup+ "EPOLLHUP")
+
+#+linux
+(defconstant +max-events+ 256
+  "How many ready descriptors a single epoll_wait() may report.")
+
 (defstruct (handler
             (:constructor make-handler (direction descriptor function))
             (:copier nil))
@@ -72,13 +99,25 @@
   ;; FIXME: Should be based on FD_SETSIZE
   (descriptor 0)
   ;; Function to call.
-  (function nil :type function))
+  (function nil :type function)
+  ;; True for the handler of a timerfd, which owns its descriptor.
+  (timer nil))
 
 
+#-linux
 (defvar *descriptor-handlers* nil
   ;;#!+sb-doc
   "List of all the currently active handlers for file descriptors")
 
+#+linux
+(defvar *descriptor-handlers* (make-hash-table)
+  "Table of the currently active handlers, keyed by file descriptor.")
+
+#+linux
+(defvar *ready-descriptors* nil
+  "Descriptors that epoll refuses, such as regular files. Like select(2)
+  does, they are taken to be always ready.")
+
 
 ;;; Add a new handler to *descriptor-handlers*.
 (defun add-fd-handler (fd direction function)
@@ -89,15 +128,25 @@
     ;; FIXME: should be TYPE-ERROR?
     (error "Invalid direction ~S, must be either :INPUT or :OUTPUT" direction))
   (let ((handler (make-handler direction fd function)))
+    #-linux
     (push handler *descriptor-handlers*)
+    #+linux
+    (let ((handlers (gethash fd *descriptor-handlers*)))
+      (update-interest fd handlers (cons handler handlers)))
     handler))
 
 ;;; Remove an old handler from *descriptor-handlers*.
 (defun remove-fd-handler (handler)
   ;;#!+sb-doc
   "Removes HANDLER from the list of active handlers."
+  #-linux
   (setf *descriptor-handlers*
-        (delete handler *descriptor-handlers*)))
+        (delete handler *descriptor-handlers*))
+  #+linux
+  (let* ((fd (handler-descriptor handler))
+         (handlers (gethash fd *descriptor-handlers*)))
+    (when (member handler handlers)
+      (update-interest fd handlers (remove handler handlers)))))
 
 ;;; Add the handler to *descriptor-handlers* for the duration of BODY.
 (defmacro with-fd-handler ((fd direction function) &rest body)
@@ -114,28 +163,33 @@
            (remove-fd-handler ,handler))))))
 
 
+#-linux
 (defmacro fd-zero(fdset)
   `(c-inline (,fdset) (:object) :void 
              "FD_ZERO((fd_set*)#0->foreign.data)"
              :one-liner t
              :side-effects t))
 
+#-linux
 (defmacro fd-set (fd fdset)
   `(c-inline (,fd ,fdset) (:int :object) :void 
              "FD_SET(#0, (fd_set*)#1->foreign.data);"
              :one-liner t
              :side-effects t))
 
+#-linux
 (defmacro fd-isset (fd fdset)
   `(c-inline (,fd ,fdset) (:int :object) :int 
              "FD_ISSET(#0, (fd_set*)#1->foreign.data)"
              :one-liner t
              :side-effects t))
 
+#-linux
 (defun fdset-size ()
   (c-inline () () :int "sizeof(fd_set)" :one-liner t :side-effects nil))
 
 
+#-linux
 (defun serve-event (&optional (seconds nil))
   "Receive pending events on all FD-STREAMS and dispatch to the appropriate
    handler functions. If timeout is specified, server will wait the specified
@@ -204,6 +258,223 @@
 		 t)))))))
 
 
+#+linux
+(defvar *epoll-descriptor* nil
+  "The epoll instance holding the interest set of *descriptor-handlers*.")
+
+#+linux
+(defvar *epoll-pid* nil
+  "Process that created *epoll-descriptor*.")
+
+#+linux
+(defvar *epoll-events* nil
+  "Foreign buffer where epoll_wait() reports ready descriptors.")
+
+#+linux
+(defun interest-mask (handlers)
+  (let ((mask 0))
+    (dolist (handler handlers mask)
+      (setf mask (logior mask (ecase (handler-direction handler)
+                                (:input +epollin+)
+                                (:output +epollout+)))))))
+
+#+linux
+(defun epoll-ctl (epfd op fd mask)
+  (c-inline (epfd op fd mask) (:int :int :int :int) (values :int :int)
+            "{ struct epoll_event ev;
+               ev.events = #3;
+               ev.data.u64 = 0;
+               ev.data.fd = #2;
+               @(return 0) = epoll_ctl(#0, #1, #2, &ev);
+               @(return 1) = errno; }"
+            :one-liner nil
+            :side-effects t))
+
+;;; Bring the kernel's interest in FD from OLD-MASK to NEW-MASK.
+#+linux
+(defun register-interest (epfd fd old-mask new-mask)
+  (cond ((= old-mask new-mask))
+        ((zerop new-mask)
+         ;; Closing the descriptor may already have taken it out of the set.
+         (epoll-ctl epfd (c-constant "EPOLL_CTL_DEL") fd 0)
+         (setf *ready-descriptors* (remove fd *ready-descriptors*)))
+        (t
+         (multiple-value-bind (retval errno)
+             (epoll-ctl epfd (if (zerop old-mask)
+                                 (c-constant "EPOLL_CTL_ADD")
+                                 (c-constant "EPOLL_CTL_MOD"))
+                        fd new-mask)
+           (when (and (minusp retval) (= errno +enoent+))
+             ;; Closed and opened again under the same number since it was added.
+             (multiple-value-setq (retval errno)
+               (epoll-ctl epfd (c-constant "EPOLL_CTL_ADD") fd new-mask)))
+           (cond ((not (minusp retval)))
+                 ((= errno +eperm+)
+                  (pushnew fd *ready-descriptors*))
+                 (t
+                  (error "Error during epoll_ctl on descriptor ~D: ~A"
+                         fd (si:errno-string))))))))
+
+;;; The epoll instance of this process, created as needed.  One inherited
+;;; through mkcl:fork is shared with the parent and must not be touched.
+#+linux
+(defun epoll-descriptor ()
+  (let ((pid (mkcl:getpid)))
+    (unless (eql pid *epoll-pid*)
+      (when *epoll-descriptor*
+        (c-inline (*epoll-descriptor*) (:int) :void "close(#0)" :one-liner t :side-effects t))
+      (let ((epfd (c-inline () () :int "epoll_create1(EPOLL_CLOEXEC)" :one-liner t :side-effects t)))
+        (when (minusp epfd)
+          (error "Error during epoll_create1: ~A" (si:errno-string)))
+        (setf *epoll-descriptor* epfd
+              *epoll-pid* pid
+              *ready-descriptors* nil)
+        (maphash #'(lambda (fd handlers)
+                     (register-interest epfd fd 0 (interest-mask handlers)))
+                 *descriptor-handlers*)))
+    *epoll-descriptor*))
+
+#+linux
+(defun update-interest (fd old-handlers new-handlers)
+  (register-interest (epoll-descriptor) fd
+                     (interest-mask old-handlers) (interest-mask new-handlers))
+  (if new-handlers
+      (setf (gethash fd *descriptor-handlers*) new-handlers)
+      (remhash fd *descriptor-handlers*)))
+
+#+linux
+(defun epoll-events ()
+  (or *epoll-events*
+      (setf *epoll-events*
+            (allocate-foreign-object
+             `(:array :unsigned-char
+                      ,(* +max-events+
+                          (c-inline () () :int "sizeof(struct epoll_event)"
+                                    :one-liner t :side-effects nil)))))))
+
+#+linux
+(defun dispatch-events (fd mask)
+  (dolist (handler (gethash fd *descriptor-handlers*))
+    (when (logtest mask (logior +epollerr+ +epollhup+
+                                (ecase (handler-direction handler)
+                                  (:input +epollin+)
+                                  (:output +epollout+))))
+      (funcall (handler-function handler) fd))))
+
+#+linux
+(defun serve-event (&optional (seconds nil))
+  "Receive pending events on all FD-STREAMS and dispatch to the appropriate
+   handler functions. If timeout is specified, server will wait the specified
+   time (in seconds) and then return, otherwise it will wait until something
+   happens. Server returns T if something happened and NIL otherwise. Timeout
+   0 means polling without waiting."
+  (let ((epfd (epoll-descriptor))
+        (events (epoll-events))
+        (timeout (cond (*ready-descriptors* 0)
+                       ((null seconds) -1)
+                       ;; In milliseconds, as an int.
+                       (t (min (max (ceiling (* seconds 1000)) 0) #x7fffffff)))))
+    (multiple-value-bind (retval errno)
+        (c-inline (epfd events +max-events+ timeout)
+                  (:int :object :int :int) (values :int :int)
+                  "{ @(return 0) = epoll_wait(#0, (struct epoll_event *)#1->foreign.data, #2, #3);
+                     @(return 1) = errno; }"
+                  :one-liner nil
+                  :side-effects t)
+      (cond ((minusp retval)
+             (if (= errno +eintr+)
+                 ;; suppress EINTR
+                 nil
+                 ;; otherwise error
+                 (error "Error during epoll_wait")))
+            (t
+             (dotimes (i retval)
+               (multiple-value-bind (fd mask)
+                   (c-inline (events i) (:object :int) (values :int :int)
+                             "{ struct epoll_event *ev = ((struct epoll_event *)#0->foreign.data) + #1;
+                                @(return 0) = ev->data.fd;
+                                @(return 1) = ev->events; }"
+                             :one-liner nil
+                             :side-effects nil)
+                 (dispatch-events fd mask)))
+             (dolist (fd *ready-descriptors*)
+               (dispatch-events fd (logior +epollin+ +epollout+)))
+             (or (plusp retval)
+                 (not (null *ready-descriptors*))))))))
+
+
+(defun add-timer-handler (seconds function &optional interval)
+  "Arrange to call FUNCTION, with no argument, once SECONDS have elapsed and
+  then every INTERVAL seconds if INTERVAL is given. The value returned should
+  be passed to REMOVE-TIMER-HANDLER when it is no longer needed, unless
+  INTERVAL is NIL: such a timer removes itself once it has run."
+  (check-type seconds (real 0))
+  (check-type interval (or null (real 0)))
+  #-linux
+  (progn function
+         (error "Timer handlers need timerfd, which is only available on Linux."))
+  #+linux
+  (let ((fd (c-inline ((float seconds 1d0) (float (or interval 0) 1d0))
+                      (:double :double) :int
+                      "{ int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+                         if (fd >= 0) {
+                           struct itimerspec its;
+
+                           its.it_value.tv_sec = (time_t) #0;
+                           its.it_value.tv_nsec = (long) ((#0 - its.it_value.tv_sec) * 1e9);
+                           if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+                             its.it_value.tv_nsec = 1; /* zero would disarm it. */
+                           its.it_interval.tv_sec = (time_t) #1;
+                           its.it_interval.tv_nsec = (long) ((#1 - its.it_interval.tv_sec) * 1e9);
+                           if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+                             int saved_errno = errno;
+
+                             close(fd);
+                             fd = -1;
+                             errno = saved_errno;
+                           }
+                         }
+                         @(return) = fd; }"
+                      :one-liner nil
+                      :side-effects t))
+        (handler nil))
+    (when (minusp fd)
+      (error "Error during timerfd_create: ~A" (si:errno-string)))
+    (setf handler
+          (make-handler :input fd
+                        #'(lambda (fd)
+                            ;; Read the expiration count, or it stays ready.
+                            (when (plusp (c-inline (fd) (:int) :int
+                                                   "{ uint64_t expirations;
+                                                      @(return) = (read(#0, &expirations, sizeof(expirations))
+                                                                   == sizeof(expirations)); }"
+                                                   :one-liner nil
+                                                   :side-effects t))
+                              (unless interval
+                                (remove-timer-handler handler))
+                              (funcall function))))
+          (handler-timer handler) t)
+    (let ((done nil))
+      (unwind-protect
+           (progn
+             (update-interest fd nil (list handler))
+             (setf done t))
+        (unless done
+          (c-inline (fd) (:int) :void "close(#0)" :one-liner t :side-effects t))))
+    handler))
+
+(defun remove-timer-handler (handler)
+  "Removes timer HANDLER and releases its timer. Does nothing if it was
+  already removed."
+  (when (handler-timer handler)
+    (setf (handler-timer handler) nil)
+    (remove-fd-handler handler)
+    #+linux
+    (c-inline ((handler-descriptor handler)) (:int) :void "close(#0)"
+              :one-liner t :side-effects t)))
+
+
 ;;; Wait for up to timeout seconds for an event to happen. Make sure all
 ;;; pending events are processed before returning.
 (defun serve-all-events (&optional (timeout nil))
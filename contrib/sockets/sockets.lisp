@@ -1419,10 +1419,11 @@ also known as unix-domain sockets."))
 
 (defmethod socket-make-stream ((socket socket)  &rest args
 			       &key (element-type 'character) (buffering :full) (external-format :default))
-  (declare (ignore args buffering))
-  ;; Trying to fit a buffering scheme designed for block devices onto a network device is utter nonsense.
-  ;; We simply ignore the whole thing.  If you really need control over socket "buffering" use
-  ;; the standard socket option SO_SNDBUF and/or SO_RCVBUF below.
+  (declare (ignore args))
+  ;; BUFFERING is :FULL, :LINE or :NONE.  A buffered socket stream receives whatever
+  ;; has arrived in one call and holds output until it fills its buffer, is forced,
+  ;; or the stream waits on input.  The kernel's own buffers are sized through
+  ;; the standard socket options SO_SNDBUF and/or SO_RCVBUF below.
   (let ((stream (and (slot-boundp socket 'stream)
 		     (slot-value socket 'stream))))
     (unless stream
@@ -1431,6 +1432,7 @@ also known as unix-domain sockets."))
 					  :element-type element-type
 					  :external-format external-format
 					  :name "SOCKET-IO-STREAM")))
+      (si:set-buffering-mode stream buffering)
       (setf (slot-value socket 'stream) stream)
       )
     stream))
@@ -883,11 +883,36 @@ ST_FUNC int mkcc_open(MKCCState *s1, const char *filename)
 }
 
 /* compile the C file opened in 'file'. Return non zero if errors. */
+/* the part of mkcc_compile() that mkcc_error() may leave */
+static int mkcc_compile_unit(MKCCState *s1, int section_sym)
+{
+    s1->nb_errors = 0;
+
+    ch = file->buf_ptr[0];
+    tok_flags = TOK_FLAG_BOL | TOK_FLAG_BOF;
+    parse_flags = PARSE_FLAG_PREPROCESS | PARSE_FLAG_TOK_NUM | PARSE_FLAG_TOK_STR;
+    next();
+    decl(VT_CONST);
+    if (tok != TOK_EOF)
+        expect("declaration");
+    /* static inline functions are emitted last, errors in them included */
+    gen_inline_functions();
+    check_vstack();
+
+    /* end of translation unit info */
+    if (s1->do_debug) {
+        put_stabs_r(NULL, N_SO, 0, 0,
+                    text_section->data_offset, text_section, section_sym);
+    }
+    return 0;
+}
+
 static int mkcc_compile(MKCCState *s1)
 {
     Sym *define_start;
     char buf[512];
     volatile int section_sym;
+    int ret;
 
 #ifdef INC_DEBUG
     printf("%s: **** new file\n", file->filename);
@@ -955,38 +980,20 @@ static int mkcc_compile(MKCCState *s1)
     define_start = define_stack;
     nocode_wanted = 1;
 
-    if (setjmp(s1->error_jmp_buf) == 0) {
-        s1->nb_errors = 0;
-        s1->error_set_jmp_enabled = 1;
-
-        ch = file->buf_ptr[0];
-        tok_flags = TOK_FLAG_BOL | TOK_FLAG_BOF;
-        parse_flags = PARSE_FLAG_PREPROCESS | PARSE_FLAG_TOK_NUM | PARSE_FLAG_TOK_STR;
-        next();
-        decl(VT_CONST);
-        if (tok != TOK_EOF)
-            expect("declaration");
-        check_vstack();
-
-        /* end of translation unit info */
-        if (s1->do_debug) {
-            put_stabs_r(NULL, N_SO, 0, 0,
-                        text_section->data_offset, text_section, section_sym);
-        }
-    }
-
-    s1->error_set_jmp_enabled = 0;
+    MKCC_WITH_ERROR_JMP(s1, ret, mkcc_compile_unit(s1, section_sym));
 
     /* reset define stack, but leave -Dsymbols (may be incorrect if
        they are undefined) */
     free_defines(define_start);
 
-    gen_inline_functions();
+    /* an error may have left macros, an inline function's body among them */
+    end_all_macros();
+    free_inline_functions();
 
     sym_pop(&global_stack, NULL);
     sym_pop(&local_stack, NULL);
 
-    return s1->nb_errors != 0 ? -1 : 0;
+    return (ret != 0 || s1->nb_errors != 0) ? -1 : 0;
 }
 
 LIBMKCCAPI int mkcc_compile_string(MKCCState *s, const char *str)
@@ -1446,10 +1453,13 @@ the_end:
 
 LIBMKCCAPI int mkcc_add_file(MKCCState *s, const char *filename, int filetype)
 {
+    int ret;
+
     if (s->output_type == MKCC_OUTPUT_PREPROCESS)
-        return mkcc_add_file_internal(s, filename, AFF_PRINT_ERROR | AFF_PREPROCESS, filetype);
+        MKCC_WITH_ERROR_JMP(s, ret, mkcc_add_file_internal(s, filename, AFF_PRINT_ERROR | AFF_PREPROCESS, filetype));
     else
-        return mkcc_add_file_internal(s, filename, AFF_PRINT_ERROR, filetype);
+        MKCC_WITH_ERROR_JMP(s, ret, mkcc_add_file_internal(s, filename, AFF_PRINT_ERROR, filetype));
+    return ret;
 }
 
 LIBMKCCAPI int mkcc_add_library_path(MKCCState *s, const char *pathname)
@@ -1629,7 +1639,7 @@ ST_FUNC void mkcc_normalize_inc_dirs(MKCCState *s)
     mkcc_free(stats);
 }
 
-LIBMKCCAPI int mkcc_set_output_type(MKCCState *s, int output_type)
+static int set_output_type(MKCCState *s, int output_type)
 {
     s->output_type = output_type;
 
@@ -1707,6 +1717,14 @@ LIBMKCCAPI int mkcc_set_output_type(MKCCState *s, int output_type)
     return 0;
 }
 
+LIBMKCCAPI int mkcc_set_output_type(MKCCState *s, int output_type)
+{
+    int ret;
+
+    MKCC_WITH_ERROR_JMP(s, ret, set_output_type(s, output_type));
+    return ret;
+}
+
 LIBMKCCAPI void mkcc_set_lib_path(MKCCState *s, const char *path)
 {
     mkcc_free(s->mkcc_lib_path);
@@ -2458,7 +2476,7 @@ LIBMKCCAPI int mkcc_set_options(MKCCState *s, const char *str)
         pstrncpy(arg, s1, len);
         dynarray_add((void ***)&argv, &argc, arg);
     }
-    ret = mkcc_parse_args(s, argc, argv);
+    MKCC_WITH_ERROR_JMP(s, ret, mkcc_parse_args(s, argc, argv));
     dynarray_reset(&argv, &argc);
     return ret;
 }
@@ -1204,6 +1204,21 @@ PUB_FUNC void mkcc_error_noabort(const char *fmt, ...);
 PUB_FUNC NORETURN void mkcc_error(const char *fmt, ...);
 PUB_FUNC void mkcc_warning(const char *fmt, ...);
 
+/* Evaluates CALL with mkcc_error() making RET -1 instead of exiting,
+   as an entry point of the library must. Nests. */
+#define MKCC_WITH_ERROR_JMP(s1, ret, call) do {                             \
+        jmp_buf saved_jmp_buf;                                              \
+        int saved_jmp_enabled = (s1)->error_set_jmp_enabled;                \
+        memcpy(saved_jmp_buf, (s1)->error_jmp_buf, sizeof saved_jmp_buf);   \
+        if (setjmp((s1)->error_jmp_buf) == 0) {                             \
+            (s1)->error_set_jmp_enabled = 1;                                \
+            (ret) = (call);                                                 \
+        } else                                                              \
+            (ret) = -1;                                                     \
+        memcpy((s1)->error_jmp_buf, saved_jmp_buf, sizeof saved_jmp_buf);   \
+        (s1)->error_set_jmp_enabled = saved_jmp_enabled;                    \
+    } while (0)
+
 /* other utilities */
 ST_FUNC void dynarray_add(void ***ptab, int *nb_ptr, void *data);
 ST_FUNC void dynarray_reset(void *pp, int *n);
@@ -1291,6 +1306,7 @@ ST_FUNC TokenSym *tok_alloc(const char *str, int len);
 ST_FUNC const char *get_tok_str(int v, CValue *cv);
 ST_FUNC void begin_macro(TokenString *str, int alloc);
 ST_FUNC void end_macro(void);
+ST_FUNC void end_all_macros(void);
 ST_FUNC void save_parse_state(ParseState *s);
 ST_FUNC void restore_parse_state(ParseState *s);
 ST_INLN void tok_str_new(TokenString *s);
@@ -1398,6 +1414,7 @@ ST_FUNC void expr_sum(void);
 ST_FUNC void gexpr(void);
 ST_FUNC int expr_const(void);
 ST_FUNC void gen_inline_functions(void);
+ST_FUNC void free_inline_functions(void);
 ST_FUNC void decl(int l);
 #if defined CONFIG_MKCC_BCHECK || defined MKCC_TARGET_C67
 ST_FUNC Sym *get_sym_ref(CType *type, Section *sec, unsigned long offset, unsigned long size);
@@ -6264,7 +6264,14 @@ ST_FUNC void gen_inline_functions(void)
             break;
     }
     file->line_num = ln;
-    /* free tokens of unused inline functions */
+}
+
+/* free tokens of unused inline functions, after an error too */
+ST_FUNC void free_inline_functions(void)
+{
+    struct InlineFunc *fn;
+    int i;
+
     for (i = 0; i < mkcc_state->nb_inline_fns; ++i) {
         fn = mkcc_state->inline_fns[i];
         if (fn->sym)
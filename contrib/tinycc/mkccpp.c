@@ -132,6 +132,14 @@ ST_FUNC void end_macro(void)
     }
 }
 
+/* cleanup from error/setjmp */
+ST_FUNC void end_all_macros(void)
+{
+    while (macro_stack)
+        end_macro();
+    macro_ptr = NULL;
+}
+
 ST_FUNC char *trimfront(char *p)
 {
     while (*p && (unsigned char)*p <= ' ')
@@ -3505,9 +3513,7 @@ ST_FUNC void preprocess_delete(void)
     free_defines(NULL);
 
     /* cleanup from error/setjmp */
-    while (macro_stack)
-        end_macro();
-    macro_ptr = NULL;
+    end_all_macros();
 
     /* free tokens */
     n = tok_ident - TOK_IDENT;
@@ -47,7 +47,7 @@ static void win64_add_function_table(MKCCState *s1);
 /* Do all relocations (needed before using mkcc_get_symbol())
    Returns -1 on error. */
 
-LIBMKCCAPI int mkcc_relocate(MKCCState *s1, void *ptr)
+static int relocate(MKCCState *s1, void *ptr)
 {
     int ret;
 
@@ -88,6 +88,14 @@ LIBMKCCAPI int mkcc_relocate(MKCCState *s1, void *ptr)
     return ret;
 }
 
+LIBMKCCAPI int mkcc_relocate(MKCCState *s1, void *ptr)
+{
+    int ret;
+
+    MKCC_WITH_ERROR_JMP(s1, ret, relocate(s1, ptr));
+    return ret;
+}
+
 /* launch the compiled program with the given arguments */
 LIBMKCCAPI int mkcc_run(MKCCState *s1, int argc, char **argv)
 {
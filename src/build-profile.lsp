@@ -24,7 +24,8 @@
 ;;; * PROFILE
 ;;;
 (build-module "profile"
-              '("../contrib/profile/profile.lisp")
+              '("../contrib/profile/profile.lisp"
+                "../contrib/profile/sampling.lisp")
               :destdir "./ext/" #|:prefix "EXT"|#
 	      )
 
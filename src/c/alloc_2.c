@@ -18,6 +18,7 @@
 #include <mkcl/mkcl.h>
 #include <mkcl/internal.h>
 #include <mkcl/mkcl-gc.h>
+#include <mkcl/gc/gc_tiny_fl.h> /* for MK_GC_GRANULE_BYTES */
 #include <mkcl/mkcl-inl.h>
 
 #if MKCL_UNIX
@@ -26,6 +27,7 @@
 
 #include <stdlib.h> /* for access to native malloc */
 #include <stdio.h> /* mainly to support debug messages. */
+#include <string.h> /* for memset() */
 
 
 
@@ -178,10 +180,18 @@ static void grow_memory(MKCL)
   mkcl_set_interrupt_status(env, &old_intr);
 }
 
+/* Allocation sampling, off while alloc_sampling_interval is 0. */
+static volatile mkcl_index alloc_sampling_interval = 0;
+static void sample_allocation(MKCL, mkcl_index size);
+
+#define SAMPLE_ALLOCATION(env, size)					\
+  if (mkcl_unlikely(alloc_sampling_interval)) sample_allocation(env, size)
+
 static inline void * MKCL_GC_MALLOC(MKCL, mkcl_index size)
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_MALLOC(size));
 
   if (mkcl_likely(new != NULL))
@@ -201,6 +211,7 @@ static inline void * MKCL_GC_MALLOC_ATOMIC(MKCL, mkcl_index size)
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_MALLOC_ATOMIC(size));
 
   if (mkcl_likely(new != NULL))
@@ -220,6 +231,7 @@ static inline void * MKCL_GC_MALLOC_UNCOLLECTABLE(MKCL, mkcl_index size)
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_MALLOC_UNCOLLECTABLE(size));
 
   if (mkcl_likely(new != NULL))
@@ -239,6 +251,7 @@ static inline void * MKCL_GC_MALLOC_IGNORE_OFF_PAGE(MKCL, mkcl_index size)
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_MALLOC_IGNORE_OFF_PAGE(size));
 
   if (mkcl_likely(new != NULL))
@@ -258,6 +271,7 @@ static inline void * MKCL_GC_MALLOC_ATOMIC_IGNORE_OFF_PAGE(MKCL, mkcl_index size
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_MALLOC_ATOMIC_IGNORE_OFF_PAGE(size));
 
   if (mkcl_likely(new != NULL))
@@ -279,6 +293,7 @@ static inline void * MKCL_GC_MEMALIGN(MKCL, mkcl_index alignment, mkcl_index siz
 {
   void * new;
 
+  SAMPLE_ALLOCATION(env, size);
   MKCL_GC_NO_INTR(env, new = MK_GC_memalign(alignment, size));
 
   if (mkcl_likely(new != NULL))
@@ -294,6 +309,96 @@ static inline void * MKCL_GC_MEMALIGN(MKCL, mkcl_index alignment, mkcl_index siz
     }
 }
 
+/*
+ * Per-thread allocation buffers.
+ *
+ * Small objects of one to MKCL_ALLOC_BUFFER_GRANULES granules are handed out
+ * from a per-thread stock refilled a GC block at a time by MK_GC_malloc_many().
+ * The stock is an array rather than the free list itself: the buffers are
+ * scanned as part of the env, so nothing in stock can be reclaimed, and no
+ * link word is left behind in the objects we give away.  A stocked object
+ * is always of the traced kind, even for floats whose payload is raw bits.
+ * The cost of that is a slightly more conservative scan, never a missed one,
+ * unlike the untraced kind, whose chain is invisible to a collection started
+ * by another thread before we get to unthread it.
+ */
+
+#define MKCL_ALLOC_BUFFER_GRANULES 4
+#define MKCL_ALLOC_BUFFER_SIZE 256 /* objects of a 4K block, at 16 bytes each */
+
+struct mkcl_alloc_buffer
+{
+  mkcl_index count;
+  void * objects[MKCL_ALLOC_BUFFER_SIZE];
+};
+
+struct mkcl_alloc_buffers
+{
+  struct mkcl_alloc_buffer small[MKCL_ALLOC_BUFFER_GRANULES];
+
+  /* Allocation sampling state of this thread. */
+  mkcl_word sample_countdown;
+  mkcl_index sample_generation;
+  unsigned int sample_seed;
+  bool sampling;
+};
+
+static struct mkcl_alloc_buffers * mkcl_alloc_alloc_buffers(MKCL)
+{
+  struct mkcl_alloc_buffers * buffers = ((env == NULL) 
+					 ? _mkcl_boot_alloc_unprotected(sizeof(struct mkcl_alloc_buffers))
+					 : mkcl_alloc(env, sizeof(struct mkcl_alloc_buffers)));
+
+  if (buffers)
+    memset(buffers, 0, sizeof(struct mkcl_alloc_buffers));
+  return buffers;
+}
+
+static void * refill_alloc_buffer(MKCL, struct mkcl_alloc_buffer * buffer, mkcl_index granules)
+{
+  void * list;
+  void * next;
+  void * new;
+
+  MKCL_GC_NO_INTR(env, list = MK_GC_malloc_many(granules * MK_GC_GRANULE_BYTES));
+  if (list == NULL)
+    return NULL;
+
+  new = list;
+  list = MK_GC_NEXT(new);
+  MK_GC_NEXT(new) = NULL;
+  for (; list != NULL && buffer->count < MKCL_ALLOC_BUFFER_SIZE; list = next)
+    {
+      next = MK_GC_NEXT(list);
+      MK_GC_NEXT(list) = NULL;
+      buffer->objects[buffer->count++] = list;
+    }
+  return new; /* Any rest of the list is just garbage from now on. */
+}
+
+static inline void * mkcl_alloc_small(MKCL, mkcl_index size)
+{ /* Same as MKCL_GC_MALLOC(). */
+  struct mkcl_alloc_buffers * const buffers = env->alloc_buffers;
+  const mkcl_index granules = (size + MK_GC_GRANULE_BYTES - 1) / MK_GC_GRANULE_BYTES;
+  void * new = NULL;
+
+  if (mkcl_likely(buffers != NULL && granules <= MKCL_ALLOC_BUFFER_GRANULES))
+    {
+      struct mkcl_alloc_buffer * const buffer = &buffers->small[granules - 1];
+
+      SAMPLE_ALLOCATION(env, size);
+      MKCL_REALLY_NO_INTR(env, {
+	  if (mkcl_likely(buffer->count))
+	    new = buffer->objects[--buffer->count];
+	  else
+	    new = refill_alloc_buffer(env, buffer, granules);
+	});
+      if (mkcl_likely(new != NULL))
+	return new;
+    }
+  return MKCL_GC_MALLOC(env, size);
+}
+
 void * mkcl_alloc_pages(MKCL, mkcl_index nb_pages)
 {
   long pagesize = mkcl_core.pagesize;
@@ -351,7 +456,7 @@ mkcl_object mkcl_alloc_cdisplay(MKCL, mkcl_index nb_levels)
   mkcl_object cd;
 
   COLLECT_STATS(env, cdisplay);
-  cd = MKCL_GC_MALLOC(env, sizeof(struct mkcl_cdisplay) + nb_levels * sizeof(mkcl_object));
+  cd = mkcl_alloc_small(env, sizeof(struct mkcl_cdisplay) + nb_levels * sizeof(mkcl_object));
   cd->display.t = mkcl_t_cdisplay;
   cd->display.nb_levels = nb_levels;
   return cd;
@@ -362,7 +467,7 @@ mkcl_object mkcl_alloc_clevel_block(MKCL, mkcl_object producer, const union mkcl
   mkcl_object cb;
 
   COLLECT_STATS(env, clevel_block);
-  cb = MKCL_GC_MALLOC(env, sizeof(struct mkcl_clevel_block) + nb_vars * sizeof(mkcl_object));
+  cb = mkcl_alloc_small(env, sizeof(struct mkcl_clevel_block) + nb_vars * sizeof(mkcl_object));
   cb->lblock.t = mkcl_t_clevel_block;
   cb->lblock.producer = producer;
   cb->lblock.outer = (mkcl_object) outer;
@@ -397,7 +502,7 @@ mkcl_cons(MKCL, mkcl_object a, mkcl_object d)
   struct mkcl_cons *obj;
   
   COLLECT_STATS(env, cons);
-  obj = MKCL_GC_MALLOC(env, sizeof(struct mkcl_cons));
+  obj = mkcl_alloc_small(env, sizeof(struct mkcl_cons));
   obj->t = mkcl_t_cons;
   obj->car = a;
   obj->cdr = d;
@@ -410,7 +515,7 @@ mkcl_list1(MKCL, mkcl_object a)
   struct mkcl_cons *obj;
 
   COLLECT_STATS(env, cons);
-  obj = MKCL_GC_MALLOC(env, sizeof(struct mkcl_cons));
+  obj = mkcl_alloc_small(env, sizeof(struct mkcl_cons));
   obj->t = mkcl_t_cons;
   obj->car = a;
   obj->cdr = mk_cl_Cnil;
@@ -602,7 +707,7 @@ mkcl_alloc_raw_singlefloat(MKCL)
   mkcl_object s;
 
   COLLECT_STATS(env, singlefloat);
-  s = MKCL_GC_MALLOC_ATOMIC(env, sizeof(struct mkcl_singlefloat));
+  s = mkcl_alloc_small(env, sizeof(struct mkcl_singlefloat));
   s->SF.t = mkcl_t_singlefloat;
   return s;
 }
@@ -613,7 +718,7 @@ mkcl_alloc_raw_doublefloat(MKCL)
   mkcl_object s;
 
   COLLECT_STATS(env, doublefloat);
-  s = MKCL_GC_MALLOC_ATOMIC(env, sizeof(struct mkcl_doublefloat));
+  s = mkcl_alloc_small(env, sizeof(struct mkcl_doublefloat));
   s->DF.t = mkcl_t_doublefloat;
   return s;
 }
@@ -953,6 +1058,7 @@ const mkcl_env _mkcl_alloc_raw_env(MKCL)
 #else
       new_env->alloc = NULL;
 #endif  
+      new_env->alloc_buffers = mkcl_alloc_alloc_buffers(env);
     }
   return new_env;
 }
@@ -1259,6 +1365,22 @@ standard_finalizer(MKCL, mkcl_object o)
 #endif
       }
       break;
+    case mkcl_t_hashtable:
+      if (o->hash.sync)
+	{
+	  int i;
+
+	  say_what_final("synchronized hash-table");
+	  for (i = 0; i < MKCL_HASHTABLE_STRIPES; i++)
+#if MKCL_WINDOWS
+	    DeleteCriticalSection(&(o->hash.sync->stripe[i]));
+#elif MKCL_PTHREADS
+	    MKCL_LIBC_NO_INTR(env, pthread_mutex_destroy(&(o->hash.sync->stripe[i])));  /* FIXME! return status? JCB */
+#else
+# error Incomplete standard_finalizer().
+#endif
+	}
+      break;
     case mkcl_t_codeblock:
       say_what_final("codeblock");
       mkcl_library_close(env, o);
@@ -1652,6 +1774,116 @@ mkcl_object mkcl_unpin(MKCL, mkcl_object pin)
 #endif
 
 
+/*
+ * Allocation sampling.
+ *
+ * While on, each thread records the Lisp backtrace of the allocation that
+ * crosses its next sampling point, then draws the next one at a random
+ * distance averaging alloc_sampling_interval bytes.  A sample stands for
+ * that many bytes allocated from the same place.  Samples from all threads
+ * go onto a single list, to be aggregated on demand.
+ */
+
+#define MKCL_ALLOC_SAMPLE_DEPTH 32
+
+static volatile mkcl_index alloc_sampling_generation = 0;
+
+static mkcl_word next_sample_distance(struct mkcl_alloc_buffers * buffers, mkcl_index interval)
+{
+  unsigned int x = buffers->sample_seed;
+
+  if (x == 0) x = (unsigned int) (mkcl_index) buffers | 1;
+  x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+  buffers->sample_seed = x;
+  return interval / 2 + (x % interval);
+}
+
+static void sample_allocation(MKCL, mkcl_index size)
+{
+  struct mkcl_alloc_buffers * const buffers = env->alloc_buffers;
+  const mkcl_index interval = alloc_sampling_interval;
+  const mkcl_index generation = alloc_sampling_generation;
+
+  if (buffers == NULL || buffers->sampling || interval == 0)
+    return;
+  if (buffers->sample_generation != generation)
+    { /* Sampling was (re)started since this thread last looked. */
+      buffers->sample_generation = generation;
+      buffers->sample_countdown = next_sample_distance(buffers, interval);
+    }
+  if ((buffers->sample_countdown -= size) > 0)
+    return;
+
+  buffers->sampling = TRUE; /* The sample itself allocates. */
+  {
+    mkcl_object sample = mkcl_cons(env, mkcl_ihs_backtrace(env, MKCL_ALLOC_SAMPLE_DEPTH),
+				   MKCL_MAKE_FIXNUM(interval));
+    mkcl_object cell = mkcl_list1(env, sample);
+    mkcl_object old = __atomic_load_n(&mkcl_core.alloc_samples, __ATOMIC_RELAXED);
+
+    do
+      MKCL_RPLACD(cell, old);
+    while (!__atomic_compare_exchange_n(&mkcl_core.alloc_samples, &old, cell, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+  buffers->sample_countdown = next_sample_distance(buffers, interval);
+  buffers->sampling = FALSE;
+}
+
+mkcl_object mk_si_start_allocation_sampling(MKCL, mkcl_object interval)
+{
+  mkcl_index bytes;
+
+  mkcl_call_stack_check(env);
+  bytes = mkcl_fixnum_in_range(env, MK_SI_start_allocation_sampling, "sampling interval",
+			       interval, 1, MKCL_MOST_POSITIVE_FIXNUM);
+  __atomic_store_n(&mkcl_core.alloc_samples, mk_cl_Cnil, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&alloc_sampling_generation, 1, __ATOMIC_ACQ_REL);
+  alloc_sampling_interval = bytes;
+  mkcl_return_value(mk_cl_Ct);
+}
+
+mkcl_object mk_si_stop_allocation_sampling(MKCL)
+{
+  mkcl_call_stack_check(env);
+  alloc_sampling_interval = 0;
+  return mk_si_allocation_samples(env);
+}
+
+mkcl_object mk_si_allocation_samples(MKCL)
+{ /* A vector of (bytes count . backtrace), one per distinct backtrace,
+     largest first. */
+  mkcl_object samples = __atomic_load_n(&mkcl_core.alloc_samples, __ATOMIC_ACQUIRE);
+  mkcl_object table, entries = mk_cl_Cnil, profile;
+  mkcl_index nb_entries = 0, i;
+
+  mkcl_call_stack_check(env);
+  table = mk_cl__make_hash_table(env, MK_CL_equal, MKCL_MAKE_FIXNUM(1024), /* size */
+				 mkcl_make_singlefloat(env, 1.5f), /* rehash-size */
+				 mkcl_make_singlefloat(env, 0.75f)); /* rehash-threshold */
+  for (; !mkcl_Null(samples); samples = MKCL_CONS_CDR(samples))
+    {
+      mkcl_object sample = MKCL_CONS_CAR(samples);
+      mkcl_object entry = mkcl_gethash_safe(env, MKCL_CONS_CAR(sample), table, mk_cl_Cnil);
+
+      if (mkcl_Null(entry))
+	{
+	  entry = mkcl_cons(env, MKCL_MAKE_FIXNUM(0), mkcl_cons(env, MKCL_MAKE_FIXNUM(0), MKCL_CONS_CAR(sample)));
+	  mkcl_sethash(env, MKCL_CONS_CAR(sample), table, entry);
+	  entries = mkcl_cons(env, entry, entries);
+	  nb_entries++;
+	}
+      MKCL_RPLACA(entry, MKCL_MAKE_FIXNUM(mkcl_fixnum_to_word(MKCL_CONS_CAR(entry))
+					  + mkcl_fixnum_to_word(MKCL_CONS_CDR(sample))));
+      MKCL_RPLACA(MKCL_CONS_CDR(entry), MKCL_MAKE_FIXNUM(mkcl_fixnum_to_word(MKCL_CONS_CAR(MKCL_CONS_CDR(entry))) + 1));
+    }
+
+  profile = mkcl_alloc_simple_vector(env, nb_entries, mkcl_aet_object);
+  for (i = 0; i < nb_entries; i++, entries = MKCL_CONS_CDR(entries))
+    profile->vector.self.t[i] = MKCL_CONS_CAR(entries);
+  return mk_si_sort_vector(env, profile, MKCL_SYM_FUN(MK_CL_G), MKCL_SYM_FUN(MK_CL_car), mk_cl_Cnil);
+}
+
+
 mkcl_object mk_si_sample_allocation_statistics(MKCL)
 {
   mkcl_object stats = mk_cl_Cnil;
@@ -66,12 +66,13 @@
 
 typedef struct mkcl_compiler_env *mk_cl_compiler_ptr;
 
-#define asm_begin(env) current_pc(env)
 #define current_pc(env) MKCL_TEMP_STACK_INDEX(env)
 #define set_pc(env,n) asm_clear(env,n)
 #define asm_ref(env,n) (mkcl_word)((env)->temp_stack[n])
+static mkcl_index asm_begin(MKCL);
 static void asm_clear(MKCL, mkcl_index h);
 static void asm_op(MKCL, mkcl_word op);
+static void asm_opcode(MKCL, int op);
 static void asm_op2(MKCL, int op, int arg);
 static mkcl_object asm_end(MKCL, mkcl_index handle, mkcl_object definition);
 static mkcl_index asm_jmp(MKCL, register int op);
@@ -125,6 +126,8 @@ static int c_car(MKCL, mkcl_object args, int push);
 static int c_cdr(MKCL, mkcl_object args, int push);
 static int c_list(MKCL, mkcl_object args, int push);
 static int c_listA(MKCL, mkcl_object args, int push);
+static int c_slot_value(MKCL, mkcl_object args, int push);
+static int c_slot_boundp(MKCL, mkcl_object args, int push);
 
 static mkcl_object mkcl_make_lambda(MKCL, mkcl_object name, mkcl_object lambda);
 
@@ -173,6 +176,8 @@ asm_end(MKCL, mkcl_index beginning, mkcl_object definition) {
 	bytecode->bytecode.definition = definition;
 	bytecode->bytecode.code_size = code_size;
 	bytecode->bytecode.data_size = data_size;
+	bytecode->bytecode.native = mk_cl_Cnil;
+	bytecode->bytecode.calls = -1;
 #if 0
 	bytecode->bytecode.code = mkcl_alloc_atomic(env, code_size * sizeof(mkcl_opcode));
 #else
@@ -221,16 +226,79 @@ asm_op(MKCL, mkcl_word code) {
         MKCL_TEMP_STACK_PUSH(env,v);
 }
 
+static mkcl_index
+asm_begin(MKCL) {
+	env->c_env->last_op_pc = -1;
+	return current_pc(env);
+}
+
 static void
 asm_clear(MKCL, mkcl_index h) {
         MKCL_TEMP_STACK_SET_INDEX(env, h);
+	env->c_env->last_op_pc = -1;
+}
+
+/*
+ * Superinstructions. When the second instruction of one of these
+ * pairs is emitted right after the first one, the opcode of the first
+ * instruction is replaced by the combined one. The second instruction
+ * is kept as it is, so that code size, operands and jump targets do
+ * not change: the interpreter just skips the dispatch to it. An
+ * instruction that was already the second half of a pair is not
+ * combined again. The pairs are the most frequent ones found when
+ * counting dispatches over typical interpreted code.
+ */
+static const struct {
+	short first, size, second, fused;
+} superinstructions[] = {
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_CAR, OP_VAR_CAR},
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_CDR, OP_VAR_CDR},
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_NOT, OP_VAR_NOT},
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_JNIL, OP_VAR_JNIL},
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_JT, OP_VAR_JT},
+	{OP_VAR, OPCODE_SIZE + OPARG_SIZE, OP_CALLG1, OP_VAR_CALLG1},
+	{OP_PUSHV, OPCODE_SIZE + OPARG_SIZE, OP_VAR, OP_PUSHV_VAR},
+	{OP_PUSHV, OPCODE_SIZE + OPARG_SIZE, OP_PUSHV, OP_PUSHV_PUSHV},
+	{OP_PUSH, OPCODE_SIZE, OP_CALLG, OP_PUSH_CALLG},
+	{OP_POPREQ, OPCODE_SIZE, OP_BIND, OP_POPREQ_BIND},
+	{OP_NOT, OPCODE_SIZE, OP_JNIL, OP_NOT_JNIL}
+};
+
+#define SUPERINSTRUCTIONS_SIZE (sizeof(superinstructions)/sizeof(superinstructions[0]))
+
+static void
+asm_opcode(MKCL, int code) {
+        const mk_cl_compiler_ptr c_env = env->c_env;
+	mkcl_word pc = current_pc(env);
+	mkcl_word last = c_env->last_op_pc;
+	int i;
+
+	c_env->last_op_pc = pc;
+#ifdef MKCL_DISPATCH_STATS
+	/* Lets a dispatch count be taken without superinstructions. */
+	if (mkcl_Null(mkcl_symbol_value(env, MK_SI_DYNVAR_bytecode_superinstructions)))
+		last = -1;
+#endif
+	if (last >= 0) {
+		for (i = 0; i < SUPERINSTRUCTIONS_SIZE; i++) {
+			if (superinstructions[i].second == code &&
+			    last + superinstructions[i].size == pc &&
+			    asm_ref(env, last) == superinstructions[i].first) {
+				env->temp_stack[last] =
+					(mkcl_object)(mkcl_word)superinstructions[i].fused;
+				c_env->last_op_pc = -1;
+				break;
+			}
+		}
+	}
+	asm_op(env, code);
 }
 
 static void
 asm_op2(MKCL, int code, int n) {
 	if (n < -MAX_OPARG || MAX_OPARG < n)
 	  mkcl_FEprogram_error(env, "Argument to bytecode is too large", 0);
-	asm_op(env, code);
+	asm_opcode(env, code);
 	asm_arg(env, n);
 }
 
@@ -244,7 +312,7 @@ asm_constant(MKCL, mkcl_object c)
 static mkcl_index
 asm_jmp(MKCL, int op) {
 	mkcl_index output;
-	asm_op(env, op);
+	asm_opcode(env, op);
 	output = current_pc(env);
 	asm_arg(env, 0);
 	return output;
@@ -333,7 +401,9 @@ static compiler_record const database[] = {
   {MK_CL_rest, c_cdr, 0},
   {MK_CL_list, c_list, 0},
   {MK_CL_listX, c_listA, 0},
-  {MK_CL_endp, c_endp, 0}
+  {MK_CL_endp, c_endp, 0},
+  {MK_CL_slot_value, c_slot_value, 0},
+  {MK_CL_slot_boundp, c_slot_boundp, 0}
 };
 
 /* ----------------- LEXICAL ENVIRONMENT HANDLING -------------------- */
@@ -376,6 +446,13 @@ asm_op2c(MKCL, int code, mkcl_object o) {
 	asm_op2(env, code, c_register_constant(env, o));
 }
 
+/* Allocates the inline cache of an OP_CALLG call site. It is a fresh
+   cons, so that it is never coalesced with other constants. */
+static void
+asm_call_cache(MKCL) {
+	asm_arg(env, c_register_constant(env, mkcl_cons(env, mk_cl_Cnil, mk_cl_Cnil)));
+}
+
 /*
  * Note: the following should match the definitions in cmp/cmpenv.lsp, as
  * well as CMP-ENV-REGISTER-MACROLET (lsp/defmacro.lsp)
@@ -538,10 +615,12 @@ c_new_env(mkcl_env the_env, mkcl_compiler_env_ptr new, mkcl_object env,
 	the_env->c_env = new;
 	new->stepping = 0;
 	new->coalesce = TRUE;
+	new->last_op_pc = -1;
 	new->lexical_level = 0;
 	new->constants = mk_cl_Cnil;
 	new->env_depth = 0;
 	new->env_size = 0;
+	new->lambdas = mk_cl_Cnil;
 	if (old) {
 		if (!mkcl_Null(env))
 			mkcl_lose(the_env, "c_new_env with both ENV and OLD");
@@ -554,6 +633,7 @@ c_new_env(mkcl_env the_env, mkcl_compiler_env_ptr new, mkcl_object env,
 		new->coalesce = old->coalesce;
 		new->stepping = old->stepping;
                 new->mode = old->mode;
+		new->lambdas = old->lambdas;
 	} else {
 		new->variables = MKCL_CAR(env);
 		new->macros = MKCL_CDR(env);
@@ -572,6 +652,26 @@ c_new_env(mkcl_env the_env, mkcl_compiler_env_ptr new, mkcl_object env,
 	}
 }
 
+/*
+ * Notes that the lexical binding found in the record at the head of
+ * PLACE, a tail of c_env->variables, is used by the enclosing LAMBDAs
+ * which have been opened since that binding was made.
+ */
+static void
+c_note_capture(MKCL, mkcl_object place)
+{
+	mkcl_object l;
+	for (l = env->c_env->lambdas; MKCL_CONSP(l); l = MKCL_CONS_CDR(l)) {
+		mkcl_object lambda = MKCL_CONS_CAR(l);
+		mkcl_object v = MKCL_CONS_CAR(lambda);
+		while (MKCL_CONSP(v) && v != place)
+			v = MKCL_CONS_CDR(v);
+		if (v != place)
+			break;
+		MKCL_RPLACD(lambda, mk_cl_Ct);
+	}
+}
+
 static mkcl_object
 c_tag_ref(MKCL, mkcl_object the_tag, mkcl_object the_type)
 {
@@ -589,6 +689,7 @@ c_tag_ref(MKCL, mkcl_object the_tag, mkcl_object the_type)
 			if (type == the_type) {
 			  mkcl_object label = mkcl_assql(env, the_tag, name);
 				if (!mkcl_Null(label)) {
+				  c_note_capture(env, l);
 				  return MKCL_CONS(env, MKCL_MAKE_FIXNUM(n), MKCL_CONS_CDR(label));
 				}
 			}
@@ -599,6 +700,7 @@ c_tag_ref(MKCL, mkcl_object the_tag, mkcl_object the_type)
 				/* Mark as used */
                                 record = MKCL_CONS_CDR(record);
 				MKCL_RPLACA(record, mk_cl_Ct);
+				c_note_capture(env, l);
 				return MKCL_MAKE_FIXNUM(n);
 			}
 			n++;
@@ -640,6 +742,7 @@ c_var_ref(MKCL, mkcl_object var, int allow_symbol_macro, bool ensure_defined)
 			mkcl_FEprogram_error(env, "Internal error: symbol macro ~S used as variable",
 					1, var);
 		} else if (mkcl_Null(special)) {
+			c_note_capture(env, l);
 			return n;
 		} else {
 			return MKCL_SPECIAL_VAR_REF;
@@ -927,6 +1030,7 @@ c_call(MKCL, mkcl_object args, int flags) {
 	{
 		asm_op2(env, OP_CALLG, nargs);
 		asm_c(env, name);
+		asm_call_cache(env);
 		flags = FLAG_VALUES;
 	} else {
 		/* Fixme!! We can optimize the case of global functions! */
@@ -1187,7 +1291,7 @@ c_while_until(MKCL, mkcl_object body, int flags, bool is_while) {
 	/* Compile test */
 	asm_complete(env, OP_JMP, labelt);
 	compile_form(env, test, FLAG_REG0);
-	asm_op(env, is_while? OP_JT : OP_JNIL);
+	asm_opcode(env, is_while? OP_JT : OP_JNIL);
 	asm_arg(env, labelb - current_pc(env));
 
 	return flags;
@@ -1739,7 +1843,7 @@ c_not(MKCL, mkcl_object args, int flags) {
 	if (flags & FLAG_USEFUL) {
 		/* The value is useful */
 	  compile_form(env, pop(env, &args), FLAG_REG0);
-		asm_op(env, OP_NOT);
+		asm_opcode(env, OP_NOT);
 	} else {
 		/* The value may be ignored. */
 	  flags = compile_form(env, pop(env, &args), flags);
@@ -2228,7 +2332,7 @@ compile_form(MKCL, mkcl_object stmt, int flags)
   */
   if (push) {
     if (new_flags & (FLAG_REG0 | FLAG_VALUES))
-      asm_op(env, OP_PUSH);
+      asm_opcode(env, OP_PUSH);
   } else if (flags & FLAG_VALUES) {
     if (new_flags & FLAG_REG0) {
       asm_op(env, OP_VALUEREG0);
@@ -2330,7 +2434,7 @@ c_car(MKCL, mkcl_object args, int flags)
 	  mkcl_FEprogram_error(env, "CAR: Too many arguments", 0);
 	}
 	compile_form(env, list, FLAG_REG0);
-	asm_op(env, OP_CAR);
+	asm_opcode(env, OP_CAR);
 	return FLAG_REG0;
 }
 
@@ -2342,7 +2446,7 @@ c_cdr(MKCL, mkcl_object args, int flags)
 	  mkcl_FEprogram_error(env, "CDR: Too many arguments", 0);
 	}
 	compile_form(env, list, FLAG_REG0);
-	asm_op(env, OP_CDR);
+	asm_opcode(env, OP_CDR);
 	return FLAG_REG0;
 }
 
@@ -2375,6 +2479,37 @@ c_listA(MKCL, mkcl_object args, int flags)
 	return c_list_listA(env, args, flags, OP_LISTA);
 }
 
+/* A slot access with a constant slot name gets a slot location cache of
+   its own as an extra constant argument, see instance.c. */
+static int
+c_cached_slot_access(MKCL, mkcl_object function, mkcl_object cached_function, mkcl_object args, int flags)
+{
+  if (mkcl_length(env, args) == 2) {
+    mkcl_object object = mk_cl_first(env, args);
+    mkcl_object name = mk_cl_second(env, args);
+
+    if (MKCL_CONSP(name) && MKCL_CONS_CAR(name) == MK_CL_quote
+	&& MKCL_CONSP(MKCL_CONS_CDR(name)) && MKCL_SYMBOLP(MKCL_CADR(name))) {
+      mkcl_object cache = mk_cl_list(env, 2, MK_CL_quote, mk_si_make_slot_cache(env));
+
+      return c_call(env, mk_cl_list(env, 4, cached_function, object, name, cache), flags | FLAG_GLOBAL);
+    }
+  }
+  return c_call(env, mkcl_cons(env, function, args), flags | FLAG_GLOBAL);
+}
+
+static int
+c_slot_value(MKCL, mkcl_object args, int flags)
+{
+  return c_cached_slot_access(env, MK_CL_slot_value, MK_SI_cached_slot_value, args, flags);
+}
+
+static int
+c_slot_boundp(MKCL, mkcl_object args, int flags)
+{
+  return c_cached_slot_access(env, MK_CL_slot_boundp, MK_SI_cached_slot_boundp, args, flags);
+}
+
 
 /* ----------------------------- PUBLIC INTERFACE ---------------------------- */
 
@@ -2737,6 +2872,18 @@ c_default(MKCL, mkcl_object var, mkcl_object stmt, mkcl_object flag, mkcl_object
         c_pbind(env, var, specials);
 }
 
+static bool
+c_has_symbol_macros(MKCL, mkcl_object variables)
+{
+  for (; MKCL_CONSP(variables); variables = MKCL_CONS_CDR(variables)) {
+    mkcl_object record = MKCL_CONS_CAR(variables);
+    if (MKCL_CONSP(record) && MKCL_CONSP(MKCL_CONS_CDR(record))
+	&& MKCL_CONS_CAR(MKCL_CONS_CDR(record)) == MK_SI_symbol_macro)
+      return TRUE;
+  }
+  return FALSE;
+}
+
 static mkcl_object
 mkcl_make_lambda(MKCL, mkcl_object name, mkcl_object lambda)
 {
@@ -2751,6 +2898,8 @@ mkcl_make_lambda(MKCL, mkcl_object name, mkcl_object lambda)
 
   old_c_env = env->c_env;
   c_new_env(env, &new_c_env, mk_cl_Cnil, old_c_env);
+  new_c_env.lambdas = MKCL_CONS(env, MKCL_CONS(env, old_c_env->variables, mk_cl_Cnil),
+				old_c_env->lambdas);
 
   new_c_env.lexical_level++;
   new_c_env.coalesce = 0;
@@ -2791,7 +2940,7 @@ mkcl_make_lambda(MKCL, mkcl_object name, mkcl_object lambda)
 
   while (!mkcl_endp(env, reqs)) {
     mkcl_object var = pop(env, &reqs);
-    asm_op(env, OP_POPREQ);
+    asm_opcode(env, OP_POPREQ);
     c_bind(env, var, specials);
   }
   while (!mkcl_endp(env, opts)) {		/* Optional arguments */
@@ -2850,6 +2999,14 @@ mkcl_make_lambda(MKCL, mkcl_object name, mkcl_object lambda)
   output->bytecode.definition 
     = mkcl_Null(mkcl_symbol_value(env, MK_SI_DYNVAR_keep_definitions))
     ? mk_cl_Cnil : lambda;
+  /* A function that uses nothing from its lexical environment can be
+     compiled again from its definition alone, see the promotion tier in
+     interpreter.c. Local macros and symbol macros are not tracked, so
+     any of them around the function rule it out. */
+  if (!mkcl_Null(output->bytecode.definition)
+      && mkcl_Null(MKCL_CONS_CDR(MKCL_CONS_CAR(new_c_env.lambdas)))
+      && mkcl_Null(old_c_env->macros) && !c_has_symbol_macros(env, old_c_env->variables))
+    output->bytecode.calls = 0;
 
   env->c_env = old_c_env;
 
@@ -216,7 +216,15 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 
 	/* OP_VAR	n{arg}
 		Sets MKCL_NVALUES=1 and MKCL_VALUES(0) to the value of the n-th local.
-	*/
+		The superinstructions starting with a VAR are listed as a
+		plain VAR, since the instruction they absorb follows them.
+	*/
+	case OP_VAR_CAR:
+	case OP_VAR_CDR:
+	case OP_VAR_NOT:
+	case OP_VAR_JNIL:
+	case OP_VAR_JT:
+	case OP_VAR_CALLG1:
 	case OP_VAR:		string = "VAR\t";
 				GET_OPARG(n, vector);
 				goto OPARG;
@@ -232,6 +240,7 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 	/* OP_PUSH
 		Pushes the object in MKCL_VALUES(0).
 	*/
+	case OP_PUSH_CALLG:
 	case OP_PUSH:		string = "PUSH\tMKCL_VALUES(0)";
 				goto NOARG;
 
@@ -241,6 +250,8 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 	/* OP_PUSHV	n{arg}
 		Pushes the value of the n-th local onto the stack.
 	*/
+	case OP_PUSHV_VAR:
+	case OP_PUSHV_PUSHV:
 	case OP_PUSHV:		string = "PUSHV\t";
 				GET_OPARG(n, vector);
 				goto OPARG;
@@ -307,13 +318,15 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 				GET_OPARG(n, vector);
 				goto OPARG;
 
-	/* OP_CALLG	n{arg}, name{arg}
+	/* OP_CALLG	n{arg}, name{arg}, cache{arg}
 		Calls the function NAME with N arguments which have been
 		deposited in the stack. The output values are left in VALUES.
+		CACHE is the inline cache of the call site.
 	*/
 	case OP_CALLG:		string = "CALLG\t";
 				GET_OPARG(n, vector);
 				GET_DATA(o, vector, data);
+				GET_OPARG(m, vector);
 				goto OPARG_ARG;
 
 	/* OP_FCALL	n{arg}
@@ -336,6 +349,7 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 	/* OP_POPREQ
 		Extracts next required argument.
 	*/
+	case OP_POPREQ_BIND:
 	case OP_POPREQ:		string = "POP\tREQ";
 				goto NOARG;
 	/* OP_NOMORE
@@ -460,6 +474,7 @@ disassemble(MKCL, mkcl_object bytecode, mkcl_opcode *vector) {
 				n = vector + m - OPARG_SIZE - base;
 				goto OPARG_ARG;
 	}
+	case OP_NOT_JNIL:
 	case OP_NOT:		string = "NOT";
 				goto NOARG;
 
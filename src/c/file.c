@@ -37,6 +37,8 @@
 #if MKCL_UNIX
 # include <sys/socket.h>
 # include <sys/select.h>
+# include <sys/uio.h>
+# include <poll.h>
 typedef int SOCKET;
 # define INVALID_SOCKET ((SOCKET)(~0)) /* a Windowsism */
 # define SOCKET_ERROR (-1)
@@ -54,6 +56,12 @@ typedef int SOCKET;
 
 #include <sys/stat.h>
 
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 #if HAVE_FSEEKO
 # define mkcl_off_t off_t
 # define mkcl_fseeko fseeko
@@ -103,6 +111,12 @@ static mkcl_index encoding_error(MKCL, mkcl_object stream, unsigned char *buffer
 static mkcl_character decoding_error(MKCL, mkcl_object stream, unsigned char *buffer, int length);
 
 static void socket_error(MKCL, const char *err_msg, mkcl_object strm);
+static void socket_stream_flush_buffer(MKCL, mkcl_object strm);
+
+static mkcl_character eformat_write_char(MKCL, mkcl_object strm, mkcl_character c);
+static bool block_readable_stream_p(MKCL, mkcl_object strm);
+static mkcl_index read_vector_chars(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start, mkcl_index end);
+static mkcl_index write_vector_chars(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start, mkcl_index end);
 
 #if MKCL_WINDOWS
 static BOOL is_a_console(MKCL, HANDLE hnd);
@@ -580,7 +594,10 @@ generic_write_vector(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start,
   ops = stream_dispatch_table(env, strm);
 
   mkcl_type t = mkcl_type_of(data);
-  if (t == mkcl_t_base_string)
+  if ((t == mkcl_t_base_string || t == mkcl_t_string) && mkcl_type_of(strm) == mkcl_t_stream
+      && ops->write_char == eformat_write_char)
+    return write_vector_chars(env, strm, data, start, end);
+  else if (t == mkcl_t_base_string)
     {
       mkcl_character (*write_char)(MKCL, mkcl_object, mkcl_character) = ops->write_char;
       for (; start < end; start++)
@@ -624,7 +641,11 @@ generic_read_vector(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start,
   expected_type = mkcl_stream_element_type(env, strm);
   ops = stream_dispatch_table(env, strm);
   if (expected_type == MK_CL_base_char || expected_type == MK_CL_character) {
+    mkcl_type t = mkcl_type_of(data);
     mkcl_character (*read_char)(MKCL, mkcl_object) = ops->read_char;
+
+    if ((t == mkcl_t_base_string || t == mkcl_t_string) && block_readable_stream_p(env, strm))
+      return read_vector_chars(env, strm, data, start, end);
     for (; start < end; start++) {
       mkcl_character c = read_char(env, strm);
       if (c == EOF)
@@ -1338,6 +1359,594 @@ utf_8_encoder(MKCL, mkcl_object stream, unsigned char *buffer, mkcl_character c)
   return nbytes;
 }
 
+/********************************************************************************
+ * BLOCK DECODERS AND ENCODERS
+ *
+ * A block decoder turns a run of octets into a run of characters in a
+ * single call. It stops short of any incomplete, invalid or otherwise
+ * unusual octet sequence and leaves it to the regular per character
+ * decoder, which alone reports decoding errors. Block encoders follow
+ * the same rule for characters the external format cannot encode.
+ */
+
+typedef mkcl_index (*block_decoder)(const unsigned char *src, mkcl_index src_len,
+				    mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed);
+typedef mkcl_index (*block_encoder)(const mkcl_character *src, mkcl_index src_len,
+				    unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed);
+
+/* Length of the leading run of octets below 0x80 in src. */
+static inline mkcl_index
+ascii_run_length(const unsigned char *src, mkcl_index len)
+{
+  mkcl_index i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= len; i += 32) {
+    int mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(src + i)));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= len; i += 16) {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(src + i)));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < len; i++)
+    if (src[i] & 0x80) break;
+  return i;
+}
+
+static inline void
+widen_octets(mkcl_character *dst, const unsigned char *src, mkcl_index n)
+{
+  mkcl_index i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i))));
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i *)(dst + i + 12), _mm_unpackhi_epi16(hi, zero));
+  }
+#endif
+  for (; i < n; i++)
+    dst[i] = src[i];
+}
+
+/* Stores into dst the leading run of characters of src below limit
+ * (0x80 or 0x100) and returns its length.
+ */
+static inline mkcl_index
+narrow_characters(unsigned char *dst, const mkcl_character *src, mkcl_index n, mkcl_character limit)
+{
+  mkcl_index i = 0;
+
+#if defined(__SSE2__)
+  const __m128i high = _mm_set1_epi32(~(limit - 1));
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 4));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src + i + 8));
+    __m128i d = _mm_loadu_si128((const __m128i *)(src + i + 12));
+    __m128i any = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, zero)) != 0xFFFF)
+      break;
+    _mm_storeu_si128((__m128i *)(dst + i),
+		     _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+#endif
+  for (; i < n; i++) {
+    if (src[i] >= limit) break;
+    dst[i] = src[i];
+  }
+  return i;
+}
+
+static mkcl_index
+latin_1_block_decoder(const unsigned char *src, mkcl_index src_len,
+		      mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index n = (src_len < dst_len) ? src_len : dst_len;
+
+  widen_octets(dst, src, n);
+  *consumed = n;
+  return n;
+}
+
+static mkcl_index
+ascii_block_decoder(const unsigned char *src, mkcl_index src_len,
+		    mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index n = ascii_run_length(src, (src_len < dst_len) ? src_len : dst_len);
+
+  widen_octets(dst, src, n);
+  *consumed = n;
+  return n;
+}
+
+static mkcl_index
+utf_8_block_decoder(const unsigned char *src, mkcl_index src_len,
+		    mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index in = 0, out = 0;
+
+  while (in < src_len && out < dst_len) {
+    mkcl_index run = ascii_run_length(src + in, ((src_len - in) < (dst_len - out)) ? (src_len - in) : (dst_len - out));
+
+    widen_octets(dst + out, src + in, run);
+    in += run;
+    out += run;
+    if (in >= src_len || out >= dst_len)
+      break;
+    else {
+      /* Same validity rules as utf_8_decoder(). */
+      unsigned char c0 = src[in];
+      mkcl_character cum;
+
+      if ((c0 & 0xE0) == 0xC0) {
+	if ((in + 2) > src_len || (src[in+1] & 0xC0) != 0x80 || (c0 & 0x1F) == 0) break;
+	cum = ((c0 & 0x1F) << 6) | (src[in+1] & 0x3F);
+	in += 2;
+      } else if ((c0 & 0xF0) == 0xE0) {
+	if ((in + 3) > src_len || (src[in+1] & 0xC0) != 0x80 || (src[in+2] & 0xC0) != 0x80
+	    || ((c0 & 0x0F) == 0 && (src[in+1] & 0x20) == 0)) break;
+	cum = ((c0 & 0x0F) << 12) | ((src[in+1] & 0x3F) << 6) | (src[in+2] & 0x3F);
+	if ((cum >= 0xD800 && cum <= 0xDFFF) || cum >= 0xFFFE) break;
+	in += 3;
+      } else if ((c0 & 0xF8) == 0xF0) {
+	if ((in + 4) > src_len || (src[in+1] & 0xC0) != 0x80 || (src[in+2] & 0xC0) != 0x80
+	    || (src[in+3] & 0xC0) != 0x80 || ((c0 & 0x07) == 0 && (src[in+1] & 0x30) == 0)) break;
+	cum = ((c0 & 0x07) << 18) | ((src[in+1] & 0x3F) << 12) | ((src[in+2] & 0x3F) << 6) | (src[in+3] & 0x3F);
+	in += 4;
+      } else
+	break;
+      dst[out++] = cum;
+    }
+  }
+  *consumed = in;
+  return out;
+}
+
+static mkcl_index
+utf_16le_block_decoder(const unsigned char *src, mkcl_index src_len,
+		       mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index in = 0, out = 0;
+
+  for (; (in + 2) <= src_len && out < dst_len; out++) {
+    mkcl_character c = ((mkcl_character)src[in+1] << 8) | src[in];
+
+    if ((src[in+1] & 0xFC) == 0xD8) {
+      if ((in + 4) > src_len || (src[in+3] & 0xFC) != 0xDC) break;
+      c = ((c & 0x3FF) << 10) + ((((mkcl_character)src[in+3] << 8) | src[in+2]) & 0x3FF) + 0x10000;
+      in += 4;
+    } else
+      in += 2;
+    dst[out] = c;
+  }
+  *consumed = in;
+  return out;
+}
+
+static mkcl_index
+utf_16be_block_decoder(const unsigned char *src, mkcl_index src_len,
+		       mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index in = 0, out = 0;
+
+  for (; (in + 2) <= src_len && out < dst_len; out++) {
+    mkcl_character c = ((mkcl_character)src[in] << 8) | src[in+1];
+
+    if ((src[in] & 0xFC) == 0xD8) {
+      if ((in + 4) > src_len || (src[in+2] & 0xFC) != 0xDC) break;
+      c = ((c & 0x3FF) << 10) + ((((mkcl_character)src[in+2] << 8) | src[in+3]) & 0x3FF) + 0x10000;
+      in += 4;
+    } else
+      in += 2;
+    dst[out] = c;
+  }
+  *consumed = in;
+  return out;
+}
+
+static mkcl_index
+utf_32le_block_decoder(const unsigned char *src, mkcl_index src_len,
+		       mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index out = 0;
+
+  for (; (4 * out + 4) <= src_len && out < dst_len; out++, src += 4)
+    dst[out] = src[0] | (src[1]<<8) | (src[2]<<16) | ((mkcl_character)src[3]<<24);
+  *consumed = 4 * out;
+  return out;
+}
+
+static mkcl_index
+utf_32be_block_decoder(const unsigned char *src, mkcl_index src_len,
+		       mkcl_character *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index out = 0;
+
+  for (; (4 * out + 4) <= src_len && out < dst_len; out++, src += 4)
+    dst[out] = src[3] | (src[2]<<8) | (src[1]<<16) | ((mkcl_character)src[0]<<24);
+  *consumed = 4 * out;
+  return out;
+}
+
+static mkcl_index
+latin_1_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		      unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index n = narrow_characters(dst, src, (src_len < dst_len) ? src_len : dst_len, 0x100);
+
+  *consumed = n;
+  return n;
+}
+
+static mkcl_index
+ascii_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		    unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index n = narrow_characters(dst, src, (src_len < dst_len) ? src_len : dst_len, 0x80);
+
+  *consumed = n;
+  return n;
+}
+
+static mkcl_index
+utf_8_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		    unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  mkcl_index in = 0, out = 0;
+
+  while (in < src_len && out < dst_len) {
+    mkcl_index run = narrow_characters(dst + out, src + in,
+				       ((src_len - in) < (dst_len - out)) ? (src_len - in) : (dst_len - out), 0x80);
+    mkcl_character c;
+
+    in += run;
+    out += run;
+    if (in >= src_len || (out + 4) > dst_len)
+      break;
+    c = src[in];
+    if (c <= 0x7FF) {
+      dst[out+1] = (c & 0x3f) | 0x80;
+      dst[out] = (c >> 6) | 0xC0;
+      out += 2;
+    } else if (c <= 0xD7FF || (c > 0xDFFF && c < 0xFFFE)) {
+      dst[out+2] = (c & 0x3f) | 0x80;
+      dst[out+1] = ((c >> 6) & 0x3f) | 0x80;
+      dst[out] = (c >> 12) | 0xE0;
+      out += 3;
+    } else if (c > 0xFFFF && c <= 0x10FFFF) {
+      dst[out+3] = (c & 0x3f) | 0x80;
+      dst[out+2] = ((c >> 6) & 0x3f) | 0x80;
+      dst[out+1] = ((c >> 12) & 0x3f) | 0x80;
+      dst[out] = (c >> 18) | 0xF0;
+      out += 4;
+    } else
+      break;
+    in++;
+  }
+  *consumed = in;
+  return out;
+}
+
+static mkcl_index
+utf_16_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		     unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed, bool little_endian)
+{
+  mkcl_index in = 0, out = 0;
+  const int lo = little_endian ? 0 : 1;
+  const int hi = little_endian ? 1 : 0;
+
+  for (; in < src_len && (out + 4) <= dst_len; in++) {
+    mkcl_character c = src[in];
+
+    if (c < 0x10000) {
+      dst[out+lo] = c;
+      dst[out+hi] = c >> 8;
+      out += 2;
+    } else if (c <= 0x10FFFF) {
+      unsigned short high_surrogate, low_surrogate;
+
+      c -= 0x10000;
+      high_surrogate = ((c >> 10) & 0x3FF) | 0xD800;
+      low_surrogate = (c & 0x3FF) | 0xDC00;
+      dst[out+lo] = high_surrogate;
+      dst[out+hi] = high_surrogate >> 8;
+      dst[out+2+lo] = low_surrogate;
+      dst[out+2+hi] = low_surrogate >> 8;
+      out += 4;
+    } else
+      break;
+  }
+  *consumed = in;
+  return out;
+}
+
+static mkcl_index
+utf_16le_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		       unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  return utf_16_block_encoder(src, src_len, dst, dst_len, consumed, TRUE);
+}
+
+static mkcl_index
+utf_16be_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		       unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  return utf_16_block_encoder(src, src_len, dst, dst_len, consumed, FALSE);
+}
+
+static mkcl_index
+utf_32_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		     unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed, bool little_endian)
+{
+  mkcl_index in = 0;
+
+  for (; in < src_len && (4 * in + 4) <= dst_len && src[in] <= 0x10FFFF; in++, dst += 4) {
+    mkcl_character c = src[in];
+
+    if (little_endian) {
+      dst[0] = c; dst[1] = c >> 8; dst[2] = c >> 16; dst[3] = c >> 24;
+    } else {
+      dst[3] = c; dst[2] = c >> 8; dst[1] = c >> 16; dst[0] = c >> 24;
+    }
+  }
+  *consumed = in;
+  return 4 * in;
+}
+
+static mkcl_index
+utf_32le_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		       unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  return utf_32_block_encoder(src, src_len, dst, dst_len, consumed, TRUE);
+}
+
+static mkcl_index
+utf_32be_block_encoder(const mkcl_character *src, mkcl_index src_len,
+		       unsigned char *dst, mkcl_index dst_len, mkcl_index *consumed)
+{
+  return utf_32_block_encoder(src, src_len, dst, dst_len, consumed, FALSE);
+}
+
+/* The block codecs only apply to plain :LF line termination,
+ * CR and CRLF translation stays with the per character path.
+ */
+static block_decoder
+stream_block_decoder(mkcl_object strm)
+{
+  mkcl_eformat_decoder decoder = strm->stream.decoder;
+
+  if (strm->stream.ops->read_char != eformat_read_char)
+    return NULL;
+  else if (decoder == passthrough_decoder)
+    return latin_1_block_decoder;
+  else if (decoder == ascii_decoder)
+    return ascii_block_decoder;
+  else if (decoder == utf_8_decoder)
+    return utf_8_block_decoder;
+  else if (decoder == utf_16le_decoder)
+    return utf_16le_block_decoder;
+  else if (decoder == utf_16be_decoder)
+    return utf_16be_block_decoder;
+  else if (decoder == utf_32le_decoder)
+    return utf_32le_block_decoder;
+  else if (decoder == utf_32be_decoder)
+    return utf_32be_block_decoder;
+  else
+    return NULL;
+}
+
+static block_encoder
+stream_block_encoder(mkcl_object strm)
+{
+  mkcl_eformat_encoder encoder = strm->stream.encoder;
+
+  if (strm->stream.ops->write_char != eformat_write_char)
+    return NULL;
+  else if (encoder == passthrough_encoder)
+    return latin_1_block_encoder;
+  else if (encoder == ascii_encoder)
+    return ascii_block_encoder;
+  else if (encoder == utf_8_encoder)
+    return utf_8_block_encoder;
+  else if (encoder == utf_16le_encoder)
+    return utf_16le_block_encoder;
+  else if (encoder == utf_16be_encoder)
+    return utf_16be_block_encoder;
+  else if (encoder == utf_32le_encoder)
+    return utf_32le_block_encoder;
+  else if (encoder == utf_32be_encoder)
+    return utf_32be_block_encoder;
+  else
+    return NULL;
+}
+
+/* Decodes into dst characters taken straight out of the input buffer of
+ * a file descriptor stream. Returns 0 when the buffer is empty or starts
+ * with a sequence the block decoder declines; the caller then goes through
+ * read_char once, which refills the buffer or reports the error.
+ * When to_newline is true the run ends with the first newline, if any.
+ */
+static mkcl_index
+read_char_run(MKCL, mkcl_object strm, block_decoder decode,
+	      mkcl_character *dst, mkcl_index n, bool to_newline)
+{
+  const unsigned char *src;
+  mkcl_index len, consumed, count;
+
+  if (strm->stream.last_op <= 0 || strm->stream.byte_stack != mk_cl_Cnil)
+    return 0;
+  src = (unsigned char *) strm->stream.buffer + strm->stream.buffer_start;
+  len = strm->stream.buffer_end - strm->stream.buffer_start;
+  if (to_newline) {
+    /* Only valid for formats where octet 0x0A always stands for #\Newline. */
+    const unsigned char *nl = memchr(src, '\n', len);
+
+    if (nl) len = (nl - src) + 1;
+  }
+  count = decode(src, len, dst, n, &consumed);
+  if (count) {
+    mkcl_object char_pos = strm->stream.character_position;
+
+    strm->stream.buffer_start += consumed;
+    strm->stream.last_char = strm->stream.last_code[0] = dst[count - 1];
+    strm->stream.last_code[1] = EOF;
+    if (!mkcl_Null(char_pos))
+      strm->stream.character_position = mkcl_plus(env, char_pos, MKCL_MAKE_FIXNUM(count));
+  }
+  return count;
+}
+
+static bool
+block_readable_stream_p(MKCL, mkcl_object strm)
+{
+  return (mkcl_type_of(strm) == mkcl_t_stream
+	  && (MKCL_STREAM_IS_FD_BASED_P(strm) || MKCL_STREAM_IS_SOCKET_P(strm))
+	  && strm->stream.buffer_size != 0
+	  && !strm->stream.closed);
+}
+
+static mkcl_index
+read_vector_chars(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start, mkcl_index end)
+{
+  mkcl_character (*read_char)(MKCL, mkcl_object) = strm->stream.ops->read_char;
+  bool base = (mkcl_type_of(data) == mkcl_t_base_string);
+
+  while (start < end) {
+    block_decoder decode = stream_block_decoder(strm);
+    mkcl_index got = 0;
+
+    if (base) {
+      /* Only formats that cannot produce a non-base character. */
+      if (decode == latin_1_block_decoder || decode == ascii_block_decoder) {
+	mkcl_character chunk[256];
+	mkcl_index want = end - start;
+
+	if (want > 256) want = 256;
+	got = read_char_run(env, strm, decode, chunk, want, FALSE);
+	(void) narrow_characters(data->base_string.self + start, chunk, got, 0x100);
+      }
+    } else if (decode)
+      got = read_char_run(env, strm, decode, data->string.self + start, end - start, FALSE);
+
+    if (got)
+      start += got;
+    else {
+      mkcl_character c = read_char(env, strm);
+
+      if (c == EOF)
+	break;
+      mkcl_elt_set(env, data, start++, MKCL_CODE_CHAR(c));
+    }
+  }
+  return start;
+}
+
+mkcl_character
+mkcl_read_line_into(MKCL, mkcl_object strm, mkcl_object token)
+{
+  mkcl_character c;
+
+  if (block_readable_stream_p(env, strm) && mkcl_type_of(token) == mkcl_t_string)
+    for (;;) {
+      block_decoder decode = stream_block_decoder(strm);
+      mkcl_index got = 0;
+
+      if (decode == latin_1_block_decoder || decode == ascii_block_decoder || decode == utf_8_block_decoder) {
+	if ((token->string.dim - token->string.fillp) < 64)
+	  mkcl_extend_string(env, token);
+	got = read_char_run(env, strm, decode, token->string.self + token->string.fillp,
+			    token->string.dim - token->string.fillp, TRUE);
+      }
+      if (got) {
+	token->string.fillp += got;
+	if (token->string.self[token->string.fillp - 1] == '\n') {
+	  token->string.self[--token->string.fillp] = 0;
+	  return '\n';
+	}
+	token->string.self[token->string.fillp] = 0;
+      } else {
+	c = mkcl_read_char(env, strm);
+	if (c == EOF || c == '\n')
+	  return c;
+	mkcl_string_push_extend(env, token, c);
+      }
+    }
+
+  for (;;) {
+    c = mkcl_read_char(env, strm);
+    if (c == EOF || c == '\n')
+      return c;
+    mkcl_string_push_extend(env, token, c);
+  }
+}
+
+static mkcl_index
+write_vector_chars(MKCL, mkcl_object strm, mkcl_object data, mkcl_index start, mkcl_index end)
+{
+  mkcl_character (*write_char)(MKCL, mkcl_object, mkcl_character) = strm->stream.ops->write_char;
+  bool base = (mkcl_type_of(data) == mkcl_t_base_string);
+
+  while (start < end) {
+    block_encoder encode = stream_block_encoder(strm);
+
+    if (encode) {
+      mkcl_character wide[256];
+      unsigned char octets[1024];
+      const mkcl_character *src;
+      mkcl_index n = end - start, consumed, nbytes;
+
+      if (base) {
+	if (n > 256) n = 256;
+	widen_octets(wide, data->base_string.self + start, n);
+	src = wide;
+      } else
+	src = data->string.self + start;
+      nbytes = encode(src, n, octets, sizeof(octets), &consumed);
+      if (consumed) {
+	mkcl_object char_pos = strm->stream.character_position;
+	mkcl_index i;
+
+	strm->stream.ops->write_octet(env, strm, octets, nbytes);
+	if (!mkcl_Null(char_pos))
+	  strm->stream.character_position = mkcl_plus(env, char_pos, MKCL_MAKE_FIXNUM(consumed));
+	for (i = 0; i < consumed; i++) {
+	  mkcl_character c = src[i];
+
+	  if (c == '\n')
+	    MKCL_IO_STREAM_COLUMN(strm) = 0;
+	  else if (c == '\t')
+	    MKCL_IO_STREAM_COLUMN(strm) = (MKCL_IO_STREAM_COLUMN(strm)&~((mkcl_word) 07)) + 8;
+	  else
+	    MKCL_IO_STREAM_COLUMN(strm)++;
+	}
+	start += consumed;
+	continue;
+      }
+    }
+    write_char(env, strm, base ? data->base_string.self[start] : data->string.self[start]);
+    start++;
+  }
+  return start;
+}
+
 /********************************************************************************
  * CLOS STREAMS
  */
@@ -2865,59 +3474,58 @@ mk_cl_synonym_stream_symbol(MKCL, mkcl_object strm)
  * POSIX FILE STREAM
  */
 
+/* A file descriptor based stream may be given a user-space buffer
+ * through si:set-buffering-mode. While stream.last_op is positive
+ * the octets in [buffer_start, buffer_end) have been read from the
+ * descriptor but not yet consumed. While stream.last_op is negative
+ * the octets in [0, buffer_end) have been written to the stream but
+ * not yet to the descriptor. The buffer is never touched while a
+ * system call is in progress, so an interrupt always finds it in a
+ * consistent state.
+ */
+#define MKCL_IO_FILE_BUFFER_SIZE 8192
+
 static mkcl_index
-io_file_read_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+io_file_raw_read(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n, bool partial_ok)
 {
-  mkcl_index peek_out = 0;
-  mkcl_index out = 0;
-  mkcl_object l = strm->stream.byte_stack;
-
-  for(; l != mk_cl_Cnil && n > 0; peek_out++, c++, n--)
-    {
-      *c = mkcl_fixnum_to_word(MKCL_CONS_CAR(l));
-      strm->stream.byte_stack = l = MKCL_CONS_CDR(l);
-    }
-
-  if (n > 0) /* Do we really need this test? A read with (n == 0) may be meaningful. JCB */
-    {
 #if __linux
-      int retry = 0;
+  int retry = 0;
 #endif
-      int f = MKCL_IO_FILE_DESCRIPTOR(strm);
-      ssize_t nread;
+  int f = MKCL_IO_FILE_DESCRIPTOR(strm);
+  mkcl_index out = 0;
+  ssize_t nread;
 
-      do {
+  do {
 #if MKCL_WINDOWS
-	/* Synchronous read cannot be interrupted in MS-Windows. */
-	MKCL_LIBC_NO_INTR(env, nread = read(f, (c + out), sizeof(char)*(n - out)));
+    /* Synchronous read cannot be interrupted in MS-Windows. */
+    MKCL_LIBC_NO_INTR(env, nread = read(f, (c + out), sizeof(char)*(n - out)));
 #else
-	MKCL_LIBC_Zzz(env, MK_KEY_io, nread = read(f, (c + out), sizeof(char)*(n - out)));
+    MKCL_LIBC_Zzz(env, MK_KEY_io, nread = read(f, (c + out), sizeof(char)*(n - out)));
 #endif
-	if (nread > 0) out += nread;
-      } while (((nread < 0) && restartable_io_error(env, strm, NULL))
+    if (nread > 0) out += nread;
+  } while (((nread < 0) && restartable_io_error(env, strm, NULL))
 #if MKCL_WINDOWS
-	       /* MS-Windows produces false EOF on consoles
-		  if there is a console control event. JCB
-	       */
-	       || ((nread == 0) && should_try_to_read_again(env, f))
+	   /* MS-Windows produces false EOF on consoles
+	      if there is a console control event. JCB
+	   */
+	   || ((nread == 0) && should_try_to_read_again(env, f))
 #elif __linux
-	       /* Linux also produces false EOF on a (pseudo?) tty
-		  for some specific line discipline as the one used
-		  by emacs in inferior shell mode. The EOF seems
-		  to happen on every boundary of 256 characters! JCB
-		  Linux 2.6.31
-	       */
-	       || ((nread == 0) && isatty(f) && (++retry < 3))
+	   /* Linux also produces false EOF on a (pseudo?) tty
+	      for some specific line discipline as the one used
+	      by emacs in inferior shell mode. The EOF seems
+	      to happen on every boundary of 256 characters! JCB
+	      Linux 2.6.31
+	   */
+	   || ((nread == 0) && isatty(f) && (++retry < 3))
 #endif
-	       || ((nread > 0) && (out < n)) /* incomplete read. */
-	       );
-      mk_mt_test_for_thread_shutdown(env);
-    }
-  return (peek_out + out);
+	   || ((nread > 0) && (out < n) && !partial_ok) /* incomplete read. */
+	   );
+  mk_mt_test_for_thread_shutdown(env);
+  return out;
 }
 
 static mkcl_index
-output_file_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+io_file_raw_write(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
 {
   mkcl_interrupt_status old_intr;
   int f = MKCL_IO_FILE_DESCRIPTOR(strm);
@@ -2937,6 +3545,142 @@ output_file_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
   return out;
 }
 
+static void
+io_file_flush_buffer(MKCL, mkcl_object strm)
+{
+  if (strm->stream.last_op < 0)
+    {
+      mkcl_index pending = strm->stream.buffer_end;
+
+      /* Emptied first so that a failed write is not retried on close. */
+      strm->stream.buffer_end = 0;
+      strm->stream.last_op = 0;
+      if (pending)
+	io_file_raw_write(env, strm, (unsigned char *) strm->stream.buffer, pending);
+    }
+}
+
+static void
+io_file_discard_input_buffer(MKCL, mkcl_object strm)
+{
+  if (strm->stream.last_op > 0)
+    {
+      strm->stream.buffer_start = strm->stream.buffer_end = 0;
+      strm->stream.last_op = 0;
+    }
+}
+
+static void
+io_file_unread_buffer(MKCL, mkcl_object strm)
+{
+  /* Gives back to the file descriptor the octets read ahead but not yet consumed. */
+  if (strm->stream.last_op > 0)
+    {
+      mkcl_index unread = strm->stream.buffer_end - strm->stream.buffer_start;
+
+      io_file_discard_input_buffer(env, strm);
+      if (unread)
+	{
+	  mkcl_off_t status;
+
+	  MKCL_LIBC_NO_INTR(env, status = lseek(MKCL_IO_FILE_DESCRIPTOR(strm), -(mkcl_off_t)unread, SEEK_CUR));
+	  if ((status == (mkcl_off_t)-1) && (errno != ESPIPE))
+	    io_error(env, strm);
+	}
+    }
+}
+
+void
+mkcl_sync_stream_buffer(MKCL, mkcl_object strm)
+{
+  if (mkcl_type_of(strm) == mkcl_t_stream && strm->stream.buffer_size != 0)
+    {
+      if (MKCL_STREAM_IS_SOCKET_P(strm))
+	{
+	  socket_stream_flush_buffer(env, strm);
+	  return;
+	}
+      io_file_flush_buffer(env, strm);
+      io_file_unread_buffer(env, strm);
+    }
+}
+
+static mkcl_index
+io_file_read_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+{
+  mkcl_index peek_out = 0;
+  mkcl_index out = 0;
+  mkcl_object l = strm->stream.byte_stack;
+
+  for(; l != mk_cl_Cnil && n > 0; peek_out++, c++, n--)
+    {
+      *c = mkcl_fixnum_to_word(MKCL_CONS_CAR(l));
+      strm->stream.byte_stack = l = MKCL_CONS_CDR(l);
+    }
+
+  if (n == 0) /* Do we really need this test? A read with (n == 0) may be meaningful. JCB */
+    return peek_out;
+  else if (strm->stream.buffer_size == 0)
+    return peek_out + io_file_raw_read(env, strm, c, n, FALSE);
+
+  io_file_flush_buffer(env, strm);
+  while (out < n)
+    {
+      mkcl_index avail = strm->stream.buffer_end - strm->stream.buffer_start;
+
+      if (avail > 0)
+	{
+	  if (avail > (n - out)) avail = n - out;
+	  memcpy(c + out, strm->stream.buffer + strm->stream.buffer_start, avail);
+	  strm->stream.buffer_start += avail;
+	  out += avail;
+	}
+      else if ((n - out) >= strm->stream.buffer_size)
+	{ /* Large requests go straight to the caller's memory. */
+	  out += io_file_raw_read(env, strm, c + out, n - out, FALSE);
+	  break;
+	}
+      else
+	{
+	  mkcl_index got = io_file_raw_read(env, strm, (unsigned char *) strm->stream.buffer,
+					    strm->stream.buffer_size, TRUE);
+
+	  strm->stream.buffer_start = 0;
+	  strm->stream.buffer_end = got;
+	  strm->stream.last_op = +1;
+	  if (got == 0) break; /* EOF */
+	}
+    }
+  return peek_out + out;
+}
+
+static inline bool
+line_buffered_p(mkcl_object strm)
+{
+  return (strm->stream.buffering_mode == MK_KEY_line || strm->stream.buffering_mode == MK_KEY_line_buffered);
+}
+
+static mkcl_index
+output_file_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+{
+  mkcl_index size = strm->stream.buffer_size;
+
+  if (size == 0)
+    return io_file_raw_write(env, strm, c, n);
+
+  if ((strm->stream.buffer_end + n) > size)
+    io_file_flush_buffer(env, strm);
+  if (n >= size)
+    return io_file_raw_write(env, strm, c, n);
+
+  memcpy(strm->stream.buffer + strm->stream.buffer_end, c, n);
+  strm->stream.buffer_end += n;
+  strm->stream.last_op = -1;
+  if (line_buffered_p(strm) && memchr(c, '\n', n))
+    io_file_flush_buffer(env, strm);
+  return n;
+}
+
 static mkcl_index
 io_file_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
 {
@@ -2947,6 +3691,7 @@ io_file_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
       mkcl_file_position_set(env, strm, aux);
     strm->stream.byte_stack = mk_cl_Cnil; /* Beware that this destroys the last unread-char. JCB */
   }
+  io_file_unread_buffer(env, strm);
   return output_file_write_octet(env, strm, c, n);
 }
 
@@ -2955,6 +3700,9 @@ io_file_listen(MKCL, mkcl_object strm)
 {
   if (strm->stream.byte_stack != mk_cl_Cnil)
     return MKCL_LISTEN_AVAILABLE;
+  if (strm->stream.last_op > 0 && strm->stream.buffer_start < strm->stream.buffer_end)
+    return MKCL_LISTEN_AVAILABLE;
+  io_file_flush_buffer(env, strm);
   if (strm->stream.flags & MKCL_STREAM_SEEKABLE) {
     int f = MKCL_IO_FILE_DESCRIPTOR(strm);
     mkcl_off_t disp, new, it;
@@ -2993,13 +3741,30 @@ io_file_clear_input(MKCL, mkcl_object strm)
     /* Do not stop here: the FILE structure needs also to be flushed */
   }
 #endif
+  io_file_discard_input_buffer(env, strm);
   while (file_listen(env, f) == MKCL_LISTEN_AVAILABLE) {
-    if (EOF == eformat_read_char(env, strm)) return;
+    if (EOF == eformat_read_char(env, strm)) break;
+    io_file_discard_input_buffer(env, strm);
   }
+  io_file_discard_input_buffer(env, strm);
+}
+
+static void
+io_file_clear_output(MKCL, mkcl_object strm)
+{
+  if (strm->stream.last_op < 0)
+    {
+      strm->stream.buffer_end = 0;
+      strm->stream.last_op = 0;
+    }
+}
+
+static void
+io_file_force_output(MKCL, mkcl_object strm)
+{
+  io_file_flush_buffer(env, strm);
 }
 
-#define io_file_clear_output generic_void
-#define io_file_force_output generic_void
 #define io_file_finish_output io_file_force_output
 
 static bool
@@ -3019,7 +3784,10 @@ static mkcl_object
 io_file_length(MKCL, mkcl_object strm)
 {
   int f = MKCL_IO_FILE_DESCRIPTOR(strm);
-  mkcl_object output = mkcl_file_len(env, f);
+  mkcl_object output;
+
+  io_file_flush_buffer(env, strm);
+  output = mkcl_file_len(env, f);
   if (strm->stream.byte_size != 8) {
     mkcl_index bs = strm->stream.byte_size;
     output = mkcl_floor2(env, output, MKCL_MAKE_FIXNUM(bs/8));
@@ -3047,6 +3815,12 @@ io_file_get_position(MKCL, mkcl_object strm)
 	io_error(env, strm);
     }
 
+  /* Account for the octets still held in the user-space buffer. */
+  if (strm->stream.last_op > 0)
+    offset -= (strm->stream.buffer_end - strm->stream.buffer_start);
+  else if (strm->stream.last_op < 0)
+    offset += strm->stream.buffer_end;
+
   if (sizeof(mkcl_off_t) == sizeof(long)) {
     output = mkcl_make_integer(env, offset);
   } else {
@@ -3089,11 +3863,13 @@ io_file_set_position(MKCL, mkcl_object strm, mkcl_object large_disp)
     if ((disp == 0) && ((strm->stream.flags & MKCL_STREAM_FORMAT_MASK) == MKCL_STREAM_TEXT))
       new_character_position = MKCL_MAKE_FIXNUM(0); /* The only one we can know right away. */
   }
+  io_file_flush_buffer(env, strm);
   MKCL_LIBC_NO_INTR(env, status = lseek(f, disp, whence));
   if ((mkcl_off_t)-1 == status)
     result = mk_cl_Cnil; /* seek failed */
   else
     {
+      io_file_discard_input_buffer(env, strm);
       strm->stream.character_position = new_character_position;
       result = mk_cl_Ct;
     }
@@ -3112,6 +3888,7 @@ io_file_close(MKCL, mkcl_object strm)
   int f = MKCL_IO_FILE_DESCRIPTOR(strm);
   int failed;
 
+  io_file_flush_buffer(env, strm);
   mkcl_safe_close(env, f, strm);
   MKCL_IO_FILE_DESCRIPTOR(strm) = -1;
   return generic_close(env, strm);
@@ -4029,34 +4806,39 @@ static void CALLBACK _mkcl_socket_send_io_done(DWORD dwError, DWORD cbTransferre
 }
 #endif
 
+/* A socket stream may be given user-space buffers through
+ * si:set-buffering-mode. The octets in [buffer_start, buffer_end) of
+ * stream.buffer have been received but not yet consumed, and
+ * stream.last_op is then positive as it is for a file stream. The
+ * octets in [0, out_buffer_end) of stream.out_buffer have been written
+ * to the stream but not yet sent. Being full-duplex a socket needs the
+ * two, and pending output is sent before blocking on a receive so that
+ * a request is never left sitting in front of the reply it awaits.
+ */
+#define MKCL_SOCKET_BUFFER_SIZE 16384
+
 static mkcl_index
-socket_stream_read_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+socket_stream_raw_recv(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n, bool partial_ok)
 {
   mkcl_index out = 0;
-  mkcl_object l;
 
-  for (l = strm->stream.byte_stack; l != mk_cl_Cnil && n > 0; ++out, ++c, --n) {
-    *c = mkcl_fixnum_to_word(MKCL_CONS_CAR(l));
-    strm->stream.byte_stack = l = MKCL_CONS_CDR(l);
-  }
-	
-  if(n > 0) {
+  if (n > 0) {
     SOCKET s = (SOCKET) MKCL_IO_FILE_DESCRIPTOR(strm);
 
     if (INVALID_SOCKET == s) {
       wrong_file_handler(env, strm);
     } else {
 #if MKCL_UNIX
-      ssize_t len = 0;
+      ssize_t len;
 
-      MKCL_LIBC_Zzz(env, MK_KEY_io, len = recv(s, (char *) c, n, MSG_WAITALL));
-      if ((len == SOCKET_ERROR) && (errno != EINTR))
-	{
-	  len = 0; 
+      do {
+	MKCL_LIBC_Zzz(env, MK_KEY_io, len = recv(s, (char *) c + out, n - out, partial_ok ? 0 : MSG_WAITALL));
+	if (len > 0)
+	  out += len;
+	else if ((len == SOCKET_ERROR) && (errno != EINTR))
 	  socket_error(env, "Cannot read bytes from socket", strm);
-	}
-      mk_mt_test_for_thread_shutdown(env);
-      out += len;
+	mk_mt_test_for_thread_shutdown(env);
+      } while ((len == SOCKET_ERROR) || ((len > 0) && (out < n) && !partial_ok));
 
 #elif MKCL_WINDOWS
       int rc;
@@ -4124,7 +4906,7 @@ socket_stream_read_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
 
 
 static mkcl_index
-socket_stream_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+socket_stream_raw_send(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
 {
   mkcl_index out = 0;
 
@@ -4137,10 +4919,12 @@ socket_stream_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n
       ssize_t res;
 
       MKCL_LIBC_Zzz(env, MK_KEY_io, res = send(s, ((char *) c) + out, n, 0));
-      if ((res == SOCKET_ERROR) && (errno != EINTR)) {
-	socket_error(env, "Cannot write bytes to socket", strm);
-	break; /* stop writing */
-      } else {			
+      if (res == SOCKET_ERROR) {
+	if (errno != EINTR) {
+	  socket_error(env, "Cannot write bytes to socket", strm);
+	  break; /* stop writing */
+	}
+      } else {
 	out += res;
 	n -= res;
       }
@@ -4206,6 +4990,129 @@ socket_stream_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n
   return out;
 }
 
+static void
+socket_stream_flush_buffer(MKCL, mkcl_object strm)
+{
+  mkcl_index pending = strm->stream.out_buffer_end;
+
+  /* Emptied first so that a failed send is not retried on close. */
+  strm->stream.out_buffer_end = 0;
+  if (pending)
+    socket_stream_raw_send(env, strm, (unsigned char *) strm->stream.out_buffer, pending);
+}
+
+#if MKCL_UNIX
+static void
+socket_stream_raw_sendv(MKCL, mkcl_object strm, struct iovec *iov, int cnt)
+{
+  SOCKET s = (SOCKET)MKCL_IO_FILE_DESCRIPTOR(strm);
+
+  if (INVALID_SOCKET == s)
+    wrong_file_handler(env, strm);
+  while (cnt > 0) {
+    ssize_t res;
+
+    MKCL_LIBC_Zzz(env, MK_KEY_io, res = writev(s, iov, cnt));
+    if (res == SOCKET_ERROR) {
+      if (errno != EINTR)
+	socket_error(env, "Cannot write bytes to socket", strm);
+    } else {
+      /* Skips what went out, a partial write may end anywhere. */
+      for (; cnt > 0 && (size_t) res >= iov->iov_len; iov++, cnt--)
+	res -= iov->iov_len;
+      if (cnt > 0) {
+	iov->iov_base = (char *) iov->iov_base + res;
+	iov->iov_len -= res;
+      }
+    }
+    mk_mt_test_for_thread_shutdown(env);
+  }
+}
+#endif
+
+static mkcl_index
+socket_stream_read_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+{
+  mkcl_index out = 0;
+  mkcl_object l;
+
+  for (l = strm->stream.byte_stack; l != mk_cl_Cnil && n > 0; ++out, ++c, --n) {
+    *c = mkcl_fixnum_to_word(MKCL_CONS_CAR(l));
+    strm->stream.byte_stack = l = MKCL_CONS_CDR(l);
+  }
+
+  if (n == 0)
+    return out;
+  else if (strm->stream.buffer_size == 0)
+    return out + socket_stream_raw_recv(env, strm, c, n, FALSE);
+
+  while (n > 0)
+    {
+      mkcl_index avail = strm->stream.buffer_end - strm->stream.buffer_start;
+
+      if (avail > 0)
+	{
+	  if (avail > n) avail = n;
+	  memcpy(c, strm->stream.buffer + strm->stream.buffer_start, avail);
+	  strm->stream.buffer_start += avail;
+	  out += avail; c += avail; n -= avail;
+	}
+      else
+	{
+	  mkcl_index got;
+
+	  socket_stream_flush_buffer(env, strm);
+	  if (n >= strm->stream.buffer_size)
+	    { /* Large requests go straight to the caller's memory. */
+	      out += socket_stream_raw_recv(env, strm, c, n, FALSE);
+	      break;
+	    }
+	  /* Takes whatever has arrived, up to a full buffer. */
+	  got = socket_stream_raw_recv(env, strm, (unsigned char *) strm->stream.buffer,
+				       strm->stream.buffer_size, TRUE);
+	  strm->stream.buffer_start = 0;
+	  strm->stream.buffer_end = got;
+	  strm->stream.last_op = +1;
+	  if (got == 0) break; /* EOF */
+	}
+    }
+  return out;
+}
+
+static mkcl_index
+socket_stream_write_octet(MKCL, mkcl_object strm, unsigned char *c, mkcl_index n)
+{
+  mkcl_index size = strm->stream.buffer_size;
+
+  if (size == 0)
+    return socket_stream_raw_send(env, strm, c, n);
+
+  if ((strm->stream.out_buffer_end + n) > size)
+    socket_stream_flush_buffer(env, strm);
+  if (n >= size)
+    return socket_stream_raw_send(env, strm, c, n);
+
+  memcpy(strm->stream.out_buffer + strm->stream.out_buffer_end, c, n);
+  strm->stream.out_buffer_end += n;
+  if (line_buffered_p(strm) && memchr(c, '\n', n))
+    socket_stream_flush_buffer(env, strm);
+  return n;
+}
+
+static void
+socket_stream_force_output(MKCL, mkcl_object strm)
+{
+  socket_stream_flush_buffer(env, strm);
+}
+
+#define socket_stream_finish_output socket_stream_force_output
+
+static void
+socket_stream_clear_output(MKCL, mkcl_object strm)
+{
+  strm->stream.out_buffer_end = 0;
+}
+
 static int
 socket_stream_listen(MKCL, mkcl_object strm) 
 {
@@ -4213,9 +5120,17 @@ socket_stream_listen(MKCL, mkcl_object strm)
   if (INVALID_SOCKET == s) {
     wrong_file_handler(env, strm);
   } else {
-    if (MKCL_CONSP(strm->stream.object0))
+    if (MKCL_CONSP(strm->stream.byte_stack)
+	|| strm->stream.buffer_start < strm->stream.buffer_end)
       return MKCL_LISTEN_AVAILABLE;
     else {
+#if MKCL_UNIX
+      /* Unlike select(), poll() has no limit on the value of the descriptor. */
+      struct pollfd fds = { s, POLLIN, 0 };
+      int result;
+
+      MKCL_LIBC_NO_INTR(env, (result = poll(&fds, 1, 0)));
+#else
       struct timeval tv = { 0, 0 };
       fd_set fds;
       mkcl_index result;
@@ -4223,6 +5138,7 @@ socket_stream_listen(MKCL, mkcl_object strm)
       FD_ZERO( &fds );
       FD_SET(s, &fds);
       MKCL_LIBC_NO_INTR(env, (result = select(0, &fds, NULL, NULL,  &tv)));
+#endif
       if (result == SOCKET_ERROR)
 	socket_error(env, "Cannot listen on socket", strm);
       return ((result > 0) ? MKCL_LISTEN_AVAILABLE : MKCL_LISTEN_NO_CHAR );
@@ -4233,8 +5149,10 @@ socket_stream_listen(MKCL, mkcl_object strm)
 static void
 socket_stream_clear_input(MKCL, mkcl_object strm)
 {
+  strm->stream.buffer_start = strm->stream.buffer_end = 0;
   while (socket_stream_listen(env, strm) == MKCL_LISTEN_AVAILABLE) {
-    eformat_read_char(env, strm);
+    if (EOF == eformat_read_char(env, strm)) break;
+    strm->stream.buffer_start = strm->stream.buffer_end = 0;
   }
 }
 
@@ -4244,6 +5162,8 @@ socket_stream_close(MKCL, mkcl_object strm)
   SOCKET s = (SOCKET) MKCL_IO_FILE_DESCRIPTOR(strm);
   int failed;
 
+  if (INVALID_SOCKET != s)
+    socket_stream_flush_buffer(env, strm);
 #if MKCL_WINDOWS
   MKCL_LIBC_NO_INTR(env, failed = closesocket(s));
   if (failed == SOCKET_ERROR)
@@ -4270,14 +5190,14 @@ static const struct mkcl_file_ops socket_stream_io_ops = {
   eformat_unread_char,
   generic_peek_char,
 
-  generic_read_vector,
-  generic_write_vector,
+  io_file_read_vector,
+  io_file_write_vector,
 
   socket_stream_listen,
   socket_stream_clear_input,
-  generic_void,
-  generic_void,
-  generic_void,
+  socket_stream_clear_output,
+  socket_stream_finish_output,
+  socket_stream_force_output,
 
   generic_always_true, /* input_p */
   generic_always_true, /* output_p */
@@ -4304,14 +5224,14 @@ static const struct mkcl_file_ops socket_stream_output_ops = {
   not_input_unread_char,
   generic_peek_char,
 
-  generic_read_vector,
-  generic_write_vector,
+  io_file_read_vector,
+  io_file_write_vector,
 
   not_input_listen,
   not_input_clear_input,
-  generic_void,
-  generic_void,
-  generic_void,
+  socket_stream_clear_output,
+  socket_stream_finish_output,
+  socket_stream_force_output,
 
   generic_always_false, /* input_p */
   generic_always_true, /* output_p */
@@ -4338,8 +5258,8 @@ static const struct mkcl_file_ops socket_stream_input_ops = {
   eformat_unread_char,
   generic_peek_char,
 
-  generic_read_vector,
-  generic_write_vector,
+  io_file_read_vector,
+  io_file_write_vector,
 
   socket_stream_listen,
   socket_stream_clear_input,
@@ -4369,7 +5289,8 @@ mk_si_get_buffering_mode(MKCL, mkcl_object stream)
   if (mkcl_type_of(stream) != mkcl_t_stream) {
     mkcl_FEtype_error_stream(env, stream);
   }
-  if (MKCL_STREAM_IS_C_STDIO_BASED_P(stream))  
+  if (MKCL_STREAM_IS_C_STDIO_BASED_P(stream) || MKCL_STREAM_IS_FD_BASED_P(stream)
+      || MKCL_STREAM_IS_SOCKET_P(stream))
     { mkcl_return_value(stream->stream.buffering_mode); }
   else
     { mkcl_return_value(MK_KEY_invalid); }
@@ -4416,6 +5337,48 @@ mk_si_set_buffering_mode(MKCL, mkcl_object stream, mkcl_object buffer_mode_symbo
 	  stream->stream.buffering_mode = buffer_mode_symbol;
 	}
     }
+  else if (MKCL_STREAM_IS_FD_BASED_P(stream))
+    {
+      mkcl_sync_stream_buffer(env, stream);
+      if (buffer_mode != _IONBF)
+	{
+	  if (stream->stream.buffer == NULL)
+	    stream->stream.buffer = mkcl_alloc_atomic(env, MKCL_IO_FILE_BUFFER_SIZE);
+	  stream->stream.buffer_size = MKCL_IO_FILE_BUFFER_SIZE;
+	}
+      else
+	{
+	  stream->stream.buffer = NULL;
+	  stream->stream.buffer_size = 0;
+	}
+      stream->stream.buffering_mode = buffer_mode_symbol;
+    }
+  else if (MKCL_STREAM_IS_SOCKET_P(stream))
+    {
+      socket_stream_flush_buffer(env, stream);
+      if (buffer_mode != _IONBF)
+	{
+	  if (stream->stream.buffer == NULL)
+	    {
+	      stream->stream.buffer = mkcl_alloc_atomic(env, MKCL_SOCKET_BUFFER_SIZE);
+	      stream->stream.out_buffer = mkcl_alloc_atomic(env, MKCL_SOCKET_BUFFER_SIZE);
+	    }
+	  stream->stream.buffer_size = MKCL_SOCKET_BUFFER_SIZE;
+	}
+      else
+	{
+	  /* Octets already received cannot be given back to the socket. */
+	  mkcl_index i = stream->stream.buffer_end;
+	  mkcl_object unread = stream->stream.byte_stack;
+
+	  while (i > stream->stream.buffer_start)
+	    unread = MKCL_CONS(env, MKCL_MAKE_FIXNUM((unsigned char) stream->stream.buffer[--i]), unread);
+	  stream->stream.byte_stack = unread;
+	  stream->stream.buffer = stream->stream.out_buffer = NULL;
+	  stream->stream.buffer_size = stream->stream.buffer_start = stream->stream.buffer_end = 0;
+	}
+      stream->stream.buffering_mode = buffer_mode_symbol;
+    }
   else
     mkcl_FEerror(env, "Do not know how to set buffering mode on stream: ~S", 1, stream);
 
@@ -4533,16 +5496,19 @@ mkcl_stream_to_handle(MKCL, mkcl_object s, bool output)
     else return fileno((FILE *) MKCL_IO_STREAM_FILE(s));
   case mkcl_smm_input_file:
     if (output) return -1;
-    else return MKCL_IO_FILE_DESCRIPTOR(s);
+    mkcl_sync_stream_buffer(env, s);
+    return MKCL_IO_FILE_DESCRIPTOR(s);
   case mkcl_smm_output:
     if (!output) return -1;
     else return fileno((FILE *) MKCL_IO_STREAM_FILE(s));
   case mkcl_smm_output_file:
     if (!output) return -1;
+    mkcl_sync_stream_buffer(env, s);
     return MKCL_IO_FILE_DESCRIPTOR(s);
   case mkcl_smm_io:
     return fileno((FILE *) MKCL_IO_STREAM_FILE(s));
   case mkcl_smm_io_file:
+    mkcl_sync_stream_buffer(env, s);
     return MKCL_IO_FILE_DESCRIPTOR(s);
   case mkcl_smm_synonym:
     s = MKCL_SYNONYM_STREAM_STREAM(env, s);
@@ -4558,8 +5524,10 @@ mkcl_stream_to_handle(MKCL, mkcl_object s, bool output)
     else return MKCL_IO_FILE_DESCRIPTOR(s);
   case mkcl_smm_output_socket:
     if (!output) return -1;
-    else return MKCL_IO_FILE_DESCRIPTOR(s);
+    mkcl_sync_stream_buffer(env, s);
+    return MKCL_IO_FILE_DESCRIPTOR(s);
   case mkcl_smm_io_socket:
+    mkcl_sync_stream_buffer(env, s);
     return MKCL_IO_FILE_DESCRIPTOR(s);
 
   case mkcl_smm_concatenated: /* many to one */
@@ -4840,6 +5808,73 @@ mk_si_do_write_sequence(MKCL, mkcl_object seq, mkcl_object stream, mkcl_object s
   mkcl_return_value(seq);
 }
 
+static bool
+octet_vector_p(MKCL, mkcl_object v)
+{
+  if (!MKCL_VECTOR_TYPE_P(mkcl_type_of(v)))
+    return FALSE;
+  else
+    {
+      mkcl_elttype t = mkcl_array_elttype(env, v);
+
+      return (t == mkcl_aet_b8 || t == mkcl_aet_i8);
+    }
+}
+
+#define MKCL_WRITEV_BATCH 64
+
+mkcl_object
+mk_mkcl_write_octet_vectors(MKCL, mkcl_object stream, mkcl_object vectors)
+{
+  mkcl_object l;
+
+  mkcl_call_stack_check(env);
+  l = vectors;
+  mkcl_loop_for_in(env, l) {
+    if (!octet_vector_p(env, MKCL_CONS_CAR(l)))
+      mkcl_FEwrong_type_argument(env, MK_MKCL_octets, MKCL_CONS_CAR(l));
+  } mkcl_end_loop_for_in;
+
+#if MKCL_UNIX
+  if (mkcl_type_of(stream) == mkcl_t_stream
+      && (stream->stream.mode == mkcl_smm_io_socket || stream->stream.mode == mkcl_smm_output_socket)
+      && stream->stream.byte_size == 8
+      && !stream->stream.closed)
+    {
+      /* What the transmit buffer holds goes out with the vectors, in the same writev(). */
+      struct iovec iov[MKCL_WRITEV_BATCH];
+      int cnt = 0;
+
+      if (stream->stream.out_buffer_end)
+	{
+	  iov[cnt].iov_base = stream->stream.out_buffer;
+	  iov[cnt++].iov_len = stream->stream.out_buffer_end;
+	  stream->stream.out_buffer_end = 0;
+	}
+      for (l = vectors; !mkcl_Null(l); l = MKCL_CONS_CDR(l))
+	{
+	  mkcl_object v = MKCL_CONS_CAR(l);
+
+	  if (v->vector.fillp == 0) continue;
+	  iov[cnt].iov_base = v->vector.self.b8;
+	  iov[cnt++].iov_len = v->vector.fillp;
+	  if (cnt == MKCL_WRITEV_BATCH)
+	    {
+	      socket_stream_raw_sendv(env, stream, iov, cnt);
+	      cnt = 0;
+	    }
+	}
+      if (cnt)
+	socket_stream_raw_sendv(env, stream, iov, cnt);
+      mkcl_return_value(vectors);
+    }
+#endif
+  for (l = vectors; !mkcl_Null(l); l = MKCL_CONS_CDR(l))
+    mk_si_do_write_sequence(env, MKCL_CONS_CAR(l), stream, MKCL_MAKE_FIXNUM(0), mk_cl_Cnil);
+  mk_cl_force_output(env, 1, stream);
+  mkcl_return_value(vectors);
+}
+
 mkcl_object
 mk_si_do_read_sequence(MKCL, mkcl_object seq, mkcl_object stream, mkcl_object s, mkcl_object e)
 {
@@ -5212,6 +6247,8 @@ mkcl_open_stream(MKCL, mkcl_object fn, enum mkcl_smmode smm,
   case mkcl_smm_io_file:
   case mkcl_smm_probe:
     x = make_file_stream_from_fd(env, fn, f, smm, byte_size, external_format);
+    if (smm != mkcl_smm_probe)
+      mk_si_set_buffering_mode(env, x, byte_size ? MK_KEY_fully_buffered : MK_KEY_line_buffered);
     break;
   default:
     {
@@ -5529,6 +6566,9 @@ alloc_stream(MKCL)
   x->stream.flags = 0;
   x->stream.byte_size = 8;
   x->stream.buffer = NULL;
+  x->stream.buffer_size = x->stream.buffer_start = x->stream.buffer_end = 0;
+  x->stream.out_buffer = NULL;
+  x->stream.out_buffer_end = 0;
   x->stream.encoder = NULL;
   x->stream.decoder = NULL;
   x->stream.last_char = EOF;
@@ -237,6 +237,108 @@ mk_si_generic_function_p(MKCL, mkcl_object x)
   mkcl_return_value(((MKCL_INSTANCEP(x) && (x->instance.isgf))? mk_cl_Ct : mk_cl_Cnil));
 }
 
+/**********************************************************************
+ * DISPATCH CACHE OF A GENERIC FUNCTION
+ *
+ * Every standard generic function has a small dispatch cache of its own in
+ * slot MKCL_GFUN_DISPATCH_CACHE, keyed like the method hash by the class
+ * precedence list of each specialized argument (or by the matching tail of
+ * its EQL specializers).  A class gets a new precedence list whenever it is
+ * redefined, so that list serves as the class wrapper and stale entries just
+ * stop matching.  The cache is a simple vector laid out as
+ *
+ *	generation, nkeys, key_1 ... key_nkeys, method, key_1 ...
+ *
+ * and is never modified once published.  Adding an entry publishes a copy
+ * with a compare-and-swap, so threads share it without locking and a lost
+ * race only costs a recomputation.  A cache stays monomorphic or polymorphic
+ * up to MKCL_GFUN_POLYMORPHIC_LIMIT entries, past that the generic function
+ * turns megamorphic (nkeys is then T) and dispatches through the per-thread
+ * method hash below.  mk_si_clear_gfun_cache() replaces the cache of a generic
+ * function by a fresh empty one, or bumps gfun_cache_generation to void all
+ * the caches at once.
+ */
+
+#define MKCL_GFUN_POLYMORPHIC_LIMIT 8
+
+#define GFUN_CACHE_GENERATION(c) ((c)->vector.self.t[0])
+#define GFUN_CACHE_NKEYS(c) ((c)->vector.self.t[1])
+#define GFUN_CACHE_HEADER_SIZE 2
+
+static volatile mkcl_word gfun_cache_generation = 0;
+
+static mkcl_object
+make_gfun_cache(MKCL, const mkcl_word generation, const mkcl_object nkeys, const mkcl_index entries_size)
+{
+  const mkcl_object cache = mkcl_alloc_simple_vector(env, GFUN_CACHE_HEADER_SIZE + entries_size, mkcl_aet_object);
+
+  GFUN_CACHE_GENERATION(cache) = MKCL_MAKE_FIXNUM(generation);
+  GFUN_CACHE_NKEYS(cache) = nkeys;
+  return cache;
+}
+
+static bool
+gfun_cache_valid_p(const mkcl_object cache, const mkcl_word generation)
+{
+  return (mkcl_type_of(cache) == mkcl_t_vector
+	  && GFUN_CACHE_GENERATION(cache) == MKCL_MAKE_FIXNUM(generation));
+}
+
+static mkcl_object
+search_gfun_cache(const mkcl_object cache, const mkcl_object * keys, const mkcl_index nkeys)
+{
+  const mkcl_object * e = cache->vector.self.t + GFUN_CACHE_HEADER_SIZE;
+  const mkcl_object * const end = cache->vector.self.t + cache->vector.dim;
+
+  if (GFUN_CACHE_NKEYS(cache) != MKCL_MAKE_FIXNUM(nkeys))
+    return MKCL_OBJNULL;
+  if (nkeys == 1)
+    { /* Single dispatch, the common case. */
+      const mkcl_object key = keys[0];
+
+      for (; e < end; e += 2)
+	if (e[0] == key)
+	  return e[1];
+    }
+  else
+    for (; e < end; e += nkeys + 1)
+      {
+	mkcl_index n;
+
+	for (n = 0; n < nkeys && e[n] == keys[n]; n++);
+	if (n == nkeys)
+	  return e[nkeys];
+      }
+  return MKCL_OBJNULL;
+}
+
+static void
+add_to_gfun_cache(MKCL, mkcl_object gf, mkcl_object cache, const mkcl_word generation,
+		  const mkcl_object * keys, const mkcl_index nkeys, mkcl_object func)
+{
+  const mkcl_index entry_size = nkeys + 1;
+  mkcl_index used = 0;
+  mkcl_object new_cache;
+
+  if (gfun_cache_valid_p(cache, generation) && GFUN_CACHE_NKEYS(cache) == MKCL_MAKE_FIXNUM(nkeys))
+    used = cache->vector.dim - GFUN_CACHE_HEADER_SIZE;
+
+  if (used >= MKCL_GFUN_POLYMORPHIC_LIMIT * entry_size)
+    new_cache = make_gfun_cache(env, generation, mk_cl_Ct, 0);
+  else
+    {
+      new_cache = make_gfun_cache(env, generation, MKCL_MAKE_FIXNUM(nkeys), used + entry_size);
+      if (used)
+	memcpy(new_cache->vector.self.t + GFUN_CACHE_HEADER_SIZE,
+	       cache->vector.self.t + GFUN_CACHE_HEADER_SIZE,
+	       used * sizeof(mkcl_object));
+      memcpy(new_cache->vector.self.t + GFUN_CACHE_HEADER_SIZE + used, keys, nkeys * sizeof(mkcl_object));
+      new_cache->vector.self.t[GFUN_CACHE_HEADER_SIZE + used + nkeys] = func;
+    }
+  /* Fails if the cache was cleared or grown by someone else in the meantime. */
+  __atomic_compare_exchange_n(&MKCL_GFUN_DISPATCH_CACHE(gf), &cache, new_cache, FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
 /**********************************************************************
  * METHOD HASH
  */
@@ -277,7 +379,7 @@ _mkcl_set_method_hash_size(struct mkcl_env_struct *env, mkcl_index size)
 {
   env->method_spec_vector =
     mk_si_make_vector(env, mk_cl_Ct, /* element type */
-		      MKCL_MAKE_FIXNUM(64), /* Maximum size */
+		      MKCL_MAKE_FIXNUM(MKCL_GFUN_MAX_SPEC_KEYS + 1), /* Maximum size */
 		      mk_cl_Ct, /* adjustable */
 		      MKCL_MAKE_FIXNUM(0), /* fill pointer */
 		      mk_cl_Cnil, /* displaced */
@@ -306,6 +408,14 @@ mk_si_clear_gfun_cache(MKCL, mkcl_object what)
   volatile bool locked = false;
 
   mkcl_call_stack_check(env);
+  if (what == mk_cl_Ct)
+    __atomic_add_fetch(&gfun_cache_generation, 1, __ATOMIC_ACQ_REL);
+  else if (MKCL_INSTANCEP(what) && what->instance.isgf
+	   && what->instance.length > MKCL_GFUN_DISPATCH_CACHE_INDEX)
+    __atomic_store_n(&MKCL_GFUN_DISPATCH_CACHE(what),
+		     make_gfun_cache(env, gfun_cache_generation, mk_cl_Cnil, 0),
+		     __ATOMIC_RELEASE);
+
   MKCL_UNWIND_PROTECT_BEGIN(env) {
     MKCL_LIBC_NO_INTR(env, (MKCL_THREAD_LIST_LOCK(), locked = true));
     list = mkcl_core.threads;
@@ -427,23 +537,20 @@ search_method_hash(MKCL, mkcl_object keys)
   return min_e;
 }
 
-static mkcl_object
-get_spec_vector(MKCL, mkcl_object frame, mkcl_object gf)
-{
+static mkcl_word
+get_spec_keys(MKCL, mkcl_object frame, mkcl_object gf, mkcl_object * keys)
+{ /* Returns the number of keys stored, or -1 if there are too many. */
   mkcl_object * const args = frame->frame.base;
   mkcl_index const narg = frame->frame.size;
   mkcl_object spec_how_list = MKCL_GFUN_SPEC(gf);
-  mkcl_object vector = env->method_spec_vector;
-  mkcl_object *argtype = vector->vector.self.t;
-  mkcl_index spec_no = 1;
+  mkcl_index spec_no = 0;
 
-  argtype[0] = gf;
   mkcl_loop_for_on_unsafe(spec_how_list) {
     mkcl_object spec_how = MKCL_CONS_CAR(spec_how_list);
     mkcl_object spec_type = MKCL_CONS_CAR(spec_how);
     mkcl_narg spec_position = mkcl_fixnum_to_word(MKCL_CONS_CDR(spec_how));
-    if (spec_no >= vector->vector.dim)
-      return MKCL_OBJNULL; /* cache key size overflow. JCB */
+    if (spec_no >= MKCL_GFUN_MAX_SPEC_KEYS)
+      return -1; /* cache key size overflow. JCB */
     if (spec_position >= narg)
       mkcl_FEwrong_num_arguments(env, gf, spec_position + 1, -1, narg);
 
@@ -451,18 +558,28 @@ get_spec_vector(MKCL, mkcl_object frame, mkcl_object gf)
       const mkcl_object arg = args[spec_position];
 
       if (MKCL_ATOM(spec_type))
-        argtype[spec_no++] = MKCL_CLASS_CPL(mk_cl_class_of(env, arg));
+        keys[spec_no++] = MKCL_CLASS_CPL(MKCL_INSTANCEP(arg) ? MKCL_CLASS_OF(arg) : mk_cl_class_of(env, arg));
       else
         {
           const mkcl_object pseudo_eql_spec = mkcl_memql(env, arg, spec_type);
           
-          argtype[spec_no++] = (mkcl_Null(pseudo_eql_spec) 
-                                ? MKCL_CLASS_CPL(mk_cl_class_of(env, arg))
-                                : pseudo_eql_spec);
+          keys[spec_no++] = (mkcl_Null(pseudo_eql_spec) 
+                             ? MKCL_CLASS_CPL(mk_cl_class_of(env, arg))
+                             : pseudo_eql_spec);
         }
     }
   } mkcl_end_loop_for_on;
-  vector->vector.fillp = spec_no;
+  return spec_no;
+}
+
+static mkcl_object
+get_spec_vector(MKCL, mkcl_object gf, const mkcl_object * keys, const mkcl_index nkeys)
+{ /* The key of gf in the method hash. */
+  mkcl_object vector = env->method_spec_vector;
+
+  vector->vector.self.t[0] = gf;
+  memcpy(vector->vector.self.t + 1, keys, nkeys * sizeof(mkcl_object));
+  vector->vector.fillp = nkeys + 1;
   return vector;
 }
 
@@ -482,7 +599,7 @@ compute_applicable_method(MKCL, mkcl_object frame, mkcl_object gf)
 mkcl_object
 _mkcl_standard_dispatch(MKCL, mkcl_object frame, mkcl_object gf)
 {
-  mkcl_object func, vector;
+  mkcl_object func;
   if ( env != frame->frame.env )
     mkcl_FEerror(env, "Incoherent environment on invocation of generic function ~A.", 1, gf);
 
@@ -517,24 +634,40 @@ _mkcl_standard_dispatch(MKCL, mkcl_object frame, mkcl_object gf)
       do_clear_method_hash(env, MKCL_CONS_CAR(clear_list));
     } mkcl_end_loop_for_on;
   }
-  vector = get_spec_vector(env, frame, gf);
-  if (vector == MKCL_OBJNULL) {
-    /* no cache because of key size overflow. JCB */
-    func = compute_applicable_method(env, frame, gf);
-  } else {
-    mkcl_object *e = search_method_hash(env, vector);
-    if (RECORD_KEY(e) != MKCL_OBJNULL) {
-      func = RECORD_VALUE(e);
-    } else {
-      mkcl_object keys = mk_cl_copy_seq(env, vector);
+  {
+    const mkcl_word generation = gfun_cache_generation;
+    const mkcl_object cache = ((gf->instance.length > MKCL_GFUN_DISPATCH_CACHE_INDEX)
+			       ? __atomic_load_n(&MKCL_GFUN_DISPATCH_CACHE(gf), __ATOMIC_ACQUIRE)
+			       : MKCL_OBJNULL);
+    const bool cache_valid = (cache != MKCL_OBJNULL && gfun_cache_valid_p(cache, generation));
+    mkcl_object keys[MKCL_GFUN_MAX_SPEC_KEYS];
+    const mkcl_word nkeys = get_spec_keys(env, frame, gf, keys);
+
+    if (nkeys < 0) {
+      /* no cache because of key size overflow. JCB */
       func = compute_applicable_method(env, frame, gf);
+    } else if (cache_valid && (func = search_gfun_cache(cache, keys, nkeys)) != MKCL_OBJNULL) {
+      /* monomorphic or polymorphic hit. */
+    } else if (cache == MKCL_OBJNULL || (cache_valid && GFUN_CACHE_NKEYS(cache) == mk_cl_Ct)) {
+      /* megamorphic */
+      mkcl_object vector = get_spec_vector(env, gf, keys, nkeys);
+      mkcl_object *e = search_method_hash(env, vector);
       if (RECORD_KEY(e) != MKCL_OBJNULL) {
-	/* The cache might have changed while we
-	 * computed applicable methods */
-	e = search_method_hash(env, vector);
+	func = RECORD_VALUE(e);
+      } else {
+	mkcl_object hash_keys = mk_cl_copy_seq(env, vector);
+	func = compute_applicable_method(env, frame, gf);
+	if (RECORD_KEY(e) != MKCL_OBJNULL) {
+	  /* The cache might have changed while we
+	   * computed applicable methods */
+	  e = search_method_hash(env, vector);
+	}
+	RECORD_KEY(e) = hash_keys;
+	RECORD_VALUE(e) = func;
       }
-      RECORD_KEY(e) = keys;
-      RECORD_VALUE(e) = func;
+    } else {
+      func = compute_applicable_method(env, frame, gf);
+      add_to_gfun_cache(env, gf, cache, generation, keys, nkeys, func);
     }
   }
   func = mkcl_funcall2(env, func, frame, mk_cl_Cnil);
@@ -22,10 +22,15 @@
 #include <ctype.h>
 
 #include <mkcl/mkcl-inl.h>
+#include <mkcl/mkcl-gc.h>
 #include <mkcl/internal.h>
 #include <mkcl/mkcl-fenv.h>
 #include "newhash.h"
 
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 #ifdef HASHTABLE_STATS
 # include <stdio.h>
 #endif
@@ -349,6 +354,617 @@ mkcl_search_hash_eq(MKCL, mkcl_object key, mkcl_object hashtable)
 
 extern inline struct mkcl_hashtable_entry *mkcl_search_hash(MKCL, mkcl_object key, mkcl_object hashtable);
 
+static struct mkcl_hashtable_entry * (*plain_search_fun(enum mkcl_httest htt))(__MKCL, mkcl_object key, mkcl_object hashtable)
+{ /* The search function of an unsynchronized, strong table of test htt. */
+  switch (htt) {
+  case mkcl_htt_eq: return mkcl_search_hash_eq;
+  case mkcl_htt_eql: return mkcl_search_hash_eql;
+  case mkcl_htt_equal: return mkcl_search_hash_equal;
+  case mkcl_htt_equalp: return mkcl_search_hash_equalp;
+  case mkcl_htt_package:
+  default: return mkcl_search_hash_package;
+  }
+}
+
+static bool
+hashtable_full_p(mkcl_object hashtable, mkcl_index i)
+{
+  return (i >= hashtable->hash.size ||
+	  /* This version is all integral ops. */
+	  (
+#if __clang__
+	   !(i & (((mkcl_index) -1) << (MKCL_WORD_BITS - 4))) /* make sure i will not overflow. */
+#else
+	   !(i & (((mkcl_word) -1) << (MKCL_WORD_BITS - 4))) /* make sure i will not overflow. */
+#endif
+	   && (i * 16) >= (hashtable->hash.size * hashtable->hash.factor_of_16th)));
+}
+
+/*
+ * Open addressing.
+ *
+ * Unsynchronized strong EQ, EQL and EQUAL hash tables keep their entries in
+ * a flat vector of slots rather than in chains.  The slot count, hash.size,
+ * is a power of 2.  A parallel vector of control bytes, hash.ctrl, says of
+ * each slot whether it is empty, deleted or full, and for a full slot holds
+ * 7 bits of the mixed hash of its key.  Lookups scan the control bytes by
+ * groups of HT_GROUP_WIDTH, with SSE2 when available, and only look at the
+ * slots whose control byte matches.  A typical lookup thus reads one group of
+ * control bytes and one slot, where a chained table follows a pointer to a
+ * separately allocated entry per probe.
+ *
+ * The probe sequence steps from group to group by triangular numbers, which
+ * visits every group of a power of 2 sized vector, and ends at the first group
+ * that has an empty slot.  The first HT_GROUP_WIDTH control bytes are mirrored
+ * past the end of the vector, so that a group may start at any slot.
+ *
+ * Slots are plain struct mkcl_hashtable_entry whose next field stays NULL,
+ * so that search_fun keeps its contract.  A removed entry leaves a tombstone
+ * that is dropped at the next rebuild.  The slot vector itself is allocated
+ * by the first insertion, an empty table only costs its control bytes.
+ */
+
+#define HT_GROUP_WIDTH 16
+#define HT_CTRL_EMPTY ((unsigned char) 0x80)
+#define HT_CTRL_DELETED ((unsigned char) 0xFE)
+#define HT_CTRL_FULL_P(c) (!((c) & 0x80))
+#define HT_MAX_FACTOR_OF_16TH 14 /* at most 7/8 of the slots in use, tombstones included. */
+
+#if MKCL_WORD_BITS >= 64
+# define HT_MIX_MULTIPLIER ((mkcl_index) 0x9E3779B97F4A7C15ULL)
+#else
+# define HT_MIX_MULTIPLIER ((mkcl_index) 0x9E3779B9UL)
+#endif
+
+static mkcl_index next_hashtable_size(MKCL, mkcl_object hashtable);
+
+static inline mkcl_index
+open_mix(const mkcl_hash_value hashed_key)
+{ /* hash_eq() leaves the low bits of aligned pointers at zero, spread the high bits down. */
+  const mkcl_index m = (mkcl_index) hashed_key * HT_MIX_MULTIPLIER;
+
+  return m ^ (m >> (MKCL_WORD_BITS / 2));
+}
+
+#define HT_H1(m) ((m) >> 7)
+#define HT_H2(m) ((unsigned char) ((m) & 0x7F))
+
+static inline unsigned int
+group_match(const unsigned char * group, const unsigned char c)
+{ /* One bit per control byte of the group equal to c. */
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) group), _mm_set1_epi8((char) c)));
+#else
+  unsigned int mask = 0;
+  int i;
+
+  for (i = 0; i < HT_GROUP_WIDTH; i++)
+    if (group[i] == c) mask |= 1U << i;
+  return mask;
+#endif
+}
+
+static inline unsigned int
+group_match_free(const unsigned char * group)
+{ /* One bit per empty or deleted slot of the group. */
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+  unsigned int mask = 0;
+  int i;
+
+  for (i = 0; i < HT_GROUP_WIDTH; i++)
+    if (!HT_CTRL_FULL_P(group[i])) mask |= 1U << i;
+  return mask;
+#endif
+}
+
+static inline void
+set_ctrl(unsigned char * ctrl, const mkcl_index size, const mkcl_index i, const unsigned char c)
+{
+  ctrl[i] = c;
+  if (i < HT_GROUP_WIDTH)
+    ctrl[size + i] = c; /* the mirror */
+}
+
+static unsigned char *
+make_open_ctrl(MKCL, const mkcl_index size)
+{
+  unsigned char * const ctrl = mkcl_alloc_atomic(env, size + HT_GROUP_WIDTH);
+
+  memset(ctrl, HT_CTRL_EMPTY, size + HT_GROUP_WIDTH);
+  return ctrl;
+}
+
+static mkcl_index
+open_size(mkcl_index size)
+{ /* The smallest power of 2 no smaller than size nor than HT_GROUP_WIDTH. */
+  mkcl_index p = HT_GROUP_WIDTH;
+
+  while (p < size && p < (MKCL_ATOTLIM / 2))
+    p <<= 1;
+  return p;
+}
+
+#ifdef HASHTABLE_STATS
+static void
+count_probes(mkcl_object hashtable, const long probes, const bool found)
+{
+  hashtable->hash.probes += probes;
+  if (found)
+    {
+      if ( probes < hashtable->hash.shortest_probe_chain )
+	hashtable->hash.shortest_probe_chain = probes;
+      if ( hashtable->hash.longest_probe_chain < probes )
+	hashtable->hash.longest_probe_chain = probes;
+    }
+  else
+    {
+      if ( probes < hashtable->hash.shortest_failed_probe_chain )
+	hashtable->hash.shortest_failed_probe_chain = probes;
+      if ( hashtable->hash.longest_failed_probe_chain < probes )
+	hashtable->hash.longest_failed_probe_chain = probes;
+    }
+}
+#endif
+
+static struct mkcl_hashtable_entry *
+_search_hash_open(MKCL, const mkcl_hash_value hashed_key, bool (*equality_fun)(__MKCL, mkcl_object o1, mkcl_object o2), mkcl_object key, mkcl_object hashtable)
+{
+  const unsigned char * const ctrl = hashtable->hash.ctrl;
+  struct mkcl_hashtable_entry * const slots = hashtable->hash.slots;
+  const mkcl_index mask = hashtable->hash.size - 1;
+  const mkcl_index m = open_mix(hashed_key);
+  const unsigned char h2 = HT_H2(m);
+  mkcl_index pos = HT_H1(m) & mask;
+  mkcl_index step = 0;
+#ifdef HASHTABLE_STATS
+  long probes = 0; /* in groups */
+
+  hashtable->hash.nb_searches++;
+#endif
+
+  for (;;)
+    {
+      unsigned int match = group_match(ctrl + pos, h2);
+
+#ifdef HASHTABLE_STATS
+      probes++;
+#endif
+      for (; match; match &= match - 1)
+	{
+	  struct mkcl_hashtable_entry * const e = &slots[(pos + __builtin_ctz(match)) & mask];
+
+	  if ( e->hashed_key == hashed_key && equality_fun(env, key, e->key) )
+	    {
+#ifdef HASHTABLE_STATS
+	      count_probes(hashtable, probes, TRUE);
+#endif
+	      return(e);
+	    }
+	}
+      if ( group_match(ctrl + pos, HT_CTRL_EMPTY) )
+	{
+#ifdef HASHTABLE_STATS
+	  count_probes(hashtable, probes, FALSE);
+#endif
+	  return(NULL);
+	}
+      step += HT_GROUP_WIDTH;
+      pos = (pos + step) & mask;
+    }
+}
+
+static struct mkcl_hashtable_entry *
+mkcl_search_hash_open(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  return _search_hash_open(env, hashtable->hash.hash_fun(env, key), hashtable->hash.equality_fun, key, hashtable);
+}
+
+static mkcl_index
+find_free_slot(const unsigned char * ctrl, const mkcl_index mask, const mkcl_index m)
+{ /* There is always one, the table is never allowed to fill up. */
+  mkcl_index pos = HT_H1(m) & mask;
+  mkcl_index step = 0;
+
+  for (;;)
+    {
+      const unsigned int free = group_match_free(ctrl + pos);
+
+      if (free)
+	return (pos + __builtin_ctz(free)) & mask;
+      step += HT_GROUP_WIDTH;
+      pos = (pos + step) & mask;
+    }
+}
+
+static void
+rehash_open(MKCL, mkcl_object hashtable, const mkcl_index new_size)
+{
+  const unsigned char * const old_ctrl = hashtable->hash.ctrl;
+  const struct mkcl_hashtable_entry * const old_slots = hashtable->hash.slots;
+  const mkcl_index old_size = hashtable->hash.size;
+  unsigned char * const ctrl = make_open_ctrl(env, new_size);
+  struct mkcl_hashtable_entry * const slots = mkcl_alloc(env, new_size * sizeof(struct mkcl_hashtable_entry));
+  mkcl_index i;
+
+  if (old_slots != NULL)
+    for (i = 0; i < old_size; i++)
+      if (HT_CTRL_FULL_P(old_ctrl[i]))
+	{
+	  const mkcl_index m = open_mix(old_slots[i].hashed_key);
+	  const mkcl_index j = find_free_slot(ctrl, new_size - 1, m);
+
+	  set_ctrl(ctrl, new_size, j, HT_H2(m));
+	  slots[j] = old_slots[i];
+	}
+  hashtable->hash.ctrl = ctrl;
+  hashtable->hash.slots = slots;
+  hashtable->hash.size = new_size;
+  hashtable->hash.tombstones = 0;
+}
+
+static void
+extend_open_hashtable(MKCL, mkcl_object hashtable)
+{
+  mkcl_index new_size = hashtable->hash.size;
+
+  /* Rebuilding in place is enough if tombstones are most of the load, growing
+     otherwise so that a steady mix of insertions and removals stays amortized. */
+  if (hashtable_full_p(hashtable, 2 * (hashtable->hash.entries + 1)))
+    {
+      new_size = open_size(next_hashtable_size(env, hashtable));
+      if (new_size <= hashtable->hash.size)
+	new_size = open_size(hashtable->hash.size + 1);
+    }
+  rehash_open(env, hashtable, new_size);
+}
+
+static void
+sethash_open(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object value)
+{
+  const mkcl_hash_value hashed_key = hashtable->hash.hash_fun(env, key);
+  struct mkcl_hashtable_entry * e = _search_hash_open(env, hashed_key, hashtable->hash.equality_fun, key, hashtable);
+
+  if (e != NULL)
+    { e->value = value; return; }
+
+  if (hashtable->hash.slots == NULL)
+    rehash_open(env, hashtable, hashtable->hash.size);
+  else if (hashtable_full_p(hashtable, hashtable->hash.entries + hashtable->hash.tombstones + 1))
+    extend_open_hashtable(env, hashtable);
+
+  {
+    const mkcl_index size = hashtable->hash.size;
+    const mkcl_index m = open_mix(hashed_key);
+    const mkcl_index i = find_free_slot(hashtable->hash.ctrl, size - 1, m);
+
+    if (hashtable->hash.ctrl[i] == HT_CTRL_DELETED)
+      hashtable->hash.tombstones--;
+    e = &(hashtable->hash.slots[i]);
+    e->key = key;
+    e->hashed_key = hashed_key;
+    e->value = value;
+    set_ctrl(hashtable->hash.ctrl, size, i, HT_H2(m));
+    hashtable->hash.entries++;
+  }
+}
+
+static bool
+remhash_open(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_entry * const e = mkcl_search_hash_open(env, key, hashtable);
+
+  if (e == NULL)
+    return FALSE;
+  set_ctrl(hashtable->hash.ctrl, hashtable->hash.size, e - hashtable->hash.slots, HT_CTRL_DELETED);
+  e->key = MKCL_OBJNULL;
+  e->hashed_key = 0;
+  e->value = MKCL_OBJNULL;
+  hashtable->hash.entries--;
+  hashtable->hash.tombstones++;
+  return TRUE;
+}
+
+static void
+clrhash_open(mkcl_object hashtable)
+{
+  memset(hashtable->hash.ctrl, HT_CTRL_EMPTY, hashtable->hash.size + HT_GROUP_WIDTH);
+  hashtable->hash.slots = NULL; /* Let the GC have the old contents. */
+  hashtable->hash.entries = 0;
+  hashtable->hash.tombstones = 0;
+}
+
+static mkcl_object
+chained_view_of_open_hashtable(MKCL, mkcl_object hashtable)
+{ /* Every full slot becomes a chain of its own, the view is searched in place. */
+  const mkcl_object view = mkcl_alloc_raw_hashtable(env);
+  const mkcl_index size = hashtable->hash.size;
+  struct mkcl_hashtable_entry ** const data = mkcl_alloc(env, size * sizeof(struct mkcl_hashtable_entry *));
+  mkcl_index i;
+
+  view->hash = hashtable->hash;
+  for (i = 0; i < size; i++)
+    data[i] = (HT_CTRL_FULL_P(hashtable->hash.ctrl[i]) ? &(hashtable->hash.slots[i]) : NULL);
+  view->hash.data = data;
+  return view;
+}
+
+/*
+ * Weak hash tables.
+ *
+ * The weak fields of an entry hold a disguised pointer, invisible to the
+ * garbage collector, and are registered as disappearing links with it.
+ * The collector clears such a field once its referent is found unreachable.
+ * The disguise is an exclusive or with MKCL_OBJNULL, so that a cleared field
+ * reads back as MKCL_OBJNULL.  Objects that are not in the collected heap
+ * (immediates, static symbols) are disguised all the same but never cleared.
+ *
+ * A disguised pointer may only be turned back into a real one while holding
+ * the allocation lock of the collector, since a collection could otherwise
+ * decide to reclaim the object between our read and our use of it.
+ *
+ * Entries whose key or value has been collected are not removed as we go,
+ * lookups simply pass over them.  They are purged in bulk by
+ * mkcl_extend_hashtable(), before the table is considered for growth.
+ */
+
+#define HT_HIDE(o) ((mkcl_object) ((mkcl_index) (o) ^ (mkcl_index) MKCL_OBJNULL))
+#define HT_REVEAL(o) HT_HIDE(o)
+
+static bool
+weak_entry_dead_p(const int weakness, const struct mkcl_hashtable_entry * e)
+{ /* A cleared field stays cleared, so this needs no lock. */
+  return (((weakness & mkcl_htw_key) && e->key == NULL)
+	  || ((weakness & mkcl_htw_value) && e->value == NULL));
+}
+
+struct weak_entry_contents_request
+{
+  struct mkcl_hashtable_entry * e;
+  int weakness;
+  mkcl_object key;
+  mkcl_object value;
+};
+
+static void * MK_GC_CALLBACK
+_weak_entry_contents(void * data)
+{ /* Runs with the allocation lock held. */
+  struct weak_entry_contents_request * const r = data;
+
+  r->key = (r->weakness & mkcl_htw_key) ? HT_REVEAL(r->e->key) : r->e->key;
+  r->value = (r->weakness & mkcl_htw_value) ? HT_REVEAL(r->e->value) : r->e->value;
+  return NULL;
+}
+
+static bool
+weak_entry_contents(MKCL, mkcl_object hashtable, struct mkcl_hashtable_entry * e, mkcl_object * key, mkcl_object * value)
+{ /* Returns FALSE if the entry is dead. */
+  struct weak_entry_contents_request r;
+
+  r.e = e;
+  r.weakness = hashtable->hash.weakness;
+  MKCL_GC_NO_INTR(env, MK_GC_call_with_alloc_lock(_weak_entry_contents, &r));
+  *key = r.key;
+  *value = r.value;
+  return (r.key != MKCL_OBJNULL && r.value != MKCL_OBJNULL);
+}
+
+static void
+set_weak_field(MKCL, mkcl_object * field, mkcl_object o)
+{
+  *field = HT_HIDE(o);
+  if (!MKCL_IMMEDIATE(o))
+    {
+      void * base;
+      int rc = MK_GC_SUCCESS;
+
+      MKCL_GC_NO_INTR(env, base = MK_GC_base(o));
+      if (base != NULL)
+	MKCL_GC_NO_INTR(env, rc = MK_GC_general_register_disappearing_link((void **) field, base));
+      if (rc == MK_GC_NO_MEMORY)
+	{
+	  *field = NULL; /* Better dead than dangling. */
+	  mkcl_FEerror(env, "Unable to register a weak hash table entry with the garbage collector.", 0);
+	}
+    }
+}
+
+static void
+forget_weak_entry(MKCL, const int weakness, struct mkcl_hashtable_entry * e)
+{
+  if (weakness & mkcl_htw_key)
+    MKCL_GC_NO_INTR(env, MK_GC_unregister_disappearing_link((void **) &(e->key)));
+  if (weakness & mkcl_htw_value)
+    MKCL_GC_NO_INTR(env, MK_GC_unregister_disappearing_link((void **) &(e->value)));
+}
+
+static struct mkcl_hashtable_entry **
+find_weak_entry(MKCL, mkcl_object key, const mkcl_hash_value hashed_key, mkcl_object hashtable)
+{
+  const int weakness = hashtable->hash.weakness;
+  const mkcl_object hidden_key = HT_HIDE(key);
+  struct mkcl_hashtable_entry ** root = &(hashtable->hash.data[hashed_key % hashtable->hash.size]);
+  struct mkcl_hashtable_entry * e;
+
+  for (; (e = *root) != NULL; root = &(e->next))
+    {
+      if (e->hashed_key != hashed_key || weak_entry_dead_p(weakness, e))
+	continue;
+      else if (!(weakness & mkcl_htw_key))
+	{
+	  if (hashtable->hash.equality_fun(env, key, e->key))
+	    return root;
+	}
+      else if (e->key == hidden_key) /* EQ implies any of our tests. */
+	return root;
+      else if (hashtable->hash.test != mkcl_htt_eq)
+	{
+	  mkcl_object k, v;
+
+	  if (weak_entry_contents(env, hashtable, e, &k, &v)
+	      && hashtable->hash.equality_fun(env, key, k))
+	    return root;
+	}
+    }
+  return NULL;
+}
+
+static struct mkcl_hashtable_entry *
+mkcl_search_hash_weak(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_entry ** const root = find_weak_entry(env, key, hashtable->hash.hash_fun(env, key), hashtable);
+
+  return (root ? *root : NULL);
+}
+
+static mkcl_object
+gethash_weak(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object def, bool * found)
+{
+  struct mkcl_hashtable_entry ** const root = find_weak_entry(env, key, hashtable->hash.hash_fun(env, key), hashtable);
+  mkcl_object k, v;
+
+  if (root != NULL && weak_entry_contents(env, hashtable, *root, &k, &v))
+    { *found = TRUE; return v; }
+  else
+    { *found = FALSE; return def; }
+}
+
+static void
+sethash_weak(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object value)
+{
+  const int weakness = hashtable->hash.weakness;
+  const mkcl_hash_value hashed_key = hashtable->hash.hash_fun(env, key);
+  struct mkcl_hashtable_entry ** root = find_weak_entry(env, key, hashed_key, hashtable);
+  struct mkcl_hashtable_entry * e;
+
+  if (root != NULL)
+    {
+      e = *root;
+      if (weakness & mkcl_htw_value)
+	{
+	  MKCL_GC_NO_INTR(env, MK_GC_unregister_disappearing_link((void **) &(e->value)));
+	  set_weak_field(env, &(e->value), value);
+	}
+      else
+	e->value = value;
+      return;
+    }
+
+  if (hashtable_full_p(hashtable, hashtable->hash.entries + 1))
+    mkcl_extend_hashtable(env, hashtable);
+
+  if ((e = hashtable->hash.free_bucket) != NULL)
+    hashtable->hash.free_bucket = e->next;
+  else
+    e = (struct mkcl_hashtable_entry *) mkcl_alloc(env, sizeof(struct mkcl_hashtable_entry));
+
+  e->next = NULL;
+  e->hashed_key = hashed_key;
+  e->key = e->value = NULL;
+  if (weakness & mkcl_htw_key) set_weak_field(env, &(e->key), key); else e->key = key;
+  if (weakness & mkcl_htw_value) set_weak_field(env, &(e->value), value); else e->value = value;
+
+  root = &(hashtable->hash.data[hashed_key % hashtable->hash.size]);
+  e->next = *root;
+  *root = e;
+  hashtable->hash.entries++;
+}
+
+static void
+release_weak_entry(MKCL, mkcl_object hashtable, struct mkcl_hashtable_entry * e)
+{ /* e must already be unlinked from its chain. */
+  forget_weak_entry(env, hashtable->hash.weakness, e);
+  e->key = MKCL_OBJNULL;
+  e->hashed_key = 0;
+  e->value = MKCL_OBJNULL;
+  e->next = hashtable->hash.free_bucket;
+  hashtable->hash.free_bucket = e;
+  hashtable->hash.entries--;
+}
+
+static bool
+remhash_weak(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_entry ** const root = find_weak_entry(env, key, hashtable->hash.hash_fun(env, key), hashtable);
+
+  if (root == NULL)
+    return FALSE;
+  else
+    {
+      struct mkcl_hashtable_entry * const e = *root;
+
+      *root = e->next;
+      release_weak_entry(env, hashtable, e);
+      return TRUE;
+    }
+}
+
+static void
+purge_weak_hashtable(MKCL, mkcl_object hashtable, const bool all)
+{
+  const int weakness = hashtable->hash.weakness;
+  struct mkcl_hashtable_entry ** const data = hashtable->hash.data;
+  const mkcl_index hsize = hashtable->hash.size;
+  mkcl_index i;
+
+  for (i = 0; i < hsize; i++)
+    {
+      struct mkcl_hashtable_entry ** root = &data[i];
+      struct mkcl_hashtable_entry * e;
+
+      while ((e = *root) != NULL)
+	if (all || weak_entry_dead_p(weakness, e))
+	  {
+	    *root = e->next;
+	    release_weak_entry(env, hashtable, e);
+	  }
+	else
+	  root = &(e->next);
+    }
+}
+
+static mkcl_object
+strong_copy_of_weak_hashtable(MKCL, mkcl_object hashtable)
+{
+  const mkcl_index hsize = hashtable->hash.size;
+  struct mkcl_hashtable_entry ** const data =
+    (struct mkcl_hashtable_entry **) mkcl_alloc(env, hsize * sizeof(struct mkcl_hashtable_entry *));
+  const mkcl_object copy = mkcl_alloc_raw_hashtable(env);
+  mkcl_index i, entries = 0;
+
+  for (i = 0; i < hsize; i++)
+    {
+      struct mkcl_hashtable_entry * e;
+
+      data[i] = NULL;
+      for (e = hashtable->hash.data[i]; e != NULL; e = e->next)
+	{
+	  mkcl_object k, v;
+
+	  if (!weak_entry_dead_p(hashtable->hash.weakness, e) && weak_entry_contents(env, hashtable, e, &k, &v))
+	    {
+	      struct mkcl_hashtable_entry * const n =
+		(struct mkcl_hashtable_entry *) mkcl_alloc(env, sizeof(struct mkcl_hashtable_entry));
+
+	      n->key = k;
+	      n->hashed_key = e->hashed_key;
+	      n->value = v;
+	      n->next = data[i];
+	      data[i] = n;
+	      entries++;
+	    }
+	}
+    }
+  copy->hash = hashtable->hash;
+  copy->hash.weakness = mkcl_htw_none;
+  copy->hash.search_fun = plain_search_fun(hashtable->hash.test);
+  copy->hash.data = data;
+  copy->hash.entries = entries;
+  copy->hash.free_bucket = NULL;
+  return copy;
+}
+
 
 mkcl_object mkcl_package_gethash(MKCL, const mkcl_object name, const mkcl_object hashtable, const mkcl_hash_value hashed_name)
 {
@@ -363,6 +979,12 @@ mkcl_gethash_safe(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object def)
   struct mkcl_hashtable_entry *e;
 
   mkcl_assert_type_hash_table(env, hashtable);
+  if (hashtable->hash.weakness)
+    {
+      bool found;
+
+      return gethash_weak(env, key, hashtable, def, &found);
+    }
   e = mkcl_search_hash(env, key, hashtable);
   if (e != NULL)
     def = e->value;
@@ -372,16 +994,7 @@ mkcl_gethash_safe(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object def)
 static void
 add_new_to_hash(MKCL, const mkcl_hash_value hashed_key, mkcl_object key, mkcl_object hashtable, mkcl_object value)
 {
-  mkcl_index i = hashtable->hash.entries + 1;
-  if (i >= hashtable->hash.size ||
-      /* This version is all integral ops. */
-      (
-#if __clang__
-       !(i & (((mkcl_index) -1) << (MKCL_WORD_BITS - 4))) /* make sure i will not overflow. */
-#else
-       !(i & (((mkcl_word) -1) << (MKCL_WORD_BITS - 4))) /* make sure i will not overflow. */
-#endif
-       && (i * 16) >= (hashtable->hash.size * hashtable->hash.factor_of_16th)))
+  if (hashtable_full_p(hashtable, hashtable->hash.entries + 1))
     mkcl_extend_hashtable(env, hashtable);
 
   {
@@ -407,11 +1020,449 @@ add_new_to_hash(MKCL, const mkcl_hash_value hashed_key, mkcl_object key, mkcl_ob
   }
 }
 
+/*
+ * Synchronized hash tables.
+ *
+ * Readers never take a lock.  Writers serialize on one of
+ * MKCL_HASHTABLE_STRIPES mutexes, picked from the hashed key.  The bucket
+ * vector of a synchronized table always has a size that is a multiple of
+ * MKCL_HASHTABLE_STRIPES, so that (hashed_key % size) % MKCL_HASHTABLE_STRIPES
+ * is equal to hashed_key % MKCL_HASHTABLE_STRIPES whatever the size.  Every
+ * bucket, in the current vector as in the one being retired, is thus owned by
+ * exactly one stripe.  An odd prime is used for that count so that the
+ * poorly mixed values of hash_eq() still spread over all the stripes.
+ *
+ * A new entry is fully built before being linked at the head of its chain, and
+ * an entry is never recycled nor cleared once it has been unlinked, so a
+ * reader walking a chain always sees a well formed chain.
+ *
+ * Growing is incremental.  The writer that finds the table full takes all the
+ * stripes just long enough to publish a new empty vector, keeping the old one
+ * in sync->old_data.  From then on each writer first moves the old bucket of
+ * its own key, plus a few more of its stripe, into the new vector.  The old
+ * chains are copied rather than relinked, so that they stay frozen for any
+ * reader still walking them, and sync->old_migrated records the buckets that
+ * have been moved.  A reader looks in the new vector, then in the old bucket
+ * if that one has not been moved yet.  The (data, size, old_data, old_size)
+ * quadruple is read under a sequence counter, sync->epoch, which is only
+ * bumped while all the stripes are held.
+ */
+
+#define HT_LOAD(place) __atomic_load_n(&(place), __ATOMIC_ACQUIRE)
+#define HT_STORE(place, val) __atomic_store_n(&(place), (val), __ATOMIC_RELEASE)
+
+#define HT_MIGRATION_STEP 4 /* old buckets moved by each write, on top of the writer's own. */
+
+#if MKCL_WINDOWS
+# define HT_STRIPE_LOCK(sync, i) EnterCriticalSection(&(sync)->stripe[i])
+# define HT_STRIPE_UNLOCK(sync, i) LeaveCriticalSection(&(sync)->stripe[i])
+#elif MKCL_PTHREADS
+# define HT_STRIPE_LOCK(sync, i)					\
+  (pthread_mutex_lock(&(sync)->stripe[i])				\
+   && (mkcl_lose(env, "Failed in HT_STRIPE_LOCK()"), 0))
+# define HT_STRIPE_UNLOCK(sync, i)					\
+  (pthread_mutex_unlock(&(sync)->stripe[i])				\
+   && (mkcl_lose(env, "Failed in HT_STRIPE_UNLOCK()"), 0))
+#else
+# error Incomplete synchronized hash tables for this OS.
+#endif
+
+static struct mkcl_hashtable_entry *
+scan_chain(MKCL, struct mkcl_hashtable_entry * e, bool (*equality_fun)(__MKCL, mkcl_object o1, mkcl_object o2), mkcl_object key)
+{
+  for (; e != NULL; e = HT_LOAD(e->next))
+    if (equality_fun(env, key, e->key))
+      return e;
+  return NULL;
+}
+
+static struct mkcl_hashtable_entry *
+_search_hash_synchronized(MKCL, const mkcl_hash_value hashed_key, bool (*equality_fun)(__MKCL, mkcl_object o1, mkcl_object o2), mkcl_object key, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  struct mkcl_hashtable_entry ** data;
+  struct mkcl_hashtable_entry ** old_data;
+  unsigned char * old_migrated;
+  mkcl_index size, old_size, epoch;
+  struct mkcl_hashtable_entry * e;
+
+  do {
+    while ((epoch = HT_LOAD(sync->epoch)) & 1); /* a swap is only a handful of stores. */
+    data = HT_LOAD(hashtable->hash.data);
+    size = HT_LOAD(hashtable->hash.size);
+    old_data = HT_LOAD(sync->old_data);
+    old_size = HT_LOAD(sync->old_size);
+    old_migrated = HT_LOAD(sync->old_migrated);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (epoch != __atomic_load_n(&sync->epoch, __ATOMIC_RELAXED));
+
+  e = scan_chain(env, HT_LOAD(data[hashed_key % size]), equality_fun, key);
+  if (e != NULL || old_data == NULL)
+    return e;
+  else
+    {
+      const mkcl_index j = hashed_key % old_size;
+
+      if (HT_LOAD(old_migrated[j]))
+	/* The bucket was moved while we were scanning the new vector. */
+	return scan_chain(env, HT_LOAD(data[hashed_key % size]), equality_fun, key);
+      else
+	/* Old chains are frozen, what we find there is what was current
+	   when we looked at old_migrated[j]. */
+	return scan_chain(env, HT_LOAD(old_data[j]), equality_fun, key);
+    }
+}
+
+static struct mkcl_hashtable_entry *
+mkcl_search_hash_synchronized(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  return _search_hash_synchronized(env, hashtable->hash.hash_fun(env, key), hashtable->hash.equality_fun, key, hashtable);
+}
+
+/* All the functions below expect to be called with interrupts disabled. */
+
+static void
+migrate_bucket(MKCL, mkcl_object hashtable, struct mkcl_hashtable_entry ** old_data, const mkcl_index j)
+{ /* Caller must hold the stripe of bucket j. */
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  struct mkcl_hashtable_entry ** const data = hashtable->hash.data;
+  const mkcl_index size = hashtable->hash.size;
+  struct mkcl_hashtable_entry * copies = NULL;
+  struct mkcl_hashtable_entry * e;
+
+  if (sync->old_migrated[j])
+    return;
+
+  /* Make all the copies first so that a storage-condition
+     cannot leave this bucket half moved. */
+  for (e = old_data[j]; e != NULL; e = e->next)
+    {
+      struct mkcl_hashtable_entry * const copy =
+	(struct mkcl_hashtable_entry *) mkcl_alloc(env, sizeof(struct mkcl_hashtable_entry));
+
+      copy->key = e->key;
+      copy->hashed_key = e->hashed_key;
+      copy->value = e->value;
+      copy->next = copies;
+      copies = copy;
+    }
+  while (copies != NULL)
+    {
+      struct mkcl_hashtable_entry ** const root = &data[copies->hashed_key % size];
+
+      e = copies;
+      copies = e->next;
+      e->next = *root;
+      HT_STORE(*root, e);
+    }
+  HT_STORE(sync->old_migrated[j], 1);
+
+  if (__atomic_sub_fetch(&sync->pending, 1, __ATOMIC_ACQ_REL) == 0)
+    HT_STORE(sync->old_data, NULL); /* old_migrated stays valid for late readers. */
+}
+
+static void
+prepare_stripe(MKCL, mkcl_object hashtable, const mkcl_hash_value hashed_key, const mkcl_index stripe)
+{ /* Caller must hold stripe. */
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  struct mkcl_hashtable_entry ** const old_data = sync->old_data;
+
+  if (old_data != NULL)
+    {
+      const mkcl_index old_size = sync->old_size;
+      int step;
+
+      migrate_bucket(env, hashtable, old_data, hashed_key % old_size);
+      for (step = 0; step < HT_MIGRATION_STEP && sync->old_data != NULL; )
+	{
+	  const mkcl_index j = sync->cursor[stripe];
+
+	  if (j >= old_size) break;
+	  sync->cursor[stripe] = j + MKCL_HASHTABLE_STRIPES;
+	  if (!sync->old_migrated[j])
+	    { migrate_bucket(env, hashtable, old_data, j); step++; }
+	}
+    }
+}
+
+static void
+lock_all_stripes(MKCL, struct mkcl_hashtable_sync * sync, volatile int * locked)
+{ /* Always in the same order, so there is no deadlock between two of us. */
+  for (; *locked < MKCL_HASHTABLE_STRIPES; (*locked)++)
+    HT_STRIPE_LOCK(sync, *locked);
+}
+
+static void
+unlock_all_stripes(MKCL, struct mkcl_hashtable_sync * sync, int locked)
+{
+  while (locked > 0)
+    HT_STRIPE_UNLOCK(sync, --locked);
+}
+
+static void
+finish_migration(MKCL, mkcl_object hashtable)
+{ /* Caller must hold all the stripes. */
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  struct mkcl_hashtable_entry ** const old_data = sync->old_data;
+
+  if (old_data != NULL)
+    {
+      const mkcl_index old_size = sync->old_size;
+      mkcl_index j;
+
+      for (j = 0; j < old_size; j++)
+	migrate_bucket(env, hashtable, old_data, j);
+    }
+}
+
+static void
+swap_bucket_vectors(MKCL, mkcl_object hashtable, struct mkcl_hashtable_entry ** new_data, mkcl_index new_size, bool keep_old)
+{ /* Caller must hold all the stripes, with no migration in progress. */
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  const mkcl_index epoch = sync->epoch;
+  unsigned char * old_migrated = NULL;
+  mkcl_index i;
+
+  for (i = 0; i < new_size; i++)
+    new_data[i] = NULL;
+  if (keep_old && hashtable->hash.entries)
+    {
+      old_migrated = mkcl_alloc_atomic(env, hashtable->hash.size);
+      memset(old_migrated, 0, hashtable->hash.size);
+    }
+
+  __atomic_store_n(&sync->epoch, epoch + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  if (old_migrated)
+    {
+      sync->old_migrated = old_migrated;
+      sync->old_data = hashtable->hash.data;
+      sync->old_size = hashtable->hash.size;
+      sync->pending = hashtable->hash.size;
+      for (i = 0; i < MKCL_HASHTABLE_STRIPES; i++)
+	sync->cursor[i] = i;
+    }
+  else
+    sync->old_data = NULL;
+  hashtable->hash.data = new_data;
+  hashtable->hash.size = new_size;
+  HT_STORE(sync->epoch, epoch + 2);
+}
+
+static void
+grow_synchronized(MKCL, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  volatile int locked = 0;
+
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    mkcl_disable_interrupts(env);
+    lock_all_stripes(env, sync, &locked);
+
+    /* Someone else may have grown it while we were waiting. */
+    if (hashtable_full_p(hashtable, hashtable->hash.entries + 1))
+      {
+	mkcl_index new_size = next_hashtable_size(env, hashtable);
+	struct mkcl_hashtable_entry ** new_data;
+
+	if (new_size % MKCL_HASHTABLE_STRIPES)
+	  new_size += MKCL_HASHTABLE_STRIPES - (new_size % MKCL_HASHTABLE_STRIPES);
+	new_data = mkcl_alloc(env, new_size * sizeof(struct mkcl_hashtable_entry *));
+
+	/* Growing faster than writers migrate. Rare, and only writers wait. */
+	finish_migration(env, hashtable);
+	swap_bucket_vectors(env, hashtable, new_data, new_size, TRUE);
+      }
+  } MKCL_UNWIND_PROTECT_EXIT {
+    unlock_all_stripes(env, sync, locked);
+  } MKCL_UNWIND_PROTECT_END;
+}
+
+static void
+sethash_synchronized(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object value)
+{
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  const mkcl_hash_value hashed_key = hashtable->hash.hash_fun(env, key);
+  const mkcl_index stripe = hashed_key % MKCL_HASHTABLE_STRIPES;
+  volatile bool full;
+
+  do {
+    volatile bool locked = FALSE;
+
+    full = FALSE;
+    MKCL_UNWIND_PROTECT_BEGIN(env) {
+      mkcl_disable_interrupts(env);
+      HT_STRIPE_LOCK(sync, stripe); locked = TRUE;
+
+      prepare_stripe(env, hashtable, hashed_key, stripe);
+      {
+	struct mkcl_hashtable_entry ** const root = &(hashtable->hash.data[hashed_key % hashtable->hash.size]);
+	struct mkcl_hashtable_entry * e = scan_chain(env, *root, hashtable->hash.equality_fun, key);
+
+	if (e != NULL)
+	  HT_STORE(e->value, value);
+	else if (hashtable_full_p(hashtable, hashtable->hash.entries + 1))
+	  full = TRUE;
+	else
+	  {
+	    e = (struct mkcl_hashtable_entry *) mkcl_alloc(env, sizeof(struct mkcl_hashtable_entry));
+	    e->key = key;
+	    e->hashed_key = hashed_key;
+	    e->value = value;
+	    e->next = *root;
+	    HT_STORE(*root, e);
+	    __atomic_add_fetch(&hashtable->hash.entries, 1, __ATOMIC_RELAXED);
+	  }
+      }
+    } MKCL_UNWIND_PROTECT_EXIT {
+      if (locked) HT_STRIPE_UNLOCK(sync, stripe);
+    } MKCL_UNWIND_PROTECT_END;
+
+    if (full)
+      grow_synchronized(env, hashtable);
+  } while (full);
+}
+
+static bool
+remhash_synchronized(MKCL, mkcl_object key, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  const mkcl_hash_value hashed_key = hashtable->hash.hash_fun(env, key);
+  const mkcl_index stripe = hashed_key % MKCL_HASHTABLE_STRIPES;
+  volatile bool locked = FALSE;
+  volatile bool found = FALSE;
+
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    mkcl_disable_interrupts(env);
+    HT_STRIPE_LOCK(sync, stripe); locked = TRUE;
+
+    prepare_stripe(env, hashtable, hashed_key, stripe);
+    {
+      struct mkcl_hashtable_entry ** root = &(hashtable->hash.data[hashed_key % hashtable->hash.size]);
+      struct mkcl_hashtable_entry * e;
+
+      for (e = *root; e != NULL; root = &(e->next), e = *root)
+	if (hashtable->hash.equality_fun(env, key, e->key))
+	  {
+	    /* e is left untouched for the readers that may still be on it. */
+	    HT_STORE(*root, e->next);
+	    __atomic_sub_fetch(&hashtable->hash.entries, 1, __ATOMIC_RELAXED);
+	    found = TRUE;
+	    break;
+	  }
+    }
+  } MKCL_UNWIND_PROTECT_EXIT {
+    if (locked) HT_STRIPE_UNLOCK(sync, stripe);
+  } MKCL_UNWIND_PROTECT_END;
+  return found;
+}
+
+static void
+clrhash_synchronized(MKCL, mkcl_object hashtable)
+{
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  volatile int locked = 0;
+
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    const mkcl_index size = hashtable->hash.size;
+    struct mkcl_hashtable_entry ** const new_data =
+      mkcl_alloc(env, size * sizeof(struct mkcl_hashtable_entry *));
+
+    mkcl_disable_interrupts(env);
+    lock_all_stripes(env, sync, &locked);
+    swap_bucket_vectors(env, hashtable, new_data, size, FALSE);
+    hashtable->hash.entries = 0;
+  } MKCL_UNWIND_PROTECT_EXIT {
+    unlock_all_stripes(env, sync, locked);
+  } MKCL_UNWIND_PROTECT_END;
+}
+
+mkcl_object
+mkcl_hash_table_snapshot(MKCL, mkcl_object hashtable)
+{
+  /* Returns a hash table header, with no synchronization of its own, over the
+     current bucket vector of hashtable.  Walking its chains is safe while other
+     threads keep on writing to hashtable, and sees some of their changes.
+     For a weak table, returns a strong copy of its live entries, and for an
+     open addressed one a chained view of its slots. */
+  struct mkcl_hashtable_sync * const sync = hashtable->hash.sync;
+  volatile int locked = 0;
+  mkcl_object view;
+
+  if (hashtable->hash.weakness)
+    return strong_copy_of_weak_hashtable(env, hashtable);
+  else if (hashtable->hash.ctrl)
+    return chained_view_of_open_hashtable(env, hashtable);
+  else if (sync == NULL)
+    return hashtable;
+
+  view = mkcl_alloc_raw_hashtable(env);
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    mkcl_disable_interrupts(env);
+    lock_all_stripes(env, sync, &locked);
+    finish_migration(env, hashtable);
+    view->hash = hashtable->hash;
+  } MKCL_UNWIND_PROTECT_EXIT {
+    unlock_all_stripes(env, sync, locked);
+  } MKCL_UNWIND_PROTECT_END;
+  view->hash.sync = NULL;
+  view->hash.search_fun = plain_search_fun(view->hash.test);
+  view->hash.lockable = 0;
+  view->hash.free_bucket = NULL;
+  return view;
+}
+
+static void
+make_hashtable_synchronized(MKCL, mkcl_object h)
+{ /* h must still be empty. */
+  struct mkcl_hashtable_sync * sync;
+  mkcl_index i;
+
+  if (h->hash.size % MKCL_HASHTABLE_STRIPES)
+    {
+      const mkcl_index hsize = h->hash.size + MKCL_HASHTABLE_STRIPES - (h->hash.size % MKCL_HASHTABLE_STRIPES);
+
+      h->hash.data = (struct mkcl_hashtable_entry **) mkcl_alloc(env, hsize * sizeof(struct mkcl_hashtable_entry *));
+      for (i = 0; i < hsize; i++)
+	h->hash.data[i] = NULL;
+      h->hash.size = hsize;
+    }
+
+  sync = (struct mkcl_hashtable_sync *) mkcl_alloc(env, sizeof(struct mkcl_hashtable_sync));
+  sync->epoch = 0;
+  sync->old_data = NULL;
+  sync->old_migrated = NULL;
+  sync->old_size = 0;
+  sync->pending = 0;
+  for (i = 0; i < MKCL_HASHTABLE_STRIPES; i++)
+    {
+      sync->cursor[i] = 0;
+#if MKCL_WINDOWS
+      InitializeCriticalSection(&(sync->stripe[i]));
+#else
+      if (pthread_mutex_init(&(sync->stripe[i]), mkcl_normal_mutexattr))
+	mkcl_C_lose(env, "make_hashtable_synchronized failed on pthread_mutex_init.");
+#endif
+    }
+
+  h->hash.sync = sync;
+  h->hash.lockable = 1;
+  h->hash.search_fun = mkcl_search_hash_synchronized;
+  mk_si_set_finalizer(env, h, mk_cl_Ct);
+}
+
 void
 mkcl_sethash(MKCL, mkcl_object key, mkcl_object hashtable, mkcl_object value)
 {
   struct mkcl_hashtable_entry *e;
 
+  if (hashtable->hash.sync)
+    { sethash_synchronized(env, key, hashtable, value); return; }
+  else if (hashtable->hash.weakness)
+    { sethash_weak(env, key, hashtable, value); return; }
+  else if (hashtable->hash.ctrl)
+    { sethash_open(env, key, hashtable, value); return; }
+
   const mkcl_hash_value hashed_key = hashtable->hash.hash_fun(env, key);
   e = _search_hash(env, hashed_key, hashtable->hash.equality_fun, key, hashtable);
 
@@ -432,14 +1483,13 @@ mkcl_package_sethash_new(MKCL, const mkcl_object key, const mkcl_object hashtabl
 }
 
 
-void
-mkcl_extend_hashtable(MKCL, mkcl_object hashtable)
+static mkcl_index
+next_hashtable_size(MKCL, mkcl_object hashtable)
 {
-  mkcl_index old_size, new_size, i;
+  const mkcl_index old_size = hashtable->hash.size;
+  mkcl_index new_size;
   mkcl_object new_size_obj;
 
-  mkcl_assert_type_hash_table(env, hashtable);
-  old_size = hashtable->hash.size;
   /* We do the computation with lisp datatypes, just in case the sizes contain
    * weird numbers */
   if (MKCL_FIXNUMP(hashtable->hash.rehash_size)) {
@@ -469,6 +1519,28 @@ mkcl_extend_hashtable(MKCL, mkcl_object hashtable)
   } else {
     new_size = mkcl_fixnum_to_word(new_size_obj);
   }
+  return new_size;
+}
+
+void
+mkcl_extend_hashtable(MKCL, mkcl_object hashtable)
+{
+  mkcl_index old_size, new_size, i;
+
+  mkcl_assert_type_hash_table(env, hashtable);
+  if (hashtable->hash.sync)
+    { grow_synchronized(env, hashtable); return; }
+  else if (hashtable->hash.ctrl)
+    { extend_open_hashtable(env, hashtable); return; }
+  else if (hashtable->hash.weakness)
+    {
+      purge_weak_hashtable(env, hashtable, FALSE);
+      if (!hashtable_full_p(hashtable, hashtable->hash.entries + 1))
+	return;
+    }
+
+  old_size = hashtable->hash.size;
+  new_size = next_hashtable_size(env, hashtable);
 
   {
     struct mkcl_hashtable_entry ** const new_data =
@@ -524,6 +1596,11 @@ mkcl_make_hashtable_for_package(MKCL, mkcl_index hsize)
   h->hash.equality_fun = mkcl_string_E;
 
   h->hash.free_bucket = NULL;
+  h->hash.sync = NULL;
+  h->hash.weakness = mkcl_htw_none;
+  h->hash.ctrl = NULL;
+  h->hash.slots = NULL;
+  h->hash.tombstones = 0;
 
 #ifdef HASHTABLE_STATS
   h->hash.nb_searches = 0;
@@ -532,6 +1609,7 @@ mkcl_make_hashtable_for_package(MKCL, mkcl_index hsize)
   h->hash.longest_probe_chain = 0;
   h->hash.shortest_failed_probe_chain = LONG_MAX;
   h->hash.longest_failed_probe_chain = 0;
+  h->hash.longest_static_chain = 0;
 
   mkcl_core.hashtables[mkcl_htt_package] = mkcl_cons(h, mkcl_core.hashtables[mkcl_htt_package]);
 #endif
@@ -539,6 +1617,8 @@ mkcl_make_hashtable_for_package(MKCL, mkcl_index hsize)
   return h;
 }
 
+static mkcl_object make_hash_table(MKCL, mkcl_object test, mkcl_object size,
+				   mkcl_object rehash_size, mkcl_object rehash_threshold, bool open_p);
 
 mkcl_object mk_cl_make_hash_table(MKCL, mkcl_narg narg, ...)
 {
@@ -548,16 +1628,54 @@ mkcl_object mk_cl_make_hash_table(MKCL, mkcl_narg narg, ...)
     mkcl_object size = MKCL_MAKE_FIXNUM(1024);
     mkcl_object rehash_size = mkcl_make_singlefloat(env, 1.5);
     mkcl_object rehash_threshold = mkcl_make_singlefloat(env, 0.7);
-    MKCL_RECEIVE_4_KEYWORD_ARGUMENTS(env, MK_CL_make_hash_table, narg, 0, narg, MK_KEY_test, &test, MK_KEY_size, &size, MK_KEY_rehash_size, &rehash_size, MK_KEY_rehash_threshold, &rehash_threshold);
+    mkcl_object synchronized = mk_cl_Cnil;
+    mkcl_object weakness = mk_cl_Cnil;
+    struct mkcl_key_param_spec key_params[] =
+      {
+       { MK_KEY_test, &test, false },
+       { MK_KEY_size, &size, false },
+       { MK_KEY_rehash_size, &rehash_size, false },
+       { MK_KEY_rehash_threshold, &rehash_threshold, false },
+       { MK_KEY_synchronized, &synchronized, false },
+       { MK_KEY_weakness, &weakness, false },
+      };
+    MKCL_RECEIVE_N_KEYWORD_ARGUMENTS(env, MK_CL_make_hash_table, narg, 0, narg, key_params);
+
+    {
+      enum mkcl_htweak htw;
+      mkcl_object h;
 
-    mkcl_return_value(mk_cl__make_hash_table(env, test, size, rehash_size, rehash_threshold));
+      while (1)
+	{
+	  if (mkcl_Null(weakness)) { htw = mkcl_htw_none; break; }
+	  else if (weakness == MK_KEY_key) { htw = mkcl_htw_key; break; }
+	  else if (weakness == MK_KEY_value) { htw = mkcl_htw_value; break; }
+	  else if (weakness == MK_KEY_key_and_value) { htw = mkcl_htw_key_and_value; break; }
+	  else
+	    weakness = mkcl_type_error(env, MK_CL_make_hash_table, "weakness", weakness,
+				       mkcl_fast_read_from_cstring(env, "(MEMBER NIL :KEY :VALUE :KEY-AND-VALUE)"));
+	}
+      if (htw != mkcl_htw_none && !mkcl_Null(synchronized))
+	mkcl_FEerror(env, "A hash table cannot be both synchronized and weak.", 0);
+
+      h = make_hash_table(env, test, size, rehash_size, rehash_threshold,
+			  mkcl_Null(synchronized) && htw == mkcl_htw_none);
+      if (!mkcl_Null(synchronized))
+	make_hashtable_synchronized(env, h);
+      else if (htw != mkcl_htw_none)
+	{
+	  h->hash.weakness = htw;
+	  h->hash.search_fun = mkcl_search_hash_weak;
+	}
+      mkcl_return_value(h);
+    }
   }
 }
 
-mkcl_object
-mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
-		       mkcl_object rehash_size, mkcl_object rehash_threshold)
-{
+static mkcl_object
+make_hash_table(MKCL, mkcl_object test, mkcl_object size,
+		mkcl_object rehash_size, mkcl_object rehash_threshold, bool open_p)
+{ /* open_p asks for open addressing, which only EQ, EQL and EQUAL tables get. */
   enum mkcl_httest htt;
   struct mkcl_hashtable_entry * (*search_fun)(MKCL, mkcl_object key, mkcl_object hashtable);  
   mkcl_hash_value (*hash_fun)(__MKCL, mkcl_object key);
@@ -577,6 +1695,8 @@ mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
     { htt = mkcl_htt_equalp; search_fun = mkcl_search_hash_equalp; hash_fun = hash_equalp; equality_fun = mkcl_equalp; }
   else
     mkcl_FEerror(env, "~S is an illegal hash-table test function.", 1, test);
+  if (htt == mkcl_htt_equalp)
+    open_p = FALSE;
 
   hsize = mkcl_fixnum_in_range(env, MK_CL_make_hash_table, "size", size, 0, MKCL_ATOTLIM);;
   if (hsize < 16) {
@@ -617,19 +1737,31 @@ mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
   h->hash.search_fun = search_fun;
   h->hash.hash_fun = hash_fun;
   h->hash.equality_fun = equality_fun;
-  h->hash.size = hsize;
   h->hash.entries = 0;
   h->hash.data = NULL;	/* for GC sake */
+  h->hash.slots = NULL;
+  h->hash.tombstones = 0;
 
-  h->hash.data = (struct mkcl_hashtable_entry **) mkcl_alloc(env, hsize * sizeof(struct mkcl_hashtable_entry *));
-  {
-    struct mkcl_hashtable_entry ** const data = h->hash.data;
-    mkcl_index i;
+  if (open_p)
+    {
+      hsize = open_size(hsize);
+      h->hash.search_fun = mkcl_search_hash_open;
+      h->hash.ctrl = make_open_ctrl(env, hsize);
+    }
+  else
+    {
+      h->hash.ctrl = NULL;
+      h->hash.data = (struct mkcl_hashtable_entry **) mkcl_alloc(env, hsize * sizeof(struct mkcl_hashtable_entry *));
+      {
+	struct mkcl_hashtable_entry ** const data = h->hash.data;
+	mkcl_index i;
 
-    for (i = (hsize - 1); i; i--)
-      data[i] = NULL;
-    data[0] = NULL;
-  }
+	for (i = (hsize - 1); i; i--)
+	  data[i] = NULL;
+	data[0] = NULL;
+      }
+    }
+  h->hash.size = hsize;
 
   h->hash.rehash_size = rehash_size;
   h->hash.threshold = rehash_threshold;
@@ -662,8 +1794,12 @@ mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
   }
   if (h->hash.factor_of_16th == 0)
     h->hash.factor_of_16th = 1;
+  else if (open_p && h->hash.factor_of_16th > HT_MAX_FACTOR_OF_16TH)
+    h->hash.factor_of_16th = HT_MAX_FACTOR_OF_16TH;
 
   h->hash.free_bucket = NULL;
+  h->hash.sync = NULL;
+  h->hash.weakness = mkcl_htw_none;
 
 #ifdef HASHTABLE_STATS
   h->hash.nb_searches = 0;
@@ -680,6 +1816,13 @@ mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
   return h;
 }
 
+mkcl_object
+mk_cl__make_hash_table(MKCL, mkcl_object test, mkcl_object size,
+		       mkcl_object rehash_size, mkcl_object rehash_threshold)
+{
+  return make_hash_table(env, test, size, rehash_size, rehash_threshold, TRUE);
+}
+
 static void
 print_stats_for_hset(mkcl_object hset)
 {
@@ -690,6 +1833,9 @@ print_stats_for_hset(mkcl_object hset)
 
     printf("Hash table size = %d, entries = %d, alpha = %f\n",
 	   h->hash.size, h->hash.entries, (float) h->hash.entries / (float)h->hash.size);
+    if (h->hash.ctrl)
+      printf("open addressing, tombstones = %d, probes counted in groups of %d slots\n",
+	     h->hash.tombstones, HT_GROUP_WIDTH);
     printf("searches = %d\n", h->hash.nb_searches);
     printf("total probes = %d\n", h->hash.probes);
     printf("average probe chain = %f\n",
@@ -699,6 +1845,31 @@ print_stats_for_hset(mkcl_object hset)
     printf("shortest failed probe chain = %d\n", h->hash.shortest_failed_probe_chain);
     printf("longest failed probe chain = %d\n", h->hash.longest_failed_probe_chain);
 
+    if (h->hash.ctrl)
+      { /* The static chain of an entry is the probe sequence that leads to its slot. */
+	const mkcl_index mask = h->hash.size - 1;
+	mkcl_index i;
+
+	for (i = 0; h->hash.slots != NULL && i <= mask; i++)
+	  if (HT_CTRL_FULL_P(h->hash.ctrl[i]))
+	    {
+	      long count = 1;
+	      mkcl_index pos = HT_H1(open_mix(h->hash.slots[i].hashed_key)) & mask;
+	      mkcl_index step = 0;
+
+	      while (((i - pos) & mask) >= HT_GROUP_WIDTH)
+		{ step += HT_GROUP_WIDTH; pos = (pos + step) & mask; count++; }
+
+	      if ( h->hash.longest_static_chain < count )
+		h->hash.longest_static_chain = count;
+
+	      if ( count >= 7 )
+		chain_count[7]++;
+	      else
+		chain_count[count]++;
+	    }
+      }
+    else
     {
       long size = h->hash.size;
       long i;
@@ -774,6 +1945,13 @@ mkcl_object mk_cl_gethash(MKCL, mkcl_narg narg, mkcl_object key, mkcl_object ht,
     MKCL_RECEIVE_1_OPTIONAL_ARGUMENT(env, MK_CL_gethash, narg, 2, ht, &no_value);
 
     mkcl_assert_type_hash_table(env, ht);
+    if (ht->hash.weakness)
+      {
+        bool found;
+        mkcl_object value = gethash_weak(env, key, ht, no_value, &found);
+
+        mkcl_return_2_values(value, (found ? mk_cl_Ct : mk_cl_Cnil));
+      }
     e = mkcl_search_hash(env, key, ht);
     if (e != NULL)
       { mkcl_return_2_values(e->value, mk_cl_Ct); }
@@ -805,6 +1983,12 @@ mkcl_remhash(MKCL, mkcl_object key, mkcl_object hashtable)
   enum mkcl_httest htest;
 
   mkcl_assert_type_hash_table(env, hashtable);
+  if (hashtable->hash.sync)
+    return remhash_synchronized(env, key, hashtable);
+  else if (hashtable->hash.weakness)
+    return remhash_weak(env, key, hashtable);
+  else if (hashtable->hash.ctrl)
+    return remhash_open(env, key, hashtable);
 
   hsize = hashtable->hash.size;
   htest = hashtable->hash.test;
@@ -923,7 +2107,15 @@ mk_cl_clrhash(MKCL, mkcl_object ht)
 {
   mkcl_call_stack_check(env);
   mkcl_assert_type_hash_table(env, ht);
-  if (ht->hash.entries) {
+  if (ht->hash.sync)
+    clrhash_synchronized(env, ht);
+  else if (ht->hash.weakness)
+    purge_weak_hashtable(env, ht, TRUE);
+  else if (ht->hash.ctrl) {
+    if (ht->hash.entries || ht->hash.tombstones)
+      clrhash_open(ht);
+  }
+  else if (ht->hash.entries) {
     do_clrhash(ht);
   }
   mkcl_return_value(ht);
@@ -946,6 +2138,31 @@ mk_cl_hash_table_test(MKCL, mkcl_object ht)
   mkcl_return_value(output);
 }
 
+mkcl_object
+mk_mkcl_hash_table_synchronized_p(MKCL, mkcl_object ht)
+{
+  mkcl_call_stack_check(env);
+  mkcl_assert_type_hash_table(env, ht);
+  mkcl_return_value((ht->hash.sync ? mk_cl_Ct : mk_cl_Cnil));
+}
+
+mkcl_object
+mk_mkcl_hash_table_weakness(MKCL, mkcl_object ht)
+{
+  mkcl_object output;
+
+  mkcl_call_stack_check(env);
+  mkcl_assert_type_hash_table(env, ht);
+  switch (ht->hash.weakness) {
+  case mkcl_htw_key: output = MK_KEY_key; break;
+  case mkcl_htw_value: output = MK_KEY_value; break;
+  case mkcl_htw_key_and_value: output = MK_KEY_key_and_value; break;
+  case mkcl_htw_none:
+  default: output = mk_cl_Cnil;
+  }
+  mkcl_return_value(output);
+}
+
 mkcl_object
 mk_cl_hash_table_size(MKCL, mkcl_object ht)
 {
@@ -1018,6 +2235,7 @@ mk_si_hash_table_iterator(MKCL, mkcl_object ht)
     mkcl_object closure_block = mkcl_alloc_clevel_block(env, mk_cl_Cnil, mk_cl_Cnil, 3);
     mkcl_object closure_syms_block = mkcl_alloc_clevel_block(env, mk_cl_Cnil, mk_cl_Cnil, 3);
 
+    ht = mkcl_hash_table_snapshot(env, ht);
     closure_block->lblock.producer = mk_cl_Cnil;
     closure_block->lblock.var[0] = ht;
     closure_block->lblock.var[1] = mkcl_make_foreign(env, mk_cl_Cnil,
@@ -1118,6 +2336,20 @@ mk_cl_maphash(MKCL, mkcl_object fun, mkcl_object ht)
 {
   mkcl_call_stack_check(env);
   mkcl_assert_type_hash_table(env, ht);
+  if (ht->hash.ctrl)
+    { /* Walk the slots directly, fun may only update or remove the current entry. */
+      const unsigned char * const ctrl = ht->hash.ctrl;
+      struct mkcl_hashtable_entry * const slots = ht->hash.slots;
+      const mkcl_index size = ht->hash.size;
+      mkcl_index i;
+
+      if (slots != NULL)
+	for (i = 0; i < size; i++)
+	  if (HT_CTRL_FULL_P(ctrl[i]))
+	    mkcl_funcall2(env, fun, slots[i].key, slots[i].value);
+      mkcl_return_value(mk_cl_Cnil);
+    }
+  ht = mkcl_hash_table_snapshot(env, ht);
 
   struct mkcl_hashtable_entry ** const data = ht->hash.data;
   const mkcl_index hsize = ht->hash.size;
@@ -1185,19 +2417,63 @@ mk_si_copy_hash_table(MKCL, mkcl_object orig)
   mkcl_object hash;
 
   mkcl_call_stack_check(env);
-  hash = mk_cl__make_hash_table(env, mk_cl_hash_table_test(env, orig),
-				mk_cl_hash_table_size(env, orig),
-				mk_cl_hash_table_rehash_size(env, orig),
-				mk_cl_hash_table_rehash_threshold(env, orig));
-
   {
-    const mkcl_index size = orig->hash.size;
-    mkcl_index i;
-    
+    if (orig->hash.ctrl)
+      { /* Same size, same layout, the slots can be copied as they are. */
+	const mkcl_index size = orig->hash.size;
+
+	hash = mk_cl__make_hash_table(env, mk_cl_hash_table_test(env, orig),
+				      MKCL_MAKE_FIXNUM(size),
+				      mk_cl_hash_table_rehash_size(env, orig),
+				      mk_cl_hash_table_rehash_threshold(env, orig));
+	if (orig->hash.slots != NULL)
+	  {
+	    struct mkcl_hashtable_entry * const slots = mkcl_alloc(env, size * sizeof(struct mkcl_hashtable_entry));
+
+	    memcpy(slots, orig->hash.slots, size * sizeof(struct mkcl_hashtable_entry));
+	    memcpy(hash->hash.ctrl, orig->hash.ctrl, size + HT_GROUP_WIDTH);
+	    hash->hash.slots = slots;
+	    hash->hash.entries = orig->hash.entries;
+	    hash->hash.tombstones = orig->hash.tombstones;
+	  }
+	mkcl_return_value(hash);
+      }
+
+    const mkcl_object view = mkcl_hash_table_snapshot(env, orig);
+    const mkcl_index size = view->hash.size;
+    mkcl_index i, entries = 0;
+
+    hash = make_hash_table(env, mk_cl_hash_table_test(env, orig),
+			   MKCL_MAKE_FIXNUM(size),
+			   mk_cl_hash_table_rehash_size(env, orig),
+			   mk_cl_hash_table_rehash_threshold(env, orig),
+			   FALSE);
+    if (orig->hash.sync)
+      make_hashtable_synchronized(env, hash);
+    else if (orig->hash.weakness)
+      {
+	hash->hash.weakness = orig->hash.weakness;
+	hash->hash.search_fun = mkcl_search_hash_weak;
+	for (i = 0; i < size; i++)
+	  {
+	    struct mkcl_hashtable_entry * e;
+
+	    for (e = view->hash.data[i]; e != NULL; e = e->next)
+	      sethash_weak(env, e->key, hash, e->value);
+	  }
+	mkcl_return_value(hash);
+      }
+
     for (i = 0; i < size; i++)
-      hash->hash.data[i] = copy_hash_table_chain(env, orig->hash.data[i]);
+      {
+	struct mkcl_hashtable_entry * e;
+
+	hash->hash.data[i] = copy_hash_table_chain(env, view->hash.data[i]);
+	for (e = hash->hash.data[i]; e != NULL; e = e->next)
+	  entries++;
+      }
+    hash->hash.entries = entries; /* orig may have changed under us if synchronized. */
   }
-  hash->hash.entries = orig->hash.entries;
 
   mkcl_return_value(hash);
 }
@@ -227,6 +227,107 @@ mk_si_sl_makunbound(MKCL, mkcl_object x, mkcl_object index)
   mkcl_return_value(x);
 }
 
+/*
+ * Slot location caches.
+ *
+ * The compilers give each SLOT-VALUE, SLOT-BOUNDP and (SETF SLOT-VALUE)
+ * with a constant slot name its own cache, a simple vector of one element
+ * holding the entry (sig generation . location): the signature (instance.sig)
+ * of the instances it last saw, the value of mkcl_core.slot_cache_generation
+ * at the time and the location of the slot in these instances. Entries are
+ * never modified, a fill replaces the whole entry with a single store so
+ * that concurrent readers see either the old entry or the new one.
+ * A hit goes straight to the slot. On a miss, clos::slot-cache-miss fills
+ * the cache when the slot is a local one of an instance of a standard class
+ * that allows optimized slot access, and goes through the full slot access
+ * protocol.
+ * si:clear-slot-caches voids all caches at once, it is called whenever
+ * classes are (un)finalized or their instances made obsolete.
+ */
+
+#define SLOT_CACHE_SIZE 1
+
+static mkcl_object
+check_slot_cache(MKCL, mkcl_object fun, mkcl_object cache)
+{
+  while (mkcl_unlikely(mkcl_type_of(cache) != mkcl_t_vector
+                       || cache->vector.elttype != mkcl_aet_object
+                       || cache->vector.dim != SLOT_CACHE_SIZE))
+    cache = mkcl_type_error(env, fun, "cache", cache, MK_CL_simple_vector);
+  return cache;
+}
+
+mkcl_object
+mk_si_make_slot_cache(MKCL)
+{
+  mkcl_object cache = mkcl_alloc_simple_vector(env, SLOT_CACHE_SIZE, mkcl_aet_object);
+
+  cache->vector.self.t[0] = mk_cl_Cnil;
+  mkcl_return_value(cache);
+}
+
+mkcl_object
+mk_si_fill_slot_cache(MKCL, mkcl_object cache, mkcl_object x, mkcl_object location)
+{
+  mkcl_object entry;
+
+  mkcl_call_stack_check(env);
+  cache = check_slot_cache(env, MK_SI_fill_slot_cache, cache);
+  if (mkcl_unlikely(!MKCL_INSTANCEP(x)))
+    mkcl_FEtype_error_instance(env, x);
+  if (mkcl_unlikely(!MKCL_FIXNUMP(location) || mkcl_fixnum_to_word(location) < 0
+                    || mkcl_fixnum_to_word(location) >= x->instance.length))
+    mkcl_FEtype_error_instance_index(env, x, location);
+
+  entry = MKCL_CONS(env, x->instance.sig, MKCL_CONS(env, mkcl_core.slot_cache_generation, location));
+  __atomic_store_n(cache->vector.self.t, entry, __ATOMIC_RELEASE);
+  mkcl_return_value(cache);
+}
+
+mkcl_object
+mk_si_clear_slot_caches(MKCL)
+{
+  mkcl_object old = mkcl_core.slot_cache_generation;
+
+  while (!__atomic_compare_exchange_n(&mkcl_core.slot_cache_generation, &old,
+                                      MKCL_MAKE_FIXNUM(mkcl_fixnum_to_word(old) + 1),
+                                      FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  mkcl_return_value(mk_cl_Cnil);
+}
+
+mkcl_object
+mkcl_slot_cache_miss(MKCL, mkcl_object cache, enum mkcl_slot_cache_op op,
+                     mkcl_object x, mkcl_object name, mkcl_object value)
+{
+  static mkcl_object const ops[] = { MK_CL_slot_value, MK_CL_slot_boundp, MK_CL_setf };
+
+  return mk_cl_funcall(env, 6, MK_CLOS_slot_cache_miss->symbol.gfdef, cache, ops[op], x, name, value);
+}
+
+mkcl_object
+mk_si_cached_slot_value(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache)
+{
+  mkcl_call_stack_check(env);
+  cache = check_slot_cache(env, MK_SI_cached_slot_value, cache);
+  mkcl_return_value(mkcl_cached_slot_value(env, x, name, cache));
+}
+
+mkcl_object
+mk_si_cached_slot_boundp(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache)
+{
+  mkcl_call_stack_check(env);
+  cache = check_slot_cache(env, MK_SI_cached_slot_boundp, cache);
+  mkcl_return_value(mkcl_cached_slot_boundp(env, x, name, cache));
+}
+
+mkcl_object
+mk_si_cached_slot_set(MKCL, mkcl_object value, mkcl_object x, mkcl_object name, mkcl_object cache)
+{
+  mkcl_call_stack_check(env);
+  cache = check_slot_cache(env, MK_SI_cached_slot_set, cache);
+  mkcl_return_value(mkcl_cached_slot_set(env, value, x, name, cache));
+}
+
 mkcl_object
 mk_si_copy_instance(MKCL, mkcl_object x)
 {
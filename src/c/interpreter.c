@@ -168,6 +168,9 @@ mkcl_lex_env_get_record(register mkcl_object lex_env, register int s)
 
 /* -------------------- AIDS TO THE INTERPRETER -------------------- */
 
+/* Native replacement of a bytecode function, see the promotion tier below. */
+#define PROMOTED_CODE(fun) __atomic_load_n(&(fun)->bytecode.native, __ATOMIC_ACQUIRE)
+
 mkcl_object
 _mkcl_bytecode_dispatch_vararg(MKCL, mkcl_narg narg, ...)
 {
@@ -222,33 +225,210 @@ _mkcl_bclosure_dispatch_vararg(MKCL, mkcl_narg narg, ...)
 mkcl_object
 _mkcl_bclosure_dispatch_f0(MKCL)
 {
+  mkcl_object native = PROMOTED_CODE(env->function->bclosure.code);
+  if (!mkcl_Null(native)) {
+    env->function = native;
+    return native->cfun.f._[0](env);
+  }
   return _mkcl_bclosure_dispatch_vararg(env, 0);
 }
 
 mkcl_object
 _mkcl_bclosure_dispatch_f1(MKCL, mkcl_object x1)
 {
+  mkcl_object native = PROMOTED_CODE(env->function->bclosure.code);
+  if (!mkcl_Null(native)) {
+    env->function = native;
+    return native->cfun.f._[1](env, x1);
+  }
   return _mkcl_bclosure_dispatch_vararg(env, 1, x1);
 }
 
 mkcl_object
 _mkcl_bclosure_dispatch_f2(MKCL, mkcl_object x1, mkcl_object x2)
 {
+  mkcl_object native = PROMOTED_CODE(env->function->bclosure.code);
+  if (!mkcl_Null(native)) {
+    env->function = native;
+    return native->cfun.f._[2](env, x1, x2);
+  }
   return _mkcl_bclosure_dispatch_vararg(env, 2, x1, x2);
 }
 
 mkcl_object
 _mkcl_bclosure_dispatch_f3(MKCL, mkcl_object x1, mkcl_object x2, mkcl_object x3)
 {
+  mkcl_object native = PROMOTED_CODE(env->function->bclosure.code);
+  if (!mkcl_Null(native)) {
+    env->function = native;
+    return native->cfun.f._[3](env, x1, x2, x3);
+  }
   return _mkcl_bclosure_dispatch_vararg(env, 3, x1, x2, x3);
 }
 
 mkcl_object
 _mkcl_bclosure_dispatch_f4(MKCL, mkcl_object x1, mkcl_object x2, mkcl_object x3, mkcl_object x4)
 {
+  mkcl_object native = PROMOTED_CODE(env->function->bclosure.code);
+  if (!mkcl_Null(native)) {
+    env->function = native;
+    return native->cfun.f._[4](env, x1, x2, x3, x4);
+  }
   return _mkcl_bclosure_dispatch_vararg(env, 4, x1, x2, x3, x4);
 }
 
+/*
+ * Tiered execution. A bytecode function that does not use its lexical
+ * environment counts its invocations in bytecode.calls and, once the
+ * count reaches mkcl_core.bytecode_promotion_threshold, is handed to
+ * the Lisp hook SI::REQUEST-BYTECODE-PROMOTION which compiles it in the
+ * background (see mp.lsp). SI:PROMOTE-BYTECODE then stores the native
+ * function in bytecode.native and swaps the entry points of the bytecode
+ * object for the trampolines below, so that every existing reference to
+ * it now runs the native code. The closures made from it check
+ * bytecode.native on their own, see the bclosure dispatchers above.
+ * A calls count of -1 means that the function is not, or no longer, a
+ * candidate for promotion.
+ */
+
+static mkcl_object
+promoted_dispatch_vararg(MKCL, mkcl_narg narg, ...)
+{
+  mkcl_object output;
+  MKCL_TEMP_STACK_FRAME_VARARGS_BEGIN(env, narg, narg, frame) {
+    mkcl_object native = PROMOTED_CODE(frame->frame.env->function);
+    output = mkcl_apply_from_temp_stack_frame(env, frame, native);
+  } MKCL_TEMP_STACK_FRAME_VARARGS_END(frame);
+  return output;
+}
+
+static mkcl_object
+promoted_dispatch_f0(MKCL)
+{
+  mkcl_object native = PROMOTED_CODE(env->function);
+  env->function = native;
+  return native->cfun.f._[0](env);
+}
+
+static mkcl_object
+promoted_dispatch_f1(MKCL, mkcl_object x1)
+{
+  mkcl_object native = PROMOTED_CODE(env->function);
+  env->function = native;
+  return native->cfun.f._[1](env, x1);
+}
+
+static mkcl_object
+promoted_dispatch_f2(MKCL, mkcl_object x1, mkcl_object x2)
+{
+  mkcl_object native = PROMOTED_CODE(env->function);
+  env->function = native;
+  return native->cfun.f._[2](env, x1, x2);
+}
+
+static mkcl_object
+promoted_dispatch_f3(MKCL, mkcl_object x1, mkcl_object x2, mkcl_object x3)
+{
+  mkcl_object native = PROMOTED_CODE(env->function);
+  env->function = native;
+  return native->cfun.f._[3](env, x1, x2, x3);
+}
+
+static mkcl_object
+promoted_dispatch_f4(MKCL, mkcl_object x1, mkcl_object x2, mkcl_object x3, mkcl_object x4)
+{
+  mkcl_object native = PROMOTED_CODE(env->function);
+  env->function = native;
+  return native->cfun.f._[4](env, x1, x2, x3, x4);
+}
+
+static void
+request_promotion(MKCL, mkcl_object bytecode, mkcl_word calls)
+{
+  /* Only the thread that wins the exchange submits the function. The
+     counter is otherwise updated without synchronization, so a race can
+     at worst delay the promotion or submit the function twice. */
+  if (__atomic_compare_exchange_n(&bytecode->bytecode.calls, &calls, -1, FALSE,
+				  __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    mkcl_object hook = MKCL_SYM_FUN(MK_SI_request_bytecode_promotion);
+    mkcl_object this_func = env->function;
+    mkcl_object queued = mk_cl_Cnil;
+
+    if (hook != MKCL_OBJNULL && !mkcl_Null(hook))
+      queued = mkcl_funcall1(env, hook, bytecode);
+    env->function = this_func;
+    if (mkcl_Null(queued)) /* Try again later. */
+      __atomic_store_n(&bytecode->bytecode.calls, 0, __ATOMIC_RELAXED);
+  }
+}
+
+mkcl_object
+mk_si_promote_bytecode(MKCL, mkcl_object bytecode, mkcl_object native)
+{
+  mkcl_call_stack_check(env);
+  if (mkcl_type_of(bytecode) != mkcl_t_bytecode)
+    mkcl_FEwrong_type_argument(env, MK_CL_compiled_function, bytecode);
+  switch (mkcl_type_of(native)) {
+  case mkcl_t_cfun:
+  case mkcl_t_cclosure:
+    break;
+  default:
+    /* Compilation failed, leave it interpreted for good. */
+    __atomic_store_n(&bytecode->bytecode.calls, -1, __ATOMIC_RELAXED);
+    mkcl_return_value(mk_cl_Cnil);
+  }
+  __atomic_store_n(&bytecode->bytecode.calls, -1, __ATOMIC_RELAXED);
+  __atomic_store_n(&bytecode->bytecode.native, native, __ATOMIC_RELEASE);
+  /* The trampolines only read bytecode.native, which is already set,
+     so a caller may see any mix of old and new entry points. */
+  __atomic_store_n(&bytecode->bytecode.f.entry, promoted_dispatch_vararg, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytecode->bytecode.f._[0], promoted_dispatch_f0, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytecode->bytecode.f._[1], promoted_dispatch_f1, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytecode->bytecode.f._[2], promoted_dispatch_f2, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytecode->bytecode.f._[3], promoted_dispatch_f3, __ATOMIC_RELEASE);
+  __atomic_store_n(&bytecode->bytecode.f._[4], promoted_dispatch_f4, __ATOMIC_RELEASE);
+  mkcl_return_value(mk_cl_Ct);
+}
+
+mkcl_object
+mk_si_set_bytecode_promotion_threshold(MKCL, mkcl_object threshold)
+{
+  mkcl_word old = mkcl_core.bytecode_promotion_threshold;
+
+  mkcl_call_stack_check(env);
+  mkcl_core.bytecode_promotion_threshold
+    = mkcl_fixnum_in_range(env, MK_SI_set_bytecode_promotion_threshold, "threshold",
+			   threshold, 0, MKCL_MOST_POSITIVE_FIXNUM);
+  mkcl_return_value(MKCL_MAKE_FIXNUM(old));
+}
+
+#ifdef MKCL_DISPATCH_STATS
+mkcl_word mkcl_dispatch_stats[MKCL_STAT_COUNT];
+#endif
+
+mkcl_object
+mk_si_bytecode_dispatch_stats(MKCL, mkcl_object reset)
+{
+  mkcl_call_stack_check(env);
+#ifdef MKCL_DISPATCH_STATS
+  {
+    mkcl_word counts[MKCL_STAT_COUNT];
+    int i;
+
+    for (i = 0; i < MKCL_STAT_COUNT; i++)
+      counts[i] = (mkcl_Null(reset)
+		   ? __atomic_load_n(&mkcl_dispatch_stats[i], __ATOMIC_RELAXED)
+		   : __atomic_exchange_n(&mkcl_dispatch_stats[i], 0, __ATOMIC_RELAXED));
+    mkcl_return_3_values(mkcl_make_integer(env, counts[MKCL_STAT_DISPATCHES]),
+			 mkcl_make_integer(env, counts[MKCL_STAT_CALLG_HITS]),
+			 mkcl_make_integer(env, counts[MKCL_STAT_CALLG_MISSES]));
+  }
+#else
+  /* Not counted in this build. */
+  mkcl_return_value(mk_cl_Cnil);
+#endif
+}
+
 
 static mkcl_object
 close_around(MKCL, mkcl_object producer, mkcl_object fun, mkcl_object lex)
@@ -280,6 +460,59 @@ mkcl_clone_bclosure(MKCL, mkcl_object c0, mkcl_object new_lex)
 
 #define SETUP_ENV(the_env) { ihs.lex_env = lex_env; }
 
+/*
+ * Inline caches for OP_CALLG. Each call site owns a slot in the data
+ * vector of its bytecode holding a cons (FUNCTION . KIND), initially
+ * (NIL . NIL). FUNCTION is the definition of the called symbol at the
+ * time of the last miss and KIND says how to invoke it. The cons is
+ * never modified, only replaced as a whole, so that other threads
+ * running the same bytecode always see a consistent pair. Generic
+ * functions are not cached since their dispatch may change without
+ * the definition of the symbol changing.
+ */
+
+enum {
+  CALL_CACHE_FIXED = 1,	/* cfun of matching fixed arity */
+  CALL_CACHE_APPLY,	/* cfun with variable arity or cclosure */
+  CALL_CACHE_BYTECODE,
+  CALL_CACHE_BCLOSURE
+};
+
+static void
+fill_call_cache(MKCL, mkcl_object *cache, mkcl_object name, mkcl_index narg)
+{
+  mkcl_object fun;
+  int kind;
+
+  if (mkcl_type_of(name) != mkcl_t_symbol || (name->symbol.stype & mkcl_stp_macro))
+    return;
+  fun = MKCL_SYM_FUN(name);
+  if (fun == MKCL_OBJNULL || mkcl_Null(fun))
+    return;
+  switch (mkcl_type_of(fun)) {
+  case mkcl_t_cfun:
+    if (fun->cfun.narg < 0)
+      kind = CALL_CACHE_APPLY;
+    else if ((mkcl_index) fun->cfun.narg == narg && narg < MKCL_MAX_FAST_FUNC_DISPATCH)
+      kind = CALL_CACHE_FIXED;
+    else
+      return;
+    break;
+  case mkcl_t_cclosure:
+    kind = CALL_CACHE_APPLY;
+    break;
+  case mkcl_t_bytecode:
+    kind = CALL_CACHE_BYTECODE;
+    break;
+  case mkcl_t_bclosure:
+    kind = CALL_CACHE_BCLOSURE;
+    break;
+  default:
+    return;
+  }
+  __atomic_store_n(cache, MKCL_CONS(env, fun, MKCL_MAKE_FIXNUM(kind)), __ATOMIC_RELEASE);
+}
+
 /*
  * INTERPRET-FUNCALL is one of the few ways to "exit" the interpreted
  * environment and get into the C/lisp world. Since almost all data
@@ -322,6 +555,23 @@ mkcl_interpret(MKCL, mkcl_object frame, mkcl_object lex_env, mkcl_object bytecod
 #else
   mkcl_call_stack_check(env, ihs);
 #endif
+  {
+    /* Callers that went around the entry points, such as apply or the
+       OP_CALLG cache, still reach the promoted version from here. Such
+       a function does not use LEX_ENV, see mkcl_make_lambda(). */
+    mkcl_object native = PROMOTED_CODE(bytecode);
+    if (!mkcl_Null(native)) {
+      env->function = native;
+      return mkcl_apply_from_temp_stack_frame(env, frame, native);
+    } else {
+      mkcl_word calls = bytecode->bytecode.calls;
+      if (calls >= 0 && mkcl_core.bytecode_promotion_threshold > 0) {
+	bytecode->bytecode.calls = ++calls;
+	if (calls >= mkcl_core.bytecode_promotion_threshold)
+	  request_promotion(env, bytecode, calls);
+      }
+    }
+  }
   mkcl_ihs_push(env, &ihs, bytecode, lex_env);
   frame_aux.t = mkcl_t_temp_stack_frame;
   frame_aux.stack = frame_aux.base = 0;
@@ -489,14 +739,53 @@ mkcl_interpret(MKCL, mkcl_object frame, mkcl_object lex_env, mkcl_object bytecod
       goto DO_CALL;
     }
 
-    /* OP_CALLG	n{arg}, name{arg}
+    /* OP_CALLG	n{arg}, name{arg}, cache{arg}
        Calls the function NAME with N arguments which have been
        deposited in the stack. The first output value is pushed on
-       the stack.
+       the stack. CACHE is the data slot of this call site, see
+       fill_call_cache(); while it matches the definition of NAME the
+       function is invoked directly instead of through DO_CALL.
     */
     CASE(OP_CALLG); {
+      mkcl_oparg cache_ndx;
+      mkcl_object cache, fun;
       GET_OPARG(narg, vector);
       GET_DATA(reg0, vector, data);
+      GET_OPARG(cache_ndx, vector);
+      cache = data[cache_ndx];
+      fun = MKCL_CONS_CAR(cache);
+      if (!mkcl_Null(fun) && fun == MKCL_SYM_FUN(reg0)
+	  && !(reg0->symbol.stype & mkcl_stp_macro)) {
+	mkcl_object *args = env->temp_stack_top - narg;
+	SETUP_ENV(env);
+	switch (mkcl_fixnum_to_word(MKCL_CONS_CDR(cache))) {
+	case CALL_CACHE_FIXED:
+	  env->function = fun;
+	  reg0 = mkcl_APPLY_fixed(env, narg, fun->cfun.f._[narg], args);
+	  break;
+	case CALL_CACHE_APPLY:
+	  env->function = fun;
+	  reg0 = mkcl_APPLY(env, narg, fun, args);
+	  break;
+	case CALL_CACHE_BYTECODE:
+	  frame_aux.size = narg;
+	  frame_aux.base = args;
+	  env->function = fun;
+	  reg0 = mkcl_interpret(env, (mkcl_object)&frame_aux, mk_cl_Cnil, fun);
+	  break;
+	case CALL_CACHE_BCLOSURE:
+	  frame_aux.size = narg;
+	  frame_aux.base = args;
+	  env->function = fun->bclosure.code;
+	  reg0 = mkcl_interpret(env, (mkcl_object)&frame_aux, fun->bclosure.lex, fun->bclosure.code);
+	  break;
+	}
+	MKCL_TEMP_STACK_POP_N_UNSAFE(env, narg);
+	COUNT_STAT(MKCL_STAT_CALLG_HITS);
+	THREAD_NEXT;
+      }
+      COUNT_STAT(MKCL_STAT_CALLG_MISSES);
+      fill_call_cache(env, &data[cache_ndx], reg0, narg);
       goto DO_CALL;
     }
 
@@ -1360,6 +1649,77 @@ mkcl_interpret(MKCL, mkcl_object frame, mkcl_object lex_env, mkcl_object bytecod
       reg0 = env->values[0];
       THREAD_NEXT;
     }
+
+    /* Superinstructions. The compiler rewrites the opcode of the
+       first instruction of some frequent pairs into one of these.
+       Each does the work of that first instruction and then runs
+       the second one, which is still in place, without going
+       through the dispatch table.
+    */
+    CASE(OP_VAR_CAR); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_CAR);
+    }
+    CASE(OP_VAR_CDR); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_CDR);
+    }
+    CASE(OP_VAR_NOT); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_NOT);
+    }
+    CASE(OP_VAR_JNIL); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_JNIL);
+    }
+    CASE(OP_VAR_JT); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_JT);
+    }
+    CASE(OP_VAR_CALLG1); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      reg0 = mkcl_lex_env_get_var(lex_env, lex_env_index);
+      THREAD_TO(OP_CALLG1);
+    }
+    CASE(OP_PUSHV_VAR); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      MKCL_TEMP_STACK_PUSH(env, mkcl_lex_env_get_var(lex_env, lex_env_index));
+      THREAD_TO(OP_VAR);
+    }
+    CASE(OP_PUSHV_PUSHV); {
+      int lex_env_index;
+      GET_OPARG(lex_env_index, vector);
+      MKCL_TEMP_STACK_PUSH(env, mkcl_lex_env_get_var(lex_env, lex_env_index));
+      THREAD_TO(OP_PUSHV);
+    }
+    CASE(OP_PUSH_CALLG); {
+      MKCL_TEMP_STACK_PUSH(env, reg0);
+      THREAD_TO(OP_CALLG);
+    }
+    CASE(OP_POPREQ_BIND); {
+      if (frame_index >= frame->frame.size) {
+	mkcl_FEwrong_num_arguments(env, bytecode->bytecode.name,
+                                   frame->frame.size, frame->frame.size, frame_index);
+      }
+      reg0 = frame->frame.base[frame_index++];
+      THREAD_TO(OP_BIND);
+    }
+    CASE(OP_NOT_JNIL); {
+      reg0 = (reg0 == mk_cl_Cnil)? mk_cl_Ct : mk_cl_Cnil;
+      THREAD_TO(OP_JNIL);
+    }
   }
 }
 
@@ -25,6 +25,10 @@
 # define INIT_PREFIX "mkcl_init_fas_"
 #endif
 
+#if MKCL_UNIX
+# include <sys/mman.h>
+#endif
+
 #if MKCL_WINDOWS
 # include <windows.h>
 # include <windef.h>
@@ -371,6 +375,14 @@ bool mkcl_library_close(MKCL, mkcl_object block)
       if (!error)
 	block->cblock.handle = NULL; /* In an attempt to prevent closing the same library twice. JCB */
     }
+#if MKCL_UNIX
+  if (block->cblock.image != NULL)
+    {
+      MKCL_LIBC_NO_INTR(env, error = munmap(block->cblock.image, block->cblock.image_size));
+      if (!error)
+	block->cblock.image = NULL;
+    }
+#endif
   if (block->cblock.self_destruct)
     {
 #if MKCL_WINDOWS
@@ -475,6 +487,218 @@ mk_si_load_binary(MKCL, mkcl_object filename, mkcl_object verbose, mkcl_object p
   mkcl_return_value(output);
 }
 
+/*
+ * In-memory compilation of C source through libmkcc, the library form
+ * of the bundled mkcc (TinyCC). The library is opened on first use only,
+ * so that a missing or broken one merely leaves this facility unavailable.
+ * libmkcc keeps global state, hence all of this runs with
+ * mt::+load-compile-lock+ held.
+ */
+
+#if MKCL_UNIX
+
+#define MKCC_OUTPUT_MEMORY 1 /* see contrib/tinycc/libmkcc.h */
+
+static struct mkcc_api {
+  void *handle;
+  void *(*create)(void);
+  void (*destroy)(void *s);
+  void (*set_lib_path)(void *s, const char *path);
+  void (*set_error_func)(void *s, void *opaque, void (*error_func)(void *opaque, const char *msg));
+  int (*set_options)(void *s, const char *str);
+  int (*add_include_path)(void *s, const char *pathname);
+  int (*set_output_type)(void *s, int output_type);
+  int (*compile_string)(void *s, const char *buf);
+  int (*add_file)(void *s, const char *filename, int filetype);
+  int (*relocate)(void *s, void *ptr);
+  void *(*get_symbol)(void *s, const char *name);
+} mkcc_api;
+
+static mkcl_object
+open_mkcc_library(MKCL, mkcl_object library) /* Returns NIL or an error message. */
+{
+  struct mkcc_api api;
+  mkcl_object os_library;
+  bool complete;
+
+  if (mkcc_api.handle != NULL)
+    return mk_cl_Cnil;
+
+  os_library = mk_si_utf_8(env, library);
+  MKCL_LIBC_NO_INTR(env, api.handle = dlopen((char *) os_library->UTF_8.self, RTLD_NOW|RTLD_LOCAL));
+  if (api.handle == NULL)
+    return mkcl_library_error(env, mk_cl_Cnil);
+
+#define MKCC_ENTRY(field, name) (*(void **) &api.field = dlsym(api.handle, name)) != NULL
+  MKCL_LIBC_NO_INTR(env, complete = (MKCC_ENTRY(create, "mkcc_new")
+                                     && MKCC_ENTRY(destroy, "mkcc_delete")
+                                     && MKCC_ENTRY(set_lib_path, "mkcc_set_lib_path")
+                                     && MKCC_ENTRY(set_error_func, "mkcc_set_error_func")
+                                     && MKCC_ENTRY(set_options, "mkcc_set_options")
+                                     && MKCC_ENTRY(add_include_path, "mkcc_add_include_path")
+                                     && MKCC_ENTRY(set_output_type, "mkcc_set_output_type")
+                                     && MKCC_ENTRY(compile_string, "mkcc_compile_string")
+                                     && MKCC_ENTRY(add_file, "mkcc_add_file")
+                                     && MKCC_ENTRY(relocate, "mkcc_relocate")
+                                     && MKCC_ENTRY(get_symbol, "mkcc_get_symbol")));
+#undef MKCC_ENTRY
+  if (!complete) {
+    mkcl_object output = mkcl_library_error(env, mk_cl_Cnil);
+    MKCL_LIBC_NO_INTR(env, dlclose(api.handle));
+    return output;
+  }
+  mkcc_api = api;
+  return mk_cl_Cnil;
+}
+
+struct mkcc_messages {
+  mkcl_env env;
+  mkcl_object messages;
+};
+
+static void
+collect_mkcc_message(void *opaque, const char *msg)
+{
+  struct mkcc_messages *m = opaque;
+  const mkcl_env env = m->env;
+
+  m->messages = MKCL_CONS(env, mkcl_cstring_to_string(env, (char *) msg), m->messages);
+}
+
+/* Options come first, "-I" and "-B" ones taken whole so that paths may hold spaces.
+   Anything not an option names a file to link against once the source is compiled.
+   Returns the size of the relocated image, or -1. */
+static int
+mkcc_compile(void *s, struct mkcc_messages *m, const char *source, char **options, mkcl_index nb_options)
+{
+  mkcl_index i;
+
+  mkcc_api.set_error_func(s, m, collect_mkcc_message);
+  for (i = 0; i < nb_options; i++)
+    if (options[i][0] != '-')
+      continue;
+    else if (options[i][1] == 'I')
+      mkcc_api.add_include_path(s, options[i] + 2);
+    else if (options[i][1] == 'B')
+      mkcc_api.set_lib_path(s, options[i] + 2);
+    else if (mkcc_api.set_options(s, options[i]) == -1)
+      return -1;
+  /* Adds the system include paths, under "-B". */
+  if (mkcc_api.set_output_type(s, MKCC_OUTPUT_MEMORY) == -1)
+    return -1;
+  if (mkcc_api.compile_string(s, source) == -1)
+    return -1;
+  for (i = 0; i < nb_options; i++)
+    if (options[i][0] != '-' && mkcc_api.add_file(s, options[i], 0) == -1)
+      return -1;
+  return mkcc_api.relocate(s, NULL);
+}
+
+/* Returns NIL once the code is loaded, T if this system will not let
+   memory be made executable, or else an error message. */
+static mkcl_object
+mkcc_load(MKCL, mkcl_object source, mkcl_object init_name, mkcl_object options)
+{
+  struct mkcc_messages m = { env, mk_cl_Cnil };
+  void (*entry)(MKCL, mkcl_object, mkcl_object) = NULL;
+  const char *c_source = (char *) mk_si_utf_8(env, source)->UTF_8.self;
+  const char *c_init_name = (char *) mk_si_utf_8(env, init_name)->UTF_8.self;
+  mkcl_index i, nb_options = mkcl_length(env, options);
+  char **c_options = mkcl_alloc(env, (nb_options + 1) * sizeof(char *));
+  void *image = NULL;
+  int not_executable = FALSE;
+  void *s;
+  int size;
+
+  for (i = 0; i < nb_options; i++, options = MKCL_CONS_CDR(options))
+    c_options[i] = (char *) mk_si_utf_8(env, mkcl_check_type_string(env, MK_SI_load_c_source, MKCL_CONS_CAR(options)))->UTF_8.self;
+
+  MKCL_LIBC_NO_INTR(env, s = mkcc_api.create());
+  if (s == NULL)
+    return mkcl_make_simple_base_string(env, "mkcc_new() failed.");
+  MKCL_LIBC_NO_INTR(env, size = mkcc_compile(s, &m, c_source, c_options, nb_options));
+  if (size != -1) {
+    /* A mapping of its own, so that making it executable touches no other data.
+       The GC needs not scan it: like those of a shared library, the constants
+       of the code live in the heap, held by its codeblock. */
+    MKCL_LIBC_NO_INTR(env, image = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+    if (image == MAP_FAILED) {
+      image = NULL;
+      m.messages = MKCL_CONS(env, mkcl_make_simple_base_string(env, "Could not map memory for the code."), m.messages);
+    } else {
+      int relocated;
+
+      MKCL_LIBC_NO_INTR(env, relocated = mkcc_api.relocate(s, image));
+      if (relocated != -1) {
+        /* libmkcc does this too but ignores the outcome. */
+        MKCL_LIBC_NO_INTR(env, not_executable = mprotect(image, size, PROT_READ|PROT_WRITE|PROT_EXEC));
+        if (!not_executable)
+          MKCL_LIBC_NO_INTR(env, *(void **) &entry = mkcc_api.get_symbol(s, c_init_name));
+      }
+      if (entry == NULL && !not_executable && mkcl_Null(m.messages))
+        m.messages = mkcl_list1(env, mkcl_make_simple_base_string(env, "Initialization function not found."));
+      if (entry == NULL)
+        MKCL_LIBC_NO_INTR(env, munmap(image, size));
+    }
+  }
+  MKCL_LIBC_NO_INTR(env, mkcc_api.destroy(s));
+
+  if (not_executable)
+    return mk_cl_Ct; /* Forbidden here, COMPILE goes through a file instead. */
+  else if (entry == NULL) {
+    mkcl_object output = mkcl_make_simple_base_string(env, "");
+    mkcl_object l;
+
+    /* libmkcc does not fully recover its global state after a compilation error,
+       so the next compilation gets a freshly loaded copy of it. */
+    MKCL_LIBC_NO_INTR(env, dlclose(mkcc_api.handle));
+    mkcc_api.handle = NULL;
+
+    for (l = mk_cl_nreverse(env, m.messages); MKCL_CONSP(l); l = MKCL_CONS_CDR(l))
+      output = mkcl_concatenate_3_strings(env, output, MKCL_CONS_CAR(l), mkcl_make_simple_base_string(env, "\n"));
+    return output;
+  } else {
+    mkcl_object block = mkcl_alloc_raw_codeblock(env);
+
+    block->cblock.name = init_name;
+    block->cblock.image = image; /* Kept as long as any of its functions is. */
+    block->cblock.image_size = size;
+    mk_si_set_finalizer(env, block, mk_cl_Ct); /* Unmaps the image. */
+    mkcl_read_VV(env, block, entry, mk_cl_Cnil);
+    return mk_cl_Cnil;
+  }
+}
+
+#endif /* MKCL_UNIX */
+
+mkcl_object
+mk_si_load_c_source(MKCL, mkcl_object source, mkcl_object init_name, mkcl_object library, mkcl_object options)
+{
+  mkcl_object l_c_lock;
+  volatile mkcl_object locked = mk_cl_Cnil;
+  volatile mkcl_object output = mk_cl_Cnil;
+
+  mkcl_call_stack_check(env);
+  source = mkcl_check_type_string(env, MK_SI_load_c_source, source);
+  init_name = mkcl_check_type_string(env, MK_SI_load_c_source, init_name);
+  library = mk_si_coerce_to_filename(env, library);
+
+  l_c_lock = mkcl_symbol_value(env, MK_MT_CONSTANT_load_compile_lock);
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    MKCL_NO_INTR(env, locked = mk_mt_get_lock(env, 1, l_c_lock));
+#if MKCL_UNIX
+    output = open_mkcc_library(env, library);
+    if (mkcl_Null(output))
+      output = mkcc_load(env, source, init_name, options);
+#else
+    output = mkcl_make_simple_base_string(env, "In-memory compilation is not available on this platform.");
+#endif
+  } MKCL_UNWIND_PROTECT_EXIT {
+    if (!mkcl_Null(locked)) mk_mt_giveup_lock(env, l_c_lock);
+  } MKCL_UNWIND_PROTECT_END;
+  mkcl_return_value(output);
+}
+
 mkcl_object
 mk_si_load_source(MKCL, mkcl_object source, mkcl_object verbose, mkcl_object print, mkcl_object external_format)
 {
@@ -411,6 +411,8 @@ static void _mkcl_boot_inner(MKCL)
   mkcl_core.gc_counter = mk_cl_Cnil;
   mkcl_core.gc_fast_counter = 0;
   mkcl_core.gc_stats = FALSE;
+  mkcl_core.alloc_samples = mk_cl_Cnil;
+  mkcl_core.slot_cache_generation = MKCL_MAKE_FIXNUM(0);
 
   mkcl_core.empty_base_string = mkcl_make_simple_base_string(env, "");
   mkcl_core.empty_string = mk_si_coerce_to_character_string(env, mkcl_core.empty_base_string);
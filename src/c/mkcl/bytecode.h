@@ -95,6 +95,18 @@ enum {
   OP_STEPIN,
   OP_STEPCALL,
   OP_STEPOUT,
+  /* Superinstructions, see superinstructions[] in compiler.c */
+  OP_VAR_CAR,
+  OP_VAR_CDR,
+  OP_VAR_NOT,
+  OP_VAR_JNIL,
+  OP_VAR_JT,
+  OP_VAR_CALLG1,
+  OP_PUSHV_VAR,
+  OP_PUSHV_PUSHV,
+  OP_PUSH_CALLG,
+  OP_POPREQ_BIND,
+  OP_NOT_JNIL,
   OP_MAXOPCODES = 128,
   OP_OPCODE_SHIFT = 7
 };
@@ -151,22 +163,49 @@ typedef int16_t mkcl_oparg;
 #define MKCL_THREADED_INTERPRETER
 #endif
 
+/*
+ * Building with -DMKCL_DISPATCH_STATS makes the interpreter count its
+ * dispatches and the hits and misses of its OP_CALLG caches, and lets
+ * SI::*BYTECODE-SUPERINSTRUCTIONS* turn superinstructions off in the
+ * compiler. See SI:BYTECODE-DISPATCH-STATS and src/util/dispatch.lsp.
+ */
+#ifdef MKCL_DISPATCH_STATS
+enum {
+  MKCL_STAT_DISPATCHES,
+  MKCL_STAT_CALLG_HITS,
+  MKCL_STAT_CALLG_MISSES,
+  MKCL_STAT_COUNT
+};
+extern mkcl_word mkcl_dispatch_stats[MKCL_STAT_COUNT];
+#define COUNT_STAT(i) \
+	__atomic_add_fetch(&mkcl_dispatch_stats[i], 1, __ATOMIC_RELAXED)
+#else
+#define COUNT_STAT(i)
+#endif
+
 #ifdef MKCL_THREADED_INTERPRETER
 #define BEGIN_SWITCH \
 	THREAD_NEXT;
 #define CASE(name) \
 	LBL_##name:
 #define THREAD_NEXT \
-	goto *(&&LBL_OP_NOP + offsets[GET_OPCODE(vector)])
+	{ COUNT_STAT(MKCL_STAT_DISPATCHES); \
+	  goto *(&&LBL_OP_NOP + offsets[GET_OPCODE(vector)]); }
 #else
 #define BEGIN_SWITCH \
+	COUNT_STAT(MKCL_STAT_DISPATCHES); \
 	switch (GET_OPCODE(vector))
 #define THREAD_NEXT \
 	goto BEGIN
 #define CASE(name) \
-	case name:
+	case name: LBL_##name:
 #endif
 
+/* Used by superinstructions to skip the opcode of the instruction
+   that follows them and run its handler without a dispatch. */
+#define THREAD_TO(name) \
+	{ vector += OPCODE_SIZE; goto LBL_##name; }
+
 #if !defined(MKCL_THREADED_INTERPRETER)
 #define MKCL_OFFSET_TABLE
 #else
@@ -252,7 +291,18 @@ typedef int16_t mkcl_oparg;
   &&LBL_OP_PUSHNIL - &&LBL_OP_NOP,\
   &&LBL_OP_STEPIN - &&LBL_OP_NOP,\
   &&LBL_OP_STEPCALL - &&LBL_OP_NOP,\
-  &&LBL_OP_STEPOUT - &&LBL_OP_NOP };
+  &&LBL_OP_STEPOUT - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_CAR - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_CDR - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_NOT - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_JNIL - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_JT - &&LBL_OP_NOP,\
+  &&LBL_OP_VAR_CALLG1 - &&LBL_OP_NOP,\
+  &&LBL_OP_PUSHV_VAR - &&LBL_OP_NOP,\
+  &&LBL_OP_PUSHV_PUSHV - &&LBL_OP_NOP,\
+  &&LBL_OP_PUSH_CALLG - &&LBL_OP_NOP,\
+  &&LBL_OP_POPREQ_BIND - &&LBL_OP_NOP,\
+  &&LBL_OP_NOT_JNIL - &&LBL_OP_NOP };
 #endif
 
 #endif /* MKCL_BYTECODE_H */
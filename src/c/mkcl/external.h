@@ -151,6 +151,7 @@ extern "C" {
 
     volatile double fp_drone;
     struct mkcl_alloc_stats * alloc;
+    struct mkcl_alloc_buffers * alloc_buffers; /* per-thread free lists of small objects. */
 
     /* Re-initialization parameters */
     char * cs_org_request;
@@ -256,6 +257,10 @@ extern "C" {
     mkcl_object gc_counter;
     long gc_fast_counter;
     bool gc_stats;
+    mkcl_object alloc_samples; /* list of (backtrace . bytes), see alloc_2.c */
+    volatile mkcl_object slot_cache_generation; /* a fixnum, see instance.c */
+    mkcl_object * cpu_samples; /* raw CPU profile, see unixint.c */
+    mkcl_word bytecode_promotion_threshold; /* 0 if off, see interpreter.c */
 
     long path_max;
     long name_max;
@@ -350,6 +355,9 @@ extern "C" {
   extern MKCL_API mkcl_object mkcl_unpin(MKCL, mkcl_object pin);
 
   extern MKCL_API mkcl_object mk_si_sample_allocation_statistics(MKCL);
+  extern MKCL_API mkcl_object mk_si_start_allocation_sampling(MKCL, mkcl_object interval);
+  extern MKCL_API mkcl_object mk_si_stop_allocation_sampling(MKCL);
+  extern MKCL_API mkcl_object mk_si_allocation_samples(MKCL);
   extern MKCL_API mkcl_object mk_si_reset_allocation_statistics(MKCL);
   extern MKCL_API mkcl_object mk_si_room_report(MKCL, mkcl_object label);
 
@@ -720,6 +728,9 @@ extern "C" {
   extern MKCL_API mkcl_object mkcl_interpret(MKCL, mkcl_object frame, mkcl_object lenv, mkcl_object bytecode);
   extern MKCL_API mkcl_object _mkcl_bytecode_dispatch(MKCL, mkcl_narg narg, ...);
   extern MKCL_API mkcl_object _mkcl_bclosure_dispatch(MKCL, mkcl_narg narg, ...);
+  extern MKCL_API mkcl_object mk_si_promote_bytecode(MKCL, mkcl_object bytecode, mkcl_object native);
+  extern MKCL_API mkcl_object mk_si_set_bytecode_promotion_threshold(MKCL, mkcl_object threshold);
+  extern MKCL_API mkcl_object mk_si_bytecode_dispatch_stats(MKCL, mkcl_object reset);
 
   /* disassembler.c */
 
@@ -908,6 +919,7 @@ extern "C" {
   extern MKCL_API mkcl_object mk_cl_file_string_length(MKCL, mkcl_object stream, mkcl_object string);
   extern MKCL_API mkcl_object mk_si_do_write_sequence(MKCL, mkcl_object string, mkcl_object stream, mkcl_object start, mkcl_object end);
   extern MKCL_API mkcl_object mk_si_do_read_sequence(MKCL, mkcl_object string, mkcl_object stream, mkcl_object start, mkcl_object end);
+  extern MKCL_API mkcl_object mk_mkcl_write_octet_vectors(MKCL, mkcl_object stream, mkcl_object vectors);
   extern MKCL_API mkcl_object mk_si_file_column(MKCL, mkcl_object strm);
   extern MKCL_API mkcl_object mk_cl_interactive_stream_p(MKCL, mkcl_object strm);
   extern MKCL_API mkcl_object mk_si_set_buffering_mode(MKCL, mkcl_object strm, mkcl_object mode);
@@ -989,6 +1001,8 @@ extern "C" {
   extern MKCL_API mkcl_object mk_cl_hash_table_rehash_threshold(MKCL, mkcl_object ht);
   extern MKCL_API mkcl_object mk_cl_hash_table_size(MKCL, mkcl_object ht);
   extern MKCL_API mkcl_object mk_cl_hash_table_test(MKCL, mkcl_object ht);
+  extern MKCL_API mkcl_object mk_mkcl_hash_table_synchronized_p(MKCL, mkcl_object ht);
+  extern MKCL_API mkcl_object mk_mkcl_hash_table_weakness(MKCL, mkcl_object ht);
   extern MKCL_API mkcl_object mk_si_hash_table_iterator(MKCL, mkcl_object ht);
   extern MKCL_API mkcl_object mk_cl_make_hash_table(MKCL, mkcl_narg narg, ...);
   extern MKCL_API mkcl_object mk_cl_gethash(MKCL, mkcl_narg narg, mkcl_object key, mkcl_object ht, ...);
@@ -1025,6 +1039,12 @@ extern "C" {
   extern MKCL_API mkcl_object mk_si_instance_sig(MKCL, mkcl_object x);
   extern MKCL_API mkcl_object mk_si_instance_sig_set(MKCL, mkcl_object x);
   extern MKCL_API mkcl_object mk_si_instance_sig_set2(MKCL, mkcl_object x, mkcl_object sig);
+  extern MKCL_API mkcl_object mk_si_make_slot_cache(MKCL);
+  extern MKCL_API mkcl_object mk_si_fill_slot_cache(MKCL, mkcl_object cache, mkcl_object x, mkcl_object location);
+  extern MKCL_API mkcl_object mk_si_clear_slot_caches(MKCL);
+  extern MKCL_API mkcl_object mk_si_cached_slot_value(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache);
+  extern MKCL_API mkcl_object mk_si_cached_slot_boundp(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache);
+  extern MKCL_API mkcl_object mk_si_cached_slot_set(MKCL, mkcl_object value, mkcl_object x, mkcl_object name, mkcl_object cache);
 
   extern MKCL_API mkcl_object mkcl_allocate_instance(MKCL, mkcl_object clas, mkcl_index size);
   extern MKCL_API mkcl_object mk_si_copy_instance(MKCL, mkcl_object x);
@@ -1166,6 +1186,7 @@ extern "C" {
 
   extern MKCL_API mkcl_object mk_si_load_source(MKCL, mkcl_object file, mkcl_object verbose, mkcl_object print, mkcl_object external_format);
   extern MKCL_API mkcl_object mk_si_load_binary(MKCL, mkcl_object file, mkcl_object verbose, mkcl_object print, mkcl_object external_format);
+  extern MKCL_API mkcl_object mk_si_load_c_source(MKCL, mkcl_object source, mkcl_object init_name, mkcl_object library, mkcl_object options);
   extern MKCL_API mkcl_object mk_cl_load(MKCL, mkcl_narg narg, mkcl_object pathname, ...);
 
   extern MKCL_API mkcl_object mk_si_list_libraries(MKCL);
@@ -1811,6 +1832,7 @@ extern "C" {
   extern MKCL_API mkcl_object mk_cl_clear_output(MKCL, mkcl_narg narg, ...);
   extern MKCL_API mkcl_object mk_si_write_object(MKCL, mkcl_object object, mkcl_object stream);
   extern MKCL_API mkcl_object mk_si_write_ugly_object(MKCL, mkcl_object object, mkcl_object stream);
+  extern MKCL_API mkcl_object mk_si_float_to_digits(MKCL, mkcl_object x);
 
   extern MKCL_API mkcl_object mkcl_princ(MKCL, mkcl_object obj, mkcl_object strm);
   extern MKCL_API mkcl_object mkcl_prin1(MKCL, mkcl_object obj, mkcl_object strm);
@@ -1889,6 +1911,7 @@ extern "C" {
   extern MKCL_API mkcl_object mk_cl_reverse(MKCL, mkcl_object x);
   extern MKCL_API mkcl_object mk_cl_nreverse(MKCL, mkcl_object x);
   extern MKCL_API mkcl_object mk_cl_subseq(MKCL, mkcl_narg narg, mkcl_object sequence, mkcl_object start, ...);
+  extern MKCL_API mkcl_object mk_si_sort_vector(MKCL, mkcl_object v, mkcl_object pred, mkcl_object key, mkcl_object stable);
 
   extern MKCL_API mkcl_object mkcl_elt(MKCL, mkcl_object seq, mkcl_word index);
   extern MKCL_API mkcl_object mkcl_elt_set(MKCL, mkcl_object seq, mkcl_word index, mkcl_object val);
@@ -2257,6 +2280,8 @@ extern "C" {
   extern MKCL_API mkcl_object mk_si_file_kind(MKCL, mkcl_narg narg, mkcl_object filespec, ...);
   extern MKCL_API mkcl_object mk_mkcl_getcwd(MKCL, mkcl_narg narg, ...);
   extern MKCL_API mkcl_object mk_mkcl_getpid(MKCL);
+  extern MKCL_API mkcl_object mk_mkcl_processor_count(MKCL);
+  extern MKCL_API mkcl_object mk_mkcl_fork(MKCL);
   extern MKCL_API mkcl_object mk_mkcl_gettid(MKCL);
   extern MKCL_API mkcl_object mk_mkcl_getuid(MKCL);
   extern MKCL_API mkcl_object mk_mkcl_chdir(MKCL, mkcl_narg narg, mkcl_object directory, ...);
@@ -2368,6 +2393,9 @@ extern "C" {
 
   extern MKCL_API mkcl_object mk_si_install_sigsegv_monitor(MKCL);
 
+  extern MKCL_API mkcl_object mk_si_start_cpu_profiling(MKCL, mkcl_object interval, mkcl_object max_samples);
+  extern MKCL_API mkcl_object mk_si_stop_cpu_profiling(MKCL);
+
   extern MKCL_API mkcl_object mk_si_setup_for_gdb(MKCL, mkcl_narg narg, ...);
 
   /* unixsys.c */
@@ -3822,6 +3850,62 @@ extern "C" {
     { x->instance.slots[i] = v; return(v); }
   }
 
+  /* Per call site slot location caches, see instance.c */
+
+  enum mkcl_slot_cache_op { mkcl_slot_cache_value, mkcl_slot_cache_boundp, mkcl_slot_cache_set };
+
+  extern MKCL_API mkcl_object mkcl_slot_cache_miss(MKCL, mkcl_object cache, enum mkcl_slot_cache_op op,
+                                                   mkcl_object x, mkcl_object name, mkcl_object value);
+
+  static inline mkcl_object * mkcl_slot_cache_lookup(mkcl_object x, mkcl_object cache)
+  {
+#if defined(__GNUC__) && !defined(__TINYC__)
+    const mkcl_object entry = __atomic_load_n(cache->vector.self.t, __ATOMIC_ACQUIRE);
+#else /* mkcc has no atomic builtins, a volatile load is what it emits anyway. */
+    const mkcl_object entry = *(mkcl_object volatile *) cache->vector.self.t;
+#endif
+
+    if (mkcl_likely(MKCL_INSTANCEP(x) && MKCL_CONSP(entry) && x->instance.sig == MKCL_CONS_CAR(entry)))
+      {
+        const mkcl_object rest = MKCL_CONS_CDR(entry);
+        const mkcl_index i = mkcl_fixnum_to_word(MKCL_CONS_CDR(rest));
+
+        if (mkcl_likely(MKCL_CONS_CAR(rest) == mkcl_core.slot_cache_generation && i < x->instance.length))
+          return x->instance.slots + i;
+      }
+    return NULL;
+  }
+
+  static inline mkcl_object mkcl_cached_slot_value(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache)
+  {
+    mkcl_object * const slot = mkcl_slot_cache_lookup(x, cache);
+
+    if (mkcl_likely(slot != NULL && *slot != MKCL_UNBOUND))
+      return *slot;
+    else
+      return mkcl_slot_cache_miss(env, cache, mkcl_slot_cache_value, x, name, mk_cl_Cnil);
+  }
+
+  static inline mkcl_object mkcl_cached_slot_boundp(MKCL, mkcl_object x, mkcl_object name, mkcl_object cache)
+  {
+    mkcl_object * const slot = mkcl_slot_cache_lookup(x, cache);
+
+    if (mkcl_likely(slot != NULL))
+      return ((*slot == MKCL_UNBOUND) ? mk_cl_Cnil : mk_cl_Ct);
+    else
+      return mkcl_slot_cache_miss(env, cache, mkcl_slot_cache_boundp, x, name, mk_cl_Cnil);
+  }
+
+  static inline mkcl_object mkcl_cached_slot_set(MKCL, mkcl_object value, mkcl_object x, mkcl_object name, mkcl_object cache)
+  {
+    mkcl_object * const slot = mkcl_slot_cache_lookup(x, cache);
+
+    if (mkcl_likely(slot != NULL))
+      return (*slot = value);
+    else
+      return mkcl_slot_cache_miss(env, cache, mkcl_slot_cache_set, x, name, value);
+  }
+
   /*********************************/
 
 #if MKCL_WINDOWS
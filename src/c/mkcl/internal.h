@@ -57,6 +57,11 @@ extern "C" {
   extern void mkcl_init_unixtime(MKCL);
   extern void mkcl_init_early_threads(MKCL);
   extern void mkcl_init_late_threads(MKCL);
+#if MKCL_PTHREADS
+  extern void mkcl_check_threads_before_fork(MKCL);
+  extern void mkcl_reinit_threads_after_fork(MKCL);
+  extern void mkcl_reinit_unixint_after_fork(MKCL);
+#endif
   extern void mkcl_init_env(MKCL, mkcl_env, struct mkcl_thread_init_parameters *);
   extern void mkcl_init_lib_LSP(MKCL, mkcl_object, mkcl_object);
 
@@ -103,6 +108,8 @@ extern "C" {
     int mode;
     bool coalesce;
     bool stepping;
+    mkcl_word last_op_pc;	/* Start of the last instruction, for superinstructions. */
+    mkcl_object lambdas;	/* (variables . captures-p) of each enclosing LAMBDA. */
   };
 
   typedef struct mkcl_compiler_env *mkcl_compiler_env_ptr;
@@ -326,9 +333,13 @@ extern "C" {
 #define MKCL_IO_FILE_ELT_TYPE(strm) (strm)->stream.object0
 #define MKCL_IO_FILE_FILENAME(strm) (strm)->stream.object1
 
+  extern void mkcl_sync_stream_buffer(MKCL, mkcl_object strm);
+  extern mkcl_character mkcl_read_line_into(MKCL, mkcl_object strm, mkcl_object token);
+
   /* hash.d */
   extern void mkcl_extend_hashtable(MKCL, mkcl_object hashtable);
   extern mkcl_object mkcl_make_hashtable_for_package(MKCL, mkcl_index hsize);
+  extern mkcl_object mkcl_hash_table_snapshot(MKCL, mkcl_object hashtable);
   extern mkcl_hash_value mkcl_hash_base_string(const mkcl_base_char *s, const mkcl_index len, mkcl_hash_value h);
   extern mkcl_hash_value mkcl_hash_full_string(const mkcl_character *s, const mkcl_index len, mkcl_hash_value h);
   extern mkcl_hash_value mkcl_hash_equal_package(MKCL, mkcl_object x);
@@ -343,6 +354,9 @@ extern "C" {
 #define MKCL_GFUN_NAME(x) ((x)->instance.slots[0]) /* hardcoded from clos/kernel.lsp */
 #define MKCL_GFUN_SPEC(x) ((x)->instance.slots[1]) /* hardcoded from clos/kernel.lsp */
 #define MKCL_GFUN_COMB(x) ((x)->instance.slots[2]) /* hardcoded from clos/kernel.lsp */
+#define MKCL_GFUN_DISPATCH_CACHE_INDEX 13 /* hardcoded from clos/kernel.lsp */
+#define MKCL_GFUN_DISPATCH_CACHE(x) ((x)->instance.slots[MKCL_GFUN_DISPATCH_CACHE_INDEX])
+#define MKCL_GFUN_MAX_SPEC_KEYS 63 /* specialized arguments beyond which dispatch is not cached */
 
   extern mkcl_object mkcl_FEnot_funcallable_vararg(MKCL, mkcl_narg narg, ...);
   extern mkcl_object mkcl_FEnot_funcallable_fixed();
@@ -421,6 +435,12 @@ extern "C" {
 
   extern int _mkcl_backq_car(MKCL, mkcl_object *px);
 
+  /* stacks.d */
+
+  extern mkcl_object mkcl_ihs_function_name(mkcl_object fun);
+  extern mkcl_object mkcl_ihs_backtrace(MKCL, mkcl_index max_depth);
+  extern mkcl_index mkcl_ihs_frame_functions(MKCL, mkcl_object * functions, mkcl_index max_depth);
+
 
 #if MKCL_PTHREADS
 
@@ -400,16 +400,39 @@ extern "C" {
     mkcl_htt_package		/*  symbol hash  */
   };
 
+  enum mkcl_htweak {		/*  hash table weakness, a bit set  */
+    mkcl_htw_none = 0,
+    mkcl_htw_key = 1,		/*  entry lives as long as its key  */
+    mkcl_htw_value = 2,		/*  entry lives as long as its value  */
+    mkcl_htw_key_and_value = 3	/*  entry lives as long as both  */
+  };
+
   struct mkcl_hashtable_entry {	/*  hash table entry  */
     struct mkcl_hashtable_entry * next;
-    mkcl_object key;		/*  key  */
+    mkcl_object key;		/*  key, disguised if weak  */
     mkcl_hash_value hashed_key; /*  key's cached hash value */
-    mkcl_object value;	        /*  value  */
+    mkcl_object value;	        /*  value, disguised if weak  */
+  };
+
+#define MKCL_HASHTABLE_STRIPES 31 /* odd prime, see hash.c */
+
+  struct mkcl_hashtable_sync {	/*  extra state of a :synchronized hash table  */
+    volatile mkcl_index epoch;	/*  odd while data, size or old_data are being swapped  */
+    struct mkcl_hashtable_entry ** old_data; /*  bucket vector still being migrated, or NULL  */
+    unsigned char * old_migrated; /*  one flag per old bucket, set once it has been moved  */
+    mkcl_index old_size;
+    mkcl_index pending;		/*  number of old buckets not yet migrated  */
+    mkcl_index cursor[MKCL_HASHTABLE_STRIPES]; /*  next old bucket to migrate, per stripe  */
+#if MKCL_WINDOWS
+    CRITICAL_SECTION stripe[MKCL_HASHTABLE_STRIPES]; /*  writer locks  */
+#else
+    pthread_mutex_t stripe[MKCL_HASHTABLE_STRIPES]; /*  writer locks  */
+#endif
   };
 
   struct mkcl_hashtable {	/*  hash table header  */
-    MKCL_HEADER2(test,lockable);
-    struct mkcl_hashtable_entry **data; /*  pointer to a vector of entry chains */
+    MKCL_HEADER3(test,lockable,weakness);
+    struct mkcl_hashtable_entry **data; /*  pointer to a vector of entry chains, NULL if open addressed */
     struct mkcl_hashtable_entry * (*search_fun)(__MKCL, mkcl_object key, mkcl_object hashtable);
     mkcl_hash_value (*hash_fun)(__MKCL, mkcl_object key);
     bool (*equality_fun)(__MKCL, mkcl_object o1, mkcl_object o2);
@@ -420,6 +443,10 @@ extern "C" {
     mkcl_index factor_of_16th;  /*  numerator of a ratio of 16th derived from threshold. */
 
     struct mkcl_hashtable_entry * free_bucket; /* a free list. */
+    struct mkcl_hashtable_sync * sync; /* NULL unless the table is :synchronized. */
+    unsigned char * ctrl;	/*  control bytes of an open addressed table, NULL if chained  */
+    struct mkcl_hashtable_entry * slots; /*  entry slots of an open addressed table  */
+    mkcl_index tombstones;	/*  deleted slots of an open addressed table  */
 
 #ifdef HASHTABLE_STATS
     long nb_searches;
@@ -613,6 +640,11 @@ extern "C" {
    || (strm)->stream.mode == mkcl_smm_io_file		\
    || (strm)->stream.mode == mkcl_smm_input_file)
   
+#define MKCL_STREAM_IS_SOCKET_P(strm)			\
+  ((strm)->stream.mode == mkcl_smm_output_socket	\
+   || (strm)->stream.mode == mkcl_smm_io_socket		\
+   || (strm)->stream.mode == mkcl_smm_input_socket)
+  
 #define MKCL_STREAM_IS_COMPOSITE_P(strm)		\
   ((strm)->stream.mode == mkcl_smm_synonym		\
    || (strm)->stream.mode == mkcl_smm_broadcast		\
@@ -684,7 +716,12 @@ extern "C" {
     mkcl_word int1;		/*  some int  */
     mkcl_index byte_size;	/*  size of byte in binary streams  */
     mkcl_word last_op;  	/*  0: unknown, 1: reading, -1: writing */
-    char *buffer;		/*  buffer for FILE  */
+    char *buffer;		/*  buffer for FILE or file descriptor  */
+    mkcl_index buffer_size;	/*  size of fd buffer, 0 if unbuffered  */
+    mkcl_index buffer_start;	/*  next unread octet in fd buffer  */
+    mkcl_index buffer_end;	/*  end of octets held in fd buffer  */
+    char *out_buffer;		/*  transmit buffer of socket streams  */
+    mkcl_index out_buffer_end;	/*  end of octets held in out_buffer  */
     mkcl_object format;	        /*  external format  */
     mkcl_eformat_encoder encoder;
     mkcl_eformat_decoder decoder;
@@ -766,6 +803,8 @@ extern "C" {
     mkcl_object * fun_ref_syms; /* pointer to a vector of symbols denoting referenced functions. */
     mkcl_object * fun_refs;     /* pointer to a vector of function objects */
     mkcl_object * cfun_objs;    /* pointer to a vector of cfun objects defined by this block. */
+    void * image;               /* code and data relocated in memory by libmkcc, or NULL. */
+    mkcl_index image_size;      /* size of the mapping at image. */
   };
 
 #define MKCL_MAX_FAST_FUNC_DISPATCH 5  /* for 0 to 4 arguments. Covers 98%+ of cases. */
@@ -787,6 +826,8 @@ extern "C" {
     mkcl_object file;		/*  file where it was defined...  */
     mkcl_object file_position;  /*  and where it was created  */
     mkcl_object owner;
+    mkcl_object native;		/*  compiled replacement, or NIL  */
+    mkcl_word calls;		/*  invocation count, -1 if not a promotion candidate  */
   };
 
   struct mkcl_bclosure {
@@ -1033,6 +1074,7 @@ extern "C" {
     mkcl_object plist;
     mkcl_object initial_bindings;
     bool detached;
+    bool daemon; /* started by the runtime for its own needs. */
     mkcl_os_thread_t thread;
     mkcl_os_thread_t base_thread;
     pid_t tid;
@@ -468,9 +468,11 @@ mkcl_equalp(MKCL, mkcl_object x, mkcl_object y)
     {
       mkcl_index i;
       struct mkcl_hashtable_entry *ex, *ey;
-      if (tx != ty ||
-	  x->hash.entries != y->hash.entries ||
-	  x->hash.test != y->hash.test)
+      if (tx != ty || x->hash.test != y->hash.test)
+	return(FALSE);
+      x = mkcl_hash_table_snapshot(env, x);
+      y = mkcl_hash_table_snapshot(env, y);
+      if (x->hash.entries != y->hash.entries)
 	return(FALSE);
       for (i = 0; i < x->hash.size; i++)
 	{
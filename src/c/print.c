@@ -23,6 +23,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <float.h>
+#include <stdint.h>
 #include <mkcl/internal.h>
 #include <mkcl/mkcl-fenv.h>
 #include <mkcl/bytecode.h>
@@ -273,406 +274,471 @@ write_base(MKCL, int base, mkcl_object stream)
   }
 }
 
-/* The floating point precision is required to make the
-   most-positive-long-float printed expression readable.
-   If this is too small, then the rounded off fraction, may be too big
-   to read */
-
-/* Maximum number of significant digits required to represent accurately
- * a double or single float. */
-#define TIMES_LOG10_2(val) (((val)*3)/10)  /* an integral approximation good to 0.35% as long as there is no overflow */
-
-#define DBL_SIG ((TIMES_LOG10_2(DBL_MANT_DIG) + 1))
-#define FLT_SIG ((TIMES_LOG10_2(FLT_MANT_DIG) + 1))
-
-/* This is the maximum number of decimal digits that our numbers will have.
- * Notice that we leave some extra margin, to ensure that reading the number
- * again will produce the same floating point number.
+/*
+ * Shortest round-trip digits of floats.
+ *
+ * float_digits() is the free-format algorithm of Burger and Dybvig,
+ * "Printing Floating-Point Numbers Quickly and Accurately" (PLDI 1996):
+ * it yields the shortest string of decimal digits that reads back as the
+ * same float under round-to-nearest-even, and among those the closest to
+ * the float.  Its exact integer arithmetic is done on fixed size bignums
+ * on the C stack, which only grow large for the extreme exponents of long
+ * floats.  The value is 0.d1d2...dn * 10^k.
  */
 
-#define LDBL_SIG ((TIMES_LOG10_2(LDBL_MANT_DIG) + 1))
-#define LDBL_MAX_DIGITS (LDBL_SIG + 3)
-#define LDBL_EXPONENT_SIZE (1 + 1 + 4)
-
-#define DBL_MAX_DIGITS (DBL_SIG + 3)
-#define DBL_EXPONENT_SIZE (1 + 1 + 3) /* Exponent marker 'e' + sign + digits .*/
-
+#define FD_LIMBS ((((-LDBL_MIN_EXP > LDBL_MAX_EXP) ? -LDBL_MIN_EXP : LDBL_MAX_EXP) \
+		   + 2 * LDBL_MANT_DIG + 64) / 32)
 
-/* The sinificant digits + the possible sign + the decimal dot. */
-#define LDBL_MANTISSA_SIZE (LDBL_MAX_DIGITS + 1 + 1)
-/* Total estimated size that a floating point number can take. */
-#define LDBL_SIZE (LDBL_MANTISSA_SIZE + LDBL_EXPONENT_SIZE)
+/* Enough for the 17 digits of a double, the 21 of a long double on x86
+   and the 36 of an IEEE quad. */
+#define FD_MAX_DIGITS 40
 
-/* The sinificant digits + the possible sign + the decimal dot. */
-#define DBL_MANTISSA_SIZE (DBL_MAX_DIGITS + 1 + 1)
-/* Total estimated size that a floating point number can take. */
-#define DBL_SIZE (DBL_MANTISSA_SIZE + DBL_EXPONENT_SIZE)
-
-#define LONG_EXP_STRING "Le"
-#define LONG_G_EXP_STRING "Lg"
-
-#define EXP_STRING "e"
-
-#define G_EXP_STRING "g"
-#define DBL_TYPE double
+struct fd_bignum {
+  int length; /* number of significant limbs, least significant first. */
+  uint32_t limb[FD_LIMBS];
+};
 
-static int edit_long_double(MKCL, int n, long double d, int *sp, char *s, int *ep)
+static void
+fd_set_word(struct fd_bignum * b, uint64_t x)
 {
-  char *exponent;
-  char buff[512] = { 0 };
-  int length;
+  b->length = 0;
+  for (; x; x >>= 32)
+    b->limb[b->length++] = (uint32_t) x;
+}
 
-  if (isnan(d) || !isfinite(d))
-    mkcl_FEerror(env, "Can't print a non-number.", 0);
-  if (!isnormal(d))
-    mkcl_FEerror(env, "Can't print a subnormal number.", 0);
-  {
-    long double ld_abs = fabsl(d);
+static void
+fd_shift_left(struct fd_bignum * b, int n)
+{
+  const int words = n / 32, bits = n % 32;
+  int i;
 
-    if ((ld_abs < LDBL_MIN) || (LDBL_MAX < ld_abs))
-      mkcl_FEerror(env, "Can't print a denormalized number.", 0);
-  }
-  if (n < -LDBL_MAX_DIGITS)
-    n = LDBL_MAX_DIGITS;
-  if (n < 0) {
-    long double aux;
-    n = -n;
-    do {
-      snprintf(buff, sizeof(buff), "%- *.*" LONG_EXP_STRING,
-               n + 1 + 1 + LDBL_EXPONENT_SIZE, n-1, d);
-      errno = 0;
-      aux = strtold(buff, NULL);
-      if ( errno == ERANGE )
+  if (b->length == 0)
+    return;
+  b->limb[b->length + words] = 0;
+  if (bits == 0)
+    for (i = b->length; i-- > 0;)
+      b->limb[i + words] = b->limb[i];
+  else
+    {
+      for (i = b->length; i-- > 0;)
 	{
-	  char msg_pattern[] = "underflow or overflow: "
-	                       "strtold in edit_long_double on: %s";
-	  char msg[sizeof(buff) + sizeof(msg_pattern) + 16] = { 0 };
-	  
-	  snprintf(msg, sizeof(msg), msg_pattern, buff);
-	  mkcl_C_lose(env, msg);
+	  b->limb[i + words + 1] |= b->limb[i] >> (32 - bits);
+	  b->limb[i + words] = b->limb[i] << bits;
 	}
-      n++;
-    } while (d != aux && n <= LDBL_MAX_DIGITS);
-    n--;
-  } else {
-    snprintf(buff, sizeof(buff), "%- *.*" LONG_EXP_STRING, LDBL_SIZE,
-             (n <= LDBL_MAX_DIGITS)? (n-1) : (LDBL_MAX_DIGITS-1), d);
-  }
-  exponent = strchr(buff, 'e');
-
-  /* Get the exponent */
-  *ep = strtol(exponent+1, NULL, 10);
+    }
+  for (i = 0; i < words; i++)
+    b->limb[i] = 0;
+  b->length += words + 1;
+  if (b->limb[b->length - 1] == 0)
+    b->length--;
+}
 
-  /* Get the sign */
-  *sp = (buff[0] == '-') ? -1 : +1;
+static void
+fd_mul_small(struct fd_bignum * b, uint32_t m)
+{
+  uint64_t carry = 0;
+  int i;
 
-  /* Get the digits of the mantissa */
-  buff[2] = buff[1];
+  for (i = 0; i < b->length; i++)
+    {
+      carry += (uint64_t) b->limb[i] * m;
+      b->limb[i] = (uint32_t) carry;
+      carry >>= 32;
+    }
+  if (carry)
+    b->limb[b->length++] = (uint32_t) carry;
+}
 
-  /* Get the actual number of digits in the mantissa */
-  length = exponent - (buff + 2);
+static void
+fd_mul_pow10(struct fd_bignum * b, int k)
+{
+  static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
 
-  /* The output consists of a string {d1,d2,d3,...,dn}
-     with all N digits of the mantissa. If we ask for more
-     digits than there are, the last ones are set to zero. */
-  if (n <= length) {
-    memcpy(s, buff+2, n);
-  } else {
-    mkcl_index i;
-    memcpy(s, buff+2, length);
-    for (i = length;  i < n;  i++)
-      s[i] = '0';
-  }
-  s[n] = '\0';
-  return length;
+  for (; k >= 9; k -= 9)
+    fd_mul_small(b, 1000000000);
+  if (k)
+    fd_mul_small(b, pow10[k]);
 }
 
-static int edit_double(MKCL, int n, double d, int *sp, char *s, int *ep)
+static int
+fd_compare(const struct fd_bignum * a, const struct fd_bignum * b)
 {
-  char *exponent;
-  char buff[512] = { 0 };
-  int length;
-
-  if (isnan(d) || !isfinite(d))
-    mkcl_FEerror(env, "Can't print a non-number.", 0);
-  if (!isnormal(d))
-    mkcl_FEerror(env, "Can't print a subnormal number.", 0);
-  {
-    double d_abs = fabs(d);
+  int i;
 
-    if ((d_abs < DBL_MIN) || (DBL_MAX < d_abs))
-      mkcl_FEerror(env, "Can't print a denormalized number.", 0);
-  }
-  if (n < -DBL_MAX_DIGITS)
-    n = DBL_MAX_DIGITS;
-  if (n < 0) {
-    double aux = 0;
-    n = -n + 1;
-    do {
-      snprintf(buff, sizeof(buff), "%- *.*" EXP_STRING, n + 1 + 1 + DBL_EXPONENT_SIZE, n-1, d);
-      errno = 0;
-      aux = strtod(buff, NULL);
-      if ( errno == ERANGE )
-	{
-	  char msg_pattern[] = "underflow or overflow: "
-	                       "strtod in edit_double on: %s";
-	  char msg[sizeof(buff) + sizeof(msg_pattern) + 16] = { 0 };
-	  
-	  snprintf(msg, sizeof(msg), msg_pattern, buff);
-	  mkcl_C_lose(env, msg);
-	}
-      n++;
-    } while (d != aux && n <= DBL_MAX_DIGITS);
-    n--;
-  } else {
-    snprintf(buff, sizeof(buff), "%- *.*" EXP_STRING, DBL_SIZE,
-             (n <= DBL_MAX_DIGITS)? (n-1) : (DBL_MAX_DIGITS-1), d);
-  }
-  exponent = strchr(buff, 'e');
+  if (a->length != b->length)
+    return (a->length < b->length) ? -1 : 1;
+  for (i = a->length; i-- > 0;)
+    if (a->limb[i] != b->limb[i])
+      return (a->limb[i] < b->limb[i]) ? -1 : 1;
+  return 0;
+}
 
-  /* Get the exponent */
-  *ep = strtol(exponent+1, NULL, 10);
+static int
+fd_compare_sum(const struct fd_bignum * a, const struct fd_bignum * b, const struct fd_bignum * c)
+{ /* Compares a + b to c. */
+  const int length = (a->length > b->length) ? a->length : b->length;
+  uint32_t sum[FD_LIMBS + 1];
+  uint64_t carry = 0;
+  int i, sum_length;
 
-  /* Get the sign */
-  *sp = (buff[0] == '-') ? -1 : +1;
+  for (i = 0; i < length; i++)
+    {
+      carry += (uint64_t) (i < a->length ? a->limb[i] : 0) + (i < b->length ? b->limb[i] : 0);
+      sum[i] = (uint32_t) carry;
+      carry >>= 32;
+    }
+  sum_length = length;
+  if (carry)
+    sum[sum_length++] = (uint32_t) carry;
+  if (sum_length != c->length)
+    return (sum_length < c->length) ? -1 : 1;
+  for (i = sum_length; i-- > 0;)
+    if (sum[i] != c->limb[i])
+      return (sum[i] < c->limb[i]) ? -1 : 1;
+  return 0;
+}
 
-  /* Get the digits of the mantissa */
-  buff[2] = buff[1];
+static void
+fd_subtract(struct fd_bignum * a, const struct fd_bignum * b)
+{ /* a -= b, where a >= b. */
+  int64_t borrow = 0;
+  int i;
 
-  /* Get the actual number of digits in the mantissa */
-  length = exponent - (buff + 2);
+  for (i = 0; i < a->length; i++)
+    {
+      borrow += (int64_t) a->limb[i] - (i < b->length ? b->limb[i] : 0);
+      a->limb[i] = (uint32_t) borrow;
+      borrow >>= 32;
+    }
+  while (a->length > 0 && a->limb[a->length - 1] == 0)
+    a->length--;
+}
 
-  /* The output consists of a string {d1,d2,d3,...,dn}
-     with all N digits of the mantissa. If we ask for more
-     digits than there are, the last ones are set to zero. */
-  if (n <= length) {
-    memcpy(s, buff+2, n);
-  } else {
-    mkcl_index i;
-    memcpy(s, buff+2, length);
-    for (i = length;  i < n;  i++)
-      s[i] = '0';
-  }
-  s[n] = '\0';
+static int
+fd_bit_length(const struct fd_bignum * b)
+{
+  int bits = 32 * (b->length - 1);
+  uint32_t top = b->limb[b->length - 1];
 
-  return length;
+  for (; top; top >>= 1)
+    bits++;
+  return bits;
 }
 
-static void
-write_long_double(MKCL, long double d, mkcl_character e, int n, mkcl_object stream, mkcl_object o)
-{
-  int exp;
-  bool fe_inexact_on = FALSE;
-  mkcl_object print_exactly_p = mkcl_symbol_value(env, MK_SI_DYNVAR_print_float_exactly); 
+static int
+float_digits(char * digits, int * k_out, struct fd_bignum * f, int e, int precision, int min_e)
+{ /* The float is f * 2^e, f > 0, with a precision bits significand whose
+     smallest exponent is min_e.  Returns the number of digits. */
+  struct fd_bignum r, s, m_plus, m_minus_storage, * m_minus = &m_plus;
+  const bool even = !(f->limb[0] & 1);
+  const int f_bits = fd_bit_length(f);
+  bool boundary = FALSE; /* Is the gap below f smaller than the one above? */
+  int k, n = 0;
+
+  if (f_bits == precision && e > min_e)
+    {
+      int i;
+
+      boundary = (f->limb[f->length - 1] == ((uint32_t) 1 << ((f_bits - 1) % 32)));
+      for (i = 0; boundary && i < f->length - 1; i++)
+	boundary = (f->limb[i] == 0);
+    }
 
-  if (mkcl_Null(print_exactly_p))
+  r = *f;
+  if (e >= 0)
     {
-      fe_inexact_on = FE_INEXACT & fegetexcept();
-      if (fe_inexact_on)
+      fd_shift_left(&r, e + (boundary ? 2 : 1));
+      fd_set_word(&s, boundary ? 4 : 2);
+      fd_set_word(&m_plus, 1);
+      fd_shift_left(&m_plus, e + (boundary ? 1 : 0));
+      if (boundary)
 	{
-	  /* printf("\nwrite_long_double: turning off FE_INEXACT!\n"); fflush(NULL); */
-	  fedisableexcept(FE_INEXACT);
+	  m_minus = &m_minus_storage;
+	  fd_set_word(m_minus, 1);
+	  fd_shift_left(m_minus, e);
 	}
     }
   else
-    { printf("\nwrite_long_double told to print exactly!\n"); fflush(NULL); }
-
-  if (!mkcl_Null(mk_cl_fboundp(env, MK_SI_output_float)))
     {
-      mkcl_funcall2(env, MK_SI_output_float->symbol.gfdef, o, stream);
+      fd_shift_left(&r, boundary ? 2 : 1);
+      fd_set_word(&s, 1);
+      fd_shift_left(&s, (boundary ? 2 : 1) - e);
+      fd_set_word(&m_plus, boundary ? 2 : 1);
+      if (boundary)
+	{
+	  m_minus = &m_minus_storage;
+	  fd_set_word(m_minus, 1);
+	}
     }
-  else if (isnan(d)) {
-    if (mkcl_print_readably(env)) {
-      mkcl_FEprint_not_readable(env, mkcl_make_longfloat(env, d));
+
+  /* An estimate of k that is either right or one too small. */
+  k = (int) ceil((e + f_bits - 1) * 0.30102999566398114 - 1e-10);
+  if (k >= 0)
+    fd_mul_pow10(&s, k);
+  else
+    {
+      fd_mul_pow10(&r, -k);
+      fd_mul_pow10(&m_plus, -k);
+      if (boundary)
+	fd_mul_pow10(m_minus, -k);
     }
-    mkcl_funcall2(env, MK_SI_output_float_nan->symbol.gfdef, o, stream);
-  }
-  else if (!isfinite(d)) {
-    mkcl_funcall2(env, MK_SI_output_float_infinity->symbol.gfdef, o, stream);
-  }
-  else {
-    if (d < 0) {
-      mkcl_write_char(env, '-', stream);
-      d = -d;
+  if (fd_compare_sum(&r, &m_plus, &s) >= (even ? 0 : 1))
+    k++;
+  else
+    {
+      fd_mul_small(&r, 10);
+      fd_mul_small(&m_plus, 10);
+      if (boundary)
+	fd_mul_small(m_minus, 10);
     }
-    if (d == 0.0) {
-#if defined(MKCL_SIGNED_ZERO) && defined(signbit)
-      if (signbit(d))
-	write_str(env, "-0.0", stream);
-      else
-#endif
-	write_str(env, "0.0", stream);
-      exp = 0;
-    } else if (d < 1e-3 || d > 1e7) {
-      int sign;
-      char buff[LDBL_MANTISSA_SIZE + 1];
-      n = edit_long_double(env, -n, d, &sign, buff, &exp);
-      mkcl_write_char(env, buff[0], stream);
-      mkcl_write_char(env, '.', stream);
-      for (;  --n > 1; ) {
-	if (buff[n] != '0') {
-	  break;
+
+  for (;;)
+    {
+      int digit = 0;
+      bool low, high;
+
+      while (fd_compare(&r, &s) >= 0)
+	{
+	  fd_subtract(&r, &s);
+	  digit++;
 	}
-	buff[n] = '\0';
-      }
-      write_str(env, buff+1, stream);
-    } else {
-      char buff[512] = { 0 };
-      int i;
-      long double aux;
-      /* Print in fixed point notation with enough number of
-       * digits to preserve all information when reading again
-       */
-      do {
-	snprintf(buff, sizeof(buff), "%0*.*" LONG_G_EXP_STRING, LDBL_MANTISSA_SIZE, n, d);
-	aux = strtod(buff, NULL);
-
-	if (n < LDBL_SIG) aux = (double)aux; /* What is the use of this? JCB */
-	if (n < DBL_SIG) aux = (float)aux; /* What is the use of this? JCB */
-
-	n++;
-      } while (aux != d && n <= LDBL_MAX_DIGITS);
-      n--;
-      /* We look for the first nonzero character. There is
-       * always one because our floating point number is not
-       * zero.*/
-      for (i = 0; buff[i] == '0' && buff[i+1] != '.'; i++)
-	;
-      write_str(env, buff + i, stream);
-      if (strchr(buff, '.') == 0) {
-	write_str(env, ".0", stream);
-      }
-      exp = 0;
+      low = (fd_compare(&r, m_minus) < (even ? 1 : 0));
+      high = (fd_compare_sum(&r, &m_plus, &s) >= (even ? 0 : 1));
+      if (!low && !high && n < FD_MAX_DIGITS - 1)
+	{
+	  digits[n++] = '0' + digit;
+	  fd_mul_small(&r, 10);
+	  fd_mul_small(&m_plus, 10);
+	  if (boundary)
+	    fd_mul_small(m_minus, 10);
+	  continue;
+	}
+      if (high && (!low || fd_compare_sum(&r, &r, &s) > 0)) /* ties go down, as in FLOAT-STRING. */
+	digit++;
+      digits[n++] = '0' + digit;
+      break;
     }
-    if (exp || e) {
-      if (e == 0)
-	e = 'E';
-      mkcl_write_char(env, e, stream);
-      if (exp < 0) {
-	mkcl_write_char(env, '-', stream);
-	exp = -exp;
-      }
-      write_decimal(env, exp, stream);
+  digits[n] = '\0';
+  *k_out = k;
+  return n;
+}
+
+static int
+double_digits(char * digits, int * k, double d, int precision, int min_exp)
+{ /* d > 0, a single or double float. */
+  struct fd_bignum f;
+  int e;
+  const double m = frexp(d, &e);
+  uint64_t bits = (uint64_t) ldexp(m, precision);
+
+  e -= precision;
+  if (e < min_exp - precision)
+    { /* Subnormal, back to its actual exponent. */
+      bits >>= (min_exp - precision) - e;
+      e = min_exp - precision;
     }
-  }
+  fd_set_word(&f, bits);
+  return float_digits(digits, k, &f, e, precision, min_exp - precision);
+}
 
-  feclearexcept(FE_INEXACT); /* Clear leftovers from casting. */ /* should it be FE_ALL_EXCEPT? JCB*/
-  if (fe_inexact_on)
+#ifdef MKCL_LONG_FLOAT
+static int
+long_double_digits(char * digits, int * k, long double d)
+{ /* d > 0 */
+  struct fd_bignum f;
+  int e, i;
+  long double m = frexpl(d, &e);
+
+  /* f = m * 2^LDBL_MANT_DIG, 32 bits at a time. */
+  f.length = 0;
+  for (i = LDBL_MANT_DIG; i > 0; i -= 32)
     {
-      /* printf("\nwrite_long_double: turning on FE_INEXACT!\n"); fflush(NULL); */
-      feenableexcept(FE_INEXACT);
+      const int n = (i < 32) ? i : 32;
+      uint32_t chunk;
+
+      m = ldexpl(m, n);
+      chunk = (uint32_t) m;
+      m -= chunk;
+      fd_shift_left(&f, n);
+      if (chunk)
+	{
+	  if (f.length == 0)
+	    f.limb[f.length++] = 0;
+	  f.limb[0] |= chunk;
+	}
     }
+  e -= LDBL_MANT_DIG;
+  if (e < LDBL_MIN_EXP - LDBL_MANT_DIG)
+    { /* Subnormal, back to its actual exponent. */
+      int shift = (LDBL_MIN_EXP - LDBL_MANT_DIG) - e;
 
+      for (; shift > 0; shift -= 31)
+	{
+	  const int n = (shift < 31) ? shift : 31;
+	  int j;
+
+	  for (j = 0; j < f.length; j++)
+	    f.limb[j] = (f.limb[j] >> n) | (j + 1 < f.length ? f.limb[j + 1] << (32 - n) : 0);
+	  while (f.length > 0 && f.limb[f.length - 1] == 0)
+	    f.length--;
+	}
+      e = LDBL_MIN_EXP - LDBL_MANT_DIG;
+    }
+  return float_digits(digits, k, &f, e, LDBL_MANT_DIG, LDBL_MIN_EXP - LDBL_MANT_DIG);
 }
+#endif
 
-static void
-write_double(MKCL, double d, mkcl_character e, int n, mkcl_object stream, mkcl_object o)
-{
-  int exp;
+static int
+mkcl_float_digits(MKCL, mkcl_object x, char * digits, int * k)
+{ /* The shortest digits of the absolute value of x, a finite non-zero float. */
   bool fe_inexact_on = FALSE;
-  mkcl_object print_exactly_p = mkcl_symbol_value(env, MK_SI_DYNVAR_print_float_exactly); 
+  int n;
 
-  if (mkcl_Null(print_exactly_p))
+  /* The digits are found with inexact operations (ceil, frexp, casts),
+     which must not trap when the user enabled FLOATING-POINT-INEXACT. */
+  if (mkcl_Null(mkcl_symbol_value(env, MK_SI_DYNVAR_print_float_exactly)))
     {
       fe_inexact_on = FE_INEXACT & fegetexcept();
       if (fe_inexact_on)
-	{
-	  /* printf("\nwrite_double: turning off FE_INEXACT!\n"); fflush(NULL); */
-	  fedisableexcept(FE_INEXACT);
-	}
+	fedisableexcept(FE_INEXACT);
     }
-  else
-    { printf("\nwrite_double told to print exactly!\n"); fflush(NULL); }
 
-  if (!mkcl_Null(mk_cl_fboundp(env, MK_SI_output_float)))
+  switch (mkcl_type_of(x))
     {
-      mkcl_funcall2(env, MK_SI_output_float->symbol.gfdef, o, stream);
+    case mkcl_t_singlefloat:
+      n = double_digits(digits, k, fabs(mkcl_single_float(x)), FLT_MANT_DIG, FLT_MIN_EXP);
+      break;
+    case mkcl_t_doublefloat:
+      n = double_digits(digits, k, fabs(mkcl_double_float(x)), DBL_MANT_DIG, DBL_MIN_EXP);
+      break;
+#ifdef MKCL_LONG_FLOAT
+    case mkcl_t_longfloat:
+      n = long_double_digits(digits, k, fabsl(mkcl_long_float(x)));
+      break;
+#endif
+    default:
+      if (fe_inexact_on)
+	feenableexcept(FE_INEXACT);
+      mkcl_FEwrong_type_argument(env, MK_CL_float, x);
     }
-  else if (isnan(d)) {
-    if (mkcl_print_readably(env)) {
-      mkcl_FEprint_not_readable(env, mkcl_make_doublefloat(env, d));
+
+  feclearexcept(FE_INEXACT); /* Clear leftovers from casting. */
+  if (fe_inexact_on)
+    feenableexcept(FE_INEXACT);
+  return n;
+}
+
+mkcl_object
+mk_si_float_to_digits(MKCL, mkcl_object x)
+{ /* Returns k and the shortest digit string d1d2...dn such that
+     |x| = 0.d1d2...dn * 10^k reads back as x, which must be finite. */
+  char digits[FD_MAX_DIGITS + 1];
+  int k;
+
+  mkcl_call_stack_check(env);
+  if (mkcl_zerop(env, x))
+    mkcl_return_2_values(MKCL_MAKE_FIXNUM(0), mkcl_make_base_string_copy(env, "0"));
+  if (!mkcl_Null(mk_si_float_infinity_p(env, x)) || !mkcl_Null(mk_si_float_nan_p(env, x)))
+    mkcl_FEerror(env, "Can't print a non-number.", 0);
+  (void) mkcl_float_digits(env, x, digits, &k);
+  mkcl_return_2_values(MKCL_MAKE_FIXNUM(k), mkcl_make_base_string_copy(env, digits));
+}
+
+static void
+write_float(MKCL, mkcl_object x, mkcl_character exponent_marker, mkcl_object stream)
+{ /* Prints x as OUTPUT-FLOAT in format.lsp does: free format from 10^-3
+     up to 10^7, exponential notation outside, exponent_marker being 0 when
+     x is of the *READ-DEFAULT-FLOAT-FORMAT*. */
+  char digits[FD_MAX_DIGITS + 1];
+  bool nan, finite, negative, zero, free_format;
+  int k, n, i;
+
+#define FLOAT_FACTS(v, min, max)		\
+  nan = isnan(v);				\
+  finite = isfinite(v);				\
+  negative = signbit(v);			\
+  zero = (v == 0);				\
+  free_format = ((v < 0 ? -v : v) >= min && (v < 0 ? -v : v) < max)
+
+  switch (mkcl_type_of(x))
+    {
+    case mkcl_t_singlefloat:
+      { const float v = mkcl_single_float(x); FLOAT_FACTS(v, 1e-3f, 1e7f); }
+      break;
+    case mkcl_t_doublefloat:
+      { const double v = mkcl_double_float(x); FLOAT_FACTS(v, 1e-3, 1e7); }
+      break;
+#ifdef MKCL_LONG_FLOAT
+    case mkcl_t_longfloat:
+      { const long double v = mkcl_long_float(x); FLOAT_FACTS(v, 1e-3L, 1e7L); }
+      break;
+#endif
+    default:
+      mkcl_FEwrong_type_argument(env, MK_CL_float, x);
     }
-    mkcl_funcall2(env, MK_SI_output_float_nan->symbol.gfdef, o, stream);
-  }
-  else if (!isfinite(d)) {
-    mkcl_funcall2(env, MK_SI_output_float_infinity->symbol.gfdef, o, stream);
-  }
-  else {
-    if (d < 0) {
-      mkcl_write_char(env, '-', stream);
-      d = -d;
+#undef FLOAT_FACTS
+
+  if (nan)
+    {
+      if (mkcl_print_readably(env))
+	mkcl_FEprint_not_readable(env, x);
+      mkcl_funcall2(env, MK_SI_output_float_nan->symbol.gfdef, x, stream);
+      return;
     }
-    if (d == 0.0) {
-#if defined(MKCL_SIGNED_ZERO) && defined(signbit)
-      if (signbit(d))
-	write_str(env, "-0.0", stream);
+  if (!finite)
+    {
+      mkcl_funcall2(env, MK_SI_output_float_infinity->symbol.gfdef, x, stream);
+      return;
+    }
+  if (negative)
+    mkcl_write_char(env, '-', stream);
+  if (zero)
+    {
+      write_str(env, "0.0", stream);
+      k = 1;
+    }
+  else
+    {
+      n = mkcl_float_digits(env, x, digits, &k);
+      if (free_format)
+	{
+	  if (k <= 0)
+	    {
+	      write_str(env, "0.", stream);
+	      for (i = k; i < 0; i++)
+		mkcl_write_char(env, '0', stream);
+	      write_str(env, digits, stream);
+	    }
+	  else if (k < n)
+	    {
+	      for (i = 0; i < k; i++)
+		mkcl_write_char(env, digits[i], stream);
+	      mkcl_write_char(env, '.', stream);
+	      write_str(env, digits + k, stream);
+	    }
+	  else
+	    {
+	      write_str(env, digits, stream);
+	      for (i = n; i < k; i++)
+		mkcl_write_char(env, '0', stream);
+	      write_str(env, ".0", stream);
+	    }
+	  k = 1;
+	}
       else
-#endif
-	write_str(env, "0.0", stream);
-      exp = 0;
-    } else if (d < 1e-3 || d > 1e7) {
-      int sign;
-      char buff[DBL_MANTISSA_SIZE + 1];
-      n = edit_double(env, -n, d, &sign, buff, &exp);
-      mkcl_write_char(env, buff[0], stream);
-      mkcl_write_char(env, '.', stream);
-      for (;  --n > 1; ) {
-	if (buff[n] != '0') {
-	  break;
+	{
+	  mkcl_write_char(env, digits[0], stream);
+	  mkcl_write_char(env, '.', stream);
+	  write_str(env, (n > 1) ? digits + 1 : "0", stream);
 	}
-	buff[n] = '\0';
-      }
-      write_str(env, buff+1, stream);
-    } else {
-#if 0
-      char buff[DBL_MANTISSA_SIZE + 1] = { 0 };
-      char buff[512] = { 0 };
-#else
-      char buff[512] = { 0 };
-#endif
-      int i;
-      double aux;
-      /* Print in fixed point notation with enough number of
-       * digits to preserve all information when reading again
-       */
-      do {
-	snprintf(buff, sizeof(buff), "%0*.*" G_EXP_STRING, DBL_MANTISSA_SIZE, n, d);
-        aux = strtod(buff, NULL);
-	if (n < DBL_SIG) aux = (float)aux; /* What is the use of this? JCB */
-
-	n++;
-      } while (aux != d && n <= DBL_MAX_DIGITS);
-      n--;
-      /* We look for the first nonzero character. There is
-       * always one because our floating point number is not
-       * zero.*/
-      for (i = 0; buff[i] == '0' && buff[i+1] != '.'; i++)
-	;
-      write_str(env, buff + i, stream);
-      if (strchr(buff, '.') == 0) {
-	write_str(env, ".0", stream);
-      }
-      exp = 0;
-    }
-    if (exp || e) {
-      if (e == 0)
-	e = 'E';
-      mkcl_write_char(env, e, stream);
-      if (exp < 0) {
-	mkcl_write_char(env, '-', stream);
-	exp = -exp;
-      }
-      write_decimal(env, exp, stream);
     }
-  }
-
-  feclearexcept(FE_INEXACT); /* Clear leftovers from casting. */ /* should it be FE_ALL_EXCEPT? JCB*/
-  if (fe_inexact_on)
+  if (exponent_marker || k != 1)
     {
-      /* printf("\nwrite_double: turning on FE_INEXACT!\n"); fflush(NULL); */
-      feenableexcept(FE_INEXACT);
+      mkcl_write_char(env, exponent_marker ? exponent_marker : 'e', stream);
+      if (k - 1 < 0)
+	mkcl_write_char(env, '-', stream);
+      write_decimal(env, (k - 1 < 0) ? 1 - k : k - 1, stream);
     }
-
 }
 
 
@@ -1188,25 +1254,21 @@ mk_si_write_ugly_object(MKCL, mkcl_object x, mkcl_object stream)
   }
   case mkcl_t_singlefloat:
     r = mkcl_symbol_value(env, MK_CL_DYNVAR_read_default_float_format);
-    write_double(env, mkcl_single_float(x), (r == MK_CL_single_float || r == MK_CL_short_float)? 0 : 's',
-		 FLT_SIG, stream, x);
+    write_float(env, x, (r == MK_CL_single_float || r == MK_CL_short_float)? 0 : 'f', stream);
     break;
 #ifdef MKCL_LONG_FLOAT
   case mkcl_t_doublefloat:
     r = mkcl_symbol_value(env, MK_CL_DYNVAR_read_default_float_format);
-    write_double(env, mkcl_double_float(x), (r == MK_CL_double_float)? 0 : 'd', DBL_SIG, stream,
-		 x);
+    write_float(env, x, (r == MK_CL_double_float)? 0 : 'd', stream);
     break;
   case mkcl_t_longfloat:
     r = mkcl_symbol_value(env, MK_CL_DYNVAR_read_default_float_format);
-    write_long_double(env, mkcl_long_float(x), (r == MK_CL_long_float)? 0 : 'l',
-		      LDBL_SIG, stream, x);
+    write_float(env, x, (r == MK_CL_long_float)? 0 : 'l', stream);
     break;
 #else
   case mkcl_t_doublefloat:
     r = mkcl_symbol_value(env, MK_CL_DYNVAR_read_default_float_format);
-    write_double(env, mkcl_double_float(x), (r == MK_CL_double_float || r == MK_CL_long_float)? 0 : 'd',
-		 DBL_SIG, stream, x);
+    write_float(env, x, (r == MK_CL_double_float || r == MK_CL_long_float)? 0 : 'd', stream);
     break;
 #endif
   case mkcl_t_complex:
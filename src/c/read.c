@@ -22,6 +22,7 @@
 #include <float.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <mkcl/internal.h>
 #include <mkcl/mkcl-inl.h>
 #include <mkcl/bytecode.h>
@@ -41,6 +42,38 @@
 
 static mkcl_object dispatch_macro_character(MKCL, mkcl_object table, mkcl_object strm, int c);
 
+/* When loading binary files, we sometimes must create
+   symbols whose package has not yet been made. We
+   allow it, but later on in mkcl_read_VV we make sure that
+   all referenced packages have been properly built.
+*/
+static mkcl_object
+package_in_waiting(MKCL, mkcl_object name)
+{
+  mkcl_object p = mk_cl_Cnil;
+  volatile bool list_locked = false;
+
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    MKCL_LIBC_NO_INTR(env, (MKCL_PACKAGE_LIST_LOCK(), list_locked = true));
+    if (mkcl_core.packages_to_be_created == MKCL_OBJNULL
+        || mkcl_Null(MKCL_SYM_VAL(env, MK_SI_CONSTANT_reading_fasl_file)))
+      p = mk_cl_Cnil; /* we confirm. */
+    else if (!mkcl_Null(p = mkcl_assoc(env, name, mkcl_core.packages_to_be_created)))
+      p = MKCL_CDR(p);
+    else
+      {
+        p = _mkcl_alloc_package(env, name);
+        mkcl_core.packages_to_be_created = mk_cl_acons(env, name, p, mkcl_core.packages_to_be_created);
+      }
+  } MKCL_UNWIND_PROTECT_EXIT {
+    if (list_locked) MKCL_PACKAGE_LIST_UNLOCK();
+  } MKCL_UNWIND_PROTECT_END;
+
+  if (mkcl_Null(p))
+    mkcl_FEerror(env, "There is no package with the name ~A.", 1, name);
+  return p;
+}
+
 #define read_suppress(env) (mkcl_symbol_value(env, MK_CL_DYNVAR_read_suppress) != mk_cl_Cnil)
 
 # define TOKEN_STRING_DIM(s) ((s)->string.dim)
@@ -230,34 +263,8 @@ mkcl_read_object_with_delimiter(MKCL, mkcl_object in, mkcl_character delimiter,
           p = mk_cl_find_package(env, token);
 #endif
         }
-        if (mkcl_Null(p) && !suppress) {
-          /* When loading binary files, we sometimes must create
-             symbols whose package has not yet been made. We
-             allow it, but later on in mkcl_read_VV we make sure that
-             all referenced packages have been properly built.
-          */
-          mkcl_object name = mk_cl_copy_seq(env, token);
-          volatile bool list_locked = false;
-
-          MKCL_UNWIND_PROTECT_BEGIN(env) {
-            MKCL_LIBC_NO_INTR(env, (MKCL_PACKAGE_LIST_LOCK(), list_locked = true));
-            if (mkcl_core.packages_to_be_created == MKCL_OBJNULL
-                || mkcl_Null(MKCL_SYM_VAL(env, MK_SI_CONSTANT_reading_fasl_file)))
-              p = mk_cl_Cnil; /* we confirm. */
-            else if (!mkcl_Null(p = mkcl_assoc(env, name, mkcl_core.packages_to_be_created)))
-              p = MKCL_CDR(p);
-            else
-              {
-                p = _mkcl_alloc_package(env, name);
-                mkcl_core.packages_to_be_created = mk_cl_acons(env, name, p, mkcl_core.packages_to_be_created);
-              }
-          } MKCL_UNWIND_PROTECT_EXIT {
-            if (list_locked) MKCL_PACKAGE_LIST_UNLOCK();
-          } MKCL_UNWIND_PROTECT_END;
-	
-          if (mkcl_Null(p))
-            mkcl_FEerror(env, "There is no package with the name ~A.", 1, name);	
-        }
+        if (mkcl_Null(p) && !suppress)
+          p = package_in_waiting(env, mk_cl_copy_seq(env, token));
         TOKEN_STRING_FILLP(token) = length = 0;
         upcase = count = colon = 0;
         escape_list = mk_cl_Cnil;
@@ -478,8 +485,265 @@ infinity(MKCL, mkcl_index exp_char, int sign)
   return mkcl_symbol_value(env, var);
 }
 
+/*
+ * Fast decimal to binary conversion.
+ *
+ * While parsing, mkcl_parse_number() also gathers the first 19 significant
+ * digits of a float into a machine word W.  The value read is then
+ * W * 10^Q, give or take the digits that did not fit.  Most of the time
+ * this is enough to get the correctly rounded float without building any
+ * bignum: either W and 10^Q are both exact floats and one IEEE operation
+ * rounds correctly (Clinger), or W is multiplied by a 128-bit
+ * approximation of 5^Q and the result decides the rounding unambiguously
+ * (Eisel & Lemire).  Whatever is left, including results that would
+ * underflow or overflow, goes through make_float()'s exact bignum path.
+ */
+
+#include "pow5_table.h"
+
+#define MAX_MANTISSA_DIGITS 19	/* Any 19 digits fit in an uint64_t. */
+
+struct decimal_mantissa {
+  uint64_t w;		/* the first significant digits, */
+  mkcl_word dropped;	/* the number of digits that followed them, */
+  bool truncated;	/* and whether any of those was not a zero. */
+};
+
+struct binary_format {
+  int mantissa_bits;		/* explicit ones, without the hidden bit. */
+  int minimum_exponent;		/* the exponent bias, negated. */
+  int infinite_power;		/* the biased exponent of infinities. */
+  int smallest_power_of_ten;	/* below which everything is zero, */
+  int largest_power_of_ten;	/* above which everything is infinite. */
+  int min_exponent_round_to_even; /* The range of Q where W * 5^Q can be */
+  int max_exponent_round_to_even; /* exactly halfway between two floats. */
+};
+
+static const struct binary_format binary32 = { 23, -127, 0xFF, -65, 38, -17, 10 };
+static const struct binary_format binary64 = { 52, -1023, 0x7FF, -342, 308, -4, 23 };
+
+static inline void
+full_multiplication(uint64_t a, uint64_t b, uint64_t *high, uint64_t *low)
+{
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 r = (unsigned __int128) a * b;
+  *high = (uint64_t) (r >> 64);
+  *low = (uint64_t) r;
+#else
+  uint64_t a_lo = (uint32_t) a, a_hi = a >> 32, b_lo = (uint32_t) b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (uint32_t) hi_lo + lo_hi;
+
+  *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  *low = (cross << 32) | (uint32_t) lo_lo;
+#endif
+}
+
+static inline int
+leading_zeros(uint64_t w)
+{
+#if defined(__GNUC__)
+  return __builtin_clzll(w);
+#else
+  int n = 0;
+  for (; !(w & ((uint64_t) 1 << 63)); w <<= 1) n++;
+  return n;
+#endif
+}
+
+/* Sets *MANTISSA and *POWER2 to the fields of the float nearest to
+   W * 10^Q, W > 0, and returns TRUE if that float is a normal one. */
+static bool
+eisel_lemire(const struct binary_format *fmt, uint64_t w, mkcl_word q,
+	     uint64_t *mantissa, int *power2)
+{
+  const int shift = 64 - fmt->mantissa_bits - 3;
+  uint64_t high, low, m;
+  int lz, upperbit, p2;
+
+  if (q < fmt->smallest_power_of_ten || q > fmt->largest_power_of_ten)
+    return FALSE;
+  lz = leading_zeros(w);
+  w <<= lz;
+
+  {
+    const mkcl_index index = 2 * (q - POW5_SMALLEST);
+    const uint64_t precision_mask = ~(uint64_t) 0 >> (fmt->mantissa_bits + 3);
+
+    full_multiplication(w, pow5_128[index], &high, &low);
+    if ((high & precision_mask) == precision_mask) {
+      /* The low bits of the first product were all ones, the carry from
+	 the next 64 bits of 5^Q may matter. */
+      uint64_t high2, low2;
+
+      full_multiplication(w, pow5_128[index + 1], &high2, &low2);
+      low += high2;
+      if (high2 > low) high++;
+    }
+  }
+
+  upperbit = (int) (high >> 63);
+  m = high >> (upperbit + shift);
+  /* floor(log2(10^Q)) + 63, the binary exponent of the product, biased. */
+  p2 = (int) (((152170 + 65536) * (int32_t) q) >> 16) + 63 + upperbit - lz - fmt->minimum_exponent;
+  if (p2 <= 0)
+    return FALSE; /* Subnormal or zero. */
+
+  if (low <= 1 && q >= fmt->min_exponent_round_to_even && q <= fmt->max_exponent_round_to_even
+      && (m & 3) == 1 && (m << (upperbit + shift)) == high)
+    m &= ~(uint64_t) 1; /* Exactly halfway, round to even. */
+  m += (m & 1);
+  m >>= 1;
+  if (m >= ((uint64_t) 2 << fmt->mantissa_bits)) {
+    m = (uint64_t) 1 << fmt->mantissa_bits;
+    p2++;
+  }
+  if (p2 >= fmt->infinite_power)
+    return FALSE;
+  *mantissa = m & ~((uint64_t) 1 << fmt->mantissa_bits);
+  *power2 = p2;
+  return TRUE;
+}
+
+/* Eisel-Lemire on the digits we kept.  When some were dropped, the value
+   lies between W and W + 1 units, and both must round the same way. */
+static bool
+decimal_to_binary(const struct binary_format *fmt, const struct decimal_mantissa *dm, mkcl_word q,
+		  uint64_t *mantissa, int *power2)
+{
+  uint64_t m2;
+  int p2;
+
+  if (!eisel_lemire(fmt, dm->w, q, mantissa, power2))
+    return FALSE;
+  return !dm->truncated
+    || (eisel_lemire(fmt, dm->w + 1, q, &m2, &p2) && m2 == *mantissa && p2 == *power2);
+}
+
+#if FLT_EVAL_METHOD == 0
+static const float exact_float_powers_of_ten[] = {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double exact_double_powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#endif
+
+static bool
+fast_float(const struct decimal_mantissa *dm, mkcl_word q, float *out)
+{
+  uint64_t mantissa;
+  int power2;
+
+#if FLT_EVAL_METHOD == 0
+  if (!dm->truncated && dm->w <= ((uint64_t) 1 << FLT_MANT_DIG) && q >= -10 && q <= 10) {
+    float f = (float) dm->w;
+
+    *out = (q < 0) ? f / exact_float_powers_of_ten[-q] : f * exact_float_powers_of_ten[q];
+    return TRUE;
+  }
+#endif
+  if (!decimal_to_binary(&binary32, dm, q, &mantissa, &power2))
+    return FALSE;
+  {
+    uint32_t bits = (uint32_t) mantissa | ((uint32_t) power2 << binary32.mantissa_bits);
+
+    memcpy(out, &bits, sizeof(bits));
+  }
+  return TRUE;
+}
+
+static bool
+fast_double(const struct decimal_mantissa *dm, mkcl_word q, double *out)
+{
+  uint64_t mantissa;
+  int power2;
+
+#if FLT_EVAL_METHOD == 0
+  if (!dm->truncated && dm->w <= ((uint64_t) 1 << DBL_MANT_DIG) && q >= -22 && q <= 22) {
+    double d = (double) dm->w;
+
+    *out = (q < 0) ? d / exact_double_powers_of_ten[-q] : d * exact_double_powers_of_ten[q];
+    return TRUE;
+  }
+#endif
+  if (!decimal_to_binary(&binary64, dm, q, &mantissa, &power2))
+    return FALSE;
+  {
+    uint64_t bits = mantissa | ((uint64_t) power2 << binary64.mantissa_bits);
+
+    memcpy(out, &bits, sizeof(bits));
+  }
+  return TRUE;
+}
+
+#if defined(MKCL_LONG_FLOAT) && LDBL_MANT_DIG >= 64
+static const long double exact_long_double_powers_of_ten[] = {
+  1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L,
+  1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+  1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+};
+
+/* Only Clinger's test here: any W is exact in a long double, and so are
+   the powers of ten up to 10^27 since 5^27 < 2^64. */
+static bool
+fast_long_double(const struct decimal_mantissa *dm, mkcl_word q, long double *out)
+{
+  if (!dm->truncated && q >= -27 && q <= 27) {
+    long double l = (long double) dm->w;
+
+    *out = (q < 0) ? l / exact_long_double_powers_of_ten[-q] : l * exact_long_double_powers_of_ten[q];
+    return TRUE;
+  }
+  return FALSE;
+}
+#endif
+
+/* The float of format EXP_CHAR nearest to SIGN * DM * 10^Q, or MKCL_OBJNULL
+   if that takes bignums. */
 static mkcl_object
-make_float(MKCL, mkcl_object num, mkcl_object exp, mkcl_index exp_char, int sign)
+fast_make_float(MKCL, const struct decimal_mantissa *dm, mkcl_word q, mkcl_index exp_char, int sign)
+{
+  q += dm->dropped;
+  switch (exp_char) {
+  case 's':  case 'S':
+  case 'f':  case 'F':
+    {
+      float f = 0.0f;
+
+      if (dm->w == 0 || fast_float(dm, q, &f))
+	return mkcl_make_singlefloat(env, (sign < 0) ? -f : f);
+    }
+    break;
+  case 'l':  case 'L':
+#ifdef MKCL_LONG_FLOAT
+    {
+# if LDBL_MANT_DIG >= 64
+      long double l = 0.0L;
+
+      if (dm->w == 0 || fast_long_double(dm, q, &l))
+	return mkcl_make_longfloat(env, (sign < 0) ? -l : l);
+# endif
+    }
+    break;
+#endif
+  case 'd':  case 'D':
+    {
+      double d = 0.0;
+
+      if (dm->w == 0 || fast_double(dm, q, &d))
+	return mkcl_make_doublefloat(env, (sign < 0) ? -d : d);
+    }
+    break;
+  }
+  return MKCL_OBJNULL;
+}
+
+static mkcl_object
+make_float(MKCL, mkcl_object num, mkcl_object exp, mkcl_index exp_char, int sign,
+	   const struct decimal_mantissa *dm)
 {
   mkcl_object output = MKCL_OBJNULL;
   bool fe_inexact_on = FALSE;
@@ -498,8 +762,12 @@ make_float(MKCL, mkcl_object num, mkcl_object exp, mkcl_index exp_char, int sign
     { printf("\nmake_float told to read exactly!\n"); fflush(NULL); }
 
 
+  if (exp_char == 'e' || exp_char == 'E')
+    exp_char = mkcl_current_read_default_float_format(env);
   if (!MKCL_FIXNUMP(exp)) {
     output = infinity(env, exp_char, sign);
+  } else if ((output = fast_make_float(env, dm, mkcl_fixnum_to_word(exp), exp_char, sign)) != MKCL_OBJNULL) {
+    /* No bignum needed. */
   } else {
     mkcl_word fix_exp = mkcl_fixnum_to_word(exp);
     if (fix_exp > 0) {
@@ -507,11 +775,7 @@ make_float(MKCL, mkcl_object num, mkcl_object exp, mkcl_index exp_char, int sign
     } else if (fix_exp < 0) {
       num = mkcl_divide(env, num, expt10(env, -fix_exp));
     }
-  AGAIN:
     switch (exp_char) {
-    case 'e': case 'E':
-      exp_char = mkcl_current_read_default_float_format(env);
-      goto AGAIN;
     case 's':  case 'S':
     case 'f':  case 'F':
       output = mkcl_make_singlefloat(env, sign * mkcl_to_float(env, num));
@@ -555,6 +819,8 @@ mkcl_parse_number(MKCL, mkcl_object str, mkcl_index start, mkcl_index end,
 {
   int sign = -1, d;
   mkcl_index c, i, decimal = end;
+  int mantissa_digits;
+  struct decimal_mantissa dm;
   mkcl_object numerator = _mkcl_big_register0(); /* "numerator" must always be a bignum, otherwise SIGSEGV! */
   if (end <= start || radix > 36) {
     *ep = start;
@@ -562,6 +828,7 @@ mkcl_parse_number(MKCL, mkcl_object str, mkcl_index start, mkcl_index end,
   }
  AGAIN:
   _mkcl_big_set_ui(numerator, 0);
+  dm.w = 0; dm.dropped = 0; dm.truncated = FALSE; mantissa_digits = 0;
   c = mkcl_char(env, str, i = start);
   sign = 1;
   if (c == '+') {
@@ -611,6 +878,13 @@ mkcl_parse_number(MKCL, mkcl_object str, mkcl_index start, mkcl_index end,
     } else if ((d = mkcl_digitp(c, radix)) >= 0) {
       _mkcl_big_mul_ui(numerator, numerator, radix);
       _mkcl_big_add_ui(numerator, numerator, d);
+      if (mantissa_digits < MAX_MANTISSA_DIGITS) {
+	dm.w = dm.w * radix + d; /* Only looked at if radix is 10. */
+	if (dm.w) mantissa_digits++;
+      } else {
+	dm.dropped++;
+	if (d) dm.truncated = TRUE;
+      }
     } else if (exponent_charp(c)) {
       mkcl_object exp, decimals;
       if (radix != 10) {
@@ -625,7 +899,7 @@ mkcl_parse_number(MKCL, mkcl_object str, mkcl_index start, mkcl_index end,
       exp = mkcl_parse_integer(env, str, ++i, end, ep, 10);
       if (exp == MKCL_OBJNULL || (*ep < end))
 	return MKCL_OBJNULL;
-      return make_float(env, num, mkcl_plus(env, decimals, exp), c, sign);
+      return make_float(env, num, mkcl_plus(env, decimals, exp), c, sign, &dm);
     } else if (radix != 10) {
       _mkcl_big_register_free(env, numerator);
       mkcl_object number = mkcl_parse_number(env, str, start, end, ep, 10);
@@ -650,7 +924,7 @@ mkcl_parse_number(MKCL, mkcl_object str, mkcl_index start, mkcl_index end,
    * 1., 2, 13., etc) we return an integer */
   *ep = i;
   if (decimal < i) {
-    return make_float(env, _mkcl_big_register_normalize(env, numerator), MKCL_MAKE_FIXNUM(decimal - i), 'e', sign);
+    return make_float(env, _mkcl_big_register_normalize(env, numerator), MKCL_MAKE_FIXNUM(decimal - i), 'e', sign, &dm);
   } else {
     if (sign < 0) _mkcl_big_complement(numerator, numerator);
     return _mkcl_big_register_normalize(env, numerator);
@@ -1738,12 +2012,7 @@ mkcl_object mk_cl_read_line(MKCL, mkcl_narg narg, ...)
       return token;
     }
     token = mk_si_get_buffer_string(env);
-    do {
-      c = mkcl_read_char(env, strm);
-      if (c == EOF || c == '\n')
-        break;
-      mkcl_string_push_extend(env, token, c);
-    } while(1);
+    c = mkcl_read_line_into(env, strm, token);
   EOFCHK:
     if (c == EOF && TOKEN_STRING_FILLP(token) == 0) {
       if (!mkcl_Null(eof_errorp))
@@ -2504,6 +2773,383 @@ mkcl_init_read(MKCL)
   mkcl_core.standard_readtable = r;
 }
 
+/*
+ * Binary data vectors.
+ *
+ * Instead of text for the reader, the compiler now writes the data of a
+ * compiled file as VV_MAGIC, a format version byte, the number of shared
+ * objects and the number of packages, then the objects themselves, each one
+ * a tag byte and its payload.  See DATA-DUMP in cmp/cmpwt.lsp, which must
+ * agree with this.  Counts are unsigned LEB128 varints, signed integers are
+ * zigzag encoded first.  Anything that does not start with VV_MAGIC is
+ * read as text, as it always was.
+ */
+
+#define VV_MAGIC "\0MKVV"
+#define VV_MAGIC_LENGTH 5
+#define VV_FORMAT_VERSION 1
+
+enum vv_tag {
+  vv_nil, vv_t, vv_fixnum, vv_integer, vv_character,
+  vv_base_string, vv_string,
+  vv_symbol,		/* package index, then name.  A new index is
+			   followed by the name of its package first. */
+  vv_keyword, vv_uninterned_symbol,
+  vv_list,		/* n >= 1 elements, then the last cdr. */
+  vv_vector,
+  vv_single_float, vv_double_float, vv_long_float, /* sign, mantissa, exponent. */
+  vv_infinity,		/* float tag, then sign. */
+  vv_ratio, vv_complex,
+  vv_label,		/* index, then the object it names. */
+  vv_reference,		/* index of an object already labeled. */
+  vv_pathname		/* namestring, as for #P. */
+};
+
+struct vv_input {
+  const unsigned char *p, *end;
+  mkcl_object filename;
+  mkcl_object *labels;
+  mkcl_index nlabels;
+  mkcl_object *packages;
+  mkcl_index npackages, packages_seen;
+};
+
+static void vv_corrupted(MKCL, struct vv_input *in) mkcl_noreturn;
+
+static void
+vv_corrupted(MKCL, struct vv_input *in)
+{
+  mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, in->filename, MK_KEY_reason, MK_KEY_corrupted);
+}
+
+static inline mkcl_index
+vv_byte(MKCL, struct vv_input *in)
+{
+  if (in->p >= in->end)
+    vv_corrupted(env, in);
+  return *in->p++;
+}
+
+static mkcl_index
+vv_varint(MKCL, struct vv_input *in)
+{
+  mkcl_index n = 0, b;
+  int shift = 0;
+
+  do {
+    if (shift >= (int) (8 * sizeof(mkcl_index)))
+      vv_corrupted(env, in);
+    b = vv_byte(env, in);
+    n |= (b & 0x7F) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return n;
+}
+
+/* A count of things taking at least one byte each. */
+static mkcl_index
+vv_count(MKCL, struct vv_input *in)
+{
+  mkcl_index n = vv_varint(env, in);
+
+  if (n > (mkcl_index) (in->end - in->p))
+    vv_corrupted(env, in);
+  return n;
+}
+
+static inline mkcl_word
+vv_zigzag(mkcl_index n)
+{
+  return (n & 1) ? -(mkcl_word) (n >> 1) - 1 : (mkcl_word) (n >> 1);
+}
+
+static mkcl_object
+vv_define(struct vv_input *in, mkcl_word label, mkcl_object x)
+{
+  if (label >= 0)
+    in->labels[label] = x;
+  return x;
+}
+
+static mkcl_object vv_read_object(MKCL, struct vv_input *in, mkcl_word label);
+
+static mkcl_object
+vv_read_string(MKCL, struct vv_input *in, mkcl_index tag)
+{
+  mkcl_object x;
+  mkcl_index i, n = vv_count(env, in);
+
+  if (tag == vv_base_string) {
+    x = mkcl_alloc_simple_base_string(env, n);
+    memcpy(x->base_string.self, in->p, n);
+    in->p += n;
+  } else if (tag == vv_string) {
+    x = mkcl_alloc_simple_character_string(env, n);
+    for (i = 0; i < n; i++) {
+      mkcl_index code = vv_varint(env, in);
+
+      if (code >= MKCL_CHAR_CODE_LIMIT)
+	vv_corrupted(env, in);
+      x->string.self[i] = code;
+    }
+  } else
+    vv_corrupted(env, in);
+  return x;
+}
+
+static mkcl_object
+vv_read_name(MKCL, struct vv_input *in)
+{
+  return vv_read_string(env, in, vv_byte(env, in));
+}
+
+static mkcl_object
+vv_read_float(MKCL, struct vv_input *in, mkcl_index tag)
+{
+  int negative = vv_byte(env, in);
+  mkcl_index mantissa = vv_varint(env, in);
+  int exponent = (int) vv_zigzag(vv_varint(env, in));
+
+  switch (tag) {
+  case vv_single_float:
+    {
+      float f = ldexpf((float) mantissa, exponent);
+      return mkcl_make_singlefloat(env, negative ? -f : f);
+    }
+#ifdef MKCL_LONG_FLOAT
+  case vv_long_float:
+    {
+      long double l = ldexpl((long double) mantissa, exponent);
+      return mkcl_make_longfloat(env, negative ? -l : l);
+    }
+#endif
+  default:
+    {
+      double d = ldexp((double) mantissa, exponent);
+      return mkcl_make_doublefloat(env, negative ? -d : d);
+    }
+  }
+}
+
+static mkcl_object
+vv_read_infinity(MKCL, struct vv_input *in)
+{
+  mkcl_index tag = vv_byte(env, in);
+  bool negative = vv_byte(env, in);
+
+  switch (tag) {
+  case vv_single_float:
+    return mkcl_symbol_value(env, negative ? MK_MKCL_single_float_negative_infinity : MK_MKCL_single_float_positive_infinity);
+#ifdef MKCL_LONG_FLOAT
+  case vv_long_float:
+    return mkcl_symbol_value(env, negative ? MK_MKCL_long_float_negative_infinity : MK_MKCL_long_float_positive_infinity);
+#endif
+  default:
+    return mkcl_symbol_value(env, negative ? MK_MKCL_double_float_negative_infinity : MK_MKCL_double_float_positive_infinity);
+  }
+}
+
+static mkcl_object
+vv_read_symbol(MKCL, struct vv_input *in)
+{
+  mkcl_index index = vv_varint(env, in);
+  mkcl_object package, name;
+  int intern_flag;
+
+  if (index == in->packages_seen && index < in->npackages) {
+    mkcl_object package_name = vv_read_name(env, in);
+
+    package = mk_cl_find_package(env, package_name);
+    if (mkcl_Null(package))
+      package = package_in_waiting(env, package_name);
+    in->packages[in->packages_seen++] = package;
+  } else if (index < in->packages_seen)
+    package = in->packages[index];
+  else
+    vv_corrupted(env, in);
+  name = vv_read_name(env, in);
+  return mkcl_intern(env, name, package, &intern_flag);
+}
+
+static mkcl_object
+vv_read_list(MKCL, struct vv_input *in, mkcl_word label)
+{
+  mkcl_index i, n = vv_count(env, in);
+  mkcl_object head, cons;
+
+  if (n == 0)
+    vv_corrupted(env, in);
+  /* All the conses exist before any element is read, so that labels
+     inside may refer to any of them. */
+  head = cons = mkcl_cons(env, mk_cl_Cnil, mk_cl_Cnil);
+  for (i = 1; i < n; i++)
+    cons = MKCL_CONS_CDR(cons) = mkcl_cons(env, mk_cl_Cnil, mk_cl_Cnil);
+  vv_define(in, label, head);
+  for (cons = head, i = 0; i < n; i++, cons = MKCL_CONS_CDR(cons))
+    MKCL_RPLACA(cons, vv_read_object(env, in, -1));
+  for (cons = head; --n; cons = MKCL_CONS_CDR(cons));
+  MKCL_RPLACD(cons, vv_read_object(env, in, -1));
+  return head;
+}
+
+static mkcl_object
+vv_read_object(MKCL, struct vv_input *in, mkcl_word label)
+{
+  mkcl_index tag = vv_byte(env, in);
+
+  switch (tag) {
+  case vv_nil:
+    return mk_cl_Cnil;
+  case vv_t:
+    return mk_cl_Ct;
+  case vv_fixnum:
+    return mkcl_make_integer(env, vv_zigzag(vv_varint(env, in)));
+  case vv_integer:
+    {
+      mkcl_object digits = vv_read_name(env, in);
+      mkcl_index ep, end = mkcl_length(env, digits);
+      mkcl_object x = mkcl_parse_integer(env, digits, 0, end, &ep, 10);
+
+      if (x == MKCL_OBJNULL || ep != end)
+	vv_corrupted(env, in);
+      return x;
+    }
+  case vv_character:
+    {
+      mkcl_index code = vv_varint(env, in);
+
+      if (code >= MKCL_CHAR_CODE_LIMIT)
+	vv_corrupted(env, in);
+      return MKCL_CODE_CHAR(code);
+    }
+  case vv_base_string:
+  case vv_string:
+    return vv_define(in, label, vv_read_string(env, in, tag));
+  case vv_symbol:
+    return vv_read_symbol(env, in);
+  case vv_keyword:
+    {
+      int intern_flag;
+      return mkcl_intern(env, vv_read_name(env, in), mkcl_core.keyword_package, &intern_flag);
+    }
+  case vv_uninterned_symbol:
+    return vv_define(in, label, mk_cl_make_symbol(env, vv_read_name(env, in)));
+  case vv_list:
+    return vv_read_list(env, in, label);
+  case vv_vector:
+    {
+      mkcl_index i, n = vv_count(env, in);
+      mkcl_object x = vv_define(in, label, mkcl_alloc_simple_vector(env, n, mkcl_aet_object));
+
+      for (i = 0; i < n; i++)
+	x->vector.self.t[i] = vv_read_object(env, in, -1);
+      return x;
+    }
+  case vv_single_float:
+  case vv_double_float:
+  case vv_long_float:
+    return vv_read_float(env, in, tag);
+  case vv_infinity:
+    return vv_read_infinity(env, in);
+  case vv_ratio:
+    {
+      mkcl_object num = vv_read_object(env, in, -1);
+      mkcl_object den = vv_read_object(env, in, -1);
+
+      if (!MKCL_FIXNUMP(num) && !MKCL_BIGNUMP(num)) vv_corrupted(env, in);
+      if (!MKCL_FIXNUMP(den) && !MKCL_BIGNUMP(den)) vv_corrupted(env, in);
+      if (den == MKCL_MAKE_FIXNUM(0)) vv_corrupted(env, in);
+      return mkcl_make_ratio(env, num, den);
+    }
+  case vv_complex:
+    {
+      mkcl_object real = vv_read_object(env, in, -1);
+      mkcl_object imag = vv_read_object(env, in, -1);
+
+      return mk_cl_complex(env, 2, real, imag);
+    }
+  case vv_label:
+    {
+      mkcl_index index = vv_varint(env, in);
+
+      if (index >= in->nlabels || in->labels[index] != MKCL_OBJNULL)
+	vv_corrupted(env, in);
+      return vv_read_object(env, in, index);
+    }
+  case vv_reference:
+    {
+      mkcl_index index = vv_varint(env, in);
+
+      if (index >= in->nlabels || in->labels[index] == MKCL_OBJNULL)
+	vv_corrupted(env, in);
+      return in->labels[index];
+    }
+  case vv_pathname:
+    return mk_cl_parse_namestring(env, 3, vv_read_name(env, in), mk_cl_Cnil, mk_cl_Cnil);
+  default:
+    vv_corrupted(env, in);
+  }
+}
+
+static bool
+binary_data_p(mkcl_object block)
+{
+  return block->cblock.data_text_size > VV_MAGIC_LENGTH
+    && memcmp(block->cblock.data_text, VV_MAGIC, VV_MAGIC_LENGTH) == 0;
+}
+
+static void
+vv_open(MKCL, struct vv_input *in, mkcl_object block, mkcl_object filename)
+{
+  mkcl_index i;
+
+  in->p = (const unsigned char *) block->cblock.data_text + VV_MAGIC_LENGTH;
+  in->end = (const unsigned char *) block->cblock.data_text + block->cblock.data_text_size;
+  in->filename = filename;
+  in->labels = NULL;
+  in->packages = NULL;
+  in->nlabels = in->npackages = in->packages_seen = 0;
+  if (vv_byte(env, in) != VV_FORMAT_VERSION)
+    mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_format);
+  in->nlabels = vv_count(env, in);
+  in->npackages = vv_count(env, in);
+  if (in->nlabels) {
+    in->labels = mkcl_alloc(env, in->nlabels * sizeof(mkcl_object));
+    for (i = 0; i < in->nlabels; i++)
+      in->labels[i] = MKCL_OBJNULL;
+  }
+  if (in->npackages)
+    in->packages = mkcl_alloc(env, in->npackages * sizeof(mkcl_object));
+}
+
+static void
+check_fasl_header_item(MKCL, mkcl_index item, mkcl_object x, mkcl_object filename)
+{
+  switch (item) {
+  case 0:
+    /* This should be :mkcl-compiled */
+    if ( x != MK_KEY_mkcl_compiled )
+      mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_format);
+    break;
+  case 1:
+    /* This should be MKCL version number
+       of the MKCL that compiled the file. */
+    if ( MKCL_VERSION_NUMBER < mkcl_fixnum_to_word(x) )
+      mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_version);
+    break;
+  case 2:
+    /* This should be MKCL FASL version number at compilation time. */
+    if ( MKCL_FASL_VERSION != mkcl_fixnum_to_word(x) )
+      mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_stale);
+    break;
+  default:
+    /* CPU identifier, OS family and OS specific version. */
+    break;
+  }
+}
+
+#define FASL_HEADER_ITEMS 6
+
 /*
  *----------------------------------------------------------------------
  *
@@ -2591,6 +3237,24 @@ mkcl_read_VV(MKCL,
     if (temp_len)
       memset(VVtemp, 0, temp_len * sizeof(*VVtemp));
 
+    if (binary_data_p(block)) {
+      struct vv_input bin;
+
+      vv_open(env, &bin, block, filename);
+      mkcl_bds_bind(env, MK_SI_CONSTANT_reading_fasl_file, mk_cl_Ct);
+      for (i = 0; i < FASL_HEADER_ITEMS; i++)
+        check_fasl_header_item(env, i, vv_read_object(env, &bin, -1), filename);
+      for (i = 0; i < len; i++) {
+        x = vv_read_object(env, &bin, -1);
+        if (i < perm_len)
+          VV[i] = x;
+        else
+          VVtemp[i-perm_len] = x;
+      }
+      mkcl_bds_unwind1(env);
+      goto NO_DATA_LABEL; /* Nothing left for the reader. */
+    }
+
     /* Read all data for the library */
     in=mkcl_make_string_input_stream(env,
 				     mkcl_make_simple_base_string(env, (char *) block->cblock.data_text),
@@ -2608,30 +3272,8 @@ mkcl_read_VV(MKCL,
       mkcl_bds_bind(env, MK_SI_DYNVAR_backq_level, MKCL_MAKE_FIXNUM(0));
       mkcl_bds_bind(env, MK_SI_CONSTANT_reading_fasl_file, mk_cl_Ct);
 
-      /* This should be :mkcl-compiled */
-      x = mkcl_read_object(env, in);
-      if ( x != MK_KEY_mkcl_compiled )
-        mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_format);
-
-      /* This should be MKCL version number
-         of the MKCL that compiled the file. */
-      x = mkcl_read_object(env, in);
-      if ( MKCL_VERSION_NUMBER < mkcl_fixnum_to_word(x) )
-        mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_version);
-
-      /* This should be MKCL FASL version number at compilation time. */
-      x = mkcl_read_object(env, in);
-      if ( MKCL_FASL_VERSION != mkcl_fixnum_to_word(x) )
-        mk_cl_error(env, 5, MK_MKCL_bad_fasl_file, MK_KEY_pathname, filename, MK_KEY_reason, MK_KEY_stale);
-
-      /* CPU identifier */
-      x = mkcl_read_object(env, in);
-
-      /* OS family */
-      x = mkcl_read_object(env, in);
-
-      /* OS specific version */
-      x = mkcl_read_object(env, in);
+      for (i = 0; i < FASL_HEADER_ITEMS; i++)
+        check_fasl_header_item(env, i, mkcl_read_object(env, in), filename);
 
       for (i = 0 ; i < len; i++) {
         x = mkcl_read_object(env, in);
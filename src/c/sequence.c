@@ -17,6 +17,7 @@
 */
 
 #include <mkcl/mkcl.h>
+#include <string.h>
 #include <mkcl/internal.h>
 #include <mkcl/mkcl-inl.h>
 
@@ -377,3 +378,338 @@ mk_cl_nreverse(MKCL, mkcl_object seq)
     }
   mkcl_return_value(seq);
 }
+
+
+/*
+ * SORTING OF VECTORS
+ *
+ * SORT and STABLE-SORT on vectors end up here.  Vectors of raw numbers or
+ * characters ordered by #'<, #'>, #'char< or #'char> with no key, and general
+ * vectors that hold only fixnums, only double-floats or only strings under
+ * the matching predicate, are sorted in place by code that never calls back
+ * into Lisp.  Anything else is copied out with its keys, sorted by calls to
+ * the predicate, and stored back, so that a non-local exit from the
+ * predicate or the key leaves the vector as it was.
+ */
+
+#define SORT_RAW_ALLOC(n) mkcl_alloc_atomic(env, (n) * sizeof(*a))
+#define SORT_OBJ_ALLOC(n) mkcl_alloc(env, (n) * sizeof(*a))
+
+/* Element types where equal elements cannot be told apart.
+   Descending order is obtained by reversing an ascending sort. */
+#define SORT_PREFIX sort_word
+#define SORT_TYPE mkcl_word
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_index
+#define SORT_TYPE mkcl_index
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_b8
+#define SORT_TYPE uint8_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_i8
+#define SORT_TYPE int8_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_b16
+#define SORT_TYPE mkcl_uint16_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_i16
+#define SORT_TYPE mkcl_int16_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_b32
+#define SORT_TYPE mkcl_uint32_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_i32
+#define SORT_TYPE mkcl_int32_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_b64
+#define SORT_TYPE mkcl_uint64_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_i64
+#define SORT_TYPE mkcl_int64_t
+#define SORT_LESS(x, y) ((x) < (y))
+#include "sort_template.h"
+
+/* A general vector of fixnums, whose tagged words order like their values. */
+#define SORT_PREFIX sort_fixnum_object
+#define SORT_TYPE mkcl_object
+#define SORT_LESS(x, y) ((mkcl_word) (x) < (mkcl_word) (y))
+#include "sort_template.h"
+
+/* Floats, where 0.0 and -0.0 are equal but distinct. */
+#define SORT_PREFIX sort_sf_lt
+#define SORT_TYPE float
+#define SORT_LESS(x, y) ((x) < (y))
+#define SORT_ALLOC SORT_RAW_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_sf_gt
+#define SORT_TYPE float
+#define SORT_LESS(x, y) ((x) > (y))
+#define SORT_ALLOC SORT_RAW_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_df_lt
+#define SORT_TYPE double
+#define SORT_LESS(x, y) ((x) < (y))
+#define SORT_ALLOC SORT_RAW_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_df_gt
+#define SORT_TYPE double
+#define SORT_LESS(x, y) ((x) > (y))
+#define SORT_ALLOC SORT_RAW_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+/* A general vector of double-floats, sorted on unboxed copies of them. */
+struct sort_df_item { double key; mkcl_object value; };
+
+#define SORT_PREFIX sort_df_item_lt
+#define SORT_TYPE struct sort_df_item
+#define SORT_LESS(x, y) ((x).key < (y).key)
+#define SORT_ALLOC SORT_OBJ_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_df_item_gt
+#define SORT_TYPE struct sort_df_item
+#define SORT_LESS(x, y) ((x).key > (y).key)
+#define SORT_ALLOC SORT_OBJ_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+/* A general vector of strings, under STRING< or STRING>. */
+static int
+sort_string_compare(mkcl_object x, mkcl_object y)
+{
+  const mkcl_index nx = x->base_string.fillp, ny = y->base_string.fillp;
+  const mkcl_index n = (nx < ny ? nx : ny);
+  mkcl_index i;
+
+  if (x->d.t == mkcl_t_base_string && y->d.t == mkcl_t_base_string)
+    {
+      const int c = memcmp(x->base_string.self, y->base_string.self, n);
+
+      if (c) return c;
+    }
+  else
+    for (i = 0; i < n; i++)
+      {
+	const mkcl_character cx = ((x->d.t == mkcl_t_base_string) ? x->base_string.self[i] : x->string.self[i]);
+	const mkcl_character cy = ((y->d.t == mkcl_t_base_string) ? y->base_string.self[i] : y->string.self[i]);
+
+	if (cx != cy) return (cx < cy ? -1 : 1);
+      }
+  return (nx < ny ? -1 : (nx > ny));
+}
+
+#define SORT_PREFIX sort_string_lt
+#define SORT_TYPE mkcl_object
+#define SORT_LESS(x, y) (sort_string_compare(x, y) < 0)
+#define SORT_ALLOC SORT_OBJ_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+#define SORT_PREFIX sort_string_gt
+#define SORT_TYPE mkcl_object
+#define SORT_LESS(x, y) (sort_string_compare(x, y) > 0)
+#define SORT_ALLOC SORT_OBJ_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+/* Everything else, through the predicate itself. */
+struct sort_item { mkcl_object key; mkcl_object value; };
+
+#define SORT_PREFIX sort_item
+#define SORT_TYPE struct sort_item
+#define SORT_LESS(x, y) (mkcl_funcall2(env, pred, (x).key, (y).key) != mk_cl_Cnil)
+#define SORT_ALLOC SORT_OBJ_ALLOC
+#define SORT_STABLE
+#include "sort_template.h"
+
+static bool
+sort_raw_vector(MKCL, mkcl_object v, mkcl_index n, bool descending, bool stable)
+{ /* Sorts in place a vector of raw numbers under #'< or #'>. */
+  union mkcl_array_data a = v->vector.self;
+
+  switch (v->vector.elttype)
+    {
+    case mkcl_aet_fixnum:
+    case mkcl_aet_word: sort_word_sort(env, mk_cl_Cnil, a.word, n); break;
+    case mkcl_aet_index: sort_index_sort(env, mk_cl_Cnil, a.index, n); break;
+    case mkcl_aet_b8: sort_b8_sort(env, mk_cl_Cnil, a.b8, n); break;
+    case mkcl_aet_i8: sort_i8_sort(env, mk_cl_Cnil, a.i8, n); break;
+    case mkcl_aet_b16: sort_b16_sort(env, mk_cl_Cnil, a.b16, n); break;
+    case mkcl_aet_i16: sort_i16_sort(env, mk_cl_Cnil, a.i16, n); break;
+    case mkcl_aet_b32: sort_b32_sort(env, mk_cl_Cnil, a.b32, n); break;
+    case mkcl_aet_i32: sort_i32_sort(env, mk_cl_Cnil, a.i32, n); break;
+    case mkcl_aet_b64: sort_b64_sort(env, mk_cl_Cnil, a.b64, n); break;
+    case mkcl_aet_i64: sort_i64_sort(env, mk_cl_Cnil, a.i64, n); break;
+    case mkcl_aet_sf:
+      if (stable)
+	(descending ? sort_sf_gt_stable_sort : sort_sf_lt_stable_sort)(env, mk_cl_Cnil, a.sf, n);
+      else
+	(descending ? sort_sf_gt_sort : sort_sf_lt_sort)(env, mk_cl_Cnil, a.sf, n);
+      return TRUE;
+    case mkcl_aet_df:
+      if (stable)
+	(descending ? sort_df_gt_stable_sort : sort_df_lt_stable_sort)(env, mk_cl_Cnil, a.df, n);
+      else
+	(descending ? sort_df_gt_sort : sort_df_lt_sort)(env, mk_cl_Cnil, a.df, n);
+      return TRUE;
+    default:
+      return FALSE;
+    }
+  if (descending)
+    mkcl_reverse_subarray(env, v, 0, n);
+  return TRUE;
+}
+
+static bool
+sort_object_vector(MKCL, mkcl_object v, mkcl_index n, mkcl_object pred, bool stable)
+{ /* Sorts in place a general vector all of whose elements are of one kind
+     the predicate is known to order. */
+  mkcl_object * a = v->vector.self.t;
+  const bool numeric = (pred == MKCL_SYM_FUN(MK_CL_L) || pred == MKCL_SYM_FUN(MK_CL_G));
+  const bool descending = (pred == MKCL_SYM_FUN(MK_CL_G) || pred == MKCL_SYM_FUN(MK_CL_stringG));
+  mkcl_index i;
+
+  if (numeric)
+    {
+      for (i = 0; i < n && MKCL_FIXNUMP(a[i]); i++);
+      if (i == n)
+	{
+	  sort_fixnum_object_sort(env, mk_cl_Cnil, a, n);
+	  if (descending)
+	    mkcl_reverse_subarray(env, v, 0, n);
+	  return TRUE;
+	}
+      for (i = 0; i < n && MKCL_DOUBLE_FLOAT_P(a[i]); i++);
+      if (i == n)
+	{
+	  struct sort_df_item * items = mkcl_alloc(env, n * sizeof(*items));
+
+	  for (i = 0; i < n; i++)
+	    { items[i].key = mkcl_double_float(a[i]); items[i].value = a[i]; }
+	  if (stable)
+	    (descending ? sort_df_item_gt_stable_sort : sort_df_item_lt_stable_sort)(env, mk_cl_Cnil, items, n);
+	  else
+	    (descending ? sort_df_item_gt_sort : sort_df_item_lt_sort)(env, mk_cl_Cnil, items, n);
+	  for (i = 0; i < n; i++)
+	    a[i] = items[i].value;
+	  return TRUE;
+	}
+    }
+  else
+    {
+      for (i = 0; i < n && MKCL_STRINGP(a[i]); i++);
+      if (i == n)
+	{
+	  if (stable)
+	    (descending ? sort_string_gt_stable_sort : sort_string_lt_stable_sort)(env, mk_cl_Cnil, a, n);
+	  else
+	    (descending ? sort_string_gt_sort : sort_string_lt_sort)(env, mk_cl_Cnil, a, n);
+	  return TRUE;
+	}
+    }
+  return FALSE;
+}
+
+static bool
+sort_character_vector(MKCL, mkcl_object v, mkcl_index n, bool descending)
+{ /* Sorts in place a string under #'char< or #'char>. */
+  if (v->d.t == mkcl_t_base_string)
+    sort_b8_sort(env, mk_cl_Cnil, v->base_string.self, n);
+  else if (v->d.t == mkcl_t_string)
+    sort_b32_sort(env, mk_cl_Cnil, v->string.self, n);
+  else
+    return FALSE;
+  if (descending)
+    mkcl_reverse_subarray(env, v, 0, n);
+  return TRUE;
+}
+
+mkcl_object
+mk_si_sort_vector(MKCL, mkcl_object v, mkcl_object pred, mkcl_object key, mkcl_object stable)
+{
+  const bool stable_p = !mkcl_Null(stable);
+  mkcl_index n, i;
+
+  mkcl_call_stack_check(env);
+  if (!MKCL_VECTORP(v))
+    mkcl_FEtype_error_sequence(env, v);
+  n = v->vector.fillp;
+  if (n < 2)
+    mkcl_return_value(v);
+
+  pred = mk_si_coerce_to_function(env, pred);
+  if (!mkcl_Null(key))
+    key = mk_si_coerce_to_function(env, key);
+  if (mkcl_Null(key) || key == MKCL_SYM_FUN(MK_CL_identity))
+    {
+      const bool descending = (pred == MKCL_SYM_FUN(MK_CL_G)
+			       || pred == MKCL_SYM_FUN(MK_CL_charG)
+			       || pred == MKCL_SYM_FUN(MK_CL_stringG));
+
+      if (pred == MKCL_SYM_FUN(MK_CL_L) || pred == MKCL_SYM_FUN(MK_CL_G))
+	{
+	  if (v->d.t == mkcl_t_vector
+	      && (v->vector.elttype == mkcl_aet_object
+		  ? sort_object_vector(env, v, n, pred, stable_p)
+		  : sort_raw_vector(env, v, n, descending, stable_p)))
+	    mkcl_return_value(v);
+	}
+      else if (pred == MKCL_SYM_FUN(MK_CL_charL) || pred == MKCL_SYM_FUN(MK_CL_charG))
+	{
+	  if (sort_character_vector(env, v, n, descending))
+	    mkcl_return_value(v);
+	}
+      else if (pred == MKCL_SYM_FUN(MK_CL_stringL) || pred == MKCL_SYM_FUN(MK_CL_stringG))
+	{
+	  if (v->d.t == mkcl_t_vector && v->vector.elttype == mkcl_aet_object
+	      && sort_object_vector(env, v, n, pred, stable_p))
+	    mkcl_return_value(v);
+	}
+      key = mk_cl_Cnil;
+    }
+
+  {
+    struct sort_item * items = mkcl_alloc(env, n * sizeof(*items));
+
+    for (i = 0; i < n; i++)
+      {
+	mkcl_object x = mkcl_vref_index(env, v, i);
+
+	items[i].value = x;
+	items[i].key = (mkcl_Null(key) ? x : mkcl_funcall1(env, key, x));
+      }
+    if (stable_p)
+      sort_item_stable_sort(env, pred, items, n);
+    else
+      sort_item_sort(env, pred, items, n);
+    for (i = 0; i < n; i++)
+      mkcl_vset_index(env, v, i, items[i].value);
+  }
+  mkcl_return_value(v);
+}
@@ -0,0 +1,328 @@
+/* -*- mode: c -*- */
+/*
+    sort_template.h -- Vector sort engine, instantiated by sequence.c.
+*/
+/*
+    MKCL is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 3 of the License, or (at your option) any later version.
+
+    See file '../../Copyright' for full details.
+*/
+
+/*
+ * This file is included once per kind of vector to be sorted, with:
+ *
+ *	SORT_PREFIX	prefix of the names of the functions defined here.
+ *	SORT_TYPE	type of the elements.
+ *	SORT_LESS(a,b)	strict order of two elements, may use env and pred.
+ *	SORT_ALLOC(n)	scratch space for n elements, may use env.
+ *	SORT_STABLE	define it to get a stable sort too.
+ *
+ * All of them are undefined at the end.
+ *
+ * PREFIX_sort() is an introsort: quicksort on a median of three, falling
+ * back to heapsort when recursion gets too deep and finishing small
+ * partitions with insertion sort.  PREFIX_stable_sort() is a natural merge
+ * sort after TimSort: it picks up the runs already present in the data,
+ * extends the short ones to a minimum length by insertion, and merges them
+ * under the usual balance rules for the stack of pending runs.
+ *
+ * SORT_LESS() may be a user predicate, nothing here assumes it to be a
+ * consistent order.  An inconsistent one yields an unspecified permutation
+ * of the elements, never an access outside of them.
+ */
+
+#define SORT_CAT2(a, b) a##b
+#define SORT_CAT(a, b) SORT_CAT2(a, b)
+#define SORT_FN(name) SORT_CAT(SORT_PREFIX, name)
+
+#ifndef SORT_INSERTION_LIMIT
+# define SORT_INSERTION_LIMIT 16
+# define SORT_MIN_MERGE 32
+# define SORT_MAX_RUNS 128 /* Run lengths grow at least like Fibonacci numbers on the stack. */
+#endif
+
+static void
+SORT_FN(_insertion_sort)(MKCL, mkcl_object pred, SORT_TYPE * a, mkcl_index n, mkcl_index sorted)
+{ /* a[0..sorted) is already in order.  Equal elements keep their order. */
+  mkcl_index i;
+
+  for (i = (sorted ? sorted : 1); i < n; i++)
+    {
+      SORT_TYPE x = a[i];
+      mkcl_index lo = 0, hi = i;
+
+      while (lo < hi)
+	{
+	  const mkcl_index mid = lo + (hi - lo) / 2;
+
+	  if (SORT_LESS(x, a[mid]))
+	    hi = mid;
+	  else
+	    lo = mid + 1;
+	}
+      memmove(a + lo + 1, a + lo, (i - lo) * sizeof(SORT_TYPE));
+      a[lo] = x;
+    }
+}
+
+static void
+SORT_FN(_sift_down)(MKCL, mkcl_object pred, SORT_TYPE * a, mkcl_index root, const mkcl_index n)
+{
+  SORT_TYPE x = a[root];
+
+  for (;;)
+    {
+      mkcl_index child = 2 * root + 1;
+
+      if (child >= n)
+	break;
+      if (child + 1 < n && SORT_LESS(a[child], a[child + 1]))
+	child++;
+      if (!SORT_LESS(x, a[child]))
+	break;
+      a[root] = a[child];
+      root = child;
+    }
+  a[root] = x;
+}
+
+static void
+SORT_FN(_heap_sort)(MKCL, mkcl_object pred, SORT_TYPE * a, const mkcl_index n)
+{
+  mkcl_index i;
+
+  for (i = n / 2; i-- > 0;)
+    SORT_FN(_sift_down)(env, pred, a, i, n);
+  for (i = n; --i > 0;)
+    {
+      SORT_TYPE x = a[0];
+
+      a[0] = a[i];
+      a[i] = x;
+      SORT_FN(_sift_down)(env, pred, a, 0, i);
+    }
+}
+
+static void
+SORT_FN(_introsort)(MKCL, mkcl_object pred, SORT_TYPE * a, mkcl_index n, int depth)
+{
+  while (n > SORT_INSERTION_LIMIT)
+    {
+      mkcl_index i, j;
+      SORT_TYPE p;
+
+      if (depth-- == 0)
+	{ SORT_FN(_heap_sort)(env, pred, a, n); return; }
+
+      { /* Median of three, left in a[0] as the pivot. */
+	const mkcl_index mid = n / 2;
+	SORT_TYPE x;
+
+	if (SORT_LESS(a[mid], a[0])) { x = a[mid]; a[mid] = a[0]; a[0] = x; }
+	if (SORT_LESS(a[n - 1], a[mid])) { x = a[mid]; a[mid] = a[n - 1]; a[n - 1] = x; }
+	if (SORT_LESS(a[mid], a[0])) { x = a[mid]; a[mid] = a[0]; a[0] = x; }
+	x = a[mid]; a[mid] = a[0]; a[0] = x;
+	p = x;
+      }
+
+      /* Hoare partition, the bounds only matter to inconsistent predicates. */
+      i = 0; j = n;
+      for (;;)
+	{
+	  SORT_TYPE x;
+
+	  do i++; while (i < n - 1 && SORT_LESS(a[i], p));
+	  do j--; while (j > 0 && SORT_LESS(p, a[j]));
+	  if (i >= j)
+	    break;
+	  x = a[i]; a[i] = a[j]; a[j] = x;
+	}
+      a[0] = a[j]; a[j] = p; /* the pivot lands in its final place. */
+
+      /* Recurse into the smaller side, loop on the larger one. */
+      if (j < n - 1 - j)
+	{
+	  SORT_FN(_introsort)(env, pred, a, j, depth);
+	  a += j + 1;
+	  n -= j + 1;
+	}
+      else
+	{
+	  SORT_FN(_introsort)(env, pred, a + j + 1, n - j - 1, depth);
+	  n = j;
+	}
+    }
+  SORT_FN(_insertion_sort)(env, pred, a, n, 0);
+}
+
+static void
+SORT_FN(_sort)(MKCL, mkcl_object pred, SORT_TYPE * a, const mkcl_index n)
+{
+  int depth = 0;
+  mkcl_index m;
+
+  for (m = n; m > 1; m >>= 1)
+    depth += 2;
+  SORT_FN(_introsort)(env, pred, a, n, depth);
+}
+
+#ifdef SORT_STABLE
+
+static mkcl_index
+SORT_FN(_count_run)(MKCL, mkcl_object pred, SORT_TYPE * a, const mkcl_index n)
+{ /* Length of the run at the start of a, which is reversed if strictly descending. */
+  mkcl_index i = 1;
+
+  if (n < 2)
+    return n;
+  if (SORT_LESS(a[1], a[0]))
+    {
+      mkcl_index lo, hi;
+
+      while (i + 1 < n && SORT_LESS(a[i + 1], a[i]))
+	i++;
+      for (lo = 0, hi = i; lo < hi; lo++, hi--)
+	{ SORT_TYPE x = a[lo]; a[lo] = a[hi]; a[hi] = x; }
+    }
+  else
+    while (i + 1 < n && !SORT_LESS(a[i + 1], a[i]))
+      i++;
+  return i + 1;
+}
+
+static void
+SORT_FN(_merge)(MKCL, mkcl_object pred, SORT_TYPE * a, mkcl_index n1, mkcl_index n2, SORT_TYPE * tmp)
+{ /* Merges the adjacent runs a[0..n1) and a[n1..n1+n2), tmp has room for the smaller one. */
+  mkcl_index lo = 0, hi = n1;
+
+  /* Elements of the first run not above a[n1] are already in place. */
+  while (lo < hi)
+    {
+      const mkcl_index mid = lo + (hi - lo) / 2;
+
+      if (SORT_LESS(a[n1], a[mid]))
+	hi = mid;
+      else
+	lo = mid + 1;
+    }
+  a += lo;
+  n1 -= lo;
+  if (n1 == 0)
+    return;
+
+  /* And so are the elements of the second run not below a[n1 - 1]. */
+  lo = 0; hi = n2;
+  while (lo < hi)
+    {
+      const mkcl_index mid = lo + (hi - lo) / 2;
+
+      if (SORT_LESS(a[n1 + mid], a[n1 - 1]))
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  n2 = lo;
+  if (n2 == 0)
+    return;
+
+  if (n1 <= n2)
+    { /* Forward, out of a copy of the first run. */
+      mkcl_index i = 0, j = n1, k = 0;
+
+      memcpy(tmp, a, n1 * sizeof(SORT_TYPE));
+      while (i < n1 && j < n1 + n2)
+	a[k++] = (SORT_LESS(a[j], tmp[i]) ? a[j++] : tmp[i++]);
+      while (i < n1)
+	a[k++] = tmp[i++];
+    }
+  else
+    { /* Backward, out of a copy of the second run. */
+      mkcl_index i = n1, j = n2, k = n1 + n2;
+
+      memcpy(tmp, a + n1, n2 * sizeof(SORT_TYPE));
+      while (i > 0 && j > 0)
+	a[--k] = (SORT_LESS(tmp[j - 1], a[i - 1]) ? a[--i] : tmp[--j]);
+      while (j > 0)
+	a[--k] = tmp[--j];
+    }
+}
+
+static void
+SORT_FN(_stable_sort)(MKCL, mkcl_object pred, SORT_TYPE * a, const mkcl_index n)
+{
+  mkcl_index base[SORT_MAX_RUNS], len[SORT_MAX_RUNS];
+  mkcl_index min_run, lo = 0, m, r = 0;
+  int sp = 0;
+  SORT_TYPE * tmp;
+
+  if (n <= SORT_MIN_MERGE)
+    { SORT_FN(_insertion_sort)(env, pred, a, n, 0); return; }
+
+  /* A run length between SORT_MIN_MERGE/2 and SORT_MIN_MERGE that splits n into
+     a power of 2 of runs, or a bit less. */
+  for (m = n; m >= SORT_MIN_MERGE; m >>= 1)
+    r |= m & 1;
+  min_run = m + r;
+
+  tmp = SORT_ALLOC(n / 2 + 1);
+  while (lo < n)
+    {
+      mkcl_index run = SORT_FN(_count_run)(env, pred, a + lo, n - lo);
+
+      if (run < min_run)
+	{
+	  const mkcl_index forced = (n - lo < min_run ? n - lo : min_run);
+
+	  SORT_FN(_insertion_sort)(env, pred, a + lo, forced, run);
+	  run = forced;
+	}
+      base[sp] = lo; len[sp] = run; sp++;
+      lo += run;
+
+      /* Restore the balance of the pending runs, 'at' being the lower of the two merged. */
+      while (sp > 1)
+	{
+	  int at = sp - 2;
+
+	  if ((at > 0 && len[at - 1] <= len[at] + len[at + 1])
+	      || (at > 1 && len[at - 2] <= len[at - 1] + len[at]))
+	    {
+	      if (len[at - 1] < len[at + 1])
+		at--;
+	    }
+	  else if (len[at] > len[at + 1])
+	    break;
+	  SORT_FN(_merge)(env, pred, a + base[at], len[at], len[at + 1], tmp);
+	  len[at] += len[at + 1];
+	  if (at == sp - 3)
+	    { base[at + 1] = base[at + 2]; len[at + 1] = len[at + 2]; }
+	  sp--;
+	}
+    }
+  while (sp > 1)
+    {
+      int at = sp - 2;
+
+      if (at > 0 && len[at - 1] < len[at + 1])
+	at--;
+      SORT_FN(_merge)(env, pred, a + base[at], len[at], len[at + 1], tmp);
+      len[at] += len[at + 1];
+      if (at == sp - 3)
+	{ base[at + 1] = base[at + 2]; len[at + 1] = len[at + 2]; }
+      sp--;
+    }
+}
+
+#endif /* SORT_STABLE */
+
+#undef SORT_FN
+#undef SORT_CAT
+#undef SORT_CAT2
+#undef SORT_PREFIX
+#undef SORT_TYPE
+#undef SORT_LESS
+#undef SORT_ALLOC
+#undef SORT_STABLE
@@ -427,8 +427,8 @@ mk_si_bds_val(MKCL, mkcl_object arg)
 
 /******************** INVOCATION STACK **********************/
 
-static mkcl_object
-ihs_function_name(mkcl_object x)
+mkcl_object
+mkcl_ihs_function_name(mkcl_object x)
 {
   mkcl_object y;
 
@@ -473,7 +473,7 @@ mkcl_object
 mk_si_ihs_top_function_name(MKCL)
 {
   mkcl_call_stack_check(env);
-  mkcl_return_value(ihs_function_name(env->ihs_top->function));
+  mkcl_return_value(mkcl_ihs_function_name(env->ihs_top->function));
 }
 
 mkcl_object
@@ -517,6 +517,35 @@ mk_si_ihs_bds_marker(MKCL, mkcl_object arg)
   mkcl_return_value(MKCL_MAKE_FIXNUM(get_ihs_ptr(env, mkcl_integer_to_index(env, arg))->bds_marker));
 }
 
+mkcl_object
+mkcl_ihs_backtrace(MKCL, mkcl_index max_depth)
+{ /* The names of the innermost max_depth functions of the IHS, innermost first. */
+  mkcl_object head = mk_cl_Cnil;
+  mkcl_object * tail = &head;
+  mkcl_ihs_ptr p;
+
+  for (p = env->ihs_top; p != NULL && p->index > 0 && max_depth > 0; p = p->next, max_depth--)
+    {
+      mkcl_object cell = mkcl_list1(env, mkcl_ihs_function_name(p->function));
+
+      *tail = cell;
+      tail = &MKCL_CONS_CDR(cell);
+    }
+  return head;
+}
+
+mkcl_index
+mkcl_ihs_frame_functions(MKCL, mkcl_object * functions, mkcl_index max_depth)
+{ /* Stores the innermost max_depth functions of the IHS, innermost first.
+     Neither allocates nor takes locks, a signal handler may call it. */
+  mkcl_index depth = 0;
+  mkcl_ihs_ptr p;
+
+  for (p = env->ihs_top; p != NULL && p->index > 0 && depth < max_depth; p = p->next)
+    functions[depth++] = p->function;
+  return depth;
+}
+
 /********************** FRAME STACK *************************/
 
 static void _resize_frs_stack(MKCL, mkcl_index new_size)
@@ -4510,6 +4510,46 @@ mkcl_symbol_initializer mkcl_root_symbol_inits[] = {
   {SYS_ "ANSI-OPEN-STREAM-P", SI_ORDINARY, mk_si_ansi_open_stream_p, 1, MKCL_OBJNULL},
   {SYS_ "ANSI-STREAM-ELEMENT-TYPE", SI_ORDINARY, mk_si_ansi_stream_element_type, 1, MKCL_OBJNULL},
 
+  {KEY_ "SYNCHRONIZED", KEYWORD, NULL, -1, MKCL_OBJNULL},
+  {MKCL_EXT_ "HASH-TABLE-SYNCHRONIZED-P", MKCL_EXT_ORDINARY, mk_mkcl_hash_table_synchronized_p, 1, MKCL_OBJNULL},
+  {KEY_ "WEAKNESS", KEYWORD, NULL, -1, MKCL_OBJNULL},
+  {KEY_ "VALUE", KEYWORD, NULL, -1, MKCL_OBJNULL},
+  {KEY_ "KEY-AND-VALUE", KEYWORD, NULL, -1, MKCL_OBJNULL},
+  {MKCL_EXT_ "HASH-TABLE-WEAKNESS", MKCL_EXT_ORDINARY, mk_mkcl_hash_table_weakness, 1, MKCL_OBJNULL},
+
+  {SYS_ "SORT-VECTOR", SI_ORDINARY, mk_si_sort_vector, 4, MKCL_OBJNULL},
+
+  {SYS_ "START-ALLOCATION-SAMPLING", SI_ORDINARY, mk_si_start_allocation_sampling, 1, MKCL_OBJNULL},
+  {SYS_ "STOP-ALLOCATION-SAMPLING", SI_ORDINARY, mk_si_stop_allocation_sampling, 0, MKCL_OBJNULL},
+  {SYS_ "ALLOCATION-SAMPLES", SI_ORDINARY, mk_si_allocation_samples, 0, MKCL_OBJNULL},
+
+  {SYS_ "START-CPU-PROFILING", SI_ORDINARY, mk_si_start_cpu_profiling, 2, MKCL_OBJNULL},
+  {SYS_ "STOP-CPU-PROFILING", SI_ORDINARY, mk_si_stop_cpu_profiling, 0, MKCL_OBJNULL},
+
+  {SYS_ "FLOAT-TO-DIGITS", SI_ORDINARY, mk_si_float_to_digits, 1, MKCL_OBJNULL},
+
+  {MKCL_EXT_ "FORK", MKCL_EXT_ORDINARY, mk_mkcl_fork, 0, MKCL_OBJNULL},
+
+  {MKCL_EXT_ "WRITE-OCTET-VECTORS", MKCL_EXT_ORDINARY, mk_mkcl_write_octet_vectors, 2, MKCL_OBJNULL},
+
+  {MKCL_EXT_ "PROCESSOR-COUNT", MKCL_EXT_ORDINARY, mk_mkcl_processor_count, 0, MKCL_OBJNULL},
+  {SYS_ "LOAD-C-SOURCE", SI_ORDINARY, mk_si_load_c_source, 4, MKCL_OBJNULL},
+  {SYS_ "MAKE-SLOT-CACHE", SI_ORDINARY, mk_si_make_slot_cache, 0, MKCL_OBJNULL},
+  {SYS_ "FILL-SLOT-CACHE", SI_ORDINARY, mk_si_fill_slot_cache, 3, MKCL_OBJNULL},
+  {SYS_ "CLEAR-SLOT-CACHES", SI_ORDINARY, mk_si_clear_slot_caches, 0, MKCL_OBJNULL},
+  {SYS_ "CACHED-SLOT-VALUE", SI_ORDINARY, mk_si_cached_slot_value, 3, MKCL_OBJNULL},
+  {SYS_ "CACHED-SLOT-BOUNDP", SI_ORDINARY, mk_si_cached_slot_boundp, 3, MKCL_OBJNULL},
+  {SYS_ "CACHED-SLOT-SET", SI_ORDINARY, mk_si_cached_slot_set, 4, MKCL_OBJNULL},
+  {CLOS_ "SLOT-CACHE-MISS", CLOS_INTERNAL_ORDINARY, NULL, -1, MKCL_OBJNULL},
+  {SYS_ "PROMOTE-BYTECODE", SI_ORDINARY, mk_si_promote_bytecode, 2, MKCL_OBJNULL},
+  {SYS_ "SET-BYTECODE-PROMOTION-THRESHOLD", SI_ORDINARY, mk_si_set_bytecode_promotion_threshold, 1, MKCL_OBJNULL},
+  {SYS_ "REQUEST-BYTECODE-PROMOTION", SI_ORDINARY, NULL, -1, MKCL_OBJNULL},
+  {SYS_ "START-BYTECODE-PROMOTION", SI_ORDINARY, NULL, -1, MKCL_OBJNULL},
+  {SYS_ "STOP-BYTECODE-PROMOTION", SI_ORDINARY, NULL, -1, MKCL_OBJNULL},
+  {SYS_ "NOTE-THREAD-KILL", SI_ORDINARY, NULL, -1, MKCL_OBJNULL},
+  {SYS_ "BYTECODE-DISPATCH-STATS", SI_ORDINARY, mk_si_bytecode_dispatch_stats, 1, MKCL_OBJNULL},
+  {SYS_ "*BYTECODE-SUPERINSTRUCTIONS*", SI_SPECIAL, NULL, -1, mk_cl_Ct},
+
   /* Tag for end of list!
      This entry, with a first field of NULL value,
      must be the very last of this array.
@@ -267,6 +267,11 @@ mkcl_top_apply(MKCL, mkcl_object function, mkcl_object args)
   return value;
 }
 
+#if MKCL_PTHREADS
+/* Threads enabled but not yet on mkcl_core.threads, see mkcl_check_threads_before_fork(). */
+static volatile int starting_threads = 0;
+#endif
+
 static thread_value_t CALL_CONV thread_entry_point(void *arg)
 {
   char stack_mark = 0;
@@ -296,6 +301,9 @@ static thread_value_t CALL_CONV thread_entry_point(void *arg)
     mkcl_setup_thread_lisp_context(env, &stack_mark);
 
     mkcl_register_thread_as_active(env, thread);
+#if MKCL_PTHREADS
+    __atomic_sub_fetch(&starting_threads, 1, __ATOMIC_RELEASE);
+#endif
     mkcl_enable_interrupts(env);
 
     /* 2) Execute the code. */
@@ -902,6 +910,7 @@ mkcl_make_thread(MKCL, mkcl_object name, mkcl_object initial_bindings, struct mk
   thread->thread.args = mk_cl_Cnil;
   thread->thread.result_value = MKCL_OBJNULL;
   thread->thread.detached = FALSE;
+  thread->thread.daemon = FALSE;
   thread->thread.thread = 0;
   thread->thread.base_thread = 0;
   thread->thread.tid = 0;
@@ -1117,6 +1126,7 @@ static void mkcl_create_imported_thread_pool_filler_thread(MKCL)
 
   thread->thread.function = mk_cl_Cnil;
   thread->thread.args = mk_cl_Cnil;
+  thread->thread.daemon = TRUE;
 
 #if MKCL_WINDOWS
   {
@@ -1594,6 +1604,7 @@ static void mkcl_create_finalization_thread(MKCL)
 
   thread->thread.function = mk_cl_Cnil;
   thread->thread.args = mk_cl_Cnil;
+  thread->thread.daemon = TRUE;
 
 #if MKCL_WINDOWS
   {
@@ -1856,6 +1867,7 @@ void mkcl_create_signal_servicing_thread(MKCL,
 
   thread->thread.function = func_designator;
   thread->thread.args = mk_cl_Cnil;
+  thread->thread.daemon = TRUE;
   
   thread->thread.running_lock = mkcl_alloc_atomic(env, sizeof(pthread_mutex_t));
   pthread_mutex_init(thread->thread.running_lock, NULL);
@@ -2483,6 +2495,16 @@ mkcl_object mk_mt_interrupt_thread(MKCL, mkcl_narg narg, mkcl_object thread, mkc
   }
 }
 
+static void
+note_thread_kill(MKCL, mkcl_object thread)
+{
+  /* The killed thread runs no cleanup, the hook may do some for it (see mp.lsp). */
+  mkcl_object hook = MKCL_SYM_FUN(MK_SI_note_thread_kill);
+
+  if (hook != MKCL_OBJNULL && !mkcl_Null(hook))
+    mkcl_funcall1(env, hook, thread);
+}
+
 mkcl_object
 mk_mt_thread_kill(MKCL, mkcl_object thread)
 {
@@ -2490,10 +2512,13 @@ mk_mt_thread_kill(MKCL, mkcl_object thread)
 
   mkcl_call_stack_check(env);
   mkcl_assert_type_thread(env, thread);
+  if (thread == mkcl_current_thread(env))
+    note_thread_kill(env, thread); /* Now, since there is no return from the kill. */
   MKCL_UNWIND_PROTECT_BEGIN(env) {
     MKCL_LIBC_NO_INTR(env, val = interrupt_thread_internal(env, thread, MK_MT_abort_thread, 0, mk_cl_Ct));
   } MKCL_UNWIND_PROTECT_EXIT {
   } MKCL_UNWIND_PROTECT_END;
+  note_thread_kill(env, thread);
 
 #if 0   /* a thread removes itself from the threads list if it needs to. JCB */
   {
@@ -2895,8 +2920,12 @@ mk_mt_thread_enable(MKCL, mkcl_object thread)
       { errno = code; mkcl_FElibc_error(env, "Startup synchronization initiation failed for thread ~S", 1, thread); }
 
     thread->thread.thread = 0;
+    __atomic_add_fetch(&starting_threads, 1, __ATOMIC_ACQUIRE);
     MKCL_GC_NO_INTR(env, create_code = pthread_create(&thread->thread.thread, attr, thread_entry_point, thread)); /* GC redirect */
-    if (create_code == 0) thread->thread.base_thread = thread->thread.thread;
+    if (create_code == 0)
+      thread->thread.base_thread = thread->thread.thread;
+    else
+      __atomic_sub_fetch(&starting_threads, 1, __ATOMIC_RELEASE);
 
     MKCL_LIBC_NO_INTR(env, code = pthread_mutex_unlock(thread->thread.running_lock));
     if (code)
@@ -4318,6 +4347,7 @@ mkcl_init_early_threads(MKCL)
   thread->thread.args = mk_cl_Cnil;
   thread->thread.result_value = MKCL_OBJNULL;
   thread->thread.detached = FALSE;
+  thread->thread.daemon = FALSE;
   thread->thread.thread = main_thread;
   thread->thread.base_thread = main_thread;
   thread->thread.tid = mkcl_gettid();
@@ -4353,6 +4383,99 @@ mkcl_init_late_threads(MKCL)
   mkcl_create_finalization_thread(env);
 }
 
+#if MKCL_PTHREADS
+/* Only the thread calling fork() makes it into the child, so we fork only
+   when that thread is the initial one and the others are our own daemons,
+   idle at that point, which we can restart in the child. */
+void mkcl_check_threads_before_fork(MKCL)
+{
+  volatile bool locked = false;
+  mkcl_object other = mk_cl_Cnil;
+
+  if (env->own_thread != mkcl_core.initial_thread)
+    mkcl_FEerror(env, "mkcl:fork can only be called from the initial thread, not from ~S.", 1, env->own_thread);
+  /* Read before the list: a thread leaves this count only once it is on it. */
+  if (__atomic_load_n(&starting_threads, __ATOMIC_ACQUIRE))
+    mkcl_FEerror(env, "mkcl:fork cannot be called while other threads are starting.", 0);
+
+  MKCL_UNWIND_PROTECT_BEGIN(env) {
+    mkcl_object l;
+
+    MKCL_LIBC_NO_INTR(env, (MKCL_THREAD_LIST_LOCK(), locked = true));
+    for (l = mkcl_core.threads; l != mk_cl_Cnil; l = MKCL_CONS_CDR(l))
+      {
+        mkcl_object thread = MKCL_CONS_CAR(l);
+
+        if (thread != env->own_thread && !thread->thread.daemon)
+          { other = thread; break; }
+      }
+  } MKCL_UNWIND_PROTECT_EXIT {
+    if (locked) MKCL_THREAD_LIST_UNLOCK();
+  } MKCL_UNWIND_PROTECT_END;
+
+  if (!mkcl_Null(other))
+    mkcl_FEerror(env, "mkcl:fork cannot be called while other threads are running, such as ~S.", 1, other);
+}
+
+/* An error checking or recursive mutex still belongs to the thread id it had
+   in the parent, so a lock we held across fork() gets a fresh mutex, taken
+   as many times as the lock was. */
+static void reacquire_lock_after_fork(MKCL, mkcl_object lock)
+{
+  mkcl_index i;
+
+  if (mkcl_type_of(lock) != mkcl_t_lock || lock->lock.holder != env->own_thread)
+    return;
+  if (pthread_mutex_init(lock->lock.mutex, (lock->lock.recursive
+                                            ? mkcl_recursive_mutexattr
+                                            : mkcl_errorcheck_mutexattr)))
+    mkcl_lose(env, "reacquire_lock_after_fork failed on pthread_mutex_init");
+  for (i = 0; i < lock->lock.counter; i++)
+    if (pthread_mutex_lock(lock->lock.mutex))
+      mkcl_lose(env, "reacquire_lock_after_fork failed on pthread_mutex_lock");
+}
+
+/* In the child of a fork(), with interrupts disabled. */
+void mkcl_reinit_threads_after_fork(MKCL)
+{
+  const pthread_mutexattr_t * const mutexattr = mkcl_normal_mutexattr;
+  const mkcl_object self = env->own_thread;
+  mkcl_object l;
+
+  /* Whoever held these in the parent is gone. */
+  if (pthread_mutex_init(&mkcl_core.package_list_lock, mutexattr)
+      || pthread_mutex_init(&mkcl_core.thread_list_lock, mutexattr)
+      || pthread_mutex_init(&mkcl_core.special_index_lock, mutexattr)
+      || pthread_mutex_init(&mkcl_imported_thread_pool_lock, mutexattr)
+      || pthread_mutex_init(&mkcl_interrupt_thread_lock, mutexattr))
+    mkcl_lose(env, "mkcl_reinit_threads_after_fork failed on pthread_mutex_init");
+
+  if (sem_init(mkcl_sleeping_thread_interrupted, 0, 0)
+      || sem_init(mkcl_interrupted_thread_suspended, 0, 0)
+      || sem_init(mkcl_interrupted_thread_resumed, 0, 0)
+      || sem_init(mkcl_run_interrupt_function, 0, 0)
+      || sem_init(mkcl_imported_thread_pool_empty, 0, 0)
+      || sem_init(mkcl_imported_thread_pool_full, 0, 0))
+    mkcl_lose(env, "mkcl_reinit_threads_after_fork failed on sem_init");
+
+  for (l = mkcl_core.threads; l != mk_cl_Cnil; l = MKCL_CONS_CDR(l))
+    {
+      mkcl_object thread = MKCL_CONS_CAR(l);
+
+      if (thread != self)
+        thread->thread.status = mkcl_thread_done;
+    }
+  mkcl_core.threads = mkcl_list1(env, self);
+  self->thread.tid = mkcl_gettid();
+
+  /* Held when mkcl:fork is called from a file being loaded. */
+  reacquire_lock_after_fork(env, mkcl_symbol_value(env, MK_MT_CONSTANT_load_compile_lock));
+  reacquire_lock_after_fork(env, mkcl_core.shutdown_gate);
+
+  mkcl_init_late_threads(env);
+}
+#endif /* MKCL_PTHREADS */
+
 void mkcl_clean_up_threads(MKCL)
 { /* Best effort only. We cannot raise an exception from here. */
 #if MKCL_WINDOWS
@@ -1789,7 +1789,10 @@ mk_mkcl_copy_file(MKCL, mkcl_object orig, mkcl_object dest)
 	in = MKCL_IO_STREAM_FILE(orig);
       else if (orig->stream.mode == mkcl_smm_io_file || orig->stream.mode == mkcl_smm_input_file)
 	{
-	  int new_in_fd = dup(MKCL_IO_FILE_DESCRIPTOR(orig));
+	  int new_in_fd;
+
+	  mkcl_sync_stream_buffer(env, orig);
+	  new_in_fd = dup(MKCL_IO_FILE_DESCRIPTOR(orig));
 
 	  if ((new_in_fd == -1) || ((in = fdopen(new_in_fd, "rb")) == NULL)) /* we should dup() and setbuf() */
 	    {
@@ -1833,7 +1836,10 @@ mk_mkcl_copy_file(MKCL, mkcl_object orig, mkcl_object dest)
 	out = MKCL_IO_STREAM_FILE(dest);
       else if (dest->stream.mode == mkcl_smm_io_file || dest->stream.mode == mkcl_smm_output_file)
 	{
-	  int new_out_fd = dup(MKCL_IO_FILE_DESCRIPTOR(dest));
+	  int new_out_fd;
+
+	  mkcl_sync_stream_buffer(env, dest);
+	  new_out_fd = dup(MKCL_IO_FILE_DESCRIPTOR(dest));
 
 	  if ((new_out_fd == -1) || ((out = fdopen(new_out_fd, "wb")) == NULL))
 	    {
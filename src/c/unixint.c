@@ -39,6 +39,7 @@ int _resetstkoflw(void); /* since MinGW does not provide it in malloc.h like MS
 # include <dlfcn.h>
 # include <ucontext.h>
 # include <sched.h>
+# include <sys/time.h>
 #endif
 
 #include <mkcl/mkcl-fenv.h>
@@ -2157,6 +2158,31 @@ void mkcl_init_late_unixint(MKCL)
   mkcl_enable_interrupts(env);
 }
 
+#if MKCL_PTHREADS
+/* In the child of a fork(). The signal handlers came along but not the
+   threads that serve them. */
+void mkcl_reinit_unixint_after_fork(MKCL)
+{
+  int i;
+
+  mkcl_pid = getpid();
+
+  if (pthread_create(&default_signal_servicing_thread, NULL, default_signal_servicing_loop, NULL))
+    mkcl_lose(env, "mkcl_reinit_unixint_after_fork failed on pthread_create.");
+
+  for (i = 0; i <= MKCL_SIGMAX; i++)
+    if (sem_init(mkcl_signals[i].sem, 0, 0))
+      mkcl_C_lose(env, "mkcl_reinit_unixint_after_fork failed on sem_init.");
+
+  install_lisp_terminal_signal_handler(env);
+  for (i = 1; i <= MKCL_SIGMAX; i++)
+    if (mkcl_signals[i].installed
+        && mk_cl_Cnil != c_signal_disposition[i].lisp_handler
+        && mk_cl_Ct != c_signal_disposition[i].lisp_handler)
+      install_lisp_signal_handler(env, i, c_signal_disposition[i].lisp_handler);
+}
+#endif /* MKCL_PTHREADS */
+
 #if __ANDROID__
 static struct sigaction old_sigwinch_sigaction;
 static void extra_wake_up_signal_handler(int sig, siginfo_t *info, void *aux)
@@ -2406,6 +2432,200 @@ mkcl_object mk_si_install_sigsegv_monitor(MKCL)
 }
 
 
+/*
+ * Statistical CPU profiling.
+ *
+ * An ITIMER_PROF timer sends SIGPROF at each interval of CPU time used by
+ * the process, and the thread that got it copies its own IHS along with
+ * the interrupted PC into mkcl_core.cpu_samples.  The handler neither
+ * allocates nor locks, each sample takes 3 + depth words: the depth, the
+ * thread, the PC, then the IHS functions innermost first.  Compiled code
+ * only keeps IHS frames when compiled with (debug 2) or more, the PC is
+ * what tells in which C function the others spend their time.
+ */
+
+#if MKCL_UNIX
+
+#define MKCL_CPU_PROFILE_DEPTH 64
+#define MKCL_CPU_PROFILE_MEAN_SAMPLE_SIZE 16
+
+static mkcl_index cpu_samples_size = 0;
+static mkcl_index cpu_samples_fill = 0;
+static mkcl_index cpu_samples_dropped = 0;
+static bool cpu_profiling = FALSE;
+static int cpu_profile_writers = 0;
+static struct sigaction cpu_profile_old_action;
+
+static void * interrupted_pc(void * aux)
+{
+  ucontext_t * ctx = aux;
+
+#if __linux && defined(__x86_64)
+  return (void *) ctx->uc_mcontext.gregs[REG_RIP];
+#elif __linux && defined(__i386)
+  return (void *) ctx->uc_mcontext.gregs[REG_EIP];
+#elif __linux && defined(__aarch64__)
+  return (void *) ctx->uc_mcontext.pc;
+#elif __linux && defined(__arm__)
+  return (void *) ctx->uc_mcontext.arm_pc;
+#elif __FreeBSD__ && defined(__x86_64)
+  return (void *) ctx->uc_mcontext.mc_rip;
+#else
+  return NULL;
+#endif
+}
+
+void mkcl_sigprof_handler(int sig, siginfo_t *info, void *aux)
+{
+  const int saved_errno = errno;
+  const mkcl_env env = MKCL_ENV();
+
+  /* Pairs with mk_si_stop_cpu_profiling(): both sides write then read
+     the other's variable, which takes sequential consistency. */
+  __atomic_add_fetch(&cpu_profile_writers, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&cpu_profiling, __ATOMIC_SEQ_CST) && env != NULL && env->own_thread != NULL)
+    {
+      mkcl_object * const samples = mkcl_core.cpu_samples;
+      mkcl_object functions[MKCL_CPU_PROFILE_DEPTH];
+      const mkcl_index depth = mkcl_ihs_frame_functions(env, functions, MKCL_CPU_PROFILE_DEPTH);
+      mkcl_index start = __atomic_load_n(&cpu_samples_fill, __ATOMIC_RELAXED);
+
+      do
+	if (start + 3 + depth > cpu_samples_size)
+	  {
+	    __atomic_add_fetch(&cpu_samples_dropped, 1, __ATOMIC_RELAXED);
+	    goto done;
+	  }
+      while (!__atomic_compare_exchange_n(&cpu_samples_fill, &start, start + 3 + depth,
+					  TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+      samples[start] = MKCL_MAKE_FIXNUM(depth);
+      samples[start + 1] = env->own_thread;
+      samples[start + 2] = MKCL_MAKE_FIXNUM((mkcl_word) interrupted_pc(aux));
+      memcpy(samples + start + 3, functions, depth * sizeof(mkcl_object));
+    }
+ done:
+  __atomic_sub_fetch(&cpu_profile_writers, 1, __ATOMIC_RELEASE);
+  errno = saved_errno;
+}
+
+static mkcl_object pc_function_name(MKCL, mkcl_object pc, mkcl_object cache)
+{ /* The name of the C function holding pc, if the dynamic linker knows it. */
+  mkcl_object name = mkcl_gethash_safe(env, pc, cache, MKCL_OBJNULL);
+
+  if (name == MKCL_OBJNULL)
+    {
+      Dl_info info;
+
+      if (pc != MKCL_MAKE_FIXNUM(0)
+	  && dladdr((void *) mkcl_fixnum_to_word(pc), &info)
+	  && info.dli_sname != NULL)
+	name = mkcl_make_base_string_copy(env, info.dli_sname);
+      else
+	name = mk_cl_Cnil;
+      mkcl_sethash(env, pc, cache, name);
+    }
+  return name;
+}
+
+#endif /* MKCL_UNIX */
+
+mkcl_object mk_si_start_cpu_profiling(MKCL, mkcl_object interval, mkcl_object max_samples)
+{
+  mkcl_call_stack_check(env);
+#if MKCL_UNIX
+  {
+    const mkcl_word usecs
+      = mkcl_fixnum_in_range(env, MK_SI_start_cpu_profiling, "sampling interval", interval, 1, 1000000);
+    const mkcl_word nb_samples
+      = mkcl_fixnum_in_range(env, MK_SI_start_cpu_profiling, "maximum number of samples", max_samples,
+			     1, MKCL_MOST_POSITIVE_FIXNUM / (sizeof(mkcl_object) * (3 + MKCL_CPU_PROFILE_MEAN_SAMPLE_SIZE)));
+    const mkcl_index size = nb_samples * (3 + MKCL_CPU_PROFILE_MEAN_SAMPLE_SIZE);
+    struct sigaction action;
+    struct itimerval timer;
+
+    if (__atomic_load_n(&cpu_profiling, __ATOMIC_SEQ_CST))
+      mkcl_FEerror(env, "CPU profiling is already on.", 0);
+
+    /* The buffer is scanned by the GC, it keeps the sampled functions alive. */
+    mkcl_core.cpu_samples = mkcl_alloc(env, size * sizeof(mkcl_object));
+    cpu_samples_size = size;
+    cpu_samples_fill = 0;
+    cpu_samples_dropped = 0;
+
+    action.sa_sigaction = mkcl_sigprof_handler;
+    sigemptyset(&action.sa_mask);
+    if (sigaddset(&action.sa_mask, interrupt_sig))
+      mkcl_FElibc_error(env, "mk_si_start_cpu_profiling failed on sigaddset.", 0);
+    action.sa_flags = SA_SIGINFO | SA_RESTART; /* Ticks must not break system calls. */
+    if (sigaction(SIGPROF, &action, &cpu_profile_old_action))
+      mkcl_FElibc_error(env, "mk_si_start_cpu_profiling failed on sigaction.", 0);
+
+    __atomic_store_n(&cpu_profiling, TRUE, __ATOMIC_SEQ_CST);
+    timer.it_interval.tv_sec = usecs / 1000000;
+    timer.it_interval.tv_usec = usecs % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL))
+      {
+	__atomic_store_n(&cpu_profiling, FALSE, __ATOMIC_SEQ_CST);
+	(void) sigaction(SIGPROF, &cpu_profile_old_action, NULL);
+	mkcl_FElibc_error(env, "mk_si_start_cpu_profiling failed on setitimer.", 0);
+      }
+    mkcl_return_value(mk_cl_Ct);
+  }
+#else
+  mkcl_FEerror(env, "CPU profiling is not supported on this platform.", 0);
+#endif
+}
+
+mkcl_object mk_si_stop_cpu_profiling(MKCL)
+{ /* Returns the samples, a list of (thread c-function-name . ihs-function-names),
+     and the number of samples that did not fit. */
+  mkcl_call_stack_check(env);
+#if MKCL_UNIX
+  {
+    static const struct itimerval no_timer = { { 0, 0 }, { 0, 0 } };
+    mkcl_object * samples = mkcl_core.cpu_samples;
+    mkcl_object head = mk_cl_Cnil, * tail = &head, cache;
+    mkcl_index i, fill;
+
+    if (!__atomic_load_n(&cpu_profiling, __ATOMIC_SEQ_CST))
+      mkcl_return_2_values(mk_cl_Cnil, MKCL_MAKE_FIXNUM(0));
+
+    if (setitimer(ITIMER_PROF, &no_timer, NULL))
+      mkcl_FElibc_error(env, "mk_si_stop_cpu_profiling failed on setitimer.", 0);
+    __atomic_store_n(&cpu_profiling, FALSE, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&cpu_profile_writers, __ATOMIC_SEQ_CST))
+      sched_yield(); /* for the handlers still writing their sample. */
+    if (sigaction(SIGPROF, &cpu_profile_old_action, NULL))
+      mkcl_FElibc_error(env, "mk_si_stop_cpu_profiling failed on sigaction.", 0);
+    mkcl_core.cpu_samples = NULL;
+
+    cache = mk_cl__make_hash_table(env, MK_CL_eql, MKCL_MAKE_FIXNUM(256), /* size */
+				   mkcl_make_singlefloat(env, 1.5f), /* rehash-size */
+				   mkcl_make_singlefloat(env, 0.75f)); /* rehash-threshold */
+    fill = cpu_samples_fill;
+    for (i = 0; i < fill; i += 3 + mkcl_fixnum_to_word(samples[i]))
+      {
+	const mkcl_index depth = mkcl_fixnum_to_word(samples[i]);
+	mkcl_object names = mk_cl_Cnil;
+	mkcl_index j;
+
+	for (j = depth; j > 0; j--)
+	  names = mkcl_cons(env, mkcl_ihs_function_name(samples[i + 2 + j]), names);
+	names = mkcl_cons(env, samples[i + 1],
+			  mkcl_cons(env, pc_function_name(env, samples[i + 2], cache), names));
+	*tail = mkcl_list1(env, names);
+	tail = &MKCL_CONS_CDR(*tail);
+      }
+    mkcl_return_2_values(head, mkcl_make_unsigned_integer(env, cpu_samples_dropped));
+  }
+#else
+  mkcl_return_2_values(mk_cl_Cnil, MKCL_MAKE_FIXNUM(0));
+#endif
+}
+
+
 #ifdef __MINGW64__
 
 #define __ImageBase __MINGW_LSYMBOL(_image_base__)
@@ -17,6 +17,7 @@
 */
 
 #include <mkcl/mkcl.h>
+#include <mkcl/mkcl-gc.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <fcntl.h>
@@ -667,6 +668,26 @@ mk_mkcl_getpid(MKCL)
 #endif
 }
 
+mkcl_object
+mk_mkcl_processor_count(MKCL)
+{
+  mkcl_call_stack_check(env);
+#if MKCL_WINDOWS
+  {
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    mkcl_return_value(MKCL_MAKE_FIXNUM(info.dwNumberOfProcessors));
+  }
+#else
+  {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    mkcl_return_value(MKCL_MAKE_FIXNUM((count > 0) ? count : 1));
+  }
+#endif
+}
+
 pid_t mkcl_gettid(void)
 {
 #ifdef __linux
@@ -1409,13 +1430,110 @@ mkcl_object mk_mkcl_run_program_1(MKCL, mkcl_narg narg, mkcl_object command, mkc
 }
 
 
+/* A child forked from a process done booting and loading its libraries
+   starts with all of that already in place, which run-program cannot do. */
+mkcl_object mk_mkcl_fork(MKCL)
+{
+  mkcl_call_stack_check(env);
+#if MKCL_UNIX
+  {
+    const mkcl_object subprocess = mkcl_alloc_raw_process(env);
+    mkcl_interrupt_status old_intr;
+    sigset_t all_signals, old_sigmask;
+    pid_t child_pid;
+    int saved_errno;
+
+    mkcl_check_threads_before_fork(env);
+
+    subprocess->process.detached = FALSE;
+    subprocess->process.command = mkcl_core.self;
+    subprocess->process.argv = mk_cl_Cnil;
+    subprocess->process.ident = 0;
+    subprocess->process.exit_code = -1;
+    subprocess->process.plist = mk_cl_Cnil;
+    subprocess->process.status = mk_cl_Cnil;
+    subprocess->process.input = mk_cl_Cnil;
+    subprocess->process.output = mk_cl_Cnil;
+    subprocess->process.error = mk_cl_Cnil;
+    subprocess->process.to_worker = mk_cl_Cnil;
+    subprocess->process.from_worker = mk_cl_Cnil;
+    subprocess->process.error_from_worker = mk_cl_Cnil;
+    mk_si_set_finalizer(env, subprocess, mk_cl_Ct);
+
+    /* Or whatever is still buffered would come out twice. */
+    mk_cl_finish_output(env, 1, mkcl_symbol_value(env, MK_CL_DYNVAR_standard_output));
+    mk_cl_finish_output(env, 1, mkcl_symbol_value(env, MK_CL_DYNVAR_error_output));
+    fflush(NULL);
+
+    mkcl_get_interrupt_status(env, &old_intr);
+    mkcl_disable_interrupts(env);
+
+    /* No allocation from here until MK_GC_atfork_parent() or MK_GC_atfork_child(),
+       the GC lock is held. It is taken before the signals are blocked, lest a
+       collection already under way wait for ever on this thread to acknowledge
+       its suspend signal. With the lock held no other collection can start. */
+    MK_GC_atfork_prepare();
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_sigmask);
+    child_pid = fork();
+    saved_errno = errno;
+    if (child_pid == 0)
+      {
+        MK_GC_atfork_child();
+        pthread_mutex_init(&children_list_lock, mkcl_normal_mutexattr);
+        mkcl_core.children = mk_cl_Cnil;
+        mkcl_core.detached_children = mkcl_list1(env, mk_cl_Cnil);
+        pthread_sigmask(SIG_SETMASK, &old_sigmask, NULL); /* before new threads inherit it. */
+        mkcl_reinit_threads_after_fork(env);
+        mkcl_reinit_unixint_after_fork(env);
+        mkcl_set_interrupt_status(env, &old_intr);
+        mkcl_return_value(mk_cl_Cnil);
+      }
+    pthread_sigmask(SIG_SETMASK, &old_sigmask, NULL);
+    MK_GC_atfork_parent();
+    mkcl_set_interrupt_status(env, &old_intr);
+
+    if (child_pid < 0)
+      {
+        errno = saved_errno;
+        mkcl_FElibc_error(env, "mkcl:fork failed on fork().", 0);
+      }
+
+    subprocess->process.ident = child_pid;
+    subprocess->process.status = MK_KEY_running;
+    {
+      volatile bool locked = false;
+
+      MKCL_UNWIND_PROTECT_BEGIN(env) {
+        MKCL_LIBC_NO_INTR(env, (CHILDREN_LIST_LOCK(env), locked = TRUE));
+        mkcl_core.children = mkcl_cons(env, mkcl_make_integer(env, child_pid), mkcl_core.children);
+      } MKCL_UNWIND_PROTECT_EXIT {
+        if (locked) CHILDREN_LIST_UNLOCK(env);
+      } MKCL_UNWIND_PROTECT_END;
+    }
+    mkcl_return_value(subprocess);
+  }
+#else
+  mkcl_FEerror(env, "mkcl:fork is not available on this platform.", 0);
+#endif
+}
+
+
 void mkcl_finalize_process(MKCL, mkcl_object proc)
 {
-  mk_mkcl_process_status(env, proc);
 #if MKCL_UNIX
+  /* After a mkcl:fork the process may well be our parent's child, not ours,
+     so waitpid() failing is no reason to complain here. */
+  if (proc->process.ident && !proc->process.detached && proc->process.status != MK_KEY_exited)
+    {
+      int status;
+
+      (void) waitpid(proc->process.ident, &status, WNOHANG);
+    }
   if (proc->process.ident)
     delete_pid_from_children(env, proc->process.ident);
 #elif MKCL_WINDOWS
+  mk_mkcl_process_status(env, proc);
   if (proc->process.ident)
     {
       CloseHandle(proc->process.ident);
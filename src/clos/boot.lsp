@@ -220,6 +220,28 @@
       (gethash (class-slot-table class) slot-name nil)
     (find slot-name (class-slots class) :key #'slot-definition-name))) ;; linear search.
 
+;;; Call sites of SLOT-VALUE, SLOT-BOUNDP and (SETF SLOT-VALUE) with a
+;;; constant slot name are compiled to use a cache of the slot location
+;;; (see instance.c). The cache is only filled for local slots of instances
+;;; of standard classes that allow optimized slot access, since for those
+;;; the slot access protocol reduces to a plain instance reference.
+;;;
+(defun slot-cache-miss (cache operation self slot-name value)
+  (when (si:instancep self)
+    (let ((class (si:instance-class self)))
+      (when (and (eq (si:instance-class class) (find-class 'standard-class nil))
+		 (class-optimize-slot-access class))
+	(ensure-up-to-date-instance self)
+	(let* ((slotd (find-effective-slot-definition class slot-name))
+	       (location (and slotd (slot-definition-location slotd))))
+	  (when (and (mkcl:fixnump location)
+		     (eq (si:instance-sig self) (class-slots class)))
+	    (si:fill-slot-cache cache self location))))))
+  (case operation
+    (slot-value (slot-value self slot-name))
+    (slot-boundp (slot-boundp self slot-name))
+    (t (setf (slot-value self slot-name) value))))
+
 (defun slot-value (self slot-name)
   (let* ((class (class-of self))
 	 (slotd (find-effective-slot-definition class slot-name)))
@@ -242,6 +264,23 @@
       (slot-missing class self slot-name 'SETF value))
     value))
 
+;;; DEFINE-SETF-EXPANDER would do away with the function (SETF SLOT-VALUE),
+;;; hence this expander is installed by hand next to it.
+(eval-when (compile load eval)
+  (si::put-sysprop
+   'slot-value 'si::setf-method
+   #'(lambda (env self slot-name)
+       (declare (ignore env))
+       (let ((object (gensym)) (store (gensym)))
+	 (if (and (consp slot-name) (eq (first slot-name) 'quote) (symbolp (second slot-name)))
+	     (values (list object) (list self) (list store)
+		     `(si:cached-slot-set ,store ,object ,slot-name (load-time-value (si:make-slot-cache)))
+		     `(slot-value ,object ,slot-name))
+	   (let ((name (gensym)))
+	     (values (list object name) (list self slot-name) (list store)
+		     `(funcall #'(setf slot-value) ,store ,object ,name)
+		     `(slot-value ,object ,name))))))))
+
 (defun slot-makunbound (self slot-name)
   (let* ((class (class-of self))
 	 (slotd (find-effective-slot-definition class slot-name)))
@@ -243,5 +243,6 @@
 
 (defmethod make-instances-obsolete ((class class))
   (setf (class-slots class) (copy-list (class-slots class)))
+  (si:clear-slot-caches)
   class)
 
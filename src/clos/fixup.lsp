@@ -380,7 +380,8 @@
        (si:set-class-proper-name name new-value))
       ((null new-value)
        (si:set-class-proper-name name new-value))
-      (t (error "~A is not a class." new-value)))))
+      (t (error "~A is not a class." new-value)))
+     (reset-constructors name)))
   new-value)
 ) ;; eval-when
 
@@ -420,3 +421,6 @@
 
 (defgeneric update-instance-for-redefined-class (instance added-slots discarded-slots property-list &rest initargs &key &allow-other-keys))
 
+;;; The methods a constructor may bypass, see standard.lsp.
+(setq *standard-initialization-methods*
+      (initialization-methods (find-class 'standard-object) 'standard-object))
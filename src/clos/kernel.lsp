@@ -129,7 +129,8 @@
 ;;; ----------------------------------------------------------------------
 ;;; STANDARD-GENERIC-FUNCTION
 
-;; The position of the first 3 slots of this object are hardcoded in gfun.d and internal.h
+;; The position of the first 3 slots of this object are hardcoded in gfun.d and internal.h,
+;; and so is the one of dispatch-cache, which must stay the last one.
 (eval-when (compile eval)
   (defparameter +standard-generic-function-slots+
     '((name :initarg :name :initform nil
@@ -155,6 +156,7 @@
       (previous :initarg :previous :initform nil :accessor generic-function-previous)
       (source :initarg :source :initform nil :accessor generic-function-source)
       (closed-p :initarg :closed-p :initform nil :accessor generic-function-closed-p)
+      (dispatch-cache :initform nil) ;; Not MOP! Only ever touched from gfun.c
       )))
 
 #.(create-accessors +standard-generic-function-slots+ 'standard-generic-function)
@@ -215,7 +217,8 @@
        (si:set-class-proper-name name new-value))
       ((null new-value)
        (si:set-class-proper-name name nil))
-      (t (error "~A is not a class." new-value)))))
+      (t (error "~A is not a class." new-value)))
+     (reset-constructors name)))
   new-value)
 
 (defsetf find-class (&rest x) (v) `(setf-find-class ,v ,@x))
@@ -495,15 +498,37 @@
     (si:clear-gfun-cache gf))))
 
 
+
+;;; Constructors are the functions compiled calls to MAKE-INSTANCE with a
+;;; constant class name and constant initarg keys go through (see
+;;; standard.lsp). Each one lives in the CAR of a cell registered here
+;;; under its class name, and gets rebuilt on first use after a reset.
+;;; Call sites with the same class name and keys share one cell.
+
+(defvar *constructor-cells* (make-hash-table :test #'eq))
+
+(defun reset-constructors (class-name)
+  (dolist (cell (gethash class-name *constructor-cells*))
+    (setf (car cell) (constructor-trampoline cell))))
+
+(defun reset-all-constructors ()
+  (maphash #'(lambda (class-name cells)
+	       (declare (ignore cells))
+	       (reset-constructors class-name))
+	   *constructor-cells*))
+
 (defun clear-cached-make-instance (class)
   (setf (class-cached-make-instance class) nil)
+  (reset-constructors (class-id class))
   (dolist (subclass (class-direct-subclasses class))
     (clear-cached-make-instance subclass)))
 
 (defun maybe-clear-cached-make-instance (gf method)
-  (when (case (generic-function-name gf)
-	      ((shared-initialize initialize-instance allocate-instance) t)
-	      (t nil))
-    (clear-cached-make-instance (car (method-specializers method))))
+  (case (generic-function-name gf)
+    ((shared-initialize initialize-instance allocate-instance)
+     (clear-cached-make-instance (car (method-specializers method))))
+    ;; Constructors bypass MAKE-INSTANCE itself, whatever it specializes on.
+    (make-instance
+     (reset-all-constructors)))
   )
 
@@ -350,6 +350,109 @@
     )
   )
 
+;;; ----------------------------------------------------------------------
+;;; MAKE-INSTANCE CONSTRUCTORS
+;;;
+;;; The compiler turns (MAKE-INSTANCE 'NAME :KEY1 V1 ... :KEYn Vn), with a
+;;; constant NAME and constant keys, into (FUNCALL (CAR cell) V1 ... Vn)
+;;; where cell comes from MAKE-CONSTRUCTOR at load time (see cmpfun.lsp).
+;;; When NAME names a standard class on which only the standard methods of
+;;; MAKE-INSTANCE (for the class and for NAME), ALLOCATE-INSTANCE,
+;;; INITIALIZE-INSTANCE and SHARED-INITIALIZE apply, the constructor
+;;; allocates the instance and fills its slots directly, along a plan worked
+;;; out once from the class and the keys. Otherwise it simply calls
+;;; MAKE-INSTANCE. Constructors are rebuilt whenever the cached make-instance
+;;; function of their class is cleared, and all of them whenever a method of
+;;; MAKE-INSTANCE comes or goes, see kernel.lsp.
+;;;
+
+(defvar *standard-initialization-methods* nil) ;; set at the end of fixup.lsp
+
+(defun initialization-methods (class class-name)
+  (let ((prototype (class-prototype class)))
+    (append (compute-applicable-methods #'make-instance (list class-name))
+	    (compute-applicable-methods #'make-instance (list class))
+	    (compute-applicable-methods #'allocate-instance (list class))
+	    (compute-applicable-methods #'initialize-instance (list prototype))
+	    (compute-applicable-methods #'shared-initialize (list prototype t)))))
+
+(defun make-constructor (class-name keys)
+  (with-metadata-lock
+   (or (find keys (gethash class-name *constructor-cells*) :key #'cddr :test #'equal)
+       (let ((cell (list* nil class-name keys)))
+	 (setf (car cell) (constructor-trampoline cell))
+	 (push cell (gethash class-name *constructor-cells*))
+	 cell))))
+
+(defun constructor-trampoline (cell)
+  #'(lambda (&rest values)
+      (apply (setf (car cell) (compute-constructor cell)) values)))
+
+(defun compute-constructor (cell)
+  (let* ((class-name (cadr cell))
+	 (keys (cddr cell))
+	 (class (find-class class-name nil)))
+    (or (and class (optimized-constructor cell class-name class keys))
+	#'(lambda (&rest values)
+	    (apply #'make-instance class-name (mapcan #'list keys values))))))
+
+(defun optimized-constructor (cell class-name class keys)
+  (unless (and (eq (si:instance-class class) (find-class 'standard-class nil))
+	       (not (has-forward-referenced-parents class)))
+    (return-from optimized-constructor nil))
+  (unless (class-finalized-p class)
+    (finalize-inheritance class))
+  (let ((slots (class-slots class)))
+    ;; Any unknown key or other initialization method is left for
+    ;; MAKE-INSTANCE to deal with.
+    (unless (and (every #'(lambda (key)
+			    (and (not (eq key :allow-other-keys))
+				 (find key slots :test #'si:memq :key #'slot-definition-initargs)))
+			keys)
+		 (every #'(lambda (method) (si:memq method *standard-initialization-methods*))
+			(initialization-methods class class-name)))
+      (return-from optimized-constructor nil))
+    ;; Each step of the plan is (location source . datum), following
+    ;; ADD-DEFAULT-INITARGS and SHARED-INITIALIZE on standard objects.
+    (let* ((size (class-size class))
+	   (defaults (remove-if #'(lambda (default) (si:memq (first default) keys))
+				(class-default-initargs class)))
+	   (default-functions (mapcar #'third defaults))
+	   (plan (loop for slotd in slots
+		       for initargs = (slot-definition-initargs slotd)
+		       for location = (slot-definition-location slotd)
+		       for key-index = (position-if #'(lambda (key) (si:memq key initargs)) keys)
+		       for default-index = (position-if #'(lambda (default) (si:memq (first default) initargs))
+							defaults)
+		       for initfunction = (slot-definition-initfunction slotd)
+		       when key-index
+		       collect (list* location :key key-index)
+		       else when default-index
+		       collect (list* location :default default-index)
+		       else when initfunction
+		       collect (list* location :initform initfunction))))
+      #'(lambda (&rest values)
+	  (declare (dynamic-extent values))
+	  (if (eq (class-slots class) slots)
+	      (let ((instance (si:allocate-raw-instance nil class size))
+		    (default-values (mapcar #'funcall default-functions)))
+		(declare (type standard-object instance))
+		(si:instance-sig-set2 instance slots)
+		(dolist (step plan instance)
+		  (let ((location (car step))
+			(datum (cddr step)))
+		    (case (cadr step)
+		      (:key (setq datum (nth datum values)))
+		      (:default (setq datum (nth datum default-values)))
+		      (t (if (or (mkcl:fixnump location) (not (si:sl-boundp (car location))))
+			     (setq datum (funcall datum))
+			   (setq location nil))))
+		    (cond ((mkcl:fixnump location)
+			   (si:instance-set instance (the fixnum location) datum))
+			  (location
+			   (rplaca location datum))))))
+	    (apply (setf (car cell) (compute-constructor cell)) values))))))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 
 (defun add-default-initargs (class initargs)
@@ -543,8 +646,8 @@
 (defmethod unfinalize-inheritance ((class class))
   "Undo side-effects of finalize-inheritance((* class))."
   ;; empty root method
-  ;; support the protocol but nothing to really do yet. JCB
-  )
+  ;; support the protocol but nothing else to really do yet. JCB
+  (si:clear-slot-caches))
 
 (defun std-create-slots-table (class)
   (let* ((all-slots (class-slots class))
@@ -556,6 +659,8 @@
 (defmethod finalize-inheritance ((class standard-class))
   (call-next-method)
   (std-create-slots-table class)
+  ;; Slot locations may have moved, see slot-cache-miss.
+  (si:clear-slot-caches)
   (std-class-generate-accessors class))
 
 (defmethod unfinalize-inheritance ((class standard-class))
@@ -539,6 +539,10 @@
   "Do we assume that type and class definitions will not change?"
   (< (cmp-env-optimization 'safety env) 1))
 
+(defun policy-expand-format-p (&optional (env *cmp-env*))
+  "Do we turn a FORMAT control string known at compile time into code?"
+  (<= (cmp-env-optimization 'space env) (cmp-env-optimization 'speed env)))
+
 
 ;;;
 ;;;
@@ -232,6 +232,56 @@
 	     (#. boole-orc2 `(logorc2 ,op1 ,op2))))
       form))
 
+;;----------------------------------------------------------------------
+;; FORMAT with a literal control string gets the function FORMATTER
+;; would make of it, so the string is not parsed again at each call.
+;; A control string FORMATTER rejects is left for FORMAT to complain about.
+;;
+
+(define-compiler-macro format (&whole form destination control-string &rest args)
+  (let ((function (and (stringp control-string)
+		       (policy-expand-format-p)
+		       (handler-case (si::%formatter control-string)
+			 (error () nil)))))
+    (if function
+	`(format ,destination #',function ,@args)
+	form)))
+
+;;----------------------------------------------------------------------
+;; SLOT-VALUE and SLOT-BOUNDP of a constant slot name go through a cache
+;; of the slot location owned by the call site. (SETF SLOT-VALUE) gets the
+;; same treatment from its SETF expander in clos/boot.lsp.
+;;
+
+(defun constant-slot-name-p (slot-name)
+  (and (consp slot-name) (eq (first slot-name) 'quote) (symbolp (second slot-name))))
+
+(define-compiler-macro slot-value (&whole form object slot-name)
+  (if (constant-slot-name-p slot-name)
+      `(si:cached-slot-value ,object ,slot-name (load-time-value (si:make-slot-cache)))
+      form))
+
+(define-compiler-macro slot-boundp (&whole form object slot-name)
+  (if (constant-slot-name-p slot-name)
+      `(si:cached-slot-boundp ,object ,slot-name (load-time-value (si:make-slot-cache)))
+      form))
+
+;;----------------------------------------------------------------------
+;; MAKE-INSTANCE of a constant class name with constant initarg keys
+;; calls a constructor specialized for the class and keys, see
+;; clos/standard.lsp.
+;;
+
+(define-compiler-macro make-instance (&whole form class &rest initargs)
+  (if (and (consp class) (eq (first class) 'quote) (symbolp (second class))
+	   (evenp (length initargs))
+	   (loop for key in initargs by #'cddr
+		 always (and (keywordp key) (not (eq key :allow-other-keys)))))
+      (let ((keys (loop for key in initargs by #'cddr collect key))
+	    (values (loop for value in (rest initargs) by #'cddr collect value)))
+	`(funcall (car (load-time-value (clos::make-constructor ,class ',keys))) ,@values))
+      form))
+
 ;----------------------------------------------------------------------
 
 (defun co1coerce (args &aux expr type (info (make-info)))
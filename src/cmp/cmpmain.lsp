@@ -18,8 +18,13 @@
 
 (defvar *trace-cc* nil)
 
+(defvar *deferred-commands* nil) ;; while a list cell, run-command only records into its car.
+
 (defun run-command (string directory &key real-name)
   ;; STRING, DIRECTORY and REAL-NAME must be strings.
+  (when *deferred-commands*
+    (push (list string directory real-name) (car *deferred-commands*))
+    (return-from run-command (values 0 nil)))
   (cmpnote "Doing: ~A" string)
   (when *trace-cc*
     (format t "~&Doing: ~A, in ~S~%" string directory)
@@ -137,6 +142,14 @@
           (*mkcl-default-library-directory*)
 	  ((error "Unable to find library directory")))))
 
+(let* ((bin-dir (make-pathname :name nil :type nil :version nil :defaults (si:self-truename)))
+       (candidates (list (merge-pathnames "../lib/mkcc/" bin-dir) ;; installed
+			 (merge-pathnames "lib/mkcc/" bin-dir)))) ;; build tree
+  (defun mkcc-directory ()
+    "Finds the directory of libmkcc and of its support files, or returns NIL."
+    (or *mkcc-directory*
+	(find-if #'(lambda (dir) (mkcl:probe-file-p (merge-pathnames "libmkcc.so" dir))) candidates))))
+
 (defun libs-ld-flags (libraries mkcl-libraries use-mkcl-shared-libs use-external-shared-libs)
   (declare (ignorable use-mkcl-shared-libs))
   (let ((mkcl-libdir (namestring (mkcl-library-directory)))
@@ -274,6 +287,167 @@
 		 (namestring working-directory))))
 
 
+;;;
+;;; Parallel C compilation.
+;;;
+;;; While *c-compilation-pipeline* is bound compile-file translates its
+;;; file to C as usual but leaves running the C compiler and the linker
+;;; to a thread of its own, and goes on translating the next file.  At
+;;; most as many of these jobs run at once as the pipeline has slots.
+;;;
+
+(defvar *c-compilation-pipeline* nil)
+
+(defstruct (c-compilation-pipeline (:conc-name pipeline-))
+  slots ;; a semaphore counting the jobs that may still be started.
+  (jobs nil)) ;; most recent first.
+
+(defstruct (c-compilation-job (:conc-name job-))
+  source
+  output-file
+  tmp-output
+  commands ;; as recorded by run-command: (string directory real-name).
+  to-delete
+  thread
+  (log nil) ;; (string result output) of each command run.
+  (condition nil))
+
+(defmacro with-deferred-commands ((deferp) &body body)
+  "Evaluates BODY. If DEFERP is true the commands BODY would run are
+returned instead, in order."
+  `(flet ((body () ,@body))
+     (if ,deferp
+	 (let ((*deferred-commands* (list nil)))
+	   (body)
+	   (reverse (car *deferred-commands*)))
+       (progn (body) nil))))
+
+(defun run-c-compilation-job (job)
+  ;; Runs in a thread of its own, reporting is left to finish-c-compilation-job.
+  (let ((log nil))
+    (handler-case
+	(dolist (command (job-commands job)
+			 (unless (equal (job-output-file job) (job-tmp-output job))
+			   (rename-file (job-tmp-output job) (job-output-file job))))
+	  (destructuring-bind (string directory real-name) command
+	    (multiple-value-bind (result output)
+		(if real-name
+		    (mkcl:run-command string directory :real-name real-name)
+		  (mkcl:run-command string directory))
+	      (push (list string result output) log)
+	      (unless (zerop result) (return)))))
+      (error (condition)
+	(setf (job-condition job) condition)))
+    (setf (job-log job) (nreverse log))))
+
+(defun start-c-compilation-job (pipeline job)
+  (let ((slots (pipeline-slots pipeline))
+	(started nil))
+    (mt:semaphore-wait slots)
+    (unwind-protect
+	(progn
+	  (setf (job-thread job)
+		(mt:thread-run-function "C compilation"
+					#'(lambda ()
+					    (unwind-protect
+						(run-c-compilation-job job)
+					      (mt:semaphore-signal slots)))))
+	  (setq started t))
+      (unless started (mt:semaphore-signal slots)))
+    (push job (pipeline-jobs pipeline))
+    job))
+
+(defun finish-c-compilation-job (job &optional (report t))
+  "Waits for JOB to be done and returns the truename of its output file, or
+NIL if it failed."
+  (mt:join-thread (prog1 (job-thread job) (setf (job-thread job) nil)))
+  (when report
+    (dolist (entry (job-log job))
+      (destructuring-bind (string result output) entry
+	(when (and *trace-cc* output)
+	  (format t "~{~A~}~%" output)
+	  (finish-output))
+	(unless (zerop result)
+	  (cerror "Continue anyway."
+		  "(mkcl:run-command ~S) returned non-zero value ~D~%~
+                   Command output:~%~{~A~}~%"
+		  string result output))))
+    (when (job-condition job)
+      (cerror "Continue anyway." "Building ~A failed: ~A" (job-output-file job) (job-condition job))))
+  (mapc #'cmp-delete-file (job-to-delete job))
+  (let ((truename (probe-file (job-output-file job))))
+    (when report
+      (if truename
+	  (cmpprogress "~&;;; Finished compiling ~a.~%" (namestring (job-source job)))
+	(format t "~&;;; The C compiler failed to compile the intermediate file of ~A.~%"
+		(namestring (job-source job)))))
+    truename))
+
+(defun finish-c-compilations (pipeline &optional (report t))
+  "Waits for all the jobs started so far in PIPELINE."
+  (let ((jobs (reverse (pipeline-jobs pipeline))))
+    (setf (pipeline-jobs pipeline) nil)
+    (dolist (job jobs)
+      (when (job-thread job) ;; else finished already.
+	(finish-c-compilation-job job report)))))
+
+(defun call-with-parallel-compilation (function jobs)
+  (if *c-compilation-pipeline*
+      (funcall function)
+    (let ((pipeline (make-c-compilation-pipeline :slots (mt:make-semaphore jobs)))
+	  (done nil))
+      (unwind-protect
+	  (multiple-value-prog1
+	      (let ((*c-compilation-pipeline* pipeline))
+		(funcall function))
+	    (finish-c-compilations pipeline)
+	    (setq done t))
+	(unless done (finish-c-compilations pipeline nil))))))
+
+(defmacro with-parallel-compilation ((&key (jobs '(mkcl:processor-count))) &body body)
+  "Evaluates BODY with the C compilation of each file handed to COMPILE-FILE
+run in parallel with the rest of BODY, up to JOBS of them at once. Values
+returned by COMPILE-FILE within BODY are those of a successful compilation;
+the files are in place once the form returns, or as soon as a builder such
+as BUILD-FASL is called."
+  `(call-with-parallel-compilation #'(lambda () ,@body) ,jobs))
+
+(defun compile-files (input-pathnames &rest args &key output-files (jobs (mkcl:processor-count)) &allow-other-keys)
+  "Compiles each of INPUT-PATHNAMES as COMPILE-FILE would with the other
+keyword arguments, while the C compilation of up to JOBS of them proceeds
+in parallel with the translation of the following ones. OUTPUT-FILES, if
+given, lists the :OUTPUT-FILE of each. Returns the list of the truenames of
+the compiled files, with NIL for any that failed, then whether there were
+warnings and whether there were failures, as COMPILE-FILE does."
+  (setq args (copy-list args))
+  (remf args :output-files)
+  (remf args :jobs)
+  (let ((pipeline (make-c-compilation-pipeline :slots (mt:make-semaphore jobs)))
+	(jobs nil) ;; one per input, NIL where no C compilation was started.
+	(any-warnings-p nil)
+	(any-failure-p nil))
+    (unwind-protect
+	(let ((*c-compilation-pipeline* pipeline))
+	  (dolist (input input-pathnames)
+	    (let ((before (pipeline-jobs pipeline)))
+	      (multiple-value-bind (output warnings-p failure-p)
+		  (apply #'compile-file input :output-file (pop output-files) args)
+		(when warnings-p (setq any-warnings-p t))
+		(when failure-p (setq any-failure-p t))
+		(push (and output
+			   (not (eq before (pipeline-jobs pipeline)))
+			   (first (pipeline-jobs pipeline)))
+		      jobs))))
+	  (values (mapcar #'(lambda (job)
+			      (or (and job (finish-c-compilation-job job))
+				  (progn (setq any-warnings-p t any-failure-p t) nil)))
+			  (nreverse jobs))
+		  any-warnings-p
+		  any-failure-p))
+      ;; Only left with jobs if aborted before the reporting above.
+      (finish-c-compilations pipeline nil))))
+
+
 (defconstant +lisp-program-full-header+ "~
 /* MKCL: Initialization code for file ~A */
 /* Date: ~D/~D/~D ~2,'0D:~2,'0D:~2,'0D (yyyy/mm/dd) */
@@ -330,7 +504,7 @@ typedef signed char int8_t;
     int	temp_data_size;
     void *handle;
     void (*entry)(MKCL, mkcl_object, mkcl_object);
-    void * __pad[9];
+    void * __pad[11];
   };
 
   union mkcl_lispunion {
@@ -651,6 +825,8 @@ filesystem or in the database of ASDF modules."
 		       (*suppress-compiler-messages* (or *suppress-compiler-messages*
 							 (not *compile-verbose*))))
   (declare (ignorable key-args))
+  (when *c-compilation-pipeline* ;; our inputs may still be in the making.
+    (finish-c-compilations *c-compilation-pipeline*))
   ;;(format t "~&In compiler::builder: target= ~S,~%  output-name= ~S,~%  key-args= ~S.~%" target output-name key-args) ;; debug
   ;;(finish-output) ;; debug JCB
 
@@ -904,11 +1080,16 @@ filesystem or in the database of ASDF modules."
       (terpri *compiler-output2*) (terpri *compiler-output2*)
       (terpri *compiler-output1*) (terpri *compiler-output1*))
     (data-dump data)
-    (with-open-file (c-file c-pathname :direction :output :external-format :utf-8) ;; JCB
-                    (princ (get-output-stream-string banner) c-file)
-                    (princ (get-output-stream-string decls) c-file)
-                    (princ (get-output-stream-string data) c-file)
-                    (princ (get-output-stream-string body) c-file))))
+    (flet ((write-c (c-file)
+             (princ (get-output-stream-string banner) c-file)
+             (princ (get-output-stream-string decls) c-file)
+             (princ (get-output-stream-string data) c-file)
+             (princ (get-output-stream-string body) c-file)))
+      (if c-pathname
+          (with-open-file (c-file c-pathname :direction :output :external-format :utf-8) ;; JCB
+                          (write-c c-file))
+        (with-output-to-string (c-file) ;; C-PATHNAME NIL asks for the C code itself.
+          (write-c c-file))))))
 
 
 (defun compiler-output-values (main-value conditions)
@@ -1075,23 +1256,34 @@ compiled successfully, returns the pathname of the compiled file."
 	 ;; Emit final object code.
 	 (let* ((o-pathname (compile-file-internal-pathname output-file :object))
 		(o-basename (file-namestring o-pathname))
-		tmp-output)
-	   (compiler-cc (mkcl:file-pathname c-pathname) o-basename tool-wd)
-	   (setq tmp-output o-pathname)
-	   (when fasl-p
-	     (push o-pathname to-delete)
-	     (setq tmp-output (compile-file-internal-pathname output-file :fasl))
-	     (link-fasl (mkcl:file-pathname tmp-output) init-name "" (list o-basename) libraries t t tool-wd))
-	   (unless (equal output-file tmp-output)
-	     ;;(format t "~&MKCL;; compiler had to rename its output from ~A to ~A.~%" tmp-output output-file) (finish-output)
-	     (rename-file tmp-output output-file))
+		tmp-output
+		(commands
+		 (with-deferred-commands (*c-compilation-pipeline*)
+		   (compiler-cc (mkcl:file-pathname c-pathname) o-basename tool-wd)
+		   (setq tmp-output o-pathname)
+		   (when fasl-p
+		     (push o-pathname to-delete)
+		     (setq tmp-output (compile-file-internal-pathname output-file :fasl))
+		     (link-fasl (mkcl:file-pathname tmp-output) init-name "" (list o-basename) libraries t t tool-wd)))))
+	   (if *c-compilation-pipeline*
+	       ;; The job now owns our working files and renames its output when done.
+	       (start-c-compilation-job *c-compilation-pipeline*
+					(make-c-compilation-job :source input-pathname
+								:output-file output-file
+								:tmp-output tmp-output
+								:commands commands
+								:to-delete (prog1 to-delete (setq to-delete nil))))
+	     (unless (equal output-file tmp-output)
+	       ;;(format t "~&MKCL;; compiler had to rename its output from ~A to ~A.~%" tmp-output output-file) (finish-output)
+	       (rename-file tmp-output output-file)))
 	   )
 	 
 	 ;;(when *trace-compiler-memory* (format t "~&compile-file after CC: ~S.~%" (si:sample-allocation-statistics)))
 	 
-	 (if (setq output-file (probe-file output-file)) ;; obtain truename or nil
-	     (cmpprogress "~&;;; Finished compiling ~a.~%" (namestring input-pathname))
-	   (cmperr "The C compiler failed to compile the intermediate file."))
+	 (unless *c-compilation-pipeline* ;; else reported by finish-c-compilation-job.
+	   (if (setq output-file (probe-file output-file)) ;; obtain truename or nil
+	       (cmpprogress "~&;;; Finished compiling ~a.~%" (namestring input-pathname))
+	     (cmperr "The C compiler failed to compile the intermediate file.")))
 	 
 	 ) ;; with-compiler-env
       
@@ -1107,6 +1299,7 @@ compiled successfully, returns the pathname of the compiled file."
 
 (defun cl:compile (name &optional (definition nil definition-supplied-p)
 			&key (libraries *compile-default-libraries*) ;; a list of strings, each naming a foreign library
+			(in-memory *compile-in-memory*)
 			&aux 
 			form
 			data-pathname
@@ -1160,6 +1353,12 @@ returned as the value of COMPILE."
 	(t
 	 (setq form `(setf (fdefinition ',name) #',form))))
 
+  (let ((mkcc-directory (and in-memory (null libraries) (mkcc-directory))))
+    (when mkcc-directory
+      (let ((output (multiple-value-list (compile-in-memory name form definition GAZONK-name mkcc-directory))))
+	(when output ;; None if memory cannot be made executable here, or libmkcc failed.
+	  (return-from compile (values-list output))))))
+
   (let* ((template #P"TMP:MKCL")
 	 errno)
     (multiple-value-setq (data-file data-pathname errno) (mkcl:mkstemp template :external-format :utf-8))
@@ -1211,6 +1410,39 @@ returned as the value of COMPILE."
   )
 
 
+(defun mkcc-options (mkcc-directory)
+  (let ((flags (string-trim " " *fast-compile-cc-flags*)))
+    `("-nostdlib"
+      ,(mkcl:bstr+ "-B" (namestring mkcc-directory))
+      ,(mkcl:bstr+ "-I" (namestring (mkcl-include-directory)))
+      ,@(unless (string= flags "") (list flags))
+      ;; compiler support routines, not part of MKCL itself.
+      ,@(mapcar #'namestring (directory (merge-pathnames "*/libmkcc1.a" mkcc-directory))))))
+
+(defun compile-in-memory (name form definition GAZONK-name mkcc-directory)
+  ;; Does the work of COMPILE with libmkcc in place of the C compiler, the linker and
+  ;; the temporary files they need.
+  (let* ((*load-time-values* 'values) ;; Only the value is kept
+	 (init-name (init-function-name "CODE" :kind :fas))
+	 (compiler-conditions nil)
+	 new-function)
+    (with-compiler-env
+     (compiler-conditions)
+     (data-init)
+     (t1expr form)
+     (let ((failure (si::load-c-source (compiler-pass2 nil nil nil init-name :input-designator (format nil "~A" definition))
+				       init-name
+				       (merge-pathnames "libmkcc.so" mkcc-directory)
+				       (mkcc-options mkcc-directory))))
+       ;; Either way COMPILE then goes through the C compiler and a file.
+       (cond ((eq failure t) (return-from compile-in-memory (values)))
+	     (failure
+	      (cmpnote "The in-memory C compiler failed to compile the intermediate code for ~s.~%~A" name failure)
+	      (return-from compile-in-memory (values)))
+	     (t (setf new-function (or name (symbol-value GAZONK-name)))))))
+    (compiler-output-values new-function compiler-conditions)))
+
+
 (defun cl:disassemble (thing &key (h-file nil) (data-file nil)
 			     &aux
 			     ;;def ;; any use? JCB
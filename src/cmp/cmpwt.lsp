@@ -126,6 +126,8 @@
 	     (t (format stream "\\~3,'0o" (char-code x))))) ;; this obviously works only of values of less than 256! JCB
 	  ((char= x #\\)
 	   (princ "\\\\" stream))
+	  ((char= x #\?) ; no trigraphs.
+	   (princ "\\077" stream))
 	  ((char= x #\")
 	   (princ "\\\"" stream))
 	  (t (princ x stream)))))
@@ -176,6 +178,205 @@
 		    0
 		    i)))
 
+;;; What mkcl_read_VV() checks before the data vector.
+(defun fasl-header ()
+  (list :mkcl-compiled
+	si:+mkcl-version-number+
+	si:+mkcl-fasl-version+
+	;; CPU identifier
+	#+x86 :x86
+	#+x86-64 :x86-64
+	#+arm :arm
+	#+aarch64 :aarch64
+	;; OS family
+	#+linux :linux
+	#+FreeBSD :FreeBSD
+	#+windows :Microsoft-Windows
+	#-(or linux FreeBSD Windows)
+	#.(error "Incomplete function compiler::fasl-header.")
+	;; OS specific version
+	nil
+	;; There should be one more item emitted here to list the "options" this MKCL instance
+	;; was built with. One option comes specially to mind: :unicode. JCB
+	))
+
+;;; Binary data vectors.
+;;;
+;;; Unless it holds objects of some other type, the data vector is written
+;;; as bytes that mkcl_read_VV() in c/read.c turns back into objects without
+;;; the reader: the magic "\0MKVV", a format version, the number of shared
+;;; objects and of packages, then each object as a tag and its payload.
+;;; Counts are LEB128 varints, signed integers are zigzag encoded first.
+;;; The tags must stay in the order of enum vv_tag over there.
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (defparameter +vv-tags+
+    '(:nil :t :fixnum :integer :character :base-string :string
+      :symbol :keyword :uninterned-symbol :list :vector
+      :single-float :double-float :long-float :infinity :ratio :complex
+      :label :reference :pathname)))
+
+(defmacro vv-tag (name)
+  (or (position name +vv-tags+)
+      (error "Unknown binary data tag ~S." name)))
+
+(defconstant +vv-format-version+ 1)
+
+(defun vv-pathname-namestring (x)
+  ;; The namestring of pathname X, if the printer writes it as #P"...".
+  (let ((printed (prin1-to-string x)))
+    (when (and (> (length printed) 2) (string= "#P" printed :end2 2))
+      (read-from-string printed t nil :start 2))))
+
+(defun vv-count-references (objects)
+  ;; Returns an EQ hash table from the objects that may be shared to the
+  ;; number of references to them, or NIL if some object has no binary form.
+  (let ((counts (make-hash-table :test #'eq)))
+    (labels ((walk (x)
+	       (loop
+		 (typecase x
+		   ((or null (member t) integer character ratio) (return))
+		   (float (if (si::float-nan-p x) (throw 'vv-text nil) (return)))
+		   (complex (walk (realpart x)) (setq x (imagpart x)))
+		   (symbol
+		    (unless (symbol-package x) (incf (gethash x counts 0)))
+		    (return))
+		   (string (incf (gethash x counts 0)) (return))
+		   (cons
+		    (when (> (incf (gethash x counts 0)) 1) (return))
+		    (walk (car x))
+		    (setq x (cdr x)))
+		   ((vector t)
+		    (when (= (incf (gethash x counts 0)) 1) (map nil #'walk x))
+		    (return))
+		   (pathname
+		    (unless (vv-pathname-namestring x) (throw 'vv-text nil))
+		    (return))
+		   (t (throw 'vv-text nil))))))
+      (catch 'vv-text
+	(map nil #'walk objects)
+	counts))))
+
+(defun vv-encode (objects)
+  ;; The binary data vector for OBJECTS, as a base string of octets, or NIL
+  ;; if some of them can only be written as text.
+  (let ((counts (vv-count-references objects)))
+    (when counts
+      (let ((out (make-array 4096 :element-type 'base-char :adjustable t :fill-pointer 0))
+	    (labels (make-hash-table :test #'eq))
+	    (packages (make-hash-table :test #'eq))
+	    (keyword (find-package "KEYWORD")))
+	(labels ((put (byte)
+		   (vector-push-extend (code-char byte) out))
+		 (put-varint (n)
+		   (loop (multiple-value-bind (rest byte) (floor n 128)
+			   (when (zerop rest) (return (put byte)))
+			   (put (logior byte 128))
+			   (setq n rest))))
+		 (put-signed (n)
+		   (put-varint (if (minusp n) (1- (* -2 n)) (* 2 n))))
+		 (put-string (s)
+		   (if (typep s 'base-string)
+		       (progn (put (vv-tag :base-string))
+			      (put-varint (length s))
+			      (loop for c across s do (put (char-code c))))
+		       (progn (put (vv-tag :string))
+			      (put-varint (length s))
+			      (loop for c across s do (put-varint (char-code c))))))
+		 (float-tag (x)
+		   (etypecase x
+		     (single-float (vv-tag :single-float))
+		     (double-float (vv-tag :double-float))
+		     (long-float (vv-tag :long-float))))
+		 (put-float (x)
+		   (if (si::float-infinity-p x)
+		       (progn (put (vv-tag :infinity))
+			      (put (float-tag x))
+			      (put (if (minusp x) 1 0)))
+		       (multiple-value-bind (mantissa exponent)
+			   (integer-decode-float x)
+			 (put (float-tag x))
+			 (put (if (minusp (float-sign x)) 1 0))
+			 (put-varint mantissa)
+			 (put-signed exponent))))
+		 (put-symbol (x)
+		   (let ((package (symbol-package x)))
+		     (cond ((null package)
+			    (put (vv-tag :uninterned-symbol)))
+			   ((eq package keyword)
+			    (put (vv-tag :keyword)))
+			   (t
+			    (put (vv-tag :symbol))
+			    (let ((index (gethash package packages)))
+			      (if index
+				  (put-varint index)
+				  (progn
+				    (put-varint (setf (gethash package packages)
+						      (hash-table-count packages)))
+				    (put-string (package-name package)))))))
+		     (put-string (symbol-name x))))
+		 (put-list (x)
+		   ;; As many elements as possible before a shared cons.
+		   (let ((elements (list (car x)))
+			 (tail (cdr x)))
+		     (loop while (and (consp tail) (<= (gethash tail counts 0) 1))
+			   do (push (car tail) elements)
+			      (setq tail (cdr tail)))
+		     (put (vv-tag :list))
+		     (put-varint (length elements))
+		     (dolist (element (nreverse elements))
+		       (put-object element))
+		     (put-object tail)))
+		 (put-object (x)
+		   (if (> (gethash x counts 0) 1)
+		       (let ((label (gethash x labels)))
+			 (if label
+			     (progn (put (vv-tag :reference))
+				    (put-varint label))
+			     (progn (put (vv-tag :label))
+				    (put-varint (setf (gethash x labels)
+						      (hash-table-count labels)))
+				    (put-unshared x))))
+		       (put-unshared x)))
+		 (put-unshared (x)
+		   (typecase x
+		     (null (put (vv-tag :nil)))
+		     ((member t) (put (vv-tag :t)))
+		     (fixnum (put (vv-tag :fixnum)) (put-signed x))
+		     (integer
+		      (put (vv-tag :integer))
+		      (put-string (coerce (write-to-string x :base 10 :radix nil) 'base-string)))
+		     (character (put (vv-tag :character)) (put-varint (char-code x)))
+		     (float (put-float x))
+		     (ratio
+		      (put (vv-tag :ratio))
+		      (put-object (numerator x))
+		      (put-object (denominator x)))
+		     (complex
+		      (put (vv-tag :complex))
+		      (put-object (realpart x))
+		      (put-object (imagpart x)))
+		     (symbol (put-symbol x))
+		     (string (put-string x))
+		     (cons (put-list x))
+		     (pathname
+		      (put (vv-tag :pathname))
+		      (put-string (vv-pathname-namestring x)))
+		     (t
+		      (put (vv-tag :vector))
+		      (put-varint (length x))
+		      (loop for element across x do (put-object element))))))
+	  (map nil #'put-object objects)
+	  (let ((body out))
+	    (setq out (make-array (+ (length body) 32) :element-type 'base-char
+				  :adjustable t :fill-pointer 0))
+	    (dolist (byte '(0 77 75 86 86)) ; "\0MKVV"
+	      (put byte))
+	    (put +vv-format-version+)
+	    (put-varint (hash-table-count labels))
+	    (put-varint (hash-table-count packages))
+	    (concatenate 'base-string out body)))))))
+
 (defun data-dump (stream &key as-lisp-file init-name close-when-done &aux must-close)
   (declare (ignore as-lisp-file init-name))
   (unless *data-storage-frozen*
@@ -211,34 +412,17 @@
 	   (setf si:*compiler-constants* output))
 	  (t ;; always emit. JCB
 	   (wt-data-begin stream)
-	   (macrolet ((stringify (data)
-			#-unicode `(prin1-to-string ,data)
-			#+unicode `(mkcl:prin1-to-base-string ,data :encoding :utf-8)))
-	     (wt-filtered-data (stringify :mkcl-compiled) stream) ;; JCB
-	     (wt-filtered-data (stringify si:+mkcl-version-number+) stream) ;; JCB
-	     (wt-filtered-data (stringify si:+mkcl-fasl-version+) stream) ;; JCB
-	     (wt-filtered-data (stringify ;; CPU identifier
-				#+x86 :x86 
-				#+x86-64 :x86-64
-				#+arm :arm
-				#+aarch64 :aarch64
-				)
-			       stream) ;; JCB
-	     (wt-filtered-data (stringify ;; OS family
-				#+linux :linux
-				#+FreeBSD :FreeBSD
-				#+windows :Microsoft-Windows
-				#-(or linux FreeBSD Windows)
-				#.(error "Incomplete function compiler::data-dump.")
-				) 
-			       stream) ;; JCB
-	     (wt-filtered-data (stringify ;; OS specific version
-				nil
-				)
-			       stream) ;; JCB
-	     ;; There should be one more item emitted here to list the "options" this MKCL instance
-	     ;; was built with. One option comes specially to mind: :unicode. JCB
-	     (wt-filtered-data (subseq (stringify (data-get-all-objects)) 1) stream))
+	   (let* ((header (fasl-header))
+		  (objects (data-get-all-objects))
+		  (binary (vv-encode (append header objects))))
+	     (if binary
+		 (wt-filtered-data binary stream)
+		 (macrolet ((stringify (data)
+			      #-unicode `(prin1-to-string ,data)
+			      #+unicode `(mkcl:prin1-to-base-string ,data :encoding :utf-8)))
+		   (dolist (item header)
+		     (wt-filtered-data (stringify item) stream)) ;; JCB
+		   (wt-filtered-data (subseq (stringify objects) 1) stream))))
 	   (wt-data-end stream)))
     (when must-close
       (close must-close))
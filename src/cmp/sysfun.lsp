@@ -2238,6 +2238,14 @@
     (def-inline si:instance-set :always (t fixnum t) t "mkcl_instance_set(env, (#0),(#1),(#2))")
     (def-inline si:instance-set :unsafe (standard-object fixnum t) t "(#0)->instance.slots[#1]=(#2)")
 
+    (proclaim-function si:make-slot-cache () t)
+    (proclaim-function si:cached-slot-value (t t t) t)
+    (def-inline si:cached-slot-value :always (t t t) t "mkcl_cached_slot_value(env, (#0),(#1),(#2))")
+    (proclaim-function si:cached-slot-boundp (t t t) t)
+    (def-inline si:cached-slot-boundp :always (t t t) t "mkcl_cached_slot_boundp(env, (#0),(#1),(#2))")
+    (proclaim-function si:cached-slot-set (t t t t) t)
+    (def-inline si:cached-slot-set :always (t t t t) t "mkcl_cached_slot_set(env, (#0),(#1),(#2),(#3))")
+
     (proclaim-function si:instance-class (t) t :no-side-effects t)
     (def-inline si:instance-class :always (standard-object) t 
       "@0;(mkcl_likely(MKCL_INSTANCEP(#0)) ? MKCL_CLASS_OF(#0) : (mkcl_FEtype_error_instance(env, #0), mk_cl_Cnil))")
@@ -95,6 +95,7 @@
   (unless (probe-file destdir)
     (si::mkdir destdir #o0777))
   (with-compilation-unit ()
+   (compiler:with-parallel-compilation ()
     (mapcar #'(lambda (source &aux (orig-source source))
 		#+(or)
 		(format t "~&In compile-if-old in ~S for ~S~%" destdir source)
@@ -122,7 +123,7 @@
 		      )
 		    )
 		  object))
-	    sources)))
+	    sources))))
 
 
 (defun build-substitute-as2-file (asdf-module-name name destdir system-attribs) ;; This is for ASDF 2
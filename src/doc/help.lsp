@@ -1177,6 +1177,15 @@ Returns the value of (- NUMBER (* first-value DIVISOR)) as the second value.")
 (docfun fmakunbound function (symbol) "
 Removes the global function definition associated with SYMBOL.  Returns SYMBOL.")
 
+(docfun mkcl:fork function () "
+MKCL specific.  Unix only.
+Creates a child process that is a copy of the current one, with everything
+loaded and initialized so far.  Returns, in the parent, a process object
+for the child, to be used with MKCL:JOIN-PROCESS, MKCL:PROCESS-STATUS and
+the like, and NIL in the child.  It must be called from the initial thread
+while no other thread than MKCL's own daemons is running.  A process
+booted once and forking a child per job spares each job the boot time.")
+
 (docfun force-output function (&optional (stream *standard-output*)) "
 Sends the contents of the output buffer for STREAM to the destination.
 Returns NIL without waiting until the buffer becomes empty.")
@@ -1330,6 +1339,14 @@ Returns the number of entries in HASH-TABLE.")
 (docfun hash-table-p function (x) "
 Returns T if X is a hash-table object; NIL otherwise.")
 
+(docfun mkcl:hash-table-synchronized-p function (hash-table) "
+Returns T if HASH-TABLE was made with a non-NIL :SYNCHRONIZED argument;
+NIL otherwise.")
+
+(docfun mkcl:hash-table-weakness function (hash-table) "
+Returns the weakness of HASH-TABLE, one of NIL, :KEY, :VALUE or
+:KEY-AND-VALUE.")
+
 (docfun host-namestring function (filespec) "
 Returns as a string the host part of the pathname specified by FILESPEC.
 FILESPEC may be a symbol, a string, a pathname, or a file stream.")
@@ -1645,7 +1662,7 @@ An echo stream is notated as
 	#<echo stream n>
 where N is a number that identifies the stream.")
 
-(docfun make-hash-table function (&key (test 'eql) (size 1024) (rehash-size 1.5) (rehash-threshold 0.7)) "
+(docfun make-hash-table function (&key (test 'eql) (size 1024) (rehash-size 1.5) (rehash-threshold 0.7) (synchronized nil) (weakness nil)) "
 Creates and returns a hash-table.
 TEST specifies which predicate should be used to access hash-table entries.
 It must be EQ, EQL, or EQUAL.  SIZE specifies the number of entries in the
@@ -1655,7 +1672,17 @@ specifies the ratio of the new size and the old size.  REHASH-THRESHOLD
 specifies when to expand the hash-table.  If an integer, the hash-table is
 expanded when REHASH-THRESHOLD / REHASH-SIZE entries have been used.  If a
 float, the hash-table is expanded when REHASH-THRESHOLD times the whole
-entries have been used.")
+entries have been used.
+If SYNCHRONIZED is non-NIL, the hash-table may be shared by several threads
+without any further locking.  GETHASH never waits on such a table, writers
+only wait on other writers of nearby keys, and the table grows incrementally.
+MAPHASH and WITH-HASH-TABLE-ITERATOR on such a table may or may not see the
+changes made by other threads while they run.
+WEAKNESS, if non-NIL, must be one of :KEY, :VALUE or :KEY-AND-VALUE and makes
+an entry go away once its key, its value, or either of them has been garbage
+collected.  HASH-TABLE-COUNT of a weak hash-table may still include entries
+that have been collected but not yet purged.  A hash-table cannot be both
+synchronized and weak.")
 
 (docfun make-list function (length &key (initial-element nil)) "
 Creates and returns a list of the specified LENGTH, whose elements are all the
@@ -2103,6 +2130,10 @@ Equivalent to
 	(PROGN (TERPRI STREAM)
 	       (WRITE OBJECT :STREAM STREAM :ESCAPE T))")
 
+(docfun mkcl:processor-count function () "
+MKCL specific.
+Returns the number of processors currently online, at least 1.")
+
 (docfun probe-file function (filespec) "
 Returns the full pathname of the specified file if it exists.  Returns NIL
 otherwise.  FILESPEC may be a symbol, a string, a pathname, or a file stream.")
@@ -2839,6 +2870,13 @@ Outputs CHAR to STREAM.  Returns CHAR.")
               &key (start 0) (end (length string))) "
 Outputs STRING and a newline character to STREAM.  Returns STRING.")
 
+(docfun mkcl:write-octet-vectors function (stream vectors) "
+MKCL specific.
+Writes the octet vectors of the list VECTORS, each up to its fill pointer,
+to STREAM and forces them out.  On a socket stream they go, along with
+whatever output the stream still holds, in as few writev() calls as
+possible.  Returns VECTORS.")
+
 (docfun write-string function (string &optional (stream *standard-output*)
               &key (start 0) (end (length string))) "
 Outputs STRING to STREAM.  Returns STRING.")
@@ -107,14 +107,43 @@
 	       (values s (length s) t (zerop fdigits) 0))
 	     (values "." 1 t t 0)))
 	(t
-	 (multiple-value-bind (sig exp)
-			      (integer-decode-float x)
-	   (let* ((precision (float-precision x))
-		  (digits (float-digits x))
-		  (fudge (- digits precision))
-		  (width (if width (max width 1) nil)))
-	   (float-string (ash sig (- fudge)) (+ exp fudge) precision width
-			 fdigits scale fmin))))))
+	 ;; The shortest digits that read back as X do, unless WIDTH or
+	 ;; FDIGITS cut them short, then it takes FLOAT-STRING to round.
+	 (multiple-value-bind (k digits)
+	     (float-to-digits x)
+	   (let* ((point (+ k (or scale 0)))
+		  (last (- point (length digits)))
+		  (cutoff (cond (fdigits (- fdigits))
+				(width (if (< point 0) (- 1 width) (- (1+ point) width))))))
+	     (when (and cutoff fmin (> cutoff (- fmin)))
+	       (setq cutoff (- fmin)))
+	     (if (or (null cutoff) (>= last cutoff))
+		 (digits-to-flonum-string digits point fdigits)
+		 (multiple-value-bind (sig exp)
+		     (integer-decode-float x)
+		   (let* ((precision (float-precision x))
+			  (digits (float-digits x))
+			  (fudge (- digits precision))
+			  (width (if width (max width 1) nil)))
+		     (float-string (ash sig (- fudge)) (+ exp fudge) precision width
+				   fdigits scale fmin)))))))))
+
+(defun digits-to-flonum-string (digits point fdigits)
+  ;; Lays out 0.DIGITS * 10^POINT as FLOAT-STRING does, with at least
+  ;; FDIGITS fraction digits.
+  (let* ((ndigits (length digits))
+	 (int-digits (max point 0))
+	 (frac-digits (max (- ndigits point) (or fdigits 0)))
+	 (string (make-string (+ int-digits 1 frac-digits)
+			      :element-type 'base-char :initial-element #\0)))
+    (if (<= point 0)
+	(replace string digits :start1 (- 1 point))
+	(progn
+	  (replace string digits :end2 (min point ndigits))
+	  (when (< point ndigits)
+	    (replace string digits :start1 (1+ point) :start2 point))))
+    (setf (schar string int-digits) #\.)
+    (values string (length string) (= int-digits 0) (= frac-digits 0) int-digits)))
 
 
 (defun float-string (fraction exponent precision width fdigits scale fmin)
@@ -404,9 +433,7 @@
 	(when tpoint (write-char #\0 stream))
 	(print-float-exponent x 0 stream))
       ;;exponential format 
-      (multiple-value-bind (f ex)
-			   (si::scale-exponent x)
-        (declare (ignorable f))
+      (let ((ex (float-to-digits x)))
 	(multiple-value-bind (str len lpoint tpoint)
 			     ;;(si::flonum-to-string f nil nil 1) ;; This one clobbers the rightmost 2 digits. JCB
 			     (si::flonum-to-string x nil nil (1+ (- ex))) ;; JCB
@@ -697,9 +724,47 @@
 	       (*output-layout-mode* nil)
 	       (*default-format-error-control-string* string)
 	       (*logical-block-popper* nil))
-	  (interpret-directive-list stream (tokenize-control-string string)
+	  (interpret-directive-list stream (control-string-directives string)
 				    orig-args args)))))
 
+;;; Control strings given to FORMAT at run time are tokenized once
+;;; and their directives kept in a cache, weak on the control string.
+;;; The directives are made from a private copy of the string,
+;;; which a hit compares to the string at hand in case it was modified.
+;;; The cache is simply emptied when it gets full.
+;;;
+(defvar *control-string-cache* (make-hash-table :test 'eq :weakness :key))
+(defvar *control-string-cache-lock* (mt:make-lock :name "format control string cache"))
+(defconstant +control-string-cache-limit+ 512)
+
+(defun control-string-directives (string)
+  (declare (simple-string string))
+  (flet ((call-with-cache-lock (function)
+	   ;; Interrupts stay off while the lock is held, lest a handler
+	   ;; calling FORMAT come back here for it. This is MT:WITH-LOCK
+	   ;; within MT:WITHOUT-INTERRUPTS, which mp.lsp defines only later.
+	   (let ((lock *control-string-cache-lock*)
+		 (were-enabled (si:disable-interrupts)))
+	     (unwind-protect
+		  (progn
+		    (mt:get-lock lock)
+		    (unwind-protect
+			 (funcall function *control-string-cache*)
+		      (mt:giveup-lock lock)))
+	       (when were-enabled
+		 (si:enable-interrupts))))))
+    (let ((entry (call-with-cache-lock #'(lambda (cache) (gethash string cache)))))
+      (if (and entry (string= (car entry) string))
+	  (cdr entry)
+	  (let* ((copy (copy-seq string))
+		 (entry (cons copy (tokenize-control-string copy))))
+	    (call-with-cache-lock
+	     #'(lambda (cache)
+		 (when (>= (hash-table-count cache) +control-string-cache-limit+)
+		   (clrhash cache))
+		 (setf (gethash string cache) entry)))
+	    (cdr entry))))))
+
 (defun interpret-directive-list (stream directives orig-args args)
   (if directives
       (let ((directive (car directives)))
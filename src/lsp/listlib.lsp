@@ -12,85 +12,120 @@
 
 (in-package "SYSTEM")
 
+(defun set-hash-test (test test-not)
+  ;; The hash table test that matches TEST and TEST-NOT, if any.
+  (unless test-not
+    (cond ((or (null test) (eq test 'eql) (eq test #'eql)) 'eql)
+	  ((or (eq test 'eq) (eq test #'eq)) 'eq)
+	  ((or (eq test 'equal) (eq test #'equal)) 'equal)
+	  ((or (eq test 'equalp) (eq test #'equalp)) 'equalp))))
+
+(defun membership-test (list1 list2 test test-not key)
+  ;; A function telling whether an element of LIST1 is in LIST2.  Once both
+  ;; lists are long enough, the keys of LIST2 go into a hash table so that
+  ;; each test stops costing a scan of LIST2.
+  (let ((hash-test (and (nthcdr 32 list1) (nthcdr 32 list2)
+			(set-hash-test test test-not))))
+    (if (null hash-test)
+	#'(lambda (x) (member1 x list2 test test-not key))
+	(let ((table (make-hash-table :test hash-test :size (length list2))))
+	  (if key
+	      (let ((key (si::coerce-to-function key)))
+		(dolist (y list2)
+		  (setf (gethash (funcall key y) table) t))
+		#'(lambda (x) (gethash (funcall key x) table)))
+	      (progn
+		(dolist (y list2)
+		  (setf (gethash y table) t))
+		#'(lambda (x) (gethash x table))))))))
+
 (defun union (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns, as a list, the union of elements in LIST1 and in LIST2."
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last list2))
-       (or first list2))
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (progn (rplacd last (cons (car x) nil))
-		 (setq last (cdr last)))
-	  (progn (setq first (cons (car x) nil))
-		 (setq last first))))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last list2))
+         (or first list2))
+      (unless (funcall member-p (car x))
+        (if last
+	    (progn (rplacd last (cons (car x) nil))
+		   (setq last (cdr last)))
+	    (progn (setq first (cons (car x) nil))
+		   (setq last first)))))))
 
 (defun nunion (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive UNION.  Both LIST1 and LIST2 may be destroyed."
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last list2))
-       (or first list2))
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last list2))
+         (or first list2))
+      (unless (funcall member-p (car x))
+        (if last
+	    (rplacd last x)
+	    (setq first x))
+        (setq last x)))))
 
 (defun intersection (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns a list consisting of those objects that are elements of both LIST1 and
 LIST2."
-  (do ((x list1 (cdr x))
-       (ans))
-      ((null x)
-       (nreverse ans)) ; optional nreverse: not required by CLtL
-    (when (member1 (car x) list2 test test-not key)
-        (push (car x) ans))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (ans))
+        ((null x)
+         (nreverse ans)) ; optional nreverse: not required by CLtL
+      (when (funcall member-p (car x))
+          (push (car x) ans)))))
 
 (defun nintersection (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive INTERSECTION.  Only LIST1 may be destroyed."
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last nil))
-       first)
-    (when (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last nil))
+         first)
+      (when (funcall member-p (car x))
+        (if last
+	    (rplacd last x)
+	    (setq first x))
+        (setq last x)))))
 
 (defun set-difference (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns, as a list, those elements of LIST1 that are not elements of LIST2."
-  (do ((x list1 (cdr x))
-       (ans))
-      ((null x) (nreverse ans))
-    (unless (member1 (car x) list2 test test-not key)
-      (push (car x) ans))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (ans))
+        ((null x) (nreverse ans))
+      (unless (funcall member-p (car x))
+        (push (car x) ans)))))
 
 (defun nset-difference (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive SET-DIFFERENCE.  Only LIST1 may be destroyed."
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last nil))
-       first)
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last nil))
+         first)
+      (unless (funcall member-p (car x))
+        (if last
+	    (rplacd last x)
+	    (setq first x))
+        (setq last x)))))
 
 (defun swap-args (f)
-  (and f #'(lambda (x y) (funcall f y x))))
+  (if (and f (not (set-hash-test f nil))) ; those are symmetric already.
+      #'(lambda (x y) (funcall f y x))
+      f))
 
 (defun set-exclusive-or (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
@@ -109,10 +144,11 @@ Destructive SET-EXCLUSIVE-OR.  Both LIST1 and LIST2 may be destroyed."
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns T if every element of LIST1 is also an element of LIST2.  Returns NIL
 otherwise."
-  (do ((l list1 (cdr l)))
-      ((null l) t)
-    (unless (member1 (car l) list2 test test-not key)
-      (return nil))))
+  (let ((member-p (membership-test list1 list2 test test-not key)))
+    (do ((l list1 (cdr l)))
+	((null l) t)
+      (unless (funcall member-p (car l))
+	(return nil)))))
 
 (defun rassoc-if (test alist &key key)
   "Returns the first pair in ALIST whose cdr satisfies TEST. Returns NIL if no
@@ -76,3 +76,477 @@
 
 
 
+
+;;;
+;;; Thread pools and promises.
+;;;
+;;; A thread pool keeps SIZE worker threads alive for its whole life so that
+;;; a task submitted to it does not pay for the creation of a thread and of
+;;; its environment (stacks, bindings, signal handling). Tasks wait for a
+;;; worker in a bounded queue, SUBMIT blocking while the queue is full.
+;;; Every task gets a promise, fulfilled with the values of the task,
+;;; that FORCE waits on.
+;;; Only semaphores and locks are used here, so that all of this works
+;;; where condition variables do not (Windows).
+;;;
+
+(defstruct (promise (:constructor make-promise ())
+		    ;; Signals SEMAPHORE, which may be shared, once settled.
+		    (:constructor %make-promise (semaphore))
+		    (:conc-name %promise-)
+		    :named
+		    (:type vector)) ;; defstruct needs defclass otherwise, which is not loaded yet.
+  (state nil) ;; NIL while pending, then :fulfilled, :failed or :aborted.
+  (values nil)
+  (semaphore (make-semaphore 0))
+  (lock (make-lock :name "promise"))
+  (worker nil)) ;; The worker running the task of the promise once it has started.
+
+(defun %settle-promise (promise state values)
+  ;; Returns NIL, leaving PROMISE as it is, if it is already settled.
+  (when (with-lock ((%promise-lock promise))
+	  (unless (%promise-state promise)
+	    (setf (%promise-values promise) values
+		  (%promise-state promise) state)))
+    (semaphore-signal (%promise-semaphore promise))
+    t))
+
+(defun fulfill-promise (promise &rest values)
+  "Makes VALUES the values of PROMISE and wakes up the threads waiting on it."
+  (unless (%settle-promise promise :fulfilled values)
+    (error "Promise already settled."))
+  promise)
+
+(defun promise-fulfilled-p (promise)
+  "True when PROMISE is settled, FORCE on it then returns without waiting."
+  (not (null (%promise-state promise))))
+
+(defun force (promise &optional (timeout t) timeout-value)
+  "Waits until PROMISE is settled and returns its values.
+TIMEOUT is T to wait for ever, NIL or 0 not to wait at all, or else
+a number of seconds. TIMEOUT-VALUE is returned if the wait times out.
+If the task computing PROMISE signaled an error, that error is signaled again here."
+  (unless (%promise-state promise)
+    (let ((semaphore (%promise-semaphore promise)))
+      (unless (semaphore-wait semaphore timeout)
+	(return-from force timeout-value))
+      ;; Pass the wake up on to the next waiting thread, if any.
+      (semaphore-signal semaphore)))
+  (multiple-value-bind (state values)
+      (with-lock ((%promise-lock promise))
+	(values (%promise-state promise) (%promise-values promise)))
+    (case state
+      (:fulfilled (values-list values))
+      (:failed (error (car values)))
+      (t (error "The task of this promise did not complete.")))))
+
+
+(defstruct (work-queue (:constructor %make-work-queue (buffer free))
+		       :named
+		       (:type vector))
+  buffer
+  (head 0)
+  (tail 0)
+  (lock (make-lock :name "work queue"))
+  (items (make-semaphore 0))
+  free)
+
+(defun make-work-queue (size)
+  (%make-work-queue (make-array size) (make-semaphore size)))
+
+(defun work-queue-put (queue item &optional (timeout t))
+  ;; Returns NIL if the queue is still full after TIMEOUT.
+  (when (semaphore-wait (work-queue-free queue) timeout)
+    (with-lock ((work-queue-lock queue))
+      (let ((tail (work-queue-tail queue))
+	    (buffer (work-queue-buffer queue)))
+	(setf (svref buffer tail) item
+	      (work-queue-tail queue) (if (= (1+ tail) (length buffer)) 0 (1+ tail)))))
+    (semaphore-signal (work-queue-items queue))
+    t))
+
+(defun work-queue-get (queue)
+  (semaphore-wait (work-queue-items queue))
+  (prog1
+      (with-lock ((work-queue-lock queue))
+	(let ((head (work-queue-head queue))
+	      (buffer (work-queue-buffer queue)))
+	  (setf (work-queue-head queue) (if (= (1+ head) (length buffer)) 0 (1+ head)))
+	  (prog1 (svref buffer head)
+	    (setf (svref buffer head) nil))))
+    (semaphore-signal (work-queue-free queue))))
+
+
+;; The workers of a pool take the same THREAD-OPTIONS as their first one.
+(defstruct (thread-pool (:constructor %make-thread-pool (name queue thread-options workers tasks))
+			:named
+			(:type vector))
+  name
+  queue
+  thread-options
+  workers ;; A simple vector, a dead worker being replaced at its index.
+  tasks ;; The promise of the task each worker is on, by index.
+  (lock (make-lock :name "thread pool"))
+  (shutdown nil))
+
+(defun run-pool-task (task)
+  ;; A task leaving by a non-local exit, be it a THROW or EXIT-THREAD,
+  ;; aborts its promise and the unwinding goes on.
+  (let ((promise (car task)))
+    (setf (%promise-worker promise) *thread*)
+    (unwind-protect
+	(handler-case (%settle-promise promise :fulfilled (multiple-value-list (apply (cadr task) (cddr task))))
+	  (error (condition) (%settle-promise promise :failed (list condition))))
+      ;; Does nothing once the task has settled its promise.
+      (%settle-promise promise :aborted nil))))
+
+(defun start-pool-worker (pool index)
+  (thread-run-function (list* :name (format nil "~A worker ~D" (thread-pool-name pool) index)
+			      (thread-pool-thread-options pool))
+		       #'thread-pool-worker pool index))
+
+(defun thread-pool-worker (pool index)
+  (let ((queue (thread-pool-queue pool))
+	(tasks (thread-pool-tasks pool))
+	(stopped nil))
+    ;; For SI::NOTE-THREAD-KILL.
+    (setf (thread-plist *thread*) (list* 'pool-worker (cons pool index) (thread-plist *thread*)))
+    (unwind-protect
+	(loop (let ((task (work-queue-get queue)))
+		(unless task
+		  (return (setq stopped t)))
+		(setf (svref tasks index) (car task))
+		(run-pool-task task)
+		(setf (svref tasks index) nil)))
+      (unless stopped
+	;; A task made this worker exit, another one takes its place.
+	(with-lock ((thread-pool-lock pool))
+	  (let ((workers (thread-pool-workers pool)))
+	    (when (and (not (thread-pool-shutdown pool))
+		       (eq (svref workers index) *thread*))
+	      (setf (svref workers index) (start-pool-worker pool index)))))))))
+
+(defun si::note-thread-kill (thread)
+  ;; Called by THREAD-KILL once THREAD has taken the interrupt that ends
+  ;; it without running any cleanup. If THREAD is a pool worker, the
+  ;; cleanup of THREAD-POOL-WORKER and RUN-POOL-TASK is done here.
+  (let ((place (getf (thread-plist thread) 'pool-worker)))
+    (when place
+      (let* ((pool (car place))
+	     (index (cdr place))
+	     (promise nil))
+	(with-lock ((thread-pool-lock pool))
+	  (let ((workers (thread-pool-workers pool)))
+	    (when (eq (svref workers index) thread)
+	      (setq promise (svref (thread-pool-tasks pool) index))
+	      (setf (svref (thread-pool-tasks pool) index) nil)
+	      (unless (thread-pool-shutdown pool)
+		(setf (svref workers index) (start-pool-worker pool index))))))
+	(when promise
+	  (%settle-promise promise :aborted nil))))))
+
+(defun make-thread-pool (&rest thread-options
+			 &key name (size (mkcl:processor-count)) (queue-size 256)
+			 &allow-other-keys)
+  "Starts SIZE worker threads waiting for tasks given by SUBMIT.
+At most QUEUE-SIZE tasks wait for a worker at any time.
+The other keyword arguments, like :CALL-STACK-SIZE or :INITIAL-BINDINGS,
+are passed on to MAKE-THREAD for each worker."
+  (let ((pool (%make-thread-pool (or name "Thread pool") (make-work-queue queue-size)
+				 (loop for (key value) on thread-options by #'cddr
+				       unless (member key '(:name :size :queue-size))
+				       nconc (list key value))
+				 (make-array size)
+				 (make-array size :initial-element nil))))
+    (with-lock ((thread-pool-lock pool))
+      (dotimes (i size pool)
+	(setf (svref (thread-pool-workers pool) i) (start-pool-worker pool i))))))
+
+(defun submit (pool function &rest arguments)
+  "Queues the application of FUNCTION to ARGUMENTS for a worker of POOL.
+Waits while the queue of POOL is full. Returns a promise of the values
+of the application, see FORCE."
+  (when (thread-pool-shutdown pool)
+    (error "~A has been shut down." (thread-pool-name pool)))
+  (let ((promise (make-promise)))
+    (work-queue-put (thread-pool-queue pool) (list* promise function arguments))
+    promise))
+
+(defun shutdown-thread-pool (pool &key (wait t))
+  "Stops the workers of POOL once the tasks already queued are done.
+If WAIT is true, returns only after all the workers have exited."
+  (when (with-lock ((thread-pool-lock pool))
+	  ;; No worker gets replaced from now on.
+	  (unless (thread-pool-shutdown pool)
+	    (setf (thread-pool-shutdown pool) t)))
+    (dotimes (i (length (thread-pool-workers pool)))
+      (work-queue-put (thread-pool-queue pool) nil)))
+  (when wait
+    (map nil #'join-thread (thread-pool-workers pool)))
+  pool)
+
+(defmacro future (pool &body body)
+  "Runs BODY in a worker of POOL and returns a promise of its values."
+  `(submit ,pool #'(lambda () ,@body)))
+
+(export '(make-promise promise-p fulfill-promise promise-fulfilled-p force
+	  make-thread-pool thread-pool-p submit shutdown-thread-pool future))
+
+;;;
+;;; Parallel sequence functions.
+;;;
+;;; The elements of a sequence are split into chunks that the calling thread
+;;; and the workers of a shared thread pool take in turn until none is left,
+;;; so that a thread held up on a slow chunk leaves the others to the rest.
+;;; The calling thread never waits for a worker to become free: it only
+;;; waits for the chunks already taken by others, so these functions can be
+;;; used from within a task of the pool itself.
+;;;
+
+(defvar *parallel-pool* nil)
+(defvar *parallel-pool-lock* (make-lock :name "parallel pool"))
+
+(defvar *parallel-grain* 4096
+  "Least number of elements worth handing over to another thread
+in the parallel sequence functions, PMAP, PREDUCE, PSORT, etc.")
+
+(defvar *parallel-inherited-specials*
+  '(*package* *readtable* *read-base* *read-default-float-format*
+    *print-base* *print-radix* *print-case* *print-escape* *print-readably*
+    *print-pretty* *print-circle* *print-length* *print-level*)
+  "Special variables the workers of the parallel sequence functions see
+bound to their values in the calling thread.")
+
+(defun parallel-pool ()
+  (or *parallel-pool*
+      (with-lock (*parallel-pool-lock*)
+	(or *parallel-pool*
+	    (setq *parallel-pool*
+		  (make-thread-pool :name "Parallel sequence pool"
+				    :size (max 1 (1- (mkcl:processor-count)))))))))
+
+(defun parallel-chunks (length grain function)
+  ;; Calls FUNCTION on the START and END of chunks covering 0 to LENGTH
+  ;; and returns a simple vector of the values of these calls, in order.
+  (let* ((pool (parallel-pool))
+	 (workers (length (thread-pool-workers pool)))
+	 (nb-chunks (max 1 (min (ceiling length grain) (* 4 (1+ workers)))))
+	 (results (make-array nb-chunks))
+	 (runners (make-array nb-chunks :initial-element nil)) ;; Threads at work on the chunks.
+	 (next 0)
+	 (done 0)
+	 (failure nil)
+	 (lock (make-lock :name "parallel chunks"))
+	 (finished (make-semaphore 0))
+	 (specials *parallel-inherited-specials*)
+	 (bindings (mapcar #'symbol-value specials)))
+    (flet ((end-chunk (i failed)
+	     ;; Counts chunk I as done, once, and signals FINISHED after the last one.
+	     (when (with-lock (lock)
+		     (when (svref runners i)
+		       (setf (svref runners i) nil)
+		       (when failed
+			 (unless failure
+			   (setq failure (if (eq failed t)
+					     "A chunk of a parallel operation did not complete."
+					     failed)))
+			 ;; Give up on the chunks nobody took yet.
+			 (incf done (- nb-chunks next))
+			 (setq next nb-chunks))
+		       (= (incf done) nb-chunks)))
+	       (semaphore-signal finished))))
+      (flet ((run-chunks ()
+	       (progv specials bindings
+		 (loop
+		  (let ((i (with-lock (lock)
+			     (when (< next nb-chunks)
+			       (setf (svref runners next) *thread*)
+			       (prog1 next (incf next))))))
+		    (unless i (return))
+		    (let ((failed t))
+		      ;; Counted as done however the chunk is left, lest the caller wait for ever.
+		      (unwind-protect
+			  (handler-case
+			      (progn
+				(setf (svref results i)
+				      (funcall function
+					       (floor (* i length) nb-chunks)
+					       (floor (* (1+ i) length) nb-chunks)))
+				(setq failed nil))
+			    (error (condition) (setq failed condition)))
+			(end-chunk i failed))))))))
+	(let* ((queue (thread-pool-queue pool))
+	       ;; Settling these also signals FINISHED.
+	       (helpers (loop repeat (min workers (1- nb-chunks))
+			      for promise = (%make-promise finished)
+			      while (work-queue-put queue (list promise #'run-chunks) nil)
+			      collect promise)))
+	  (run-chunks)
+	  (loop (semaphore-wait finished)
+		(when (with-lock (lock) (= done nb-chunks))
+		  (return))
+		;; A helper is over with chunks left: a worker killed by
+		;; THREAD-KILL never ends its chunk itself.
+		(dolist (promise helpers)
+		  (let ((worker (%promise-worker promise)))
+		    (when (and worker (eq (%promise-state promise) :aborted))
+		      (dotimes (i nb-chunks)
+			(when (eq (svref runners i) worker)
+			  (end-chunk i t))))))))
+	(when failure
+	  (error failure))
+	results))))
+
+(defun parallel-vector (sequence)
+  (if (vectorp sequence)
+      sequence
+      (coerce sequence 'simple-vector)))
+
+(defun pmap (result-type function sequence &rest more-sequences)
+  "Like MAP, the applications of FUNCTION being spread over several threads
+in no particular order."
+  (let* ((vectors (mapcar #'parallel-vector (cons sequence more-sequences)))
+	 (vector (first vectors))
+	 (length (reduce #'min vectors :key #'length))
+	 (result (make-array length)))
+    (parallel-chunks length *parallel-grain*
+		     (if more-sequences
+			 #'(lambda (start end)
+			     (do ((i start (1+ i)))
+				 ((>= i end))
+			       (setf (svref result i)
+				     (apply function (mapcar #'(lambda (v) (aref v i)) vectors)))))
+			 #'(lambda (start end)
+			     (do ((i start (1+ i)))
+				 ((>= i end))
+			       (setf (svref result i) (funcall function (aref vector i)))))))
+    (and result-type
+	 (coerce result result-type))))
+
+(defun preduce (function sequence &key key (start 0) end
+			 (initial-value nil initial-value-p))
+  "Like REDUCE without :FROM-END, FUNCTION being applied over several threads.
+FUNCTION must be associative, as the elements are combined in chunks."
+  (let* ((vector (parallel-vector sequence))
+	 (end (or end (length vector)))
+	 (length (- end start)))
+    (if (zerop length)
+	(if initial-value-p initial-value (funcall function))
+	(let ((partials (parallel-chunks length *parallel-grain*
+					 #'(lambda (s e)
+					     (reduce function vector :key key
+						     :start (+ start s) :end (+ start e))))))
+	  (if initial-value-p
+	      (reduce function partials :initial-value initial-value)
+	      (reduce function partials))))))
+
+(defun pcount-if (predicate sequence &key key (start 0) end)
+  "Like COUNT-IF without :FROM-END, PREDICATE being applied over several threads."
+  (let* ((vector (parallel-vector sequence))
+	 (end (or end (length vector))))
+    (reduce #'+ (parallel-chunks (- end start) *parallel-grain*
+				 #'(lambda (s e)
+				     (count-if predicate vector :key key
+					       :start (+ start s) :end (+ start e)))))))
+
+(defun pposition-if (predicate sequence &key key (start 0) end)
+  "Like POSITION-IF without :FROM-END, PREDICATE being applied over several threads."
+  (let* ((vector (parallel-vector sequence))
+	 (end (or end (length vector))))
+    (find-if-not #'null (parallel-chunks (- end start) *parallel-grain*
+					 #'(lambda (s e)
+					     (position-if predicate vector :key key
+							  :start (+ start s) :end (+ start e)))))))
+
+(defun premove-if (predicate sequence &key key (start 0) end)
+  "Like REMOVE-IF without :FROM-END nor :COUNT, PREDICATE being applied over
+several threads. Always returns a fresh sequence."
+  (let* ((vector (parallel-vector sequence))
+	 (end (or end (length vector)))
+	 (kept (parallel-chunks (- end start) *parallel-grain*
+				#'(lambda (s e)
+				    (loop for i from (+ start s) below (+ start e)
+					  for x = (aref vector i)
+					  unless (funcall predicate (if key (funcall key x) x))
+					  collect x))))
+	 (elements (nconc (coerce (subseq vector 0 start) 'list)
+			  (reduce #'append kept :from-end t)
+			  (coerce (subseq vector end) 'list))))
+    (if (listp sequence)
+	elements
+	(make-array (length elements)
+		    :element-type (array-element-type sequence)
+		    :initial-contents elements))))
+
+(defun psort (sequence predicate &key key)
+  "Like SORT, chunks of SEQUENCE being sorted then merged over several threads."
+  (let ((runs (let ((vector (coerce sequence 'simple-vector)))
+		(parallel-chunks (length vector) *parallel-grain*
+				 #'(lambda (start end)
+				     (sort (subseq vector start end) predicate :key key))))))
+    (loop while (> (length runs) 1)
+	  do (let ((previous runs))
+	       (setq runs (coerce (reduce #'append
+					  (parallel-chunks (ceiling (length previous) 2) 1
+							   #'(lambda (start end)
+							       (loop for i from (* 2 start) below (* 2 end) by 2
+								     collect (if (< (1+ i) (length previous))
+										 (merge 'simple-vector
+											(svref previous i)
+											(svref previous (1+ i))
+											predicate :key key)
+										 (svref previous i)))))
+					  :from-end t)
+				  'simple-vector))))
+    (replace sequence (svref runs 0))))
+
+(export '(*parallel-grain* *parallel-inherited-specials*
+	  pmap preduce psort pcount-if pposition-if premove-if))
+
+;;;
+;;; Tiered execution.
+;;;
+;;; Once the bytecode interpreter has run a function that closes over nothing
+;;; a given number of times, it passes it to SI::REQUEST-BYTECODE-PROMOTION.
+;;; The function is then compiled by a worker thread and its native version
+;;; installed behind the existing function object by SI:PROMOTE-BYTECODE,
+;;; after which every caller runs native code. See interpreter.c.
+;;;
+
+(defvar *promotion-pool* nil)
+
+(defun promote-hot-bytecode (bytecode)
+  (let ((*standard-output* (make-broadcast-stream))
+	(*error-output* (make-broadcast-stream))
+	(*compile-verbose* nil)
+	(*compile-print* nil))
+    (multiple-value-bind (native warnings-p failure-p)
+	(handler-case (handler-bind ((warning #'muffle-warning))
+			(compile nil bytecode :in-memory t))
+	  (error () (values nil t t)))
+      (declare (ignore warnings-p))
+      (si:promote-bytecode bytecode (unless failure-p native)))))
+
+(defun si::request-bytecode-promotion (bytecode)
+  ;; Called by the interpreter, must neither wait nor signal.
+  ;; Returns NIL if the function could not be queued.
+  (let ((pool *promotion-pool*))
+    (and pool
+	 (not (thread-pool-shutdown pool))
+	 (work-queue-put (thread-pool-queue pool)
+			 (list (make-promise) #'promote-hot-bytecode bytecode)
+			 nil))))
+
+(defun si:start-bytecode-promotion (&key (threshold 1000))
+  "Has the interpreted functions defined at toplevel compiled to native code
+in the background once they have been called THRESHOLD times."
+  (unless *promotion-pool*
+    (setq *promotion-pool* (make-thread-pool :name "Bytecode promotion" :size 1)))
+  (si:set-bytecode-promotion-threshold threshold)
+  threshold)
+
+(defun si:stop-bytecode-promotion ()
+  "Stops counting the calls of interpreted functions. The functions already
+compiled keep running native code."
+  (si:set-bytecode-promotion-threshold 0)
+  nil)
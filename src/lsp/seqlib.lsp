@@ -397,6 +397,45 @@
      (when ,satisfies-the-test (return i))))
 
 
+(defun filter-duplicates (sequence start end from-end key hash-test)
+  ;; REMOVE-DUPLICATES for tests that a hash table of HASH-TEST implements.
+  ;; Each element of the range is checked against the keys of the elements
+  ;; of the range kept so far, in the direction that finds the kept ones first.
+  (declare (fixnum start end))
+  (let* ((elements (if (listp sequence) (coerce sequence 'simple-vector) sequence))
+	 (l (length elements))
+	 (key (and key (si::coerce-to-function key)))
+	 (table (make-hash-table :test hash-test :size (- end start)))
+	 (dups (make-array l :element-type 'bit :initial-element 0))
+	 (n 0))
+    (declare (fixnum l n))
+    (flet ((visit (i)
+	     (declare (fixnum i))
+	     (let* ((x (aref elements i))
+		    (k (if key (funcall key x) x)))
+	       (if (gethash k table)
+		   (setf (sbit dups i) 1 n (1+ n))
+		   (setf (gethash k table) t)))))
+      (if from-end
+	  (do ((i start (1+ i))) ((>= i end)) (declare (fixnum i)) (visit i))
+	  (do ((i (1- end) (1- i))) ((< i start)) (declare (fixnum i)) (visit i))))
+    (if (listp sequence)
+	(do ((i 0 (1+ i))
+	     (ans))
+	    ((>= i l) (nreverse ans))
+	  (declare (fixnum i))
+	  (when (zerop (sbit dups i))
+	    (push (aref elements i) ans)))
+	(do ((newseq (make-sequence (seqtype sequence) (the fixnum (- l n))))
+	     (i 0 (1+ i))
+	     (j 0))
+	    ((>= i l) newseq)
+	  (declare (fixnum i j))
+	  (when (zerop (sbit dups i))
+	    (setf (aref newseq j) (aref elements i))
+	    (incf j))))))
+
+
 (defun remove-duplicates (sequence
                           &key test test-not from-end (start 0) end key)
   "Args: (sequence
@@ -404,7 +443,8 @@
             (start 0) (end (length sequence)) (from-end nil))
 Returns a copy of SEQUENCE without duplicated elements."
   (and test test-not (test-error))
-  (when (and (listp sequence) (not from-end) (zerop #|null|# start) (null end))
+  (when (and (listp sequence) (not from-end) (zerop #|null|# start) (null end)
+             (not (and (nthcdr 32 sequence) (set-hash-test test test-not))))
         (when (endp sequence) (return-from remove-duplicates nil))
         (do ((l sequence (cdr l)) (l1 nil))
             ((endp (cdr l))
@@ -426,6 +466,12 @@ Returns a copy of SEQUENCE without duplicated elements."
                      (start 0) (end (length sequence)) (from-end nil))
 Destructive REMOVE-DUPLICATES.  SEQUENCE may be destroyed."
   (declare (fixnum l))
+  (let ((hash-test (set-hash-test test test-not)))
+    (when hash-test
+      (with-start-end start end sequence
+	(when (> (- end start) 32)
+	  (return-from delete-duplicates
+	    (filter-duplicates sequence start end from-end key hash-test))))))
   (with-tests (test test-not key)
     (when (and (listp sequence) (not from-end) (zerop start) (null end))
       (when (endp sequence) (return-from delete-duplicates nil))
@@ -589,7 +635,7 @@ evaluates to NIL.  See STABLE-SORT."
 	predicate (si::coerce-to-function predicate))
   (if (listp sequence)
       (list-merge-sort sequence predicate key)
-      (quick-sort sequence 0 (the fixnum (length sequence)) predicate key)))
+      (sort-vector sequence predicate key nil)))
 
 
 (defun list-merge-sort (l predicate key)
@@ -644,30 +690,6 @@ evaluates to NIL.  See STABLE-SORT."
      (go loop)))
 
 
-(defun quick-sort (seq start end pred key)
-  (declare (fixnum start end) (function pred key))
-  (if (<= end (the fixnum (1+ start)))
-      seq
-      (let* ((j start) (k end) (d (elt seq start)) (kd (funcall key d)))
-            (declare (fixnum j k))
-        (block outer-loop
-          (loop (loop (decf k)
-                      (unless (< j k) (return-from outer-loop))
-                      (when (funcall pred (funcall key (elt seq k)) kd)
-                            (return)))
-                (loop (incf j)
-                      (unless (< j k) (return-from outer-loop))
-                      (unless (funcall pred (funcall key (elt seq j)) kd)
-                              (return)))
-                (let ((temp (elt seq j)))
-                  (setf (elt seq j) (elt seq k)
-                        (elt seq k) temp))))
-        (setf (elt seq start) (elt seq j)
-              (elt seq j) d)
-        (quick-sort seq start j pred key)
-        (quick-sort seq (1+ j) end pred key))))
-
-
 (defun stable-sort (sequence predicate &key key)
   "Args: (sequence test &key key)
 Destructively sorts SEQUENCE and returns the result.  TEST should return non-
@@ -681,12 +703,7 @@ SEQUENCE.  See SORT."
 	predicate (si::coerce-to-function predicate))
   (if (listp sequence)
       (list-merge-sort sequence predicate key)
-      (if (or (stringp sequence) (bit-vector-p sequence))
-          (sort sequence predicate :key key)
-          (coerce (list-merge-sort (coerce sequence 'list)
-                                   predicate
-                                   key)
-                  (seqtype sequence)))))
+      (sort-vector sequence predicate key t)))
 
 
 (defun merge (result-type sequence1 sequence2 predicate &key key
@@ -0,0 +1,111 @@
+;;;;  -*- Mode: Lisp; Syntax: Common-Lisp; Package: CL-USER -*-
+;;;;
+;;;;  DISPATCH.LSP  -- Dispatch count benchmark of the bytecode interpreter.
+;;;;
+;;;;  Needs an MKCL built with -DMKCL_DISPATCH_STATS, for instance
+;;;;
+;;;;      ./configure CPPFLAGS=-DMKCL_DISPATCH_STATS && make
+;;;;
+;;;;  Run as: mkcl -norc -load dispatch.lsp
+;;;;
+;;;;  The workload is compiled to bytecode twice, with and without
+;;;;  superinstructions, and run once each way. For each run we print the
+;;;;  number of opcode dispatches, the OP_CALLG cache hits and misses and
+;;;;  the run time. Fused pairs run two instructions for one dispatch, so
+;;;;  only the dispatch count differs between the two runs.
+
+(defparameter *workload*
+  '(;; Recursion.
+    (defun bench-fib (n)
+      (if (< n 2) n (+ (bench-fib (- n 1)) (bench-fib (- n 2)))))
+    (defun bench-tak (x y z)
+      (if (not (< y x))
+	  z
+	  (bench-tak (bench-tak (1- x) y z)
+		     (bench-tak (1- y) z x)
+		     (bench-tak (1- z) x y))))
+    ;; List walking.
+    (defun bench-length (l)
+      (let ((n 0))
+	(loop (when (endp l) (return n))
+	   (setq n (1+ n) l (cdr l)))))
+    (defun bench-sum (l)
+      (if (null l) 0 (+ (car l) (bench-sum (cdr l)))))
+    (defun bench-reverse (l)
+      (let ((r nil))
+	(dolist (x l r) (push x r))))
+    (defun bench-filter (pred l)
+      (cond ((null l) nil)
+	    ((funcall pred (car l)) (cons (car l) (bench-filter pred (cdr l))))
+	    (t (bench-filter pred (cdr l)))))
+    (defun bench-lists (n)
+      (let ((l (bench-reverse (loop for i below 200 collect i)))
+	    (total 0))
+	(dotimes (i n total)
+	  (setq total (+ total
+			 (bench-length l)
+			 (bench-sum (bench-filter #'evenp l))
+			 (car (bench-reverse l)))))))
+    ;; Assoc-based rule bodies.
+    (defun bench-lookup (key bindings)
+      (let ((pair (assoc key bindings)))
+	(if pair (cdr pair) :unbound)))
+    (defun bench-variable-p (x)
+      (and (symbolp x) (not (null x)) (char= (char (symbol-name x) 0) #\?)))
+    (defun bench-match (pattern datum bindings)
+      (cond ((eq bindings :fail) :fail)
+	    ((bench-variable-p pattern)
+	     (let ((value (bench-lookup pattern bindings)))
+	       (cond ((eq value :unbound) (acons pattern datum bindings))
+		     ((equal value datum) bindings)
+		     (t :fail))))
+	    ((and (consp pattern) (consp datum))
+	     (bench-match (cdr pattern) (cdr datum)
+			  (bench-match (car pattern) (car datum) bindings)))
+	    ((eql pattern datum) bindings)
+	    (t :fail)))
+    (defun bench-rules (n)
+      (let ((facts '((parent tom bob) (parent bob ann) (parent ann joe)
+		     (parent tom liz) (parent liz pat) (age tom 70)
+		     (age bob 45) (age ann 20) (age joe 2) (age liz 40)))
+	    (count 0))
+	(dotimes (i n count)
+	  (dolist (f1 facts)
+	    (let ((b (bench-match '(parent ?x ?y) f1 nil)))
+	      (unless (eq b :fail)
+		(dolist (f2 facts)
+		  (let ((b2 (bench-match '(parent ?y ?z) f2 b)))
+		    (unless (eq b2 :fail)
+		      (when (numberp (bench-lookup '?z b2))
+			(decf count))
+		      (incf count))))))))))
+    (defun bench-run ()
+      (list (bench-fib 22)
+	    (bench-tak 18 12 6)
+	    (bench-lists 300)
+	    (bench-rules 2000)))))
+
+(defun dispatch-run (superinstructions)
+  (let ((si::*bytecode-superinstructions* superinstructions))
+    (mapc #'eval *workload*))
+  (si::bytecode-dispatch-stats t)
+  (let ((start (get-internal-real-time))
+	(result (funcall 'bench-run)))
+    (multiple-value-bind (dispatches hits misses)
+	(si::bytecode-dispatch-stats t)
+      (format t "~&;;; Superinstructions ~:[off~;on ~]: ~:D dispatches, ~
+                 ~:D OP_CALLG hits, ~:D misses, ~,2F s~%"
+	      superinstructions dispatches hits misses
+	      (/ (- (get-internal-real-time) start)
+		 internal-time-units-per-second))
+      (values dispatches result))))
+
+(if (null (si::bytecode-dispatch-stats nil))
+    (format t "~&;;; This MKCL was not built with -DMKCL_DISPATCH_STATS.~%")
+    (multiple-value-bind (before result-before) (dispatch-run nil)
+      (multiple-value-bind (after result-after) (dispatch-run t)
+	(format t "~&;;; Dispatches saved: ~,1F%~@[ (RESULTS DIFFER)~]~%"
+		(* 100 (/ (- before after) before))
+		(not (equal result-before result-after))))))
+
+(mkcl:quit)
@@ -0,0 +1,36 @@
+;;;;  -*- Mode: Lisp; Syntax: Common-Lisp; Package: CL-USER -*-
+;;;;
+;;;;  TIERTEST.LSP  -- Regression check of the promotion of hot bytecode.
+;;;;
+;;;;  Run as: mkcl -norc -load tiertest.lsp
+;;;;  Exits with status 0 if all went well, 1 otherwise.
+;;;;
+;;;;  A hot function using a constant-name SLOT-VALUE used to take the whole
+;;;;  image down once promoted, libmkcc exiting on an error in code that
+;;;;  MKCL compiles fine with the C compiler.
+
+(defclass tier-point () ((x :initarg :x) (y :initarg :y)))
+
+(defun tier-getx (p) (slot-value p 'x))
+(defun tier-setx (p v) (setf (slot-value p 'x) v))
+
+(defun tier-check ()
+  (let ((p (make-instance 'tier-point :x 5 :y 7))
+	(sum 0))
+    (dotimes (i 100) (incf sum (tier-getx p)))
+    ;; Give the promotion thread the time to compile them.
+    (sleep 5)
+    (dotimes (i 100) (incf sum (tier-getx p)))
+    (tier-setx p 6)
+    (incf sum (tier-getx p))
+    ;; The slot moves, the cached location must not be used any more.
+    (defclass tier-point () ((y :initarg :y) (x :initarg :x)))
+    (incf sum (tier-getx (make-instance 'tier-point :x 3 :y 7)))
+    (= sum (+ 1000 6 3))))
+
+(si:start-bytecode-promotion :threshold 20)
+
+(let ((ok (ignore-errors (tier-check))))
+  (si:stop-bytecode-promotion)
+  (format t "~&;;; Bytecode promotion check ~:[FAILED~;passed~].~%" ok)
+  (mkcl:quit :exit-code (if ok 0 1)))